@@ -0,0 +1,55 @@
+#include "bench.h"
+#include "nm_cpu.h"
+#include <cstring>
+
+namespace bench {
+
+  volatile double sink = 0.0;
+
+}
+
+struct benchGroup {
+  const char* name;
+  void ( *run )();
+};
+
+static const benchGroup c_groups[] = {
+  { "vecmath", bench::vecmath },
+  { "rcp", bench::rcp },
+  { "kernels", bench::kernels },
+  { "reduce", bench::reduce },
+  { "parallel", bench::parallel },
+  { "mat4f", bench::mat4 },
+  { "soa", bench::soa },
+  { "quatf", bench::quat },
+  { "ray", bench::ray },
+  { "bvh", bench::bvh },
+  { "cull", bench::cull },
+  { "broadphase", bench::broadphase },
+  { "biquad", bench::biquads },
+  { "convolve", bench::convolution },
+  { "pcm", bench::pcm },
+  { "channels", bench::channels },
+  { "fft", bench::fourier },
+  { "resample", bench::resampling },
+  { "mix", bench::mixing }
+};
+
+int main( int argc, char* argv[] )
+{
+  const char* isaNames[] = { "nothing", "SSE4.1", "AVX", "AVX2+FMA3" };
+  printf( "nmath benchmarks, compiled for %s, host supports %s\n",
+    isaNames[static_cast<int>( nmath::compiledIsa ) + 1],
+    isaNames[static_cast<int>( nmath::cpu().best() ) + 1] );
+  // run everything, or just the groups named on the command line
+  for ( const auto& group : c_groups )
+  {
+    bool wanted = ( argc < 2 );
+    for ( int i = 1; i < argc; ++i )
+      if ( strcmp( argv[i], group.name ) == 0 )
+        wanted = true;
+    if ( wanted )
+      group.run();
+  }
+  return 0;
+}
@@ -0,0 +1,90 @@
+#ifndef NM_BENCH_H
+#define NM_BENCH_H
+
+#include <chrono>
+#include <cstdio>
+#include <cstddef>
+
+namespace bench {
+
+  using clock = std::chrono::steady_clock;
+
+  //! Keeps results observable so the optimizer can't drop the work
+  extern volatile double sink;
+
+  //! Best-of-runs wall time of fn in nanoseconds
+  template <typename Fn>
+  double measure( Fn&& fn, int runs = 7 )
+  {
+    fn(); // warm up caches & page in buffers
+    double best = 1e300;
+    for ( int i = 0; i < runs; ++i )
+    {
+      const auto start = clock::now();
+      fn();
+      const auto end = clock::now();
+      const double ns = static_cast<double>( std::chrono::duration_cast<std::chrono::nanoseconds>( end - start ).count() );
+      if ( ns < best )
+        best = ns;
+    }
+    return best;
+  }
+
+  //! Print one result line: time per item, throughput and speedup over a baseline time
+  inline void report( const char* name, double ns, double items, double baselineNs = 0.0 )
+  {
+    const double perItem = ns / items;
+    const double rate = items / ns * 1e3;
+    if ( baselineNs > 0.0 )
+      printf( "  %-40s %10.3f ns/item %10.2f M/s %8.2fx\n", name, perItem, rate, baselineNs / ns );
+    else
+      printf( "  %-40s %10.3f ns/item %10.2f M/s\n", name, perItem, rate );
+  }
+
+  //! Print one memory throughput line: bytes moved per second & speedup over a baseline time
+  inline void reportBandwidth( const char* name, double ns, double bytes, double baselineNs = 0.0 )
+  {
+    const double rate = bytes / ns;
+    if ( baselineNs > 0.0 )
+      printf( "  %-40s %10.2f GB/s %8.2fx\n", name, rate, baselineNs / ns );
+    else
+      printf( "  %-40s %10.2f GB/s\n", name, rate );
+  }
+
+  //! Print one transform line: time per call, GFLOPS for flops per call & speedup over a baseline time
+  inline void reportFlops( const char* name, double ns, double flops, double baselineNs = 0.0 )
+  {
+    if ( baselineNs > 0.0 )
+      printf( "  %-40s %10.0f ns %10.2f GFLOPS %8.2fx\n", name, ns, flops / ns, baselineNs / ns );
+    else
+      printf( "  %-40s %10.0f ns %10.2f GFLOPS\n", name, ns, flops / ns );
+  }
+
+  inline void header( const char* group )
+  {
+    printf( "\n%s\n", group );
+  }
+
+  void vecmath();
+  void rcp();
+  void kernels();
+  void reduce();
+  void parallel();
+  void mat4();
+  void soa();
+  void quat();
+  void ray();
+  void bvh();
+  void cull();
+  void broadphase();
+  void biquads();
+  void convolution();
+  void pcm();
+  void channels();
+  void fourier();
+  void resampling();
+  void mixing();
+
+}
+
+#endif
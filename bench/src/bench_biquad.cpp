@@ -0,0 +1,129 @@
+#include "bench.h"
+#include "nm_biquad.h"
+#include <vector>
+
+using namespace nmath;
+
+namespace bench {
+
+  // frames per processing block
+  static constexpr size_t c_frames = 4096;
+
+  //! What the bank replaces: one channel after the other through its own biquad
+  template <typename S>
+  static void scalarBiquad( const biquad& c, S& z1, S& z2, const S* in, S* out, const size_t count, const size_t stride )
+  {
+    const S b0 = static_cast<S>( c.b0 ), b1 = static_cast<S>( c.b1 ), b2 = static_cast<S>( c.b2 ), a1 = static_cast<S>( c.a1 ), a2 = static_cast<S>( c.a2 );
+    for ( size_t n = 0; n < count; ++n )
+    {
+      const S x = in[n * stride];
+      const S y = b0 * x + z1;
+      z1 = b1 * x - a1 * y + z2;
+      z2 = b2 * x - a2 * y;
+      out[n * stride] = y;
+    }
+  }
+
+  template <typename V>
+  static void bank( const char* name, const char* scalarName )
+  {
+    using S = typename biquadBank<V>::scalar;
+    const int channels = biquadBank<V>::channels;
+    std::vector<S> frames( c_frames * channels );
+    for ( size_t i = 0; i < frames.size(); ++i )
+      frames[i] = static_cast<S>( ( i * 7919 ) % 1000 ) * S( 0.001 ) - S( 0.5 );
+    biquad designs[8];
+    for ( int c = 0; c < channels; ++c )
+      designs[c] = biquad::peak( 48000.0, 100.0 * ( c + 1 ), 1.0, 3.0 );
+    const double items = static_cast<double>( frames.size() );
+
+    S z[16] = {};
+    const auto scalar = measure( [&]()
+    {
+      for ( int c = 0; c < channels; ++c )
+        scalarBiquad( designs[c], z[2 * c], z[2 * c + 1], frames.data() + c, frames.data() + c, c_frames, channels );
+      sink = frames[0];
+    } );
+    report( scalarName, scalar, items );
+    biquadBank<V> filters;
+    for ( int c = 0; c < channels; ++c )
+      filters.set( c, designs[c], false );
+    const auto simd = measure( [&]()
+    {
+      filters.process( frames.data(), frames.data(), c_frames );
+      sink = frames[0];
+    } );
+    report( name, simd, items, scalar );
+  }
+
+  template <typename V>
+  static void cascade( const char* name, const size_t sections, double scalar )
+  {
+    using S = typename biquadCascade<V>::scalar;
+    std::vector<S> samples( c_frames );
+    for ( size_t i = 0; i < samples.size(); ++i )
+      samples[i] = static_cast<S>( ( i * 7919 ) % 1000 ) * S( 0.001 ) - S( 0.5 );
+    biquadCascade<V> filters( sections );
+    for ( size_t k = 0; k < sections; ++k )
+      filters.set( k, biquad::lowpass( 48000.0, 8000.0 + 100.0 * k, 0.6 ), false );
+    const auto simd = measure( [&]()
+    {
+      filters.process( samples.data(), samples.data(), c_frames );
+      sink = samples[0];
+    } );
+    report( name, simd, static_cast<double>( c_frames ), scalar );
+  }
+
+  //! Scalar time for a cascade of sections on one float channel, a section at a time
+  static double scalarCascade( const size_t sections )
+  {
+    std::vector<float> samples( c_frames );
+    for ( size_t i = 0; i < samples.size(); ++i )
+      samples[i] = static_cast<float>( ( i * 7919 ) % 1000 ) * 0.001f - 0.5f;
+    std::vector<biquad> designs( sections );
+    for ( size_t k = 0; k < sections; ++k )
+      designs[k] = biquad::lowpass( 48000.0, 8000.0 + 100.0 * k, 0.6 );
+    std::vector<float> z( 2 * sections );
+    return measure( [&]()
+    {
+      for ( size_t k = 0; k < sections; ++k )
+        scalarBiquad( designs[k], z[2 * k], z[2 * k + 1], samples.data(), samples.data(), c_frames, 1 );
+      sink = samples[0];
+    } );
+  }
+
+  void biquads()
+  {
+    header( "biquad filter banks, samples per second over all channels" );
+    bank<vec4f>( "biquadBank<vec4f>, 4 channels", "scalar float, 4 channels" );
+    bank<vec8f>( "biquadBank<vec8f>, 8 channels", "scalar float, 8 channels" );
+    bank<vec4d>( "biquadBank<vec4d>, 4 channels", "scalar double, 4 channels" );
+    {
+      // gliding costs five more multiply-adds per frame while it lasts
+      std::vector<float> frames( c_frames * 8, 0.25f );
+      biquadBank<vec8f> filters;
+      filters.glideTime( 1e6 );
+      const auto glide = measure( [&]()
+      {
+        filters.setAll( biquad::lowpass( 48000.0, 500.0 ) );
+        filters.process( frames.data(), frames.data(), c_frames );
+        sink = frames[0];
+      } );
+      report( "biquadBank<vec8f>, gliding", glide, static_cast<double>( frames.size() ) );
+    }
+
+    header( "biquad cascades, samples per second of one channel" );
+    for ( size_t sections : { size_t( 4 ), size_t( 8 ), size_t( 16 ) } )
+    {
+      const double scalar = scalarCascade( sections );
+      char label[64];
+      snprintf( label, sizeof( label ), "scalar float, %zu sections", sections );
+      report( label, scalar, static_cast<double>( c_frames ) );
+      snprintf( label, sizeof( label ), "biquadCascade<vec4f>, %zu sections", sections );
+      cascade<vec4f>( label, sections, scalar );
+      snprintf( label, sizeof( label ), "biquadCascade<vec8f>, %zu sections", sections );
+      cascade<vec8f>( label, sections, scalar );
+    }
+  }
+
+}
@@ -0,0 +1,125 @@
+#include "bench.h"
+#include "nm_broadphase.h"
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+using namespace nmath;
+
+namespace bench {
+
+  //! What the broadphase replaces: sort along x every frame, then scalar pairwise tests
+  static size_t scalarSweep( const soa3f& lo, const soa3f& hi, std::vector<uint32_t>& order, bodyPair* pairs, const size_t capacity )
+  {
+    const size_t count = lo.size();
+    order.resize( count );
+    for ( size_t i = 0; i < count; ++i )
+      order[i] = static_cast<uint32_t>( i );
+    std::sort( order.begin(), order.end(), [&]( uint32_t a, uint32_t b ) { return lo.x[a] < lo.x[b]; } );
+    size_t found = 0;
+    for ( size_t i = 0; i < count; ++i )
+    {
+      const uint32_t a = order[i];
+      for ( size_t j = i + 1; j < count && lo.x[order[j]] <= hi.x[a]; ++j )
+      {
+        const uint32_t b = order[j];
+        if ( lo.y[a] <= hi.y[b] && lo.y[b] <= hi.y[a] && lo.z[a] <= hi.z[b] && lo.z[b] <= hi.z[a] )
+        {
+          if ( found < capacity )
+            pairs[found] = { std::min( a, b ), std::max( a, b ) };
+          ++found;
+        }
+      }
+    }
+    return found;
+  }
+
+  //! Times the broadphase over count boxes of size 0.5 to 1.5. Sparse scenes spread
+  //! them over a thin slab, so boxes overlap few others along x; dense ones pack
+  //! them into a cube, where the x ranges of thousands of boxes overlap.
+  static void scene( const size_t count, const bool dense )
+  {
+    const float side = dense ? std::cbrt( static_cast<float>( count ) * 2.0f ) : std::sqrt( static_cast<float>( count ) * 4.0f );
+    const float depth = dense ? side : 8.0f;
+    soa3f lo( count ), hi( count );
+    uint32_t seed = 3;
+    auto next = [&]() { seed = seed * 1664525u + 1013904223u; return static_cast<float>( seed >> 8 ) / 16777216.0f; };
+    for ( size_t i = 0; i < count; ++i )
+    {
+      const float size = 0.5f + next();
+      lo.x[i] = side * next();
+      lo.y[i] = side * next();
+      lo.z[i] = depth * next();
+      hi.x[i] = lo.x[i] + size;
+      hi.y[i] = lo.y[i] + size;
+      hi.z[i] = lo.z[i] + size;
+    }
+    std::vector<bodyPair> pairs( 4 * count );
+    std::vector<uint32_t> order;
+    const double items = static_cast<double>( count );
+    // sweeping dense scenes grows with the square of the count
+    const bool sweep = !dense || count <= 100000;
+
+    size_t found = 0;
+    uniformGrid grid( 2.0f );
+    const auto cells = measure( [&]()
+    {
+      found = grid.findPairs( lo, hi, pairs.data(), pairs.size() );
+      sink = static_cast<double>( found );
+    }, 3 );
+    printf( "    %zu bodies, %s, %zu pairs\n", count, dense ? "dense" : "sparse", found );
+    double scalar = 0.0;
+    if ( sweep )
+    {
+      scalar = measure( [&]()
+      {
+        sink = static_cast<double>( scalarSweep( lo, hi, order, pairs.data(), pairs.size() ) );
+      }, dense ? 1 : 3 );
+      report( "scalar sort & sweep", scalar, items );
+    }
+    if ( count <= 10000 )
+    {
+      const auto brute = measure( [&]()
+      {
+        size_t n = 0;
+        for ( size_t a = 0; a < count; ++a )
+          for ( size_t b = a + 1; b < count; ++b )
+            n += ( lo.x[a] <= hi.x[b] ) & ( lo.x[b] <= hi.x[a] ) & ( lo.y[a] <= hi.y[b] ) & ( lo.y[b] <= hi.y[a] ) & ( lo.z[a] <= hi.z[b] ) & ( lo.z[b] <= hi.z[a] );
+        sink = static_cast<double>( n );
+      }, 1 );
+      report( "scalar all pairs", brute, items, scalar );
+    }
+    if ( sweep )
+    {
+      sweepAndPrune sap;
+      const auto cold = measure( [&]()
+      {
+        sap.reset();
+        sink = static_cast<double>( sap.findPairs( lo, hi, pairs.data(), pairs.size() ) );
+      }, dense ? 1 : 3 );
+      report( "sweepAndPrune, from scratch", cold, items, scalar );
+      // bodies drifting a little every frame, as in a running simulation
+      const auto coherent = measure( [&]()
+      {
+        for ( size_t i = 0; i < count; i += 7 )
+        {
+          const float dx = 0.02f * next() - 0.01f;
+          lo.x[i] += dx;
+          hi.x[i] += dx;
+        }
+        sink = static_cast<double>( sap.findPairs( lo, hi, pairs.data(), pairs.size() ) );
+      }, 3 );
+      report( "sweepAndPrune, next frame", coherent, items, scalar );
+    }
+    report( "uniformGrid", cells, items, scalar );
+  }
+
+  void broadphase()
+  {
+    header( "broadphase" );
+    for ( const bool dense : { false, true } )
+      for ( size_t count : { size_t( 10000 ), size_t( 100000 ), size_t( 1000000 ) } )
+        scene( count, dense );
+  }
+
+}
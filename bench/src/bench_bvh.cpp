@@ -0,0 +1,130 @@
+#include "bench.h"
+#include "nm_bvh.h"
+#include <vector>
+#include <cmath>
+#include <bit>
+
+using namespace nmath;
+
+namespace bench {
+
+  // height field of 2 * 512 * 512 triangles
+  static constexpr uint32_t c_grid = 512;
+  static constexpr size_t c_rays = 1 << 18;
+
+  void bvh()
+  {
+    header( "bvh8 over a height field mesh" );
+    std::vector<float> vertices;
+    std::vector<uint32_t> indices;
+    for ( uint32_t y = 0; y <= c_grid; ++y )
+      for ( uint32_t x = 0; x <= c_grid; ++x )
+      {
+        vertices.push_back( static_cast<float>( x ) );
+        vertices.push_back( static_cast<float>( y ) );
+        vertices.push_back( 8.0f * std::sin( 0.05f * x ) * std::cos( 0.037f * y ) + std::sin( 0.9f * x + 0.4f * y ) );
+      }
+    for ( uint32_t y = 0; y < c_grid; ++y )
+      for ( uint32_t x = 0; x < c_grid; ++x )
+      {
+        const uint32_t i = y * ( c_grid + 1 ) + x;
+        indices.insert( indices.end(), { i, i + 1, i + c_grid + 1, i + 1, i + c_grid + 2, i + c_grid + 1 } );
+      }
+    const size_t triangles = indices.size() / 3;
+    printf( " %zu triangles\n", triangles );
+
+    bvh8 tree;
+    const auto serial = measure( [&]() { tree.build( vertices.data(), indices.data(), triangles ); }, 3 );
+    report( "build, one thread", serial, static_cast<double>( triangles ) );
+    threadpool pool;
+    const auto parallel = measure( [&]() { tree.build( vertices.data(), indices.data(), triangles, &pool ); }, 3 );
+    char label[64];
+    snprintf( label, sizeof( label ), "build, %zu threads", pool.size() );
+    report( label, parallel, static_cast<double>( triangles ), serial );
+    printf( "    %zu nodes, %zu leaves\n", tree.nodeCount(), tree.leafCount() );
+
+    // slanted rays from above the field, on a regular grid
+    std::vector<rayf> rays( c_rays );
+    const uint32_t side = static_cast<uint32_t>( std::sqrt( static_cast<double>( c_rays ) ) );
+    for ( size_t i = 0; i < c_rays; ++i )
+    {
+      const float u = static_cast<float>( i % side ) / side, v = static_cast<float>( i / side ) / side;
+      rays[i] = { { u * c_grid, v * c_grid, 20.0f }, { 0.3f * ( u - 0.5f ), 0.2f, -1.0f } };
+    }
+
+    // a brute force search over all triangles, eight at a time, for a few rays
+    const size_t bruteRays = 8;
+    const auto brute = measure( [&]()
+    {
+      float total = 0.0f;
+      for ( size_t r = 0; r < bruteRays; ++r )
+      {
+        const auto packet = ray8f::splat( rays[r * 997] );
+        float nearest = std::numeric_limits<float>::infinity();
+        for ( size_t first = 0; first + 8 <= triangles; first += 8 )
+        {
+          tri8f tris;
+          for ( int k = 0; k < 8; ++k )
+          {
+            const uint32_t* tri = &indices[3 * ( first + k )];
+            tris.set( k, &vertices[3 * tri[0]], &vertices[3 * tri[1]], &vertices[3 * tri[2]] );
+          }
+          vec8f t, u, v;
+          for ( int mask = intersect( packet, tris, t, u, v ); mask; mask &= mask - 1 )
+            nearest = std::min( nearest, reinterpret_cast<const float*>( &t )[std::countr_zero( static_cast<unsigned>( mask ) )] );
+        }
+        total += nearest;
+      }
+      sink = total;
+    }, 1 );
+    report( "brute force closest hit", brute, static_cast<double>( bruteRays ) );
+    const auto closest = measure( [&]()
+    {
+      float total = 0.0f;
+      rayhit hit;
+      for ( const auto& ray : rays )
+        if ( tree.intersect( ray, hit ) )
+          total += hit.t;
+      sink = total;
+    }, 3 );
+    report( "bvh8 closest hit", closest, static_cast<double>( c_rays ), brute / bruteRays * c_rays );
+    const auto shadow = measure( [&]()
+    {
+      size_t blocked = 0;
+      for ( const auto& ray : rays )
+        blocked += tree.occluded( ray );
+      sink = static_cast<double>( blocked );
+    }, 3 );
+    report( "bvh8 occluded", shadow, static_cast<double>( c_rays ), brute / bruteRays * c_rays );
+    // the same rays as packets of 4 x 2 neighbours on the grid, the way a
+    // renderer traces tiles of pixels
+    std::vector<ray8f> packets;
+    for ( uint32_t y = 0; y + 2 <= side; y += 2 )
+      for ( uint32_t x = 0; x + 4 <= side; x += 4 )
+      {
+        rayf tile[8];
+        for ( uint32_t k = 0; k < 8; ++k )
+          tile[k] = rays[( y + k / 4 ) * side + x + k % 4];
+        packets.push_back( ray8f::gather( tile ) );
+      }
+    const auto packetClosest = measure( [&]()
+    {
+      float total = 0.0f;
+      rayhit hits[8];
+      for ( const auto& packet : packets )
+        for ( int mask = tree.intersect( packet, hits ); mask; mask &= mask - 1 )
+          total += hits[std::countr_zero( static_cast<unsigned>( mask ) )].t;
+      sink = total;
+    }, 3 );
+    report( "bvh8 closest hit, 4 x 2 packets", packetClosest, static_cast<double>( 8 * packets.size() ), closest );
+    const auto packetShadow = measure( [&]()
+    {
+      size_t blocked = 0;
+      for ( const auto& packet : packets )
+        blocked += std::popcount( static_cast<unsigned>( tree.occluded( packet ) ) );
+      sink = static_cast<double>( blocked );
+    }, 3 );
+    report( "bvh8 occluded, 4 x 2 packets", packetShadow, static_cast<double>( 8 * packets.size() ), shadow );
+  }
+
+}
@@ -0,0 +1,117 @@
+#include "bench.h"
+#include "nm_channels.h"
+#include <cstring>
+#include <vector>
+
+using namespace nmath;
+
+namespace bench {
+
+  // frames per block, a typical audio callback at the large end
+  static constexpr size_t c_frames = 2048;
+
+  void channels()
+  {
+    header( "interleaved <-> planar, bytes read & written per second" );
+    for ( size_t channels : { size_t( 2 ), size_t( 4 ), size_t( 6 ), size_t( 8 ) } )
+    {
+      std::vector<float> frames( channels * c_frames ), copy( channels * c_frames );
+      for ( size_t i = 0; i < frames.size(); ++i )
+        frames[i] = static_cast<float>( i );
+      std::vector<buffer<float>> planes( channels, buffer<float>( c_frames ) );
+      std::vector<float*> planar;
+      for ( auto& p : planes )
+        planar.push_back( p.data() );
+      const double bytes = 2.0 * static_cast<double>( frames.size() * sizeof( float ) );
+      char label[64];
+
+      const auto memcpyNs = measure( [&]()
+      {
+        memcpy( copy.data(), frames.data(), frames.size() * sizeof( float ) );
+        sink = copy[0];
+      } );
+      snprintf( label, sizeof( label ), "memcpy, %zu channels of frames", channels );
+      reportBandwidth( label, memcpyNs, bytes );
+      const auto scalar = measure( [&]()
+      {
+        for ( size_t i = 0; i < c_frames; ++i )
+          for ( size_t c = 0; c < channels; ++c )
+            planar[c][i] = frames[channels * i + c];
+        sink = planar[0][0];
+      } );
+      snprintf( label, sizeof( label ), "scalar deinterleave, %zu channels", channels );
+      reportBandwidth( label, scalar, bytes );
+      const auto split = measure( [&]()
+      {
+        deinterleave( frames.data(), planar.data(), channels, c_frames );
+        sink = planar[0][0];
+      } );
+      snprintf( label, sizeof( label ), "deinterleave, %zu channels", channels );
+      reportBandwidth( label, split, bytes, scalar );
+      const auto scalarJoin = measure( [&]()
+      {
+        for ( size_t i = 0; i < c_frames; ++i )
+          for ( size_t c = 0; c < channels; ++c )
+            frames[channels * i + c] = planar[c][i];
+        sink = frames[0];
+      } );
+      snprintf( label, sizeof( label ), "scalar interleave, %zu channels", channels );
+      reportBandwidth( label, scalarJoin, bytes );
+      const auto join = measure( [&]()
+      {
+        interleave( planar.data(), frames.data(), channels, c_frames );
+        sink = frames[0];
+      } );
+      snprintf( label, sizeof( label ), "interleave, %zu channels", channels );
+      reportBandwidth( label, join, bytes, scalarJoin );
+    }
+
+    header( "splat & remix, frames per second" );
+    {
+      std::vector<float> mono( c_frames ), stereo( 2 * c_frames ), surround( 6 * c_frames );
+      for ( size_t i = 0; i < c_frames; ++i )
+        mono[i] = static_cast<float>( i ) * 0.001f;
+      const double items = static_cast<double>( c_frames );
+      for ( size_t channels : { size_t( 2 ), size_t( 6 ) } )
+      {
+        const auto scalar = measure( [&]()
+        {
+          for ( size_t i = 0; i < c_frames; ++i )
+            for ( size_t c = 0; c < channels; ++c )
+              surround[channels * i + c] = mono[i];
+          sink = surround[0];
+        } );
+        char label[64];
+        snprintf( label, sizeof( label ), "scalar mono to %zu channels", channels );
+        report( label, scalar, items );
+        const auto simd = measure( [&]()
+        {
+          splat( mono.data(), surround.data(), channels, c_frames );
+          sink = surround[0];
+        } );
+        snprintf( label, sizeof( label ), "splat, mono to %zu channels", channels );
+        report( label, simd, items, scalar );
+      }
+      splat( mono.data(), stereo.data(), 2, c_frames );
+      // stereo to 5.1: L & R to the fronts & surrounds, their average to center
+      const float gains[12] = { 1.0f, 0.0f, 0.0f, 1.0f, 0.5f, 0.5f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f };
+      const auto scalar = measure( [&]()
+      {
+        for ( size_t i = 0; i < c_frames; ++i )
+        {
+          for ( size_t o = 0; o < 6; ++o )
+            surround[6 * i + o] = gains[2 * o] * stereo[2 * i] + gains[2 * o + 1] * stereo[2 * i + 1];
+        }
+        sink = surround[0];
+      } );
+      report( "scalar stereo to 5.1", scalar, items );
+      const auto simd = measure( [&]()
+      {
+        remix( stereo.data(), 2, surround.data(), 6, gains, c_frames );
+        sink = surround[0];
+      } );
+      report( "remix, stereo to 5.1", simd, items, scalar );
+    }
+  }
+
+}
@@ -0,0 +1,78 @@
+#include "bench.h"
+#include "nm_convolve.h"
+#include <vector>
+
+using namespace nmath;
+
+namespace bench {
+
+  // samples per block, the convolver's latency
+  static constexpr size_t c_block = 256;
+  // blocks per measurement
+  static constexpr size_t c_blocks = 16;
+
+  //! What the kernels replace: the convolution sum one output at a time
+  static void scalarFir( const float* taps, const size_t count, const float* line, float* out, const size_t samples )
+  {
+    // line holds count - 1 samples of history before the input
+    for ( size_t n = 0; n < samples; ++n )
+    {
+      float sum = 0.0f;
+      for ( size_t k = 0; k < count; ++k )
+        sum += taps[k] * line[n + count - 1 - k];
+      out[n] = sum;
+    }
+  }
+
+  void convolution()
+  {
+    const size_t samples = c_block * c_blocks;
+    std::vector<float> input( samples ), output( samples );
+    for ( size_t i = 0; i < samples; ++i )
+      input[i] = static_cast<float>( ( i * 7919 ) % 1000 ) * 0.001f - 0.5f;
+
+    char title[96];
+    snprintf( title, sizeof( title ), "FIR & partitioned FFT convolution, time per block of %zu samples", c_block );
+    header( title );
+    for ( size_t taps = 16; taps <= ( size_t( 1 ) << 20 ); taps *= 4 )
+    {
+      std::vector<float> kernel( taps );
+      for ( size_t k = 0; k < taps; ++k )
+        kernel[k] = static_cast<float>( ( k * 104729 ) % 2000 ) * 0.0005f - 0.5f;
+      char label[64];
+      double scalar = 0.0;
+      // direct convolution is quadratic, so long kernels are left to the convolver
+      if ( taps <= 16384 )
+      {
+        std::vector<float> line( taps - 1 + samples );
+        std::copy( input.begin(), input.end(), line.begin() + static_cast<std::ptrdiff_t>( taps - 1 ) );
+        scalar = measure( [&]()
+        {
+          scalarFir( kernel.data(), taps, line.data(), output.data(), samples );
+          sink = output[0];
+        }, 3 );
+        snprintf( label, sizeof( label ), "scalar FIR, %zu taps", taps );
+        report( label, scalar, c_blocks );
+
+        firFilter fir( kernel.data(), taps );
+        const auto direct = measure( [&]()
+        {
+          fir.process( input.data(), output.data(), samples );
+          sink = output[0];
+        }, 3 );
+        snprintf( label, sizeof( label ), "firFilter, %zu taps", taps );
+        report( label, direct, c_blocks, scalar );
+      }
+      convolver reverb( kernel.data(), taps, c_block );
+      const auto fft = measure( [&]()
+      {
+        for ( size_t b = 0; b < c_blocks; ++b )
+          reverb.process( input.data() + b * c_block, output.data() + b * c_block, c_block );
+        sink = output[0];
+      }, 3 );
+      snprintf( label, sizeof( label ), "convolver, %zu taps", taps );
+      report( label, fft, c_blocks, scalar );
+    }
+  }
+
+}
@@ -0,0 +1,87 @@
+#include "bench.h"
+#include "nm_cull.h"
+#include <vector>
+#include <cmath>
+
+using namespace nmath;
+
+namespace bench {
+
+  // objects culled per frame
+  static constexpr size_t c_objects = 500000;
+
+  //! What the batch cull replaces: six dot products per object, out at the first plane missed
+  static size_t scalarCull( const frustumf& f, const float* x, const float* y, const float* z, const float* r,
+    const size_t count, uint32_t* visible )
+  {
+    size_t n = 0;
+    for ( size_t i = 0; i < count; ++i )
+    {
+      bool inside = true;
+      for ( int p = 0; p < 6 && inside; ++p )
+        inside = f.planes[p].x * x[i] + f.planes[p].y * y[i] + f.planes[p].z * z[i] + f.planes[p].w >= -r[i];
+      if ( inside )
+        visible[n++] = static_cast<uint32_t>( i );
+    }
+    return n;
+  }
+
+  void cull()
+  {
+    header( "frustum culling" );
+    // a 90 degree perspective looking down -z from the middle of a field of objects,
+    // which keeps roughly a fifth of them
+    const float nearZ = 0.5f, farZ = 200.0f;
+    const mat4f projection(
+      vec4f( 1.0f, 0.0f, 0.0f, 0.0f ),
+      vec4f( 0.0f, 1.0f, 0.0f, 0.0f ),
+      vec4f( 0.0f, 0.0f, farZ / ( nearZ - farZ ), -1.0f ),
+      vec4f( 0.0f, 0.0f, nearZ * farZ / ( nearZ - farZ ), 0.0f ) );
+    const auto frustum = frustumf::fromMatrix( projection );
+    soa4f spheres( c_objects );
+    soa3f extents( c_objects );
+    uint32_t seed = 1;
+    auto next = [&]() { seed = seed * 1664525u + 1013904223u; return static_cast<float>( seed >> 8 ) / 16777216.0f; };
+    for ( size_t i = 0; i < c_objects; ++i )
+    {
+      spheres.x[i] = 400.0f * next() - 200.0f;
+      spheres.y[i] = 400.0f * next() - 200.0f;
+      spheres.z[i] = 400.0f * next() - 200.0f;
+      spheres.w[i] = 2.0f * next();
+      extents.x[i] = extents.y[i] = extents.z[i] = 0.577f * spheres.w[i];
+    }
+    soa3f centers( c_objects );
+    std::copy( spheres.x.begin(), spheres.x.end(), centers.x.begin() );
+    std::copy( spheres.y.begin(), spheres.y.end(), centers.y.begin() );
+    std::copy( spheres.z.begin(), spheres.z.end(), centers.z.begin() );
+    std::vector<uint32_t> visible( c_objects );
+    std::vector<uint8_t> bits( ( c_objects + 7 ) / 8 );
+    const double items = static_cast<double>( c_objects );
+
+    size_t kept = 0;
+    const auto scalar = measure( [&]()
+    {
+      kept = scalarCull( frustum, spheres.x.data(), spheres.y.data(), spheres.z.data(), spheres.w.data(), c_objects, visible.data() );
+      sink = static_cast<double>( kept );
+    } );
+    printf( "    %zu of %zu visible\n", kept, c_objects );
+    report( "scalar spheres, early out", scalar, items );
+    const auto indices = measure( [&]()
+    {
+      sink = static_cast<double>( cullSpheres( frustum, spheres, visible.data() ) );
+    } );
+    report( "cullSpheres, index list", indices, items, scalar );
+    const auto mask = measure( [&]()
+    {
+      cullSpheresMask( frustum, spheres.x.data(), spheres.y.data(), spheres.z.data(), spheres.w.data(), c_objects, bits.data() );
+      sink = bits[c_objects / 16];
+    } );
+    report( "cullSpheresMask, bitmask", mask, items, scalar );
+    const auto boxes = measure( [&]()
+    {
+      sink = static_cast<double>( cullBoxes( frustum, centers, extents, visible.data() ) );
+    } );
+    report( "cullBoxes, index list", boxes, items, scalar );
+  }
+
+}
@@ -0,0 +1,133 @@
+#include "bench.h"
+#include "nm_fft.h"
+#include <cmath>
+#include <vector>
+
+using namespace nmath;
+
+namespace bench {
+
+  //! What the transforms replace: an in-place radix 2 FFT on interleaved complex
+  //! values, bit reversal first & a table of twiddles
+  template <typename S>
+  class scalarFft {
+  private:
+    size_t size_;
+    std::vector<S> twiddles_;
+  public:
+    explicit scalarFft( const size_t size ): size_( size ), twiddles_( size )
+    {
+      for ( size_t k = 0; k < size / 2; ++k )
+      {
+        twiddles_[2 * k] = static_cast<S>( std::cos( -2.0 * 3.14159265358979323846 * static_cast<double>( k ) / static_cast<double>( size ) ) );
+        twiddles_[2 * k + 1] = static_cast<S>( std::sin( -2.0 * 3.14159265358979323846 * static_cast<double>( k ) / static_cast<double>( size ) ) );
+      }
+    }
+    void forward( S* x ) const
+    {
+      for ( size_t i = 1, j = 0; i < size_; ++i )
+      {
+        size_t bit = size_ >> 1;
+        for ( ; j & bit; bit >>= 1 )
+          j ^= bit;
+        j |= bit;
+        if ( i < j )
+        {
+          std::swap( x[2 * i], x[2 * j] );
+          std::swap( x[2 * i + 1], x[2 * j + 1] );
+        }
+      }
+      for ( size_t half = 1; half < size_; half *= 2 )
+      {
+        const size_t step = size_ / ( 2 * half );
+        for ( size_t block = 0; block < size_; block += 2 * half )
+        {
+          for ( size_t k = 0; k < half; ++k )
+          {
+            const S wr = twiddles_[2 * k * step], wi = twiddles_[2 * k * step + 1];
+            S* a = x + 2 * ( block + k );
+            S* b = a + 2 * half;
+            const S br = b[0] * wr - b[1] * wi, bi = b[0] * wi + b[1] * wr;
+            b[0] = a[0] - br;
+            b[1] = a[1] - bi;
+            a[0] += br;
+            a[1] += bi;
+          }
+        }
+      }
+    }
+  };
+
+  //! Points transformed per measurement, so that small sizes run many times
+  static constexpr size_t c_points = size_t( 1 ) << 20;
+
+  template <typename V>
+  static void transforms( const char* name )
+  {
+    using scalar = typename fft<V>::scalar;
+    char title[96];
+    snprintf( title, sizeof( title ), "%s, time per transform & GFLOPS at 5 n log2 n (2.5 for real)", name );
+    header( title );
+    for ( size_t size = 16; size <= ( size_t( 1 ) << 22 ); size *= 4 )
+    {
+      const size_t reps = std::max<size_t>( c_points / size, 1 );
+      const int runs = size >= ( size_t( 1 ) << 20 ) ? 3 : 7;
+      const double flops = 5.0 * static_cast<double>( size ) * std::log2( static_cast<double>( size ) );
+      std::vector<scalar> re( size ), im( size ), interleaved( 2 * size );
+      for ( size_t i = 0; i < size; ++i )
+      {
+        re[i] = static_cast<scalar>( ( i * 7919 ) % 1000 ) * scalar( 0.001 ) - scalar( 0.5 );
+        im[i] = static_cast<scalar>( ( i * 104729 ) % 1000 ) * scalar( 0.001 ) - scalar( 0.5 );
+        interleaved[2 * i] = re[i];
+        interleaved[2 * i + 1] = im[i];
+      }
+      char label[64];
+      scalarFft<scalar> reference( size );
+      const auto scalar2 = measure( [&]()
+      {
+        for ( size_t r = 0; r < reps; ++r )
+          reference.forward( interleaved.data() );
+        sink = interleaved[0];
+      }, runs ) / static_cast<double>( reps );
+      snprintf( label, sizeof( label ), "scalar radix 2, %zu points", size );
+      reportFlops( label, scalar2, flops );
+
+      fft<V> complex( size );
+      std::vector<scalar> outRe( size ), outIm( size );
+      const auto outOfPlace = measure( [&]()
+      {
+        for ( size_t r = 0; r < reps; ++r )
+          complex.forward( re.data(), im.data(), outRe.data(), outIm.data() );
+        sink = outRe[0];
+      }, runs ) / static_cast<double>( reps );
+      snprintf( label, sizeof( label ), "complex, %zu points", size );
+      reportFlops( label, outOfPlace, flops, scalar2 );
+      const auto inPlace = measure( [&]()
+      {
+        for ( size_t r = 0; r < reps; ++r )
+          complex.forward( outRe.data(), outIm.data(), outRe.data(), outIm.data() );
+        sink = outRe[0];
+      }, runs ) / static_cast<double>( reps );
+      snprintf( label, sizeof( label ), "complex in place, %zu points", size );
+      reportFlops( label, inPlace, flops, scalar2 );
+
+      realFft<V> real( size );
+      std::vector<scalar> binsRe( real.bins() ), binsIm( real.bins() );
+      const auto forward = measure( [&]()
+      {
+        for ( size_t r = 0; r < reps; ++r )
+          real.forward( re.data(), binsRe.data(), binsIm.data() );
+        sink = binsRe[0];
+      }, runs ) / static_cast<double>( reps );
+      snprintf( label, sizeof( label ), "real, %zu points", size );
+      reportFlops( label, forward, flops / 2.0 );
+    }
+  }
+
+  void fourier()
+  {
+    transforms<vec8f>( "fftf & realFftf, float" );
+    transforms<vec4d>( "fftd & realFftd, double" );
+  }
+
+}
@@ -0,0 +1,108 @@
+#include "bench.h"
+#include "nm_kernels.h"
+#include <vector>
+
+using namespace nmath;
+
+namespace bench {
+
+  // working sets from L1 out to main memory, the last one past nontemporalThreshold
+  static constexpr size_t c_sizes[] = { 1 << 11, 1 << 15, 1 << 18, 1 << 23 };
+
+  template <typename Scalar, typename Kernel>
+  static void compare( const char* name, size_t n, double bytesPerItem, Scalar scalar, Kernel kernel )
+  {
+    const double bytes = bytesPerItem * static_cast<double>( n );
+    // repeat small sizes so each timing covers roughly the same amount of traffic
+    const int repeats = static_cast<int>( ( size_t( 1 ) << 23 ) / n );
+    const auto base = measure( [&]()
+    {
+      for ( int r = 0; r < repeats; ++r )
+        scalar();
+    }, 5 );
+    const auto wide = measure( [&]()
+    {
+      for ( int r = 0; r < repeats; ++r )
+        kernel();
+    }, 5 );
+    char label[64];
+    snprintf( label, sizeof( label ), "scalar %s n=%zu", name, n );
+    reportBandwidth( label, base / repeats, bytes );
+    snprintf( label, sizeof( label ), "kernels::%s n=%zu", name, n );
+    reportBandwidth( label, wide / repeats, bytes, base / repeats );
+  }
+
+  template <typename S>
+  static void group( const char* type )
+  {
+    char title[64];
+    snprintf( title, sizeof( title ), "kernels (%s)", type );
+    header( title );
+    for ( const auto n : c_sizes )
+    {
+      // +1 element so dst is deliberately misaligned & the kernels have to peel
+      std::vector<S> a( n + 1, S( 1.5 ) ), b( n + 1, S( 0.25 ) ), c( n + 1, S( -1 ) ), dst( n + 1 );
+      S* out = dst.data() + 1;
+      const S* pa = a.data();
+      const S* pb = b.data();
+      const S* pc = c.data();
+      compare( "add", n, 3.0 * sizeof( S ), [&]()
+      {
+        for ( size_t i = 0; i < n; ++i )
+          out[i] = pa[i] + pb[i];
+        sink = out[n / 2];
+      }, [&]()
+      {
+        kernels::add( out, pa, pb, n );
+        sink = out[n / 2];
+      } );
+      compare( "scale", n, 2.0 * sizeof( S ), [&]()
+      {
+        for ( size_t i = 0; i < n; ++i )
+          out[i] = pa[i] * S( 0.5 );
+        sink = out[n / 2];
+      }, [&]()
+      {
+        kernels::scale( out, pa, 0.5, n );
+        sink = out[n / 2];
+      } );
+      compare( "axpy", n, 3.0 * sizeof( S ), [&]()
+      {
+        for ( size_t i = 0; i < n; ++i )
+          out[i] = S( 0.5 ) * pa[i] + out[i];
+        sink = out[n / 2];
+      }, [&]()
+      {
+        kernels::axpy( out, 0.5, pa, n );
+        sink = out[n / 2];
+      } );
+      compare( "fma", n, 4.0 * sizeof( S ), [&]()
+      {
+        for ( size_t i = 0; i < n; ++i )
+          out[i] = pa[i] * pb[i] + pc[i];
+        sink = out[n / 2];
+      }, [&]()
+      {
+        kernels::fma( out, pa, pb, pc, n );
+        sink = out[n / 2];
+      } );
+      compare( "clamp", n, 2.0 * sizeof( S ), [&]()
+      {
+        for ( size_t i = 0; i < n; ++i )
+          out[i] = pa[i] < S( 0 ) ? S( 0 ) : ( pa[i] > S( 1 ) ? S( 1 ) : pa[i] );
+        sink = out[n / 2];
+      }, [&]()
+      {
+        kernels::clamp( out, pa, 0.0, 1.0, n );
+        sink = out[n / 2];
+      } );
+    }
+  }
+
+  void kernels()
+  {
+    group<float>( "float" );
+    group<double>( "double" );
+  }
+
+}
@@ -0,0 +1,142 @@
+#include "bench.h"
+#include "nm_mat4f.h"
+#include "nm_memory.h"
+#include <vector>
+
+using namespace nmath;
+
+namespace bench {
+
+  static constexpr size_t c_count = 4096;
+  // points for the batch transforms: in L1, and 12 MiB of xyz that streams from L3 or memory
+  static constexpr size_t c_points[] = { 1024, size_t( 1 ) << 20 };
+
+  //! What mat4f replaces: a plain row-major 4x4 float matrix
+  struct scalarMat4 {
+    float m[4][4];
+    scalarMat4 operator * ( const scalarMat4& rhs ) const
+    {
+      scalarMat4 r;
+      for ( int i = 0; i < 4; ++i )
+        for ( int j = 0; j < 4; ++j )
+          r.m[i][j] = m[i][0] * rhs.m[0][j] + m[i][1] * rhs.m[1][j] + m[i][2] * rhs.m[2][j] + m[i][3] * rhs.m[3][j];
+      return r;
+    }
+  };
+
+  void mat4()
+  {
+    header( "mat4f" );
+    std::vector<scalarMat4> sa( c_count ), sb( c_count ), sc( c_count );
+    aligned_vector<mat4f> va( c_count ), vb( c_count ), vc( c_count );
+    for ( size_t i = 0; i < c_count; ++i )
+    {
+      // rotations by small angles so that long chains neither blow up nor vanish
+      const float c = 0.99995f, s = 0.0099998f * ( i % 2 ? 1.0f : -1.0f );
+      const float rows[16] = { c, s, 0.0f, 0.0f, -s, c, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.1f, 0.2f, 0.3f, 1.0f };
+      for ( int k = 0; k < 16; ++k )
+      {
+        sa[i].m[k / 4][k % 4] = rows[k];
+        sb[i].m[k / 4][k % 4] = rows[( k + 5 ) % 16];
+      }
+      va[i].loadUnaligned( rows );
+      vb[i].loadUnaligned( &sb[i].m[0][0] );
+    }
+    const double items = static_cast<double>( c_count );
+
+    // a chain is one long dependency, so this is about latency
+    const auto scalarChain = measure( [&]()
+    {
+      auto acc = sa[0];
+      for ( size_t i = 1; i < c_count; ++i )
+        acc = acc * sa[i];
+      sink = acc.m[3][0];
+    } );
+    report( "scalar 4x4 chain", scalarChain, items );
+    const auto chain = measure( [&]()
+    {
+      auto acc = va[0];
+      for ( size_t i = 1; i < c_count; ++i )
+        acc = acc * va[i];
+      sink = acc( 3, 0 );
+    } );
+    report( "mat4f chain", chain, items, scalarChain );
+
+    // independent products are about throughput
+    const auto scalarBatch = measure( [&]()
+    {
+      for ( size_t i = 0; i < c_count; ++i )
+        sc[i] = sa[i] * sb[i];
+      sink = sc[c_count / 2].m[3][0];
+    } );
+    report( "scalar 4x4 batch", scalarBatch, items );
+    const auto batch = measure( [&]()
+    {
+      for ( size_t i = 0; i < c_count; ++i )
+        vc[i] = va[i] * vb[i];
+      sink = vc[c_count / 2]( 3, 0 );
+    } );
+    report( "mat4f batch (vec4f)", batch, items, scalarBatch );
+    const auto wide = measure( [&]()
+    {
+      multiply( vc.data(), va.data(), vb.data(), c_count );
+      sink = vc[c_count / 2]( 3, 0 );
+    } );
+    report( "multiply batch (vec8f)", wide, items, scalarBatch );
+
+    const auto inv = measure( [&]()
+    {
+      for ( size_t i = 0; i < c_count; ++i )
+        vc[i] = va[i].inverse();
+      sink = vc[c_count / 2]( 3, 0 );
+    } );
+    report( "mat4f inverse", inv, items );
+    const auto invAffine = measure( [&]()
+    {
+      for ( size_t i = 0; i < c_count; ++i )
+        vc[i] = va[i].inverseAffine();
+      sink = vc[c_count / 2]( 3, 0 );
+    } );
+    report( "mat4f inverseAffine", invAffine, items, inv );
+
+    header( "mat4f point transform, AoS vec4f vs SoA vec8f" );
+    const mat4f m = mat4f::scaling( 1.5f, 0.5f, 2.0f ) * va[1] * mat4f::translation( 1.0f, -2.0f, 3.0f );
+    for ( const auto n : c_points )
+    {
+      aligned_vector<vec4f> aos( n ), aosOut( n );
+      aligned_vector<float> x( n ), y( n ), z( n ), ox( n ), oy( n ), oz( n );
+      for ( size_t i = 0; i < n; ++i )
+      {
+        x[i] = static_cast<float>( i % 1000 ) * 0.01f;
+        y[i] = static_cast<float>( i % 777 ) * 0.02f;
+        z[i] = static_cast<float>( i % 555 ) * -0.03f;
+        aos[i] = vec4f( x[i], y[i], z[i], 1.0f );
+      }
+      // repeat small sizes so each timing covers the same number of points
+      const size_t repeats = c_points[1] / n;
+      const double points = static_cast<double>( n * repeats );
+      printf( " n=%zu\n", n );
+      const auto aosTime = measure( [&]()
+      {
+        for ( size_t r = 0; r < repeats; ++r )
+          for ( size_t i = 0; i < n; ++i )
+            aosOut[i].packed = m.transform( aos[i] ).packed;
+        sink = aosOut[n / 2].x;
+      } );
+      report( "mat4f::transform points (AoS)", aosTime, points );
+      auto soa = [&]( auto fn )
+      {
+        return measure( [&]()
+        {
+          for ( size_t r = 0; r < repeats; ++r )
+            fn( m, x.data(), y.data(), z.data(), ox.data(), oy.data(), oz.data(), n );
+          sink = ox[n / 2];
+        } );
+      };
+      report( "transformPoints (SoA)", soa( transformPoints ), points, aosTime );
+      report( "transformDirections (SoA)", soa( transformDirections ), points, aosTime );
+      report( "projectPoints (SoA)", soa( projectPoints ), points, aosTime );
+    }
+  }
+
+}
@@ -0,0 +1,136 @@
+#include "bench.h"
+#include "nm_mix.h"
+#include "nm_kernels.h"
+#include <cmath>
+#include <vector>
+
+using namespace nmath;
+
+namespace bench {
+
+  // samples per block & buses mixed into one
+  static constexpr size_t c_samples = 512;
+  static constexpr size_t c_buses = 32;
+
+  void mixing()
+  {
+    std::vector<std::vector<float>> buses( c_buses, std::vector<float>( c_samples ) );
+    std::vector<const float*> inputs;
+    std::vector<float> gains( c_buses ), out( c_samples );
+    for ( size_t b = 0; b < c_buses; ++b )
+    {
+      for ( size_t i = 0; i < c_samples; ++i )
+        buses[b][i] = std::sin( static_cast<float>( i * ( b + 1 ) ) * 0.01f );
+      gains[b] = 1.0f / static_cast<float>( b + 1 );
+      inputs.push_back( buses[b].data() );
+    }
+    const double samples = static_cast<double>( c_buses * c_samples );
+
+    header( "mixing 32 buses of 512 samples, per bus sample" );
+    const auto scalar = measure( [&]()
+    {
+      for ( size_t b = 0; b < c_buses; ++b )
+        for ( size_t i = 0; i < c_samples; ++i )
+          out[i] += gains[b] * inputs[b][i];
+      sink = out[0];
+    } );
+    report( "scalar, bus by bus", scalar, samples );
+    const auto axpyNs = measure( [&]()
+    {
+      for ( size_t b = 0; b < c_buses; ++b )
+        kernels::axpy( out.data(), gains[b], inputs[b], c_samples );
+      sink = out[0];
+    } );
+    report( "axpy, bus by bus", axpyNs, samples, scalar );
+    const auto mixNs = measure( [&]()
+    {
+      mix( inputs.data(), gains.data(), c_buses, out.data(), c_samples );
+      sink = out[0];
+    } );
+    report( "mix, all buses at once", mixNs, samples, scalar );
+
+    header( "gain ramps & crossfades of 32 buses of 512 samples, per bus sample" );
+    const auto scalarRamp = measure( [&]()
+    {
+      for ( size_t b = 0; b < c_buses; ++b )
+      {
+        const float step = ( 0.25f - gains[b] ) / static_cast<float>( c_samples );
+        for ( size_t i = 0; i < c_samples; ++i )
+          out[i] += ( gains[b] + step * static_cast<float>( i ) ) * inputs[b][i];
+      }
+      sink = out[0];
+    } );
+    report( "scalar linear ramp & mix", scalarRamp, samples );
+    const auto linearNs = measure( [&]()
+    {
+      for ( size_t b = 0; b < c_buses; ++b )
+        mixRamp( inputs[b], out.data(), gains[b], 0.25f, c_samples );
+      sink = out[0];
+    } );
+    report( "mixRamp, linear", linearNs, samples, scalarRamp );
+    const auto scalarPower = measure( [&]()
+    {
+      for ( size_t b = 0; b < c_buses; ++b )
+      {
+        const float from = gains[b] * gains[b], step = ( 0.0625f - from ) / static_cast<float>( c_samples );
+        for ( size_t i = 0; i < c_samples; ++i )
+          out[i] += std::sqrt( from + step * static_cast<float>( i ) ) * inputs[b][i];
+      }
+      sink = out[0];
+    } );
+    report( "scalar equal-power ramp & mix", scalarPower, samples );
+    const auto powerNs = measure( [&]()
+    {
+      for ( size_t b = 0; b < c_buses; ++b )
+        mixRamp( inputs[b], out.data(), gains[b], 0.25f, c_samples, fadeCurve::equalPower );
+      sink = out[0];
+    } );
+    report( "mixRamp, equal power", powerNs, samples, scalarPower );
+    const auto fadeNs = measure( [&]()
+    {
+      for ( size_t b = 0; b + 1 < c_buses; ++b )
+        crossfade( inputs[b], inputs[b + 1], out.data(), c_samples, fadeCurve::equalPower );
+      sink = out[0];
+    } );
+    report( "crossfade, equal power", fadeNs, samples - c_samples );
+
+    // reverb & filter tails decaying from 1e-37 by 0.98 a sample, denormal below
+    // 1.2e-38 from about the 100th sample on
+    for ( auto& bus : buses )
+      for ( size_t i = 0; i < c_samples; ++i )
+        bus[i] = 1e-37f * std::pow( 0.98f, static_cast<float>( i ) );
+    std::fill( out.begin(), out.end(), 0.0f );
+    header( "mixing 32 buses of 512 samples decaying into denormals, per bus sample" );
+    const auto stalled = measure( [&]()
+    {
+      mix( inputs.data(), gains.data(), c_buses, out.data(), c_samples );
+      sink = out[0];
+    } );
+    report( "mix", stalled, samples, mixNs );
+    const auto stalledRamp = measure( [&]()
+    {
+      for ( size_t b = 0; b < c_buses; ++b )
+        mixRamp( inputs[b], out.data(), gains[b], 0.25f, c_samples );
+      sink = out[0];
+    } );
+    report( "mixRamp, linear", stalledRamp, samples, linearNs );
+    {
+      const denormalGuard ftz;
+      const auto flushed = measure( [&]()
+      {
+        mix( inputs.data(), gains.data(), c_buses, out.data(), c_samples );
+        sink = out[0];
+      } );
+      report( "mix under denormalGuard", flushed, samples, mixNs );
+      const auto flushedRamp = measure( [&]()
+      {
+        for ( size_t b = 0; b < c_buses; ++b )
+          mixRamp( inputs[b], out.data(), gains[b], 0.25f, c_samples );
+        sink = out[0];
+      } );
+      report( "mixRamp, linear, under denormalGuard", flushedRamp, samples, linearNs );
+    }
+    printf( "    speedups against the same kernel on audible signals\n" );
+  }
+
+}
@@ -0,0 +1,59 @@
+#include "bench.h"
+#include "nm_parallel.h"
+#include <memory>
+#include <vector>
+
+using namespace nmath;
+
+namespace bench {
+
+  // well past the last-level cache, so this measures memory bandwidth
+  static constexpr size_t c_count = size_t( 1 ) << 25;
+
+  //! Thread counts to try: powers of two up to the hardware, and the hardware count itself
+  static std::vector<size_t> threadCounts()
+  {
+    const size_t hardware = std::thread::hardware_concurrency() ? std::thread::hardware_concurrency() : 1;
+    std::vector<size_t> counts;
+    for ( size_t t = 1; t < hardware; t *= 2 )
+      counts.push_back( t );
+    counts.push_back( hardware );
+    return counts;
+  }
+
+  void parallel()
+  {
+    header( "parallel kernels (float), scaling over threads" );
+    double baseAdd = 0.0, baseSum = 0.0;
+    for ( const auto threads : threadCounts() )
+    {
+      threadpool pool( threads );
+      // fresh & uninitialized for every thread count, so the first touch of
+      // every page happens from this pool & places it near the thread using it
+      std::unique_ptr<float[]> a( new float[c_count] ), b( new float[c_count] ), dst( new float[c_count] );
+      kernels::firstTouch( pool, a.get(), c_count );
+      kernels::firstTouch( pool, b.get(), c_count );
+      kernels::firstTouch( pool, dst.get(), c_count );
+      const auto add = measure( [&]()
+      {
+        kernels::add( pool, dst.get(), a.get(), b.get(), c_count );
+        sink = dst[c_count / 2];
+      }, 5 );
+      const auto sum = measure( [&]()
+      {
+        sink = kernels::sum( pool, a.get(), c_count );
+      }, 5 );
+      if ( threads == 1 )
+      {
+        baseAdd = add;
+        baseSum = sum;
+      }
+      char label[64];
+      snprintf( label, sizeof( label ), "kernels::add threads=%zu", threads );
+      reportBandwidth( label, add, 3.0 * sizeof( float ) * c_count, baseAdd );
+      snprintf( label, sizeof( label ), "kernels::sum threads=%zu", threads );
+      reportBandwidth( label, sum, 1.0 * sizeof( float ) * c_count, baseSum );
+    }
+  }
+
+}
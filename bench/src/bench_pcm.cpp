@@ -0,0 +1,172 @@
+#include "bench.h"
+#include "nm_pcm.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace nmath;
+
+namespace bench {
+
+  // samples per conversion, a few blocks of interleaved stereo
+  static constexpr size_t c_samples = 1 << 16;
+
+  //! What the kernels replace: a sample at a time with lrint & clamping
+  template <typename I>
+  static I scalarQuantize( const float x, const float scale, const float lo, const float hi )
+  {
+    return static_cast<I>( std::lrint( std::min( std::max( x * scale, lo ), hi ) ) );
+  }
+
+  void pcm()
+  {
+    std::vector<float> samples( c_samples );
+    for ( size_t i = 0; i < c_samples; ++i )
+      samples[i] = static_cast<float>( ( i * 7919 ) % 1000 ) * 0.0021f - 1.05f;
+    std::vector<int16_t> pcm16( c_samples );
+    std::vector<uint8_t> pcm24( 3 * c_samples );
+    std::vector<int32_t> pcm32( c_samples );
+    buffer<float> out( c_samples );
+    const double items = static_cast<double>( c_samples );
+
+    header( "PCM to float, samples per second" );
+    floatToInt16( samples.data(), pcm16.data(), c_samples );
+    floatToInt24( samples.data(), pcm24.data(), c_samples );
+    floatToInt32( samples.data(), pcm32.data(), c_samples );
+    {
+      const auto scalar = measure( [&]()
+      {
+        for ( size_t i = 0; i < c_samples; ++i )
+          out[i] = static_cast<float>( pcm16[i] ) * ( 1.0f / 32768.0f );
+        sink = out[0];
+      } );
+      report( "scalar int16", scalar, items );
+      const auto simd = measure( [&]()
+      {
+        int16ToFloat( pcm16.data(), c_samples, out );
+        sink = out[0];
+      } );
+      report( "int16ToFloat", simd, items, scalar );
+    }
+    {
+      const auto scalar = measure( [&]()
+      {
+        for ( size_t i = 0; i < c_samples; ++i )
+        {
+          const uint8_t* p = &pcm24[3 * i];
+          const int32_t s = static_cast<int32_t>( ( static_cast<uint32_t>( p[0] ) << 8 ) | ( static_cast<uint32_t>( p[1] ) << 16 ) | ( static_cast<uint32_t>( p[2] ) << 24 ) ) >> 8;
+          out[i] = static_cast<float>( s ) * ( 1.0f / 8388608.0f );
+        }
+        sink = out[0];
+      } );
+      report( "scalar packed int24", scalar, items );
+      const auto simd = measure( [&]()
+      {
+        int24ToFloat( pcm24.data(), c_samples, out );
+        sink = out[0];
+      } );
+      report( "int24ToFloat", simd, items, scalar );
+    }
+    {
+      const auto scalar = measure( [&]()
+      {
+        for ( size_t i = 0; i < c_samples; ++i )
+          out[i] = static_cast<float>( pcm32[i] ) * ( 1.0f / 2147483648.0f );
+        sink = out[0];
+      } );
+      report( "scalar int32", scalar, items );
+      const auto simd = measure( [&]()
+      {
+        int32ToFloat( pcm32.data(), c_samples, out );
+        sink = out[0];
+      } );
+      report( "int32ToFloat", simd, items, scalar );
+    }
+
+    header( "float to PCM, samples per second" );
+    {
+      const auto scalar = measure( [&]()
+      {
+        for ( size_t i = 0; i < c_samples; ++i )
+          pcm16[i] = scalarQuantize<int16_t>( samples[i], 32768.0f, -32768.0f, 32767.0f );
+        sink = pcm16[0];
+      } );
+      report( "scalar int16", scalar, items );
+      const auto simd = measure( [&]()
+      {
+        floatToInt16( samples.data(), pcm16.data(), c_samples );
+        sink = pcm16[0];
+      } );
+      report( "floatToInt16", simd, items, scalar );
+      uint32_t state = 1;
+      const auto scalarDither = measure( [&]()
+      {
+        // two xorshift32 draws per sample for the triangular noise
+        auto uniform = [&]()
+        {
+          state ^= state << 13;
+          state ^= state >> 17;
+          state ^= state << 5;
+          return static_cast<float>( state >> 8 ) * ( 1.0f / 16777216.0f );
+        };
+        for ( size_t i = 0; i < c_samples; ++i )
+        {
+          const float noise = uniform() - uniform();
+          pcm16[i] = static_cast<int16_t>( std::lrint( std::min( std::max( samples[i] * 32768.0f + noise, -32768.0f ), 32767.0f ) ) );
+        }
+        sink = pcm16[0];
+      } );
+      report( "scalar int16, TPDF dither", scalarDither, items );
+      tpdfDither dither;
+      const auto simdDither = measure( [&]()
+      {
+        floatToInt16( samples.data(), pcm16.data(), c_samples, dither );
+        sink = pcm16[0];
+      } );
+      report( "floatToInt16, TPDF dither", simdDither, items, scalarDither );
+    }
+    {
+      const auto scalar = measure( [&]()
+      {
+        for ( size_t i = 0; i < c_samples; ++i )
+        {
+          const auto s = scalarQuantize<int32_t>( samples[i], 8388608.0f, -8388608.0f, 8388607.0f );
+          pcm24[3 * i] = static_cast<uint8_t>( s );
+          pcm24[3 * i + 1] = static_cast<uint8_t>( s >> 8 );
+          pcm24[3 * i + 2] = static_cast<uint8_t>( s >> 16 );
+        }
+        sink = pcm24[0];
+      } );
+      report( "scalar packed int24", scalar, items );
+      const auto simd = measure( [&]()
+      {
+        floatToInt24( samples.data(), pcm24.data(), c_samples );
+        sink = pcm24[0];
+      } );
+      report( "floatToInt24", simd, items, scalar );
+      tpdfDither dither;
+      const auto simdDither = measure( [&]()
+      {
+        floatToInt24( samples.data(), pcm24.data(), c_samples, dither );
+        sink = pcm24[0];
+      } );
+      report( "floatToInt24, TPDF dither", simdDither, items );
+    }
+    {
+      const auto scalar = measure( [&]()
+      {
+        for ( size_t i = 0; i < c_samples; ++i )
+          pcm32[i] = static_cast<int32_t>( std::llrint( std::min( std::max( static_cast<double>( samples[i] ) * 2147483648.0, -2147483648.0 ), 2147483647.0 ) ) );
+        sink = pcm32[0];
+      } );
+      report( "scalar int32", scalar, items );
+      const auto simd = measure( [&]()
+      {
+        floatToInt32( samples.data(), pcm32.data(), c_samples );
+        sink = pcm32[0];
+      } );
+      report( "floatToInt32", simd, items, scalar );
+    }
+  }
+
+}
@@ -0,0 +1,110 @@
+#include "bench.h"
+#include "nm_quatf.h"
+#include <vector>
+#include <cmath>
+
+using namespace nmath;
+
+namespace bench {
+
+  // joints blended per frame
+  static constexpr size_t c_joints = 32768;
+
+  //! What quatf replaces: a plain four float quaternion
+  struct scalarQuat {
+    float x, y, z, w;
+  };
+
+  static scalarQuat scalarNlerp( const scalarQuat& a, scalarQuat b, float t )
+  {
+    if ( a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w < 0.0f )
+      b = { -b.x, -b.y, -b.z, -b.w };
+    const scalarQuat r = { a.x + ( b.x - a.x ) * t, a.y + ( b.y - a.y ) * t, a.z + ( b.z - a.z ) * t, a.w + ( b.w - a.w ) * t };
+    const float rl = 1.0f / std::sqrt( r.x * r.x + r.y * r.y + r.z * r.z + r.w * r.w );
+    return { r.x * rl, r.y * rl, r.z * rl, r.w * rl };
+  }
+
+  static scalarQuat scalarSlerp( const scalarQuat& a, scalarQuat b, float t )
+  {
+    float d = a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+    if ( d < 0.0f )
+    {
+      d = -d;
+      b = { -b.x, -b.y, -b.z, -b.w };
+    }
+    float wa = 1.0f - t, wb = t;
+    if ( d < 0.9995f )
+    {
+      const float theta = std::acos( d );
+      const float rs = 1.0f / std::sin( theta );
+      wa = std::sin( wa * theta ) * rs;
+      wb = std::sin( wb * theta ) * rs;
+    }
+    return { a.x * wa + b.x * wb, a.y * wa + b.y * wb, a.z * wa + b.z * wb, a.w * wa + b.w * wb };
+  }
+
+  void quat()
+  {
+    header( "quaternion blend of two poses" );
+    std::vector<scalarQuat> sa( c_joints ), sb( c_joints ), sc( c_joints );
+    std::vector<quatf> qa( c_joints ), qb( c_joints ), qc( c_joints );
+    soa4f pa( c_joints ), pb( c_joints ), pc( c_joints );
+    for ( size_t i = 0; i < c_joints; ++i )
+    {
+      const float f = static_cast<float>( i );
+      const auto a = quatf::axisAngle( 0.6f, 0.0f, 0.8f, std::fmod( f * 0.37f, 6.0f ) );
+      const auto b = quatf::axisAngle( 0.0f, 0.8f, 0.6f, std::fmod( f * 0.11f, 6.0f ) );
+      qa[i] = a;
+      qb[i] = b;
+      sa[i] = { a.v.x, a.v.y, a.v.z, a.v.w };
+      sb[i] = { b.v.x, b.v.y, b.v.z, b.v.w };
+      pa.x[i] = a.v.x, pa.y[i] = a.v.y, pa.z[i] = a.v.z, pa.w[i] = a.v.w;
+      pb.x[i] = b.v.x, pb.y[i] = b.v.y, pb.z[i] = b.v.z, pb.w[i] = b.v.w;
+    }
+    const double items = static_cast<double>( c_joints );
+    const float t = 0.3f;
+
+    const auto scalarN = measure( [&]()
+    {
+      for ( size_t i = 0; i < c_joints; ++i )
+        sc[i] = scalarNlerp( sa[i], sb[i], t );
+      sink = sc[c_joints / 2].w;
+    } );
+    report( "scalar nlerp", scalarN, items );
+    const auto quatN = measure( [&]()
+    {
+      for ( size_t i = 0; i < c_joints; ++i )
+        qc[i] = nlerp( qa[i], qb[i], t );
+      sink = qc[c_joints / 2].v.w;
+    } );
+    report( "quatf nlerp", quatN, items, scalarN );
+    const auto soaN = measure( [&]()
+    {
+      nlerp( pc, pa, pb, t );
+      sink = pc.w[c_joints / 2];
+    } );
+    report( "nlerp over soa4f (vec8f)", soaN, items, scalarN );
+
+    const auto scalarS = measure( [&]()
+    {
+      for ( size_t i = 0; i < c_joints; ++i )
+        sc[i] = scalarSlerp( sa[i], sb[i], t );
+      sink = sc[c_joints / 2].w;
+    } );
+    report( "scalar slerp", scalarS, items );
+    const auto quatS = measure( [&]()
+    {
+      for ( size_t i = 0; i < c_joints; ++i )
+        qc[i] = slerp( qa[i], qb[i], t );
+      sink = qc[c_joints / 2].v.w;
+    } );
+    report( "quatf slerp", quatS, items, scalarS );
+    const auto soaS = measure( [&]()
+    {
+      slerp( pc, pa, pb, t );
+      sink = pc.w[c_joints / 2];
+    } );
+    report( "slerp over soa4f (vec8f)", soaS, items, scalarS );
+  }
+
+}
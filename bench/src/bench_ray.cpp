@@ -0,0 +1,101 @@
+#include "bench.h"
+#include "nm_ray.h"
+#include <vector>
+#include <algorithm>
+#include <bit>
+
+using namespace nmath;
+
+namespace bench {
+
+  // ray-box tests per timing, with the boxes in L1
+  static constexpr size_t c_rays = 4096;
+  static constexpr size_t c_boxes = 64;
+
+  //! What the packet test replaces: one ray against one box, with early outs
+  static bool scalarSlab( const rayf& ray, const float* rd, const float* lo, const float* hi, float& tnear )
+  {
+    float t0 = ray.tmin, t1 = ray.tmax;
+    for ( int a = 0; a < 3; ++a )
+    {
+      float tn = ( lo[a] - ray.origin[a] ) * rd[a];
+      float tf = ( hi[a] - ray.origin[a] ) * rd[a];
+      if ( tn > tf )
+        std::swap( tn, tf );
+      t0 = std::max( t0, tn );
+      t1 = std::min( t1, tf );
+      if ( t0 > t1 )
+        return false;
+    }
+    tnear = t0;
+    return true;
+  }
+
+  void ray()
+  {
+    header( "ray vs AABB slab tests" );
+    std::vector<rayf> rays( c_rays );
+    std::vector<float> rds( 3 * c_rays );
+    for ( size_t i = 0; i < c_rays; ++i )
+    {
+      const float f = static_cast<float>( i );
+      rays[i] = { { -10.0f, static_cast<float>( i % 17 ) - 8.0f, static_cast<float>( i % 13 ) - 6.0f },
+        { 1.0f, 0.01f * static_cast<float>( i % 7 ) - 0.03f, 0.02f * f / c_rays - 0.01f } };
+      for ( int a = 0; a < 3; ++a )
+        rds[3 * i + a] = 1.0f / rays[i].direction[a];
+    }
+    std::vector<float> lo( 3 * c_boxes ), hi( 3 * c_boxes );
+    std::vector<aabb8f> wide( c_boxes / 8 );
+    for ( size_t b = 0; b < c_boxes; ++b )
+    {
+      const float c[3] = { static_cast<float>( b % 8 ) * 2.0f - 8.0f, static_cast<float>( b % 5 ) * 3.0f - 6.0f, static_cast<float>( b / 8 ) * 1.5f - 6.0f };
+      for ( int a = 0; a < 3; ++a )
+      {
+        lo[3 * b + a] = c[a] - 1.0f;
+        hi[3 * b + a] = c[a] + 1.0f;
+      }
+      wide[b / 8].set( static_cast<int>( b % 8 ), &lo[3 * b], &hi[3 * b] );
+    }
+    const double tests = static_cast<double>( c_rays * c_boxes );
+
+    const auto scalar = measure( [&]()
+    {
+      size_t hits = 0;
+      for ( size_t i = 0; i < c_rays; ++i )
+        for ( size_t b = 0; b < c_boxes; ++b )
+        {
+          float t;
+          hits += scalarSlab( rays[i], &rds[3 * i], &lo[3 * b], &hi[3 * b], t );
+        }
+      sink = static_cast<double>( hits );
+    } );
+    report( "scalar ray vs box", scalar, tests );
+    const auto packet = measure( [&]()
+    {
+      size_t hits = 0;
+      vec8f tnear;
+      for ( size_t i = 0; i < c_rays; i += 8 )
+      {
+        const auto packet = ray8f::gather( &rays[i] );
+        for ( size_t b = 0; b < c_boxes; ++b )
+          hits += std::popcount( static_cast<unsigned>( intersect( packet, aabb8f::splat( &lo[3 * b], &hi[3 * b] ), tnear ) ) );
+      }
+      sink = static_cast<double>( hits );
+    } );
+    report( "8 rays vs box", packet, tests, scalar );
+    const auto boxes = measure( [&]()
+    {
+      size_t hits = 0;
+      vec8f tnear;
+      for ( size_t i = 0; i < c_rays; ++i )
+      {
+        const auto ray = ray8f::splat( rays[i] );
+        for ( const auto& b : wide )
+          hits += std::popcount( static_cast<unsigned>( intersect( ray, b, tnear ) ) );
+      }
+      sink = static_cast<double>( hits );
+    } );
+    report( "ray vs 8 boxes", boxes, tests, scalar );
+  }
+
+}
@@ -0,0 +1,111 @@
+#include "bench.h"
+#include "nm_vec4f.h"
+#include "nm_vec8f.h"
+#include "nm_vec4d.h"
+#include <cmath>
+
+using namespace nmath;
+
+namespace bench {
+
+  // small enough to stay in L1, so the divider rather than memory is the limit
+  static constexpr size_t c_count = 4096;
+  static constexpr int c_repeats = 64;
+
+  alignas( 32 ) static float g_fin[c_count], g_fout[c_count];
+  alignas( 32 ) static double g_din[c_count], g_dout[c_count];
+
+  template <typename S>
+  static double maxRelError( const S* in, const S* out, bool isRsqrt )
+  {
+    double worst = 0.0;
+    for ( size_t i = 0; i < c_count; ++i )
+    {
+      const double x = static_cast<double>( in[i] );
+      const double exact = isRsqrt ? 1.0 / std::sqrt( x ) : 1.0 / x;
+      const double err = std::fabs( static_cast<double>( out[i] ) / exact - 1.0 );
+      if ( err > worst )
+        worst = err;
+    }
+    return worst;
+  }
+
+  template <typename Fn>
+  static double runFloat( Fn fn )
+  {
+    return measure( [&]()
+    {
+      for ( int r = 0; r < c_repeats; ++r )
+        for ( size_t i = 0; i < c_count; i += 8 )
+          fn( vec8f( &g_fin[i] ) ).storeTemporal( &g_fout[i] );
+      sink = g_fout[c_count / 2];
+    } );
+  }
+
+  template <typename Fn>
+  static double runDouble( Fn fn )
+  {
+    return measure( [&]()
+    {
+      for ( int r = 0; r < c_repeats; ++r )
+        for ( size_t i = 0; i < c_count; i += 4 )
+          fn( vec4d( &g_din[i] ) ).storeTemporal( &g_dout[i] );
+      sink = g_dout[c_count / 2];
+    } );
+  }
+
+  static void show( const char* name, double ns, double err, double baseline )
+  {
+    char label[64];
+    snprintf( label, sizeof( label ), "%s (err %.1e)", name, err );
+    report( label, ns, static_cast<double>( c_count * c_repeats ), baseline );
+  }
+
+  template <typename Fn>
+  static double lineFloat( const char* name, bool isRsqrt, double baseline, Fn fn )
+  {
+    const auto ns = runFloat( fn );
+    show( name, ns, maxRelError( g_fin, g_fout, isRsqrt ), baseline );
+    return ns;
+  }
+
+  template <typename Fn>
+  static double lineDouble( const char* name, bool isRsqrt, double baseline, Fn fn )
+  {
+    const auto ns = runDouble( fn );
+    show( name, ns, maxRelError( g_din, g_dout, isRsqrt ), baseline );
+    return ns;
+  }
+
+  void rcp()
+  {
+    header( "rcp: approximate reciprocal & rsqrt vs div & sqrt" );
+    for ( size_t i = 0; i < c_count; ++i )
+    {
+      g_din[i] = 0.001 + 1000.0 * static_cast<double>( i ) / c_count;
+      g_fin[i] = static_cast<float>( g_din[i] );
+    }
+    const vec8f one8( 1.0f );
+    const vec4d one4( 1.0 );
+    auto base = lineFloat( "vec8f 1 / x", false, 0.0, [&]( const vec8f& v ) { return one8 / v; } );
+    lineFloat( "vec8f rcp<0>", false, base, []( const vec8f& v ) { return v.rcp<0>(); } );
+    lineFloat( "vec8f rcp<1>", false, base, []( const vec8f& v ) { return v.rcp<1>(); } );
+    lineFloat( "vec8f rcp<2>", false, base, []( const vec8f& v ) { return v.rcp<2>(); } );
+    base = lineFloat( "vec8f 1 / sqrt(x)", true, 0.0, [&]( const vec8f& v ) { return one8 / v.sqrt(); } );
+    lineFloat( "vec8f rsqrt<0>", true, base, []( const vec8f& v ) { return v.rsqrt<0>(); } );
+    lineFloat( "vec8f rsqrt<1>", true, base, []( const vec8f& v ) { return v.rsqrt<1>(); } );
+    lineFloat( "vec8f rsqrt<2>", true, base, []( const vec8f& v ) { return v.rsqrt<2>(); } );
+
+    base = lineDouble( "vec4d 1 / x", false, 0.0, [&]( const vec4d& v ) { return one4 / v; } );
+    lineDouble( "vec4d rcp<0>", false, base, []( const vec4d& v ) { return v.rcp<0>(); } );
+    lineDouble( "vec4d rcp<1>", false, base, []( const vec4d& v ) { return v.rcp<1>(); } );
+    lineDouble( "vec4d rcp<2>", false, base, []( const vec4d& v ) { return v.rcp<2>(); } );
+    lineDouble( "vec4d rcp<3>", false, base, []( const vec4d& v ) { return v.rcp<3>(); } );
+    base = lineDouble( "vec4d 1 / sqrt(x)", true, 0.0, [&]( const vec4d& v ) { return one4 / v.sqrt(); } );
+    lineDouble( "vec4d rsqrt<0>", true, base, []( const vec4d& v ) { return v.rsqrt<0>(); } );
+    lineDouble( "vec4d rsqrt<1>", true, base, []( const vec4d& v ) { return v.rsqrt<1>(); } );
+    lineDouble( "vec4d rsqrt<2>", true, base, []( const vec4d& v ) { return v.rsqrt<2>(); } );
+    lineDouble( "vec4d rsqrt<3>", true, base, []( const vec4d& v ) { return v.rsqrt<3>(); } );
+  }
+
+}
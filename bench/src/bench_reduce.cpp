@@ -0,0 +1,136 @@
+#include "bench.h"
+#include "nm_reduce.h"
+#include <vector>
+#include <cmath>
+
+using namespace nmath;
+
+namespace bench {
+
+  // from L1 out to main memory
+  static constexpr size_t c_sizes[] = { 1 << 11, 1 << 15, 1 << 20, 1 << 24 };
+
+  //! The loop reductions replace: one vec8f accumulator, every add waiting on the last
+  static float singleChainSum( const float* src, size_t n )
+  {
+    vec8f acc;
+    size_t i = 0;
+    for ( ; i + 8 <= n; i += 8 )
+    {
+      vec8f v;
+      v.loadUnaligned( src + i );
+      acc = acc + v;
+    }
+    float total = acc.sum();
+    for ( ; i < n; ++i )
+      total += src[i];
+    return total;
+  }
+
+  static float singleChainDot( const float* a, const float* b, size_t n )
+  {
+    vec8f acc;
+    size_t i = 0;
+    for ( ; i + 8 <= n; i += 8 )
+    {
+      vec8f va, vb;
+      va.loadUnaligned( a + i );
+      vb.loadUnaligned( b + i );
+      acc = acc.fma( va, vb, acc );
+    }
+    float total = acc.sum();
+    for ( ; i < n; ++i )
+      total += a[i] * b[i];
+    return total;
+  }
+
+  //! Read anew for every call, so that a pure reduction can't be hoisted out of the repeats
+  static volatile size_t g_zero = 0;
+
+  template <typename Fn>
+  static double timed( size_t n, Fn&& fn )
+  {
+    // repeat small sizes so each timing covers roughly the same amount of traffic
+    const int repeats = static_cast<int>( ( size_t( 1 ) << 24 ) / n );
+    return measure( [&]()
+    {
+      double acc = 0.0;
+      for ( int r = 0; r < repeats; ++r )
+        acc += static_cast<double>( fn( g_zero ) );
+      sink = acc;
+    }, 5 ) / repeats;
+  }
+
+  //! Relative error against a long double reference
+  static double relError( double value, long double exact )
+  {
+    return static_cast<double>( std::fabs( ( static_cast<long double>( value ) - exact ) / exact ) );
+  }
+
+  void reduce()
+  {
+    header( "reductions (float)" );
+    for ( const auto n : c_sizes )
+    {
+      std::vector<float> a( n ), b( n );
+      long double exactSum = 0.0L, exactDot = 0.0L;
+      for ( size_t i = 0; i < n; ++i )
+      {
+        // positive values of varied magnitude, so the error of a sum actually grows
+        a[i] = 1.0f + static_cast<float>( ( i * 7919 ) % 1000 ) * 0.001f;
+        b[i] = 0.5f + static_cast<float>( ( i * 104729 ) % 997 ) * 0.01f;
+        exactSum += a[i];
+        exactDot += static_cast<long double>( a[i] ) * b[i];
+      }
+      const float* pa = a.data();
+      const float* pb = b.data();
+      const double items = static_cast<double>( n );
+      printf( " n=%zu\n", n );
+
+      const auto base = timed( n, [&]( size_t z ) { return singleChainSum( pa + z, n ); } );
+      report( "sum single chain", base, items );
+      const auto fast = timed( n, [&]( size_t z ) { return kernels::sum( pa + z, n ); } );
+      report( "kernels::sum", fast, items, base );
+      const auto comp = timed( n, [&]( size_t z ) { return kernels::sum<kernels::accumulate::compensated>( pa + z, n ); } );
+      report( "kernels::sum compensated", comp, items, base );
+      const auto wide = timed( n, [&]( size_t z ) { return kernels::sum<kernels::accumulate::wide>( pa + z, n ); } );
+      report( "kernels::sum wide", wide, items, base );
+      printf( "    rel. error: single chain %.2e, fast %.2e, compensated %.2e, wide %.2e\n",
+        relError( singleChainSum( pa, n ), exactSum ),
+        relError( kernels::sum( pa, n ), exactSum ),
+        relError( kernels::sum<kernels::accumulate::compensated>( pa, n ), exactSum ),
+        relError( kernels::sum<kernels::accumulate::wide>( pa, n ), exactSum ) );
+
+      const auto dotBase = timed( n, [&]( size_t z ) { return singleChainDot( pa + z, pb + z, n ); } );
+      report( "dot single chain", dotBase, items );
+      const auto dotFast = timed( n, [&]( size_t z ) { return kernels::dot( pa + z, pb + z, n ); } );
+      report( "kernels::dot", dotFast, items, dotBase );
+      const auto dotComp = timed( n, [&]( size_t z ) { return kernels::dot<kernels::accumulate::compensated>( pa + z, pb + z, n ); } );
+      report( "kernels::dot compensated", dotComp, items, dotBase );
+      printf( "    rel. error: single chain %.2e, fast %.2e, compensated %.2e\n",
+        relError( singleChainDot( pa, pb, n ), exactDot ),
+        relError( kernels::dot( pa, pb, n ), exactDot ),
+        relError( kernels::dot<kernels::accumulate::compensated>( pa, pb, n ), exactDot ) );
+
+      const auto scalarMax = timed( n, [&]( size_t z )
+      {
+        const float* p = pa + z;
+        float hi = -INFINITY;
+        for ( size_t i = 0; i < n; ++i )
+          hi = ( p[i] > hi ? p[i] : hi );
+        return hi;
+      } );
+      report( "scalar max", scalarMax, items );
+      const auto mm = timed( n, [&]( size_t z )
+      {
+        float lo, hi;
+        kernels::minmax( pa + z, n, lo, hi );
+        return lo + hi;
+      } );
+      report( "kernels::minmax", mm, items, scalarMax );
+      const auto am = timed( n, [&]( size_t z ) { return static_cast<float>( kernels::argmax( pa + z, n ) ); } );
+      report( "kernels::argmax", am, items, scalarMax );
+    }
+  }
+
+}
@@ -0,0 +1,78 @@
+#include "bench.h"
+#include "nm_resample.h"
+#include <vector>
+
+using namespace nmath;
+
+namespace bench {
+
+  //! What the resampler replaces: the same polyphase filter one scalar dot
+  //! product at a time, over the whole input at once
+  static size_t scalarResample( const float* table, const size_t up, const size_t down, const size_t taps,
+    const float* in, const size_t count, float* out )
+  {
+    size_t produced = 0;
+    for ( size_t start = 0, phase = 0; start + taps <= count; ++produced )
+    {
+      const float* h = table + phase * taps;
+      float sum = 0.0f;
+      for ( size_t k = 0; k < taps; ++k )
+        sum += h[k] * in[start + k];
+      out[produced] = sum;
+      start += down / up;
+      phase += down % up;
+      if ( phase >= up )
+      {
+        phase -= up;
+        ++start;
+      }
+    }
+    return produced;
+  }
+
+  // samples per block handed to the resampler
+  static constexpr size_t c_block = 512;
+
+  void resampling()
+  {
+    header( "polyphase resampling, one second of one channel in blocks of 512" );
+    const std::pair<size_t, size_t> rates[] = { { 44100, 48000 }, { 48000, 44100 }, { 48000, 96000 }, { 96000, 48000 } };
+    const std::pair<resampleQuality, const char*> presets[] = {
+      { resampleQuality::fast, "fast" }, { resampleQuality::good, "good" }, { resampleQuality::best, "best" } };
+    for ( const auto& [inRate, outRate] : rates )
+    {
+      std::vector<float> input( inRate );
+      for ( size_t i = 0; i < inRate; ++i )
+        input[i] = static_cast<float>( ( i * 7919 ) % 1000 ) * 0.001f - 0.5f;
+      for ( const auto& [quality, name] : presets )
+      {
+        resampler converter( inRate, outRate, quality );
+        std::vector<float> output( converter.maxOutput( inRate ) + c_block );
+        std::vector<float> table( converter.up() * converter.taps() );
+        for ( size_t i = 0; i < table.size(); ++i )
+          table[i] = static_cast<float>( ( i * 104729 ) % 2000 ) * 0.0005f - 0.5f;
+        const double outputs = static_cast<double>( outRate );
+        char label[64];
+        const auto scalar = measure( [&]()
+        {
+          sink = static_cast<double>( scalarResample( table.data(), converter.up(), converter.down(), converter.taps(),
+            input.data(), inRate, output.data() ) );
+        }, 3 );
+        snprintf( label, sizeof( label ), "scalar %zu -> %zu, %s", inRate, outRate, name );
+        report( label, scalar, outputs );
+        const auto simd = measure( [&]()
+        {
+          size_t produced = 0;
+          for ( size_t i = 0; i < inRate; i += c_block )
+            produced += converter.process( input.data() + i, std::min( c_block, inRate - i ), output.data() + produced );
+          sink = output[produced / 2];
+        }, 3 );
+        snprintf( label, sizeof( label ), "resampler %zu -> %zu, %s", inRate, outRate, name );
+        report( label, simd, outputs, scalar );
+        printf( "    %zu taps per phase, %zu phases, %.3f%% of a core per channel in real time\n",
+          converter.taps(), converter.up(), simd / 1e7 );
+      }
+    }
+  }
+
+}
@@ -0,0 +1,116 @@
+#include "bench.h"
+#include "nm_soa.h"
+#include <vector>
+
+using namespace nmath;
+
+namespace bench {
+
+  // points: in L1/L2, and well past the last-level cache
+  static constexpr size_t c_sizes[] = { 1 << 10, 1 << 22 };
+
+  template <typename Fn>
+  static double timed( size_t n, Fn&& fn )
+  {
+    // repeat small sizes so each timing covers roughly the same number of points
+    const size_t repeats = c_sizes[1] / n;
+    return measure( [&]()
+    {
+      for ( size_t r = 0; r < repeats; ++r )
+        fn();
+    }, 5 ) / static_cast<double>( repeats );
+  }
+
+  void soa()
+  {
+    header( "AoS <-> SoA transposes (float), bytes read + written" );
+    for ( const auto n : c_sizes )
+    {
+      std::vector<float> aos( 4 * n );
+      for ( size_t i = 0; i < aos.size(); ++i )
+        aos[i] = static_cast<float>( i % 1000 );
+      soa4f s( n );
+      float* x = s.x.data();
+      float* y = s.y.data();
+      float* z = s.z.data();
+      float* w = s.w.data();
+      float* p = aos.data();
+      printf( " n=%zu\n", n );
+
+      const double bytes3 = 2.0 * 3.0 * sizeof( float ) * n;
+      const auto scalar3 = timed( n, [&]()
+      {
+        for ( size_t i = 0; i < n; ++i )
+        {
+          x[i] = p[3 * i];
+          y[i] = p[3 * i + 1];
+          z[i] = p[3 * i + 2];
+        }
+        sink = x[n / 2];
+      } );
+      reportBandwidth( "scalar xyz -> SoA", scalar3, bytes3 );
+      const auto de3 = timed( n, [&]()
+      {
+        deinterleave3( p, x, y, z, n );
+        sink = x[n / 2];
+      } );
+      reportBandwidth( "deinterleave3", de3, bytes3, scalar3 );
+      const auto scalarIn3 = timed( n, [&]()
+      {
+        for ( size_t i = 0; i < n; ++i )
+        {
+          p[3 * i] = x[i];
+          p[3 * i + 1] = y[i];
+          p[3 * i + 2] = z[i];
+        }
+        sink = p[n / 2];
+      } );
+      reportBandwidth( "scalar SoA -> xyz", scalarIn3, bytes3 );
+      const auto in3 = timed( n, [&]()
+      {
+        interleave3( x, y, z, p, n );
+        sink = p[n / 2];
+      } );
+      reportBandwidth( "interleave3", in3, bytes3, scalarIn3 );
+
+      const double bytes4 = 2.0 * 4.0 * sizeof( float ) * n;
+      const auto scalar4 = timed( n, [&]()
+      {
+        for ( size_t i = 0; i < n; ++i )
+        {
+          x[i] = p[4 * i];
+          y[i] = p[4 * i + 1];
+          z[i] = p[4 * i + 2];
+          w[i] = p[4 * i + 3];
+        }
+        sink = x[n / 2];
+      } );
+      reportBandwidth( "scalar xyzw -> SoA", scalar4, bytes4 );
+      const auto de4 = timed( n, [&]()
+      {
+        deinterleave4( p, x, y, z, w, n );
+        sink = x[n / 2];
+      } );
+      reportBandwidth( "deinterleave4", de4, bytes4, scalar4 );
+      const auto scalarIn4 = timed( n, [&]()
+      {
+        for ( size_t i = 0; i < n; ++i )
+        {
+          p[4 * i] = x[i];
+          p[4 * i + 1] = y[i];
+          p[4 * i + 2] = z[i];
+          p[4 * i + 3] = w[i];
+        }
+        sink = p[n / 2];
+      } );
+      reportBandwidth( "scalar SoA -> xyzw", scalarIn4, bytes4 );
+      const auto in4 = timed( n, [&]()
+      {
+        interleave4( x, y, z, w, p, n );
+        sink = p[n / 2];
+      } );
+      reportBandwidth( "interleave4", in4, bytes4, scalarIn4 );
+    }
+  }
+
+}
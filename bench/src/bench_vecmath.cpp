@@ -0,0 +1,109 @@
+#include "bench.h"
+#include "nm_vecmath.h"
+#include <cmath>
+#include <vector>
+
+using namespace nmath;
+
+namespace bench {
+
+  static constexpr size_t c_count = 1 << 16;
+
+  template <typename ScalarFn, typename Vec8Fn, typename Vec4Fn>
+  static void compareFloat( const char* name, const std::vector<float>& in, std::vector<float>& out, ScalarFn scalar, Vec8Fn wide, Vec4Fn narrow )
+  {
+    const auto n = in.size();
+    const auto base = measure( [&]()
+    {
+      for ( size_t i = 0; i < n; ++i )
+        out[i] = scalar( in[i] );
+      sink = out[n / 2];
+    } );
+    const auto v8 = measure( [&]()
+    {
+      for ( size_t i = 0; i < n; i += 8 )
+      {
+        vec8f v;
+        v.loadUnaligned( &in[i] );
+        wide( v ).storeUnaligned( &out[i] );
+      }
+      sink = out[n / 2];
+    } );
+    const auto v4 = measure( [&]()
+    {
+      for ( size_t i = 0; i < n; i += 4 )
+      {
+        vec4f v;
+        v.loadUnaligned( &in[i] );
+        narrow( v ).storeUnaligned( &out[i] );
+      }
+      sink = out[n / 2];
+    } );
+    char label[64];
+    snprintf( label, sizeof( label ), "std::%s (float)", name );
+    report( label, base, static_cast<double>( n ) );
+    snprintf( label, sizeof( label ), "%s vec4f", name );
+    report( label, v4, static_cast<double>( n ), base );
+    snprintf( label, sizeof( label ), "%s vec8f", name );
+    report( label, v8, static_cast<double>( n ), base );
+  }
+
+  template <typename ScalarFn, typename VecFn>
+  static void compareDouble( const char* name, const std::vector<double>& in, std::vector<double>& out, ScalarFn scalar, VecFn wide )
+  {
+    const auto n = in.size();
+    const auto base = measure( [&]()
+    {
+      for ( size_t i = 0; i < n; ++i )
+        out[i] = scalar( in[i] );
+      sink = out[n / 2];
+    } );
+    const auto v4 = measure( [&]()
+    {
+      for ( size_t i = 0; i < n; i += 4 )
+      {
+        vec4d v;
+        v.loadUnaligned( &in[i] );
+        wide( v ).storeUnaligned( &out[i] );
+      }
+      sink = out[n / 2];
+    } );
+    char label[64];
+    snprintf( label, sizeof( label ), "std::%s (double)", name );
+    report( label, base, static_cast<double>( n ) );
+    snprintf( label, sizeof( label ), "%s vec4d", name );
+    report( label, v4, static_cast<double>( n ), base );
+  }
+
+  void vecmath()
+  {
+    header( "vecmath: transcendentals vs scalar libm" );
+    std::vector<float> inf( c_count ), outf( c_count );
+    std::vector<double> ind( c_count ), outd( c_count );
+    for ( size_t i = 0; i < c_count; ++i )
+    {
+      ind[i] = -20.0 + 40.0 * static_cast<double>( i ) / c_count;
+      inf[i] = static_cast<float>( ind[i] );
+    }
+    compareFloat( "exp", inf, outf, []( float x ) { return std::exp( x ); }, []( const vec8f& v ) { return exp( v ); }, []( const vec4f& v ) { return exp( v ); } );
+    compareFloat( "sin", inf, outf, []( float x ) { return std::sin( x ); }, []( const vec8f& v ) { return sin( v ); }, []( const vec4f& v ) { return sin( v ); } );
+    compareFloat( "cos", inf, outf, []( float x ) { return std::cos( x ); }, []( const vec8f& v ) { return cos( v ); }, []( const vec4f& v ) { return cos( v ); } );
+    compareFloat( "tan", inf, outf, []( float x ) { return std::tan( x ); }, []( const vec8f& v ) { return tan( v ); }, []( const vec4f& v ) { return tan( v ); } );
+    compareFloat( "atan2", inf, outf, []( float x ) { return std::atan2( x, 1.5f ); }, []( const vec8f& v ) { return atan2( v, vec8f( 1.5f ) ); }, []( const vec4f& v ) { return atan2( v, vec4f( 1.5f ) ); } );
+    compareDouble( "exp", ind, outd, []( double x ) { return std::exp( x ); }, []( const vec4d& v ) { return exp( v ); } );
+    compareDouble( "sin", ind, outd, []( double x ) { return std::sin( x ); }, []( const vec4d& v ) { return sin( v ); } );
+    compareDouble( "cos", ind, outd, []( double x ) { return std::cos( x ); }, []( const vec4d& v ) { return cos( v ); } );
+    compareDouble( "atan2", ind, outd, []( double x ) { return std::atan2( x, 1.5 ); }, []( const vec4d& v ) { return atan2( v, vec4d( 1.5 ) ); } );
+    // log & pow want positive inputs
+    for ( size_t i = 0; i < c_count; ++i )
+    {
+      ind[i] = std::exp( ind[i] );
+      inf[i] = static_cast<float>( ind[i] );
+    }
+    compareFloat( "log", inf, outf, []( float x ) { return std::log( x ); }, []( const vec8f& v ) { return log( v ); }, []( const vec4f& v ) { return log( v ); } );
+    compareFloat( "pow", inf, outf, []( float x ) { return std::pow( x, 1.7f ); }, []( const vec8f& v ) { return pow( v, vec8f( 1.7f ) ); }, []( const vec4f& v ) { return pow( v, vec4f( 1.7f ) ); } );
+    compareDouble( "log", ind, outd, []( double x ) { return std::log( x ); }, []( const vec4d& v ) { return log( v ); } );
+    compareDouble( "pow", ind, outd, []( double x ) { return std::pow( x, 1.7 ); }, []( const vec4d& v ) { return pow( v, vec4d( 1.7 ) ); } );
+  }
+
+}
@@ -0,0 +1,427 @@
+#ifndef NM_BIQUAD_H
+#define NM_BIQUAD_H
+
+#include "nm_common.h"
+#include "nm_cpu.h"
+#include "nm_vec4f.h"
+#include "nm_vec8f.h"
+#include "nm_vec4d.h"
+#include "nm_vecmath.h"
+#include "nm_memory.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// Biquad (second order IIR) filters with one filter per SIMD lane.
+//
+// The recursion of an IIR filter runs sample after sample, so a single
+// channel can't be split across lanes the way an FIR can. What does vectorize
+// is running independent filters in lockstep: biquadBank filters 4 or 8
+// channels of interleaved frames at once, one channel per lane, in vec4f,
+// vec8f or vec4d. biquadCascade gets a single channel through a chain of
+// sections by pipelining them, section k in lane k working on the sample
+// that section k - 1 finished one step earlier.
+//
+// Both run in transposed direct form II and can glide to new coefficients
+// with a one-pole smoother instead of jumping, which would click. While they
+// run, denormals are flushed to zero (FTZ & DAZ) so that decaying tails
+// don't fall off the slow path of the FPU; the caller's mode is restored after.
+
+namespace nmath {
+
+  inline namespace NMATH_ISA_NAMESPACE {
+
+    //! Coefficients of one biquad, normalized so that a0 = 1:
+    //! y[n] = b0 x[n] + b1 x[n-1] + b2 x[n-2] - a1 y[n-1] - a2 y[n-2].
+    //! The designs are those of the RBJ audio EQ cookbook; frequency & sampleRate
+    //! in Hz, gains in dB.
+    struct biquad {
+      double b0 = 1.0, b1 = 0.0, b2 = 0.0, a1 = 0.0, a2 = 0.0;
+      static biquad lowpass( const double sampleRate, const double frequency, const double q = 0.70710678118654752 )
+      {
+        const auto d = design( sampleRate, frequency, q );
+        return normalize( ( 1.0 - d.cosw ) * 0.5, 1.0 - d.cosw, ( 1.0 - d.cosw ) * 0.5, 1.0 + d.alpha, -2.0 * d.cosw, 1.0 - d.alpha );
+      }
+      static biquad highpass( const double sampleRate, const double frequency, const double q = 0.70710678118654752 )
+      {
+        const auto d = design( sampleRate, frequency, q );
+        return normalize( ( 1.0 + d.cosw ) * 0.5, -( 1.0 + d.cosw ), ( 1.0 + d.cosw ) * 0.5, 1.0 + d.alpha, -2.0 * d.cosw, 1.0 - d.alpha );
+      }
+      //! Band pass with 0 dB at the center
+      static biquad bandpass( const double sampleRate, const double frequency, const double q )
+      {
+        const auto d = design( sampleRate, frequency, q );
+        return normalize( d.alpha, 0.0, -d.alpha, 1.0 + d.alpha, -2.0 * d.cosw, 1.0 - d.alpha );
+      }
+      static biquad notch( const double sampleRate, const double frequency, const double q )
+      {
+        const auto d = design( sampleRate, frequency, q );
+        return normalize( 1.0, -2.0 * d.cosw, 1.0, 1.0 + d.alpha, -2.0 * d.cosw, 1.0 - d.alpha );
+      }
+      static biquad allpass( const double sampleRate, const double frequency, const double q )
+      {
+        const auto d = design( sampleRate, frequency, q );
+        return normalize( 1.0 - d.alpha, -2.0 * d.cosw, 1.0 + d.alpha, 1.0 + d.alpha, -2.0 * d.cosw, 1.0 - d.alpha );
+      }
+      static biquad peak( const double sampleRate, const double frequency, const double q, const double gainDb )
+      {
+        const auto d = design( sampleRate, frequency, q );
+        const double a = std::pow( 10.0, gainDb / 40.0 );
+        return normalize( 1.0 + d.alpha * a, -2.0 * d.cosw, 1.0 - d.alpha * a, 1.0 + d.alpha / a, -2.0 * d.cosw, 1.0 - d.alpha / a );
+      }
+      static biquad lowShelf( const double sampleRate, const double frequency, const double q, const double gainDb )
+      {
+        const auto d = design( sampleRate, frequency, q );
+        const double a = std::pow( 10.0, gainDb / 40.0 ), s = 2.0 * std::sqrt( a ) * d.alpha;
+        return normalize(
+          a * ( ( a + 1.0 ) - ( a - 1.0 ) * d.cosw + s ), 2.0 * a * ( ( a - 1.0 ) - ( a + 1.0 ) * d.cosw ), a * ( ( a + 1.0 ) - ( a - 1.0 ) * d.cosw - s ),
+          ( a + 1.0 ) + ( a - 1.0 ) * d.cosw + s, -2.0 * ( ( a - 1.0 ) + ( a + 1.0 ) * d.cosw ), ( a + 1.0 ) + ( a - 1.0 ) * d.cosw - s );
+      }
+      static biquad highShelf( const double sampleRate, const double frequency, const double q, const double gainDb )
+      {
+        const auto d = design( sampleRate, frequency, q );
+        const double a = std::pow( 10.0, gainDb / 40.0 ), s = 2.0 * std::sqrt( a ) * d.alpha;
+        return normalize(
+          a * ( ( a + 1.0 ) + ( a - 1.0 ) * d.cosw + s ), -2.0 * a * ( ( a - 1.0 ) + ( a + 1.0 ) * d.cosw ), a * ( ( a + 1.0 ) + ( a - 1.0 ) * d.cosw - s ),
+          ( a + 1.0 ) - ( a - 1.0 ) * d.cosw + s, 2.0 * ( ( a - 1.0 ) - ( a + 1.0 ) * d.cosw ), ( a + 1.0 ) - ( a - 1.0 ) * d.cosw - s );
+      }
+    private:
+      struct prototype {
+        double cosw, alpha;
+      };
+      static prototype design( const double sampleRate, const double frequency, const double q )
+      {
+        const double w = 6.283185307179586 * frequency / sampleRate;
+        return { std::cos( w ), std::sin( w ) / ( 2.0 * q ) };
+      }
+      static biquad normalize( const double b0, const double b1, const double b2, const double a0, const double a1, const double a2 )
+      {
+        biquad c;
+        c.b0 = b0 / a0;
+        c.b1 = b1 / a0;
+        c.b2 = b2 / a0;
+        c.a1 = a1 / a0;
+        c.a2 = a2 / a0;
+        return c;
+      }
+    };
+
+    namespace detail {
+
+      //! Unaligned loads & stores of a vector's worth of samples, & the lane shift
+      //! of the cascade, on top of vecmath
+      template <typename V>
+      struct biquadOps;
+
+      template <>
+      struct biquadOps<vec4f> {
+        using scalar = float;
+        static constexpr int lanes = 4;
+        static nmath_inline __m128 load( const float* p ) { return _mm_loadu_ps( p ); }
+        static nmath_inline void store( float* p, const __m128 v ) { _mm_storeu_ps( p, v ); }
+        //! ( x, v0, v1, v2 )
+        static nmath_inline __m128 shiftIn( const __m128 v, const float x )
+        {
+          return _mm_move_ss( _mm_castsi128_ps( _mm_slli_si128( _mm_castps_si128( v ), 4 ) ), _mm_set_ss( x ) );
+        }
+        static nmath_inline float last( const __m128 v ) { return _mm_cvtss_f32( _mm_shuffle_ps( v, v, _MM_SHUFFLE( 3, 3, 3, 3 ) ) ); }
+        static nmath_inline __m128 laneIndex() { return _mm_setr_ps( 0.0f, 1.0f, 2.0f, 3.0f ); }
+      };
+
+      template <>
+      struct biquadOps<vec8f> {
+        using scalar = float;
+        static constexpr int lanes = 8;
+        static nmath_inline __m256 load( const float* p ) { return _mm256_loadu_ps( p ); }
+        static nmath_inline void store( float* p, const __m256 v ) { _mm256_storeu_ps( p, v ); }
+        //! ( x, v0, v1, .. v6 )
+        static nmath_inline __m256 shiftIn( const __m256 v, const float x )
+        {
+          // rotate each half up by one, then move v3 over from the low half into lane 4
+          const auto r = _mm256_permute_ps( v, _MM_SHUFFLE( 2, 1, 0, 3 ) );
+          const auto carry = _mm256_permute2f128_ps( r, r, 0x08 );
+          return _mm256_blend_ps( _mm256_blend_ps( r, carry, 0x11 ), _mm256_set1_ps( x ), 0x01 );
+        }
+        static nmath_inline float last( const __m256 v )
+        {
+          const auto hi = _mm256_extractf128_ps( v, 1 );
+          return _mm_cvtss_f32( _mm_shuffle_ps( hi, hi, _MM_SHUFFLE( 3, 3, 3, 3 ) ) );
+        }
+        static nmath_inline __m256 laneIndex() { return _mm256_setr_ps( 0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f ); }
+      };
+
+      template <>
+      struct biquadOps<vec4d> {
+        using scalar = double;
+        static constexpr int lanes = 4;
+        static nmath_inline __m256d load( const double* p ) { return _mm256_loadu_pd( p ); }
+        static nmath_inline void store( double* p, const __m256d v ) { _mm256_storeu_pd( p, v ); }
+        //! ( x, v0, v1, v2 )
+        static nmath_inline __m256d shiftIn( const __m256d v, const double x )
+        {
+          // low half of v into the high half, zeroing the low one, then interleave
+          const auto up = _mm256_permute2f128_pd( v, v, 0x08 );
+          return _mm256_blend_pd( _mm256_shuffle_pd( up, v, 0b0100 ), _mm256_set1_pd( x ), 0x1 );
+        }
+        static nmath_inline double last( const __m256d v )
+        {
+          const auto hi = _mm256_extractf128_pd( v, 1 );
+          return _mm_cvtsd_f64( _mm_unpackhi_pd( hi, hi ) );
+        }
+        static nmath_inline __m256d laneIndex() { return _mm256_setr_pd( 0.0, 1.0, 2.0, 3.0 ); }
+      };
+
+      //! One biquad per lane: coefficients, the targets they glide to & the state
+      template <typename V>
+      class biquadLanes {
+      public:
+        using T = vecmath<V>;
+        using O = biquadOps<V>;
+        using reg = typename T::reg;
+        using scalar = typename O::scalar;
+        static constexpr int lanes = O::lanes;
+      private:
+        V c_[5]; //!< b0, b1, b2, a1, a2
+        V target_[5];
+        V z1_, z2_;
+        V rate_; //!< fraction of the way to the targets covered per sample
+        size_t glideLength_ = 0; //!< samples until a glide is within rounding of its targets
+        size_t glideLeft_ = 0;
+        static void setLane( V& v, const int lane, const double value )
+        {
+          reinterpret_cast<scalar*>( &v )[lane] = static_cast<scalar>( value );
+        }
+      public:
+        biquadLanes()
+        {
+          for ( int i = 0; i < lanes; ++i )
+            set( i, biquad(), false );
+          glideTime( 0.0 );
+        }
+        //! Filter lane i with c, jumping there or gliding from the current
+        //! coefficients; with a glide time of 0 there is no glide & it jumps either way
+        void set( const int i, const biquad& c, const bool glide )
+        {
+          const bool jump = !glide || !glideLength_;
+          const double values[5] = { c.b0, c.b1, c.b2, c.a1, c.a2 };
+          for ( int k = 0; k < 5; ++k )
+          {
+            setLane( target_[k], i, values[k] );
+            if ( jump )
+              setLane( c_[k], i, values[k] );
+          }
+          if ( !jump )
+            glideLeft_ = glideLength_;
+        }
+        //! Time constant of the glide in samples; 0 jumps straight to new coefficients
+        void glideTime( const double samples )
+        {
+          rate_ = V( static_cast<scalar>( samples > 0.0 ? 1.0 - std::exp( -1.0 / samples ) : 1.0 ) );
+          // e^-40 is below the rounding of double coefficients
+          glideLength_ = static_cast<size_t>( std::ceil( 40.0 * std::max( samples, 0.0 ) ) );
+          // cutting a glide short lands on its targets, as settle would
+          glideLeft_ = std::min( glideLeft_, glideLength_ );
+          if ( !glideLeft_ )
+          {
+            for ( int k = 0; k < 5; ++k )
+              c_[k] = target_[k];
+          }
+        }
+        void reset()
+        {
+          z1_ = V( scalar( 0 ) );
+          z2_ = V( scalar( 0 ) );
+        }
+        bool gliding() const
+        {
+          return glideLeft_ > 0;
+        }
+        //! One sample per lane through the filters, updating the state in valid lanes only
+        template <bool Glide, bool Masked>
+        nmath_inline reg step( const reg x, const reg valid = reg() )
+        {
+          if constexpr ( Glide )
+          {
+            for ( int k = 0; k < 5; ++k )
+              c_[k].packed = T::madd( T::sub( target_[k].packed, c_[k].packed ), rate_.packed, c_[k].packed );
+          }
+          const reg y = T::madd( c_[0].packed, x, z1_.packed );
+          const reg z1 = T::sub( T::madd( c_[1].packed, x, z2_.packed ), T::mul( c_[3].packed, y ) );
+          const reg z2 = T::sub( T::mul( c_[2].packed, x ), T::mul( c_[4].packed, y ) );
+          if constexpr ( Masked )
+          {
+            z1_.packed = T::select( valid, z1, z1_.packed );
+            z2_.packed = T::select( valid, z2, z2_.packed );
+          }
+          else
+          {
+            z1_.packed = z1;
+            z2_.packed = z2;
+          }
+          return y;
+        }
+        //! After a block of count samples of gliding: snap to the targets once the
+        //! glide has run long enough to be within rounding of them anyway
+        void settle( const size_t count )
+        {
+          glideLeft_ -= std::min( glideLeft_, count );
+          if ( !glideLeft_ )
+          {
+            for ( int k = 0; k < 5; ++k )
+              c_[k] = target_[k];
+          }
+        }
+      };
+
+    }
+
+    //! lanes independent biquads, one per channel of interleaved frames.
+    //! V is vec4f or vec8f for 4 or 8 float channels, or vec4d for 4 double channels.
+    template <typename V>
+    class biquadBank {
+    public:
+      using scalar = typename detail::biquadOps<V>::scalar;
+      static constexpr int channels = detail::biquadOps<V>::lanes;
+    private:
+      detail::biquadLanes<V> lanes_;
+      template <bool Glide>
+      void run( const scalar* in, scalar* out, const size_t frames )
+      {
+        using O = detail::biquadOps<V>;
+        for ( size_t n = 0; n < frames; ++n )
+          O::store( out + n * channels, lanes_.template step<Glide, false>( O::load( in + n * channels ) ) );
+      }
+    public:
+      //! All channels pass through unchanged until set
+      biquadBank() = default;
+      //! Filter channel with c. With glide the coefficients move there over the
+      //! glide time, otherwise they jump, as they do with the default glide time of 0.
+      void set( const int channel, const biquad& c, const bool glide = true )
+      {
+        lanes_.set( channel, c, glide );
+      }
+      //! The same filter on every channel
+      void setAll( const biquad& c, const bool glide = true )
+      {
+        for ( int i = 0; i < channels; ++i )
+          lanes_.set( i, c, glide );
+      }
+      //! Time constant of coefficient glides in samples, 0 to jump. Defaults to 0.
+      void glideTime( const double samples )
+      {
+        lanes_.glideTime( samples );
+      }
+      //! Clear the filter state, as after silence
+      void reset()
+      {
+        lanes_.reset();
+      }
+      //! Filter frames frames of channels interleaved samples from in to out, which
+      //! may be the same buffer. Planar buffers can go through interleave first.
+      void process( const scalar* in, scalar* out, const size_t frames )
+      {
+        const denormalGuard ftz;
+        if ( lanes_.gliding() )
+        {
+          run<true>( in, out, frames );
+          lanes_.settle( frames );
+        }
+        else
+          run<false>( in, out, frames );
+      }
+    };
+
+    //! A single channel through any number of biquad sections in series, for high
+    //! order filters. Sections run lanes at a time, pipelined across the lanes of V:
+    //! each step takes a new sample into lane 0 & hands every lane's output to the
+    //! next lane. A block of n samples takes n + lanes - 1 steps per group of lanes,
+    //! the extra ones finishing the block in the later sections, so there is no latency.
+    template <typename V>
+    class biquadCascade {
+    public:
+      using scalar = typename detail::biquadOps<V>::scalar;
+      static constexpr int lanes = detail::biquadOps<V>::lanes;
+    private:
+      aligned_vector<detail::biquadLanes<V>> groups_;
+      size_t sections_ = 0;
+      template <bool Glide>
+      static void run( detail::biquadLanes<V>& g, const scalar* in, scalar* out, const size_t count )
+      {
+        using T = detail::vecmath<V>;
+        using O = detail::biquadOps<V>;
+        const auto index = O::laneIndex();
+        typename T::reg y = T::set1( scalar( 0 ) );
+        const size_t steps = count + lanes - 1;
+        for ( size_t t = 0; t < steps; ++t )
+        {
+          const auto x = O::shiftIn( y, t < count ? in[t] : scalar( 0 ) );
+          if ( t + 1 < lanes || t >= count )
+          {
+            // lane k is at sample t - k, which is only in this block for 0 <= t - k < count
+            const auto started = T::lt( index, T::set1( static_cast<scalar>( t + 1 ) ) );
+            const auto unfinished = T::lt( T::set1( static_cast<scalar>( t ) - static_cast<scalar>( count ) ), index );
+            y = g.template step<Glide, true>( x, T::and_( started, unfinished ) );
+          }
+          else
+            y = g.template step<Glide, false>( x );
+          if ( t + 1 >= lanes )
+            out[t + 1 - lanes] = O::last( y );
+        }
+      }
+    public:
+      //! sections sections, all passing the signal through unchanged until set
+      explicit biquadCascade( const size_t sections = 1 )
+      {
+        resize( sections );
+      }
+      //! Change the number of sections, keeping those that remain
+      void resize( const size_t sections )
+      {
+        sections_ = sections;
+        groups_.resize( ( sections + lanes - 1 ) / lanes );
+      }
+      size_t size() const
+      {
+        return sections_;
+      }
+      //! Filter section with c, gliding there or jumping like biquadBank::set
+      void set( const size_t section, const biquad& c, const bool glide = true )
+      {
+        groups_[section / lanes].set( static_cast<int>( section % lanes ), c, glide );
+      }
+      //! Time constant of coefficient glides in samples, 0 to jump. Defaults to 0.
+      void glideTime( const double samples )
+      {
+        for ( auto& g : groups_ )
+          g.glideTime( samples );
+      }
+      void reset()
+      {
+        for ( auto& g : groups_ )
+          g.reset();
+      }
+      //! Filter count samples from in to out, which may be the same buffer
+      void process( const scalar* in, scalar* out, const size_t count )
+      {
+        const denormalGuard ftz;
+        for ( auto& g : groups_ )
+        {
+          if ( g.gliding() )
+          {
+            run<true>( g, in, out, count );
+            g.settle( count );
+          }
+          else
+            run<false>( g, in, out, count );
+          in = out;
+        }
+        if ( groups_.empty() && in != out )
+          std::copy( in, in + count, out );
+      }
+    };
+
+  }
+
+}
+
+#endif
@@ -0,0 +1,338 @@
+#ifndef NM_BROADPHASE_H
+#define NM_BROADPHASE_H
+
+#include "nm_common.h"
+#include "nm_ray.h"
+#include "nm_soa.h"
+#include "nm_memory.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Collision broadphase: the pairs of bodies whose axis aligned boxes overlap.
+//
+// Both finders test one box against the next eight at a time with vec8f
+// compares, from copies of the boxes laid out structure-of-arrays in the order
+// they are visited. sweepAndPrune sorts the boxes along x & only tests boxes
+// whose x ranges overlap; the sort starts from the previous call's order, so
+// with bodies that move little between frames it is close to linear.
+// uniformGrid bins boxes into cells of a fixed size & only tests boxes sharing
+// a cell, which holds up better in dense scenes where many x ranges overlap.
+//
+// Pairs go to a buffer owned by the caller. When it is too small the finders
+// still return how many pairs there are, so it can be grown & the call repeated.
+
+namespace nmath {
+
+  inline namespace NMATH_ISA_NAMESPACE {
+
+    //! Two overlapping bodies, a < b
+    struct bodyPair {
+      uint32_t a, b;
+      bool operator == ( const bodyPair& rhs ) const
+      {
+        return ( a == rhs.a && b == rhs.b );
+      }
+      bool operator < ( const bodyPair& rhs ) const
+      {
+        return ( a < rhs.a || ( a == rhs.a && b < rhs.b ) );
+      }
+    };
+
+    //! Mask of the lanes where the boxes of a & b overlap, bit i for lane i.
+    //! Boxes are closed, so boxes that only touch overlap. Splat one box with
+    //! aabb8f::splat to test it against eight.
+    nmath_inline int overlap( const aabb8f& a, const aabb8f& b )
+    {
+      auto both = _mm256_and_ps( _mm256_cmp_ps( a.minX.packed, b.maxX.packed, _CMP_LE_OQ ), _mm256_cmp_ps( b.minX.packed, a.maxX.packed, _CMP_LE_OQ ) );
+      both = _mm256_and_ps( both, _mm256_and_ps( _mm256_cmp_ps( a.minY.packed, b.maxY.packed, _CMP_LE_OQ ), _mm256_cmp_ps( b.minY.packed, a.maxY.packed, _CMP_LE_OQ ) ) );
+      both = _mm256_and_ps( both, _mm256_and_ps( _mm256_cmp_ps( a.minZ.packed, b.maxZ.packed, _CMP_LE_OQ ), _mm256_cmp_ps( b.minZ.packed, a.maxZ.packed, _CMP_LE_OQ ) ) );
+      return _mm256_movemask_ps( both );
+    }
+
+    namespace detail {
+
+      //! Boxes as six component arrays, with eight spare entries past the end so
+      //! that a box can always be tested against the next eight
+      struct broadphaseBoxes {
+        buffer<float> minX, minY, minZ, maxX, maxY, maxZ;
+        void resize( const size_t count )
+        {
+          for ( auto b : { &minX, &minY, &minZ, &maxX, &maxY, &maxZ } )
+            b->resize( count + 8 );
+        }
+        nmath_inline void set( const size_t i, const soa3f& lo, const soa3f& hi, const size_t body )
+        {
+          minX[i] = lo.x[body];
+          minY[i] = lo.y[body];
+          minZ[i] = lo.z[body];
+          maxX[i] = hi.x[body];
+          maxY[i] = hi.y[body];
+          maxZ[i] = hi.z[body];
+        }
+        //! Box i in all lanes
+        nmath_inline aabb8f splat( const size_t i ) const
+        {
+          aabb8f b;
+          b.minX = vec8f( minX[i] );
+          b.minY = vec8f( minY[i] );
+          b.minZ = vec8f( minZ[i] );
+          b.maxX = vec8f( maxX[i] );
+          b.maxY = vec8f( maxY[i] );
+          b.maxZ = vec8f( maxZ[i] );
+          return b;
+        }
+        //! Boxes first to first + 7
+        nmath_inline aabb8f load( const size_t first ) const
+        {
+          aabb8f b;
+          b.minX.loadUnaligned( &minX[first] );
+          b.minY.loadUnaligned( &minY[first] );
+          b.minZ.loadUnaligned( &minZ[first] );
+          b.maxX.loadUnaligned( &maxX[first] );
+          b.maxY.loadUnaligned( &maxY[first] );
+          b.maxZ.loadUnaligned( &maxZ[first] );
+          return b;
+        }
+      };
+
+      //! Append the pair of bodies a & b if there is room, & count it either way
+      nmath_inline void addPair( bodyPair* pairs, const size_t capacity, size_t& found, const uint32_t a, const uint32_t b )
+      {
+        if ( found < capacity )
+          pairs[found] = ( a < b ? bodyPair{ a, b } : bodyPair{ b, a } );
+        ++found;
+      }
+
+    }
+
+    //! Sweep and prune along x, keeping the sorted order from call to call
+    class sweepAndPrune {
+    public:
+      struct entry {
+        float key; //!< min x
+        uint32_t body;
+      };
+    private:
+      std::vector<entry> order_; //!< bodies by increasing min x as of the last call
+      detail::broadphaseBoxes sorted_; //!< boxes in that order
+      //! Insertion sort order_, giving up once it has moved entries more than
+      //! budget places in total. Returns whether it finished.
+      bool resort( const size_t budget )
+      {
+        size_t moves = 0;
+        for ( size_t i = 1; i < order_.size(); ++i )
+        {
+          const auto e = order_[i];
+          size_t j = i;
+          for ( ; j > 0 && order_[j - 1].key > e.key; --j )
+            order_[j] = order_[j - 1];
+          order_[j] = e;
+          moves += i - j;
+          if ( moves > budget )
+            return false;
+        }
+        return true;
+      }
+    public:
+      //! Forget the order, so that the next call sorts from scratch
+      void reset()
+      {
+        order_.clear();
+      }
+      //! Find the overlapping pairs among the boxes from lo[i] to hi[i], writing up
+      //! to capacity of them to pairs in no particular order. Returns the number
+      //! of pairs, which is more than capacity when some didn't fit.
+      size_t findPairs( const soa3f& lo, const soa3f& hi, bodyPair* pairs, const size_t capacity )
+      {
+        const size_t count = lo.size();
+        if ( order_.size() != count )
+        {
+          order_.resize( count );
+          for ( size_t i = 0; i < count; ++i )
+            order_[i].body = static_cast<uint32_t>( i );
+        }
+        for ( auto& e : order_ )
+          e.key = lo.x[e.body];
+        // a few moves per body is what coherent motion costs, beyond that a full sort is cheaper
+        if ( !resort( 8 * count ) )
+          std::sort( order_.begin(), order_.end(), []( const entry& a, const entry& b ) { return a.key < b.key; } );
+
+        sorted_.resize( count );
+        for ( size_t i = 0; i < count; ++i )
+          sorted_.set( i, lo, hi, order_[i].body );
+        // past the end, boxes that start beyond everything & end the sweep
+        for ( size_t i = count; i < count + 8; ++i )
+          sorted_.minX[i] = std::numeric_limits<float>::infinity();
+
+        size_t found = 0;
+        for ( size_t i = 0; i < count; ++i )
+        {
+          const auto box = sorted_.splat( i );
+          const float reach = sorted_.maxX[i];
+          // everything from i + 1 on starts at or after box i's min x, so x overlaps
+          // for as long as it starts before box i's max x
+          // (the sentinels don't stop a box reaching to +inf, so count still bounds it)
+          for ( size_t first = i + 1; first < count && sorted_.minX[first] <= reach; first += 8 )
+          {
+            int mask = overlap( box, sorted_.load( first ) );
+            if ( count - first < 8 )
+              mask &= ( 1 << ( count - first ) ) - 1;
+            for ( ; mask; mask &= mask - 1 )
+            {
+              const size_t j = first + std::countr_zero( static_cast<unsigned>( mask ) );
+              detail::addPair( pairs, capacity, found, order_[i].body, order_[j].body );
+            }
+          }
+        }
+        return found;
+      }
+      //! Bodies by increasing min x as of the last call
+      const std::vector<entry>& order() const
+      {
+        return order_;
+      }
+    };
+
+    //! Uniform grid of cubic cells, hashed so that the world needs no bounds.
+    //! Every box is entered into each cell it overlaps, so the cell size should be
+    //! one to two times the size of a typical box: much smaller & boxes fill many
+    //! cells, much larger & each cell holds many boxes that are tested against each other.
+    //! Boxes must be finite & span a modest number of cells: coordinates are clamped
+    //! to the 2^21 cells per axis that the keys hold, so a box reaching to infinity
+    //! would be entered into millions of cells at least. sweepAndPrune handles those.
+    class uniformGrid {
+    private:
+      float cellSize_, inverse_;
+      std::vector<int32_t> ranges_; //!< per body, first & last cell along x, y & z
+      std::vector<uint32_t> hashes_; //!< bucket of each body & cell, in body order
+      std::vector<uint32_t> starts_; //!< first entry of each bucket, & the end
+      std::vector<uint32_t> bodies_; //!< body per entry
+      std::vector<uint64_t> cells_; //!< cell per entry
+      detail::broadphaseBoxes entries_; //!< box per entry
+      int shift_ = 64;
+      nmath_inline int32_t cellOf( const float v ) const
+      {
+        // clamped first, as casting an out of range float is undefined (NaN ends up low)
+        constexpr float limit = float( 1 << 20 );
+        return static_cast<int32_t>( std::floor( std::max( -limit, std::min( v * inverse_, limit - 1.0f ) ) ) );
+      }
+      nmath_inline static uint64_t cellKey( const int32_t x, const int32_t y, const int32_t z )
+      {
+        const uint64_t bits = 0x1FFFFF;
+        return ( static_cast<uint64_t>( x ) & bits ) | ( ( static_cast<uint64_t>( y ) & bits ) << 21 ) | ( ( static_cast<uint64_t>( z ) & bits ) << 42 );
+      }
+      nmath_inline uint32_t bucketOf( const uint64_t key ) const
+      {
+        return static_cast<uint32_t>( ( key * 0x9E3779B97F4A7C15ull ) >> shift_ );
+      }
+    public:
+      explicit uniformGrid( const float cellSize ): cellSize_( cellSize ), inverse_( 1.0f / cellSize )
+      {
+      }
+      float cellSize() const
+      {
+        return cellSize_;
+      }
+      //! As sweepAndPrune::findPairs
+      size_t findPairs( const soa3f& lo, const soa3f& hi, bodyPair* pairs, const size_t capacity )
+      {
+        const size_t count = lo.size();
+        ranges_.resize( 6 * count );
+        size_t total = 0;
+        for ( size_t i = 0; i < count; ++i )
+        {
+          int32_t* r = &ranges_[6 * i];
+          r[0] = cellOf( lo.x[i] );
+          r[1] = cellOf( hi.x[i] );
+          r[2] = cellOf( lo.y[i] );
+          r[3] = cellOf( hi.y[i] );
+          r[4] = cellOf( lo.z[i] );
+          r[5] = cellOf( hi.z[i] );
+          total += size_t( r[1] - r[0] + 1 ) * size_t( r[3] - r[2] + 1 ) * size_t( r[5] - r[4] + 1 );
+        }
+        // at least two buckets per entry keeps unrelated cells from sharing buckets
+        const int bits = std::max( 1, static_cast<int>( std::bit_width( 2 * total - ( total > 0 ) ) ) );
+        shift_ = 64 - bits;
+        const size_t buckets = size_t( 1 ) << bits;
+
+        // counting sort of the entries by bucket
+        starts_.assign( buckets + 1, 0 );
+        hashes_.resize( total );
+        size_t e = 0;
+        for ( size_t i = 0; i < count; ++i )
+        {
+          const int32_t* r = &ranges_[6 * i];
+          for ( int32_t z = r[4]; z <= r[5]; ++z )
+            for ( int32_t y = r[2]; y <= r[3]; ++y )
+              for ( int32_t x = r[0]; x <= r[1]; ++x )
+                ++starts_[hashes_[e++] = bucketOf( cellKey( x, y, z ) )];
+        }
+        uint32_t sum = 0;
+        for ( auto& s : starts_ )
+        {
+          const uint32_t n = s;
+          s = sum;
+          sum += n;
+        }
+        bodies_.resize( total );
+        cells_.resize( total );
+        entries_.resize( total );
+        e = 0;
+        for ( size_t i = 0; i < count; ++i )
+        {
+          const int32_t* r = &ranges_[6 * i];
+          for ( int32_t z = r[4]; z <= r[5]; ++z )
+            for ( int32_t y = r[2]; y <= r[3]; ++y )
+              for ( int32_t x = r[0]; x <= r[1]; ++x )
+              {
+                const uint32_t slot = starts_[hashes_[e++]]++;
+                bodies_[slot] = static_cast<uint32_t>( i );
+                cells_[slot] = cellKey( x, y, z );
+                entries_.set( slot, lo, hi, i );
+              }
+        }
+        // the fill moved every start to the next bucket's
+        for ( size_t b = buckets; b > 0; --b )
+          starts_[b] = starts_[b - 1];
+        starts_[0] = 0;
+
+        size_t found = 0;
+        for ( size_t b = 0; b < buckets; ++b )
+        {
+          const uint32_t end = starts_[b + 1];
+          for ( uint32_t i = starts_[b]; i + 1 < end; ++i )
+          {
+            const auto box = entries_.splat( i );
+            for ( uint32_t first = i + 1; first < end; first += 8 )
+            {
+              int mask = overlap( box, entries_.load( first ) );
+              if ( end - first < 8 )
+                mask &= ( 1 << ( end - first ) ) - 1;
+              for ( ; mask; mask &= mask - 1 )
+              {
+                const uint32_t j = first + std::countr_zero( static_cast<unsigned>( mask ) );
+                // a pair sharing several cells is only reported from the one holding
+                // the low corner of the overlap; other cells in the bucket don't count
+                if ( cells_[j] != cells_[i] )
+                  continue;
+                const auto corner = cellKey( cellOf( std::max( entries_.minX[i], entries_.minX[j] ) ),
+                  cellOf( std::max( entries_.minY[i], entries_.minY[j] ) ), cellOf( std::max( entries_.minZ[i], entries_.minZ[j] ) ) );
+                if ( corner == cells_[i] )
+                  detail::addPair( pairs, capacity, found, bodies_[i], bodies_[j] );
+              }
+            }
+          }
+        }
+        return found;
+      }
+    };
+
+  }
+
+}
+
+#endif
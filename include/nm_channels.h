@@ -0,0 +1,304 @@
+#ifndef NM_CHANNELS_H
+#define NM_CHANNELS_H
+
+#include "nm_common.h"
+#include "nm_vec8f.h"
+#include "nm_vecmath.h"
+#include "nm_soa.h"
+#include <type_traits>
+#include <utility>
+
+// Moving audio between interleaved frames & planar channels.
+//
+// Audio APIs & files deliver interleaved frames, L R L R..., while filters
+// want each channel contiguous. The kernels here transpose eight frames at a
+// time in registers, one vec8f per channel, for the common layouts of 1, 2,
+// 3, 4, 6 (5.1) & 8 (7.1) channels; other counts take a scalar loop. The same
+// register transposes serve splat, which copies a mono signal to every
+// channel of a frame, & remix, which applies a gain matrix for up & down mixes.
+
+namespace nmath {
+
+  inline namespace NMATH_ISA_NAMESPACE {
+
+    namespace detail {
+
+      template <class Fn, int... K>
+      nmath_inline void unroll( const Fn& fn, std::integer_sequence<int, K...> )
+      {
+        ( fn( K ), ... );
+      }
+
+      //! fn( 0 ) to fn( N - 1 ) written out, so that arrays of vectors indexed by
+      //! the argument stay in registers; GCC at -O2 keeps them in memory otherwise
+      template <int N, class Fn>
+      nmath_inline void unroll( const Fn& fn )
+      {
+        unroll( fn, std::make_integer_sequence<int, N>() );
+      }
+
+      //! Transpose eight rows of eight floats
+      nmath_inline void transpose8x8( __m256* r )
+      {
+        const auto t0 = _mm256_unpacklo_ps( r[0], r[1] ), t1 = _mm256_unpackhi_ps( r[0], r[1] );
+        const auto t2 = _mm256_unpacklo_ps( r[2], r[3] ), t3 = _mm256_unpackhi_ps( r[2], r[3] );
+        const auto t4 = _mm256_unpacklo_ps( r[4], r[5] ), t5 = _mm256_unpackhi_ps( r[4], r[5] );
+        const auto t6 = _mm256_unpacklo_ps( r[6], r[7] ), t7 = _mm256_unpackhi_ps( r[6], r[7] );
+        // columns k in the low lanes & k + 4 in the high lanes, rows 0-3 & 4-7
+        const auto s0 = _mm256_shuffle_ps( t0, t2, _MM_SHUFFLE( 1, 0, 1, 0 ) ), s1 = _mm256_shuffle_ps( t0, t2, _MM_SHUFFLE( 3, 2, 3, 2 ) );
+        const auto s2 = _mm256_shuffle_ps( t1, t3, _MM_SHUFFLE( 1, 0, 1, 0 ) ), s3 = _mm256_shuffle_ps( t1, t3, _MM_SHUFFLE( 3, 2, 3, 2 ) );
+        const auto s4 = _mm256_shuffle_ps( t4, t6, _MM_SHUFFLE( 1, 0, 1, 0 ) ), s5 = _mm256_shuffle_ps( t4, t6, _MM_SHUFFLE( 3, 2, 3, 2 ) );
+        const auto s6 = _mm256_shuffle_ps( t5, t7, _MM_SHUFFLE( 1, 0, 1, 0 ) ), s7 = _mm256_shuffle_ps( t5, t7, _MM_SHUFFLE( 3, 2, 3, 2 ) );
+        r[0] = _mm256_permute2f128_ps( s0, s4, 0x20 );
+        r[1] = _mm256_permute2f128_ps( s1, s5, 0x20 );
+        r[2] = _mm256_permute2f128_ps( s2, s6, 0x20 );
+        r[3] = _mm256_permute2f128_ps( s3, s7, 0x20 );
+        r[4] = _mm256_permute2f128_ps( s0, s4, 0x31 );
+        r[5] = _mm256_permute2f128_ps( s1, s5, 0x31 );
+        r[6] = _mm256_permute2f128_ps( s2, s6, 0x31 );
+        r[7] = _mm256_permute2f128_ps( s3, s7, 0x31 );
+      }
+
+      //! Eight frames of C interleaved channels into one vector per channel
+      template <int C>
+      nmath_inline void loadFrames( const float* __restrict frames, __m256* ch )
+      {
+        static_assert( C == 1 || C == 2 || C == 3 || C == 4 || C == 6 || C == 8, "no transpose for this many channels" );
+        if constexpr ( C == 1 )
+          ch[0] = _mm256_loadu_ps( frames );
+        else if constexpr ( C == 2 )
+        {
+          const auto a = _mm256_loadu_ps( frames );
+          const auto b = _mm256_loadu_ps( frames + 8 );
+          const auto lo = _mm256_permute2f128_ps( a, b, 0x20 );
+          const auto hi = _mm256_permute2f128_ps( a, b, 0x31 );
+          ch[0] = _mm256_shuffle_ps( lo, hi, _MM_SHUFFLE( 2, 0, 2, 0 ) );
+          ch[1] = _mm256_shuffle_ps( lo, hi, _MM_SHUFFLE( 3, 1, 3, 1 ) );
+        }
+        else if constexpr ( C == 3 || C == 4 )
+        {
+          vec8f v[4];
+          if constexpr ( C == 3 )
+            transpose8x3( frames, v[0], v[1], v[2] );
+          else
+            transpose8x4( frames, v[0], v[1], v[2], v[3] );
+          unroll<C>( [&]( int c ) { ch[c] = v[c].packed; } );
+        }
+        else if constexpr ( C == 6 )
+        {
+          // each frame read as a row of eight, the last two being the next frame's;
+          // the last frame reads only its own six
+          __m256 r[8];
+          unroll<7>( [&]( int f ) { r[f] = _mm256_loadu_ps( frames + 6 * f ); } );
+          const auto last = _mm_loadl_pi( _mm_setzero_ps(), reinterpret_cast<const __m64*>( frames + 46 ) );
+          r[7] = _mm256_insertf128_ps( _mm256_castps128_ps256( _mm_loadu_ps( frames + 42 ) ), last, 1 );
+          transpose8x8( r );
+          unroll<6>( [&]( int c ) { ch[c] = r[c]; } );
+        }
+        else
+        {
+          __m256 r[8];
+          unroll<8>( [&]( int f ) { r[f] = _mm256_loadu_ps( frames + 8 * f ); } );
+          transpose8x8( r );
+          unroll<8>( [&]( int c ) { ch[c] = r[c]; } );
+        }
+      }
+
+      //! One vector per channel into eight frames of C interleaved channels
+      template <int C>
+      nmath_inline void storeFrames( const __m256* ch, float* __restrict frames )
+      {
+        static_assert( C == 1 || C == 2 || C == 3 || C == 4 || C == 6 || C == 8, "no transpose for this many channels" );
+        if constexpr ( C == 1 )
+          _mm256_storeu_ps( frames, ch[0] );
+        else if constexpr ( C == 2 )
+        {
+          const auto lo = _mm256_unpacklo_ps( ch[0], ch[1] );
+          const auto hi = _mm256_unpackhi_ps( ch[0], ch[1] );
+          _mm256_storeu_ps( frames, _mm256_permute2f128_ps( lo, hi, 0x20 ) );
+          _mm256_storeu_ps( frames + 8, _mm256_permute2f128_ps( lo, hi, 0x31 ) );
+        }
+        else if constexpr ( C == 3 )
+          transpose3x8( vec8f( ch[0] ), vec8f( ch[1] ), vec8f( ch[2] ), frames );
+        else if constexpr ( C == 4 )
+          transpose4x8( vec8f( ch[0] ), vec8f( ch[1] ), vec8f( ch[2] ), vec8f( ch[3] ), frames );
+        else if constexpr ( C == 6 )
+        {
+          __m256 r[8] = { ch[0], ch[1], ch[2], ch[3], ch[4], ch[5], _mm256_setzero_ps(), _mm256_setzero_ps() };
+          transpose8x8( r );
+          // rows of eight in order, each overwriting the two extra floats of the
+          // one before; the last frame stores only its own six
+          unroll<7>( [&]( int f ) { _mm256_storeu_ps( frames + 6 * f, r[f] ); } );
+          _mm_storeu_ps( frames + 42, _mm256_castps256_ps128( r[7] ) );
+          _mm_storel_pi( reinterpret_cast<__m64*>( frames + 46 ), _mm256_extractf128_ps( r[7], 1 ) );
+        }
+        else
+        {
+          __m256 r[8];
+          unroll<8>( [&]( int c ) { r[c] = ch[c]; } );
+          transpose8x8( r );
+          unroll<8>( [&]( int f ) { _mm256_storeu_ps( frames + 8 * f, r[f] ); } );
+        }
+      }
+
+      template <int C>
+      nmath_inline void deinterleave( const float* __restrict frames, float* const* planar, const size_t count )
+      {
+        size_t i = 0;
+        for ( ; i + 8 <= count; i += 8 )
+        {
+          __m256 ch[C];
+          loadFrames<C>( frames + C * i, ch );
+          unroll<C>( [&]( int c ) { _mm256_storeu_ps( planar[c] + i, ch[c] ); } );
+        }
+        for ( const float* f = frames + C * i; i < count; ++i, f += C )
+          for ( int c = 0; c < C; ++c )
+            planar[c][i] = f[c];
+      }
+
+      template <int C>
+      nmath_inline void interleave( const float* const* planar, float* __restrict frames, const size_t count )
+      {
+        size_t i = 0;
+        for ( ; i + 8 <= count; i += 8 )
+        {
+          __m256 ch[C];
+          unroll<C>( [&]( int c ) { ch[c] = _mm256_loadu_ps( planar[c] + i ); } );
+          storeFrames<C>( ch, frames + C * i );
+        }
+        for ( float* f = frames + C * i; i < count; ++i, f += C )
+          for ( int c = 0; c < C; ++c )
+            f[c] = planar[c][i];
+      }
+
+      template <int C>
+      nmath_inline void splat( const float* __restrict mono, float* __restrict frames, const size_t count )
+      {
+        size_t i = 0;
+        for ( ; i + 8 <= count; i += 8 )
+        {
+          vec8f v;
+          v.loadUnaligned( mono + i );
+          if constexpr ( C == 4 )
+          {
+            // four copies of each sample is unpack8x4's pattern
+            vec8f a, b, c, d;
+            v.unpack8x4( a, b, c, d );
+            a.storeUnaligned( frames + 4 * i );
+            b.storeUnaligned( frames + 4 * i + 8 );
+            c.storeUnaligned( frames + 4 * i + 16 );
+            d.storeUnaligned( frames + 4 * i + 24 );
+          }
+          else if constexpr ( C == 8 )
+          {
+            unroll<8>( [&]( int f ) { _mm256_storeu_ps( frames + 8 * ( i + f ), _mm256_broadcast_ss( mono + i + f ) ); } );
+          }
+          else
+          {
+            __m256 ch[C];
+            unroll<C>( [&]( int c ) { ch[c] = v.packed; } );
+            storeFrames<C>( ch, frames + C * i );
+          }
+        }
+        mono += i;
+        for ( float* f = frames + C * i; i < count; ++i, f += C, ++mono )
+          for ( int c = 0; c < C; ++c )
+            f[c] = *mono;
+      }
+
+      //! Call fn with std::integral_constant<int, channels> for the channel counts
+      //! with register transposes; false for the others
+      template <class Fn>
+      nmath_inline bool withChannels( const size_t channels, const Fn& fn )
+      {
+        switch ( channels )
+        {
+          case 1: fn( std::integral_constant<int, 1>() ); return true;
+          case 2: fn( std::integral_constant<int, 2>() ); return true;
+          case 3: fn( std::integral_constant<int, 3>() ); return true;
+          case 4: fn( std::integral_constant<int, 4>() ); return true;
+          case 6: fn( std::integral_constant<int, 6>() ); return true;
+          case 8: fn( std::integral_constant<int, 8>() ); return true;
+          default: return false;
+        }
+      }
+
+    }
+
+    //! count interleaved frames of channels samples each into one array per channel
+    nmath_inline void deinterleave( const float* __restrict frames, float* const* planar, const size_t channels, const size_t count )
+    {
+      if ( detail::withChannels( channels, [&]( auto c ) { detail::deinterleave<decltype( c )::value>( frames, planar, count ); } ) )
+        return;
+      for ( size_t i = 0; i < count; ++i )
+        for ( size_t c = 0; c < channels; ++c )
+          planar[c][i] = frames[channels * i + c];
+    }
+
+    //! count samples from each of channels arrays into interleaved frames
+    nmath_inline void interleave( const float* const* planar, float* __restrict frames, const size_t channels, const size_t count )
+    {
+      if ( detail::withChannels( channels, [&]( auto c ) { detail::interleave<decltype( c )::value>( planar, frames, count ); } ) )
+        return;
+      for ( size_t i = 0; i < count; ++i )
+        for ( size_t c = 0; c < channels; ++c )
+          frames[channels * i + c] = planar[c][i];
+    }
+
+    //! count mono samples into interleaved frames with the sample in every channel
+    nmath_inline void splat( const float* __restrict mono, float* __restrict frames, const size_t channels, const size_t count )
+    {
+      if ( detail::withChannels( channels, [&]( auto c ) { detail::splat<decltype( c )::value>( mono, frames, count ); } ) )
+        return;
+      for ( size_t i = 0; i < count; ++i )
+        for ( size_t c = 0; c < channels; ++c )
+          frames[channels * i + c] = mono[i];
+    }
+
+    //! count interleaved frames of inChannels to frames of outChannels, output
+    //! channel o being the sum of input channel i times gains[o * inChannels + i].
+    //! Upmixes, downmixes & channel reorders are all gain matrices, e.g. stereo to
+    //! 5.1 (L R C LFE Ls Rs) as { 1 0, 0 1, .5 .5, 0 0, 1 0, 0 1 }. in & out must
+    //! not overlap.
+    inline void remix( const float* __restrict in, const size_t inChannels, float* __restrict out, const size_t outChannels,
+      const float* gains, const size_t count )
+    {
+      size_t i = 0;
+      detail::withChannels( inChannels, [&]( auto ic )
+      {
+        detail::withChannels( outChannels, [&]( auto oc )
+        {
+          constexpr int I = decltype( ic )::value, O = decltype( oc )::value;
+          __m256 g[O][I];
+          detail::unroll<O>( [&]( int o ) { detail::unroll<I>( [&]( int c ) { g[o][c] = _mm256_set1_ps( gains[o * I + c] ); } ); } );
+          for ( ; i + 8 <= count; i += 8 )
+          {
+            __m256 x[I], y[O];
+            detail::loadFrames<I>( in + I * i, x );
+            detail::unroll<O>( [&]( int o )
+            {
+              y[o] = _mm256_mul_ps( g[o][0], x[0] );
+              detail::unroll<I - 1>( [&]( int c ) { y[o] = detail::vecmath<vec8f>::madd( g[o][c + 1], x[c + 1], y[o] ); } );
+            } );
+            detail::storeFrames<O>( y, out + O * i );
+          }
+        } );
+      } );
+      // the tail, or everything for channel counts without transposes
+      for ( ; i < count; ++i )
+      {
+        for ( size_t o = 0; o < outChannels; ++o )
+        {
+          float sum = 0.0f;
+          for ( size_t c = 0; c < inChannels; ++c )
+            sum += gains[o * inChannels + c] * in[inChannels * i + c];
+          out[outChannels * i + o] = sum;
+        }
+      }
+    }
+
+  }
+
+}
+
+#endif
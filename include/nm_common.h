@@ -2,10 +2,48 @@
 #define NM_COMMON_H
 
 #include <cstdint>
-#include <intrin.h>
 
-#define nmath_16b_align __declspec(align(16))
-#define nmath_32b_align __declspec(align(32))
-#define nmath_inline __forceinline
+#if defined( _MSC_VER ) && !defined( __clang__ )
+# define NMATH_MSVC
+#endif
 
-#endif
\ No newline at end of file
+#ifdef NMATH_MSVC
+# include <intrin.h>
+# define nmath_inline __forceinline
+#else
+# include <immintrin.h>
+# define nmath_inline inline __attribute__( ( always_inline ) )
+#endif
+
+#define nmath_16b_align alignas( 16 )
+#define nmath_32b_align alignas( 32 )
+
+// Instruction set features this translation unit is being compiled for.
+// MSVC only tells us about /arch:AVX and /arch:AVX2 (which implies FMA3),
+// and emits any intrinsic regardless of /arch, so SSE4.1 is the assumed floor.
+// That floor only covers vec4f & vec4i; the 256-bit vectors & everything built
+// on them (most of the library) need AVX, & stop with an #error without it.
+#if defined( __AVX__ )
+# define NMATH_HAS_AVX
+#endif
+#if defined( __AVX2__ )
+# define NMATH_HAS_AVX2
+#endif
+#if defined( __FMA__ ) || ( defined( NMATH_MSVC ) && defined( __AVX2__ ) )
+# define NMATH_HAS_FMA
+#endif
+
+// Everything that compiles differently depending on the instruction set
+// lives in an inline namespace named after it. This lets the same headers be
+// built into several translation units with different compiler flags for
+// runtime dispatch (see nm_cpu.h) without the linker folding the differently
+// compiled inline functions together.
+#if defined( NMATH_HAS_AVX2 ) && defined( NMATH_HAS_FMA )
+# define NMATH_ISA_NAMESPACE isa_avx2_fma
+#elif defined( NMATH_HAS_AVX )
+# define NMATH_ISA_NAMESPACE isa_avx
+#else
+# define NMATH_ISA_NAMESPACE isa_sse41
+#endif
+
+#endif
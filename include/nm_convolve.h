@@ -0,0 +1,304 @@
+#ifndef NM_CONVOLVE_H
+#define NM_CONVOLVE_H
+
+#include "nm_common.h"
+#include "nm_vec8f.h"
+#include "nm_vecmath.h"
+#include "nm_memory.h"
+#include "nm_fft.h"
+#include <algorithm>
+#include <cstring>
+
+// Convolution of a signal with a fixed kernel: FIR filters & reverb.
+//
+// firFilter computes the sum directly, which is the fastest way for kernels
+// up to a few hundred taps. It works on 32 outputs at once: each tap is
+// broadcast & multiply-added into four vectors of outputs, so a tap costs
+// four FMAs & five loads without any horizontal sums.
+//
+// convolver is for long kernels, up to millions of taps. It splits the kernel
+// into partitions the length of one block & runs uniformly partitioned
+// overlap-save convolution: each block of input is transformed once, kept in
+// a delay line of spectra & multiplied with every partition's spectrum, so a
+// block costs two FFTs of twice its length plus a complex multiply-add per
+// bin & partition. The latency is one block whatever the kernel's length.
+
+namespace nmath {
+
+  inline namespace NMATH_ISA_NAMESPACE {
+
+    //! A direct form FIR filter: y[n] = sum of taps[k] x[n - k]
+    class firFilter {
+    private:
+      static constexpr size_t c_chunk = 512;
+      //! The taps in reverse, so that outputs run forward through the input
+      buffer<float> taps_;
+      //! size() - 1 samples of history, then the chunk being filtered
+      buffer<float> line_;
+      //! Outputs n to n + 31 from the line, four taps per iteration
+      void run32( const size_t n, float* out ) const
+      {
+        using T = detail::vecmath<vec8f>;
+        const float* h = taps_.data();
+        const float* x = line_.data() + n;
+        const size_t taps = taps_.size();
+        auto acc0 = T::set1( 0.0f ), acc1 = T::set1( 0.0f ), acc2 = T::set1( 0.0f ), acc3 = T::set1( 0.0f );
+        const auto tap = [&]( const size_t k )
+        {
+          const auto hk = _mm256_broadcast_ss( h + k );
+          acc0 = T::madd( hk, _mm256_loadu_ps( x + k ), acc0 );
+          acc1 = T::madd( hk, _mm256_loadu_ps( x + k + 8 ), acc1 );
+          acc2 = T::madd( hk, _mm256_loadu_ps( x + k + 16 ), acc2 );
+          acc3 = T::madd( hk, _mm256_loadu_ps( x + k + 24 ), acc3 );
+        };
+        size_t k = 0;
+        for ( ; k + 4 <= taps; k += 4 )
+        {
+          tap( k );
+          tap( k + 1 );
+          tap( k + 2 );
+          tap( k + 3 );
+        }
+        for ( ; k < taps; ++k )
+          tap( k );
+        _mm256_storeu_ps( out + n, acc0 );
+        _mm256_storeu_ps( out + n + 8, acc1 );
+        _mm256_storeu_ps( out + n + 16, acc2 );
+        _mm256_storeu_ps( out + n + 24, acc3 );
+      }
+      //! Outputs n to n + 7 from the line, those before count
+      void run8( const size_t n, float* out, const size_t count ) const
+      {
+        using T = detail::vecmath<vec8f>;
+        const float* h = taps_.data();
+        const float* x = line_.data() + n;
+        const size_t taps = taps_.size();
+        auto acc0 = T::set1( 0.0f ), acc1 = T::set1( 0.0f );
+        size_t k = 0;
+        for ( ; k + 2 <= taps; k += 2 )
+        {
+          acc0 = T::madd( _mm256_broadcast_ss( h + k ), _mm256_loadu_ps( x + k ), acc0 );
+          acc1 = T::madd( _mm256_broadcast_ss( h + k + 1 ), _mm256_loadu_ps( x + k + 1 ), acc1 );
+        }
+        if ( k < taps )
+          acc0 = T::madd( _mm256_broadcast_ss( h + k ), _mm256_loadu_ps( x + k ), acc0 );
+        vec8f y( T::add( acc0, acc1 ) );
+        if ( n + 8 <= count )
+          y.storeUnaligned( out + n );
+        else
+          y.storePartial( out + n, count - n );
+      }
+    public:
+      firFilter() = default;
+      //! A filter with count taps, at least one, & no history
+      firFilter( const float* taps, const size_t count )
+      {
+        set( taps, count );
+      }
+      //! Replace the taps & clear the history
+      void set( const float* taps, const size_t count )
+      {
+        taps_.resize( count );
+        std::reverse_copy( taps, taps + count, taps_.data() );
+        // loads of the last outputs reach up to 7 past the chunk
+        line_.resize( 0 );
+        line_.resize( count - 1 + c_chunk + 8 );
+      }
+      size_t size() const
+      {
+        return taps_.size();
+      }
+      void reset()
+      {
+        std::fill( line_.begin(), line_.end(), 0.0f );
+      }
+      //! Filter count samples from in to out, which may be the same buffer
+      void process( const float* in, float* out, size_t count )
+      {
+        const size_t history = taps_.size() - 1;
+        while ( count )
+        {
+          const size_t chunk = std::min( count, c_chunk );
+          std::copy( in, in + chunk, line_.data() + history );
+          size_t n = 0;
+          for ( ; n + 32 <= chunk; n += 32 )
+            run32( n, out );
+          for ( ; n < chunk; n += 8 )
+            run8( n, out, chunk );
+          std::memmove( line_.data(), line_.data() + chunk, history * sizeof( float ) );
+          in += chunk;
+          out += chunk;
+          count -= chunk;
+        }
+      }
+    };
+
+    //! Uniformly partitioned FFT convolution of a signal with a long kernel, such
+    //! as the impulse response of a room. Outputs come one block late: sample n of
+    //! the output is sample n - blockSize() of the convolution.
+    class convolver {
+    private:
+      size_t block_ = 0;
+      size_t partitions_ = 0;
+      //! Bins of a spectrum rounded up to whole vectors
+      size_t stride_ = 0;
+      realFftf fft_;
+      //! Spectra of the kernel's partitions, scaled by 1 / fft size
+      buffer<float> kernelRe_, kernelIm_;
+      //! Spectra of the last partitions_ input windows, a ring starting at head_
+      buffer<float> delayRe_, delayIm_;
+      size_t head_ = 0;
+      buffer<float> accRe_, accIm_;
+      buffer<float> zero_;
+      //! The previous block of input, then the block being filled
+      buffer<float> window_;
+      buffer<float> time_;
+      //! Output of the last full block, handed out while the next one fills
+      buffer<float> output_;
+      size_t fill_ = 0;
+      void convolveBlock()
+      {
+        using T = detail::vecmath<vec8f>;
+        float* xr = delayRe_.data() + head_ * stride_;
+        float* xi = delayIm_.data() + head_ * stride_;
+        fft_.forward( window_.data(), xr, xi );
+        // the newest spectrum meets partition 0, the one before partition 1 & so on.
+        // Partitions go four at a time through the whole spectrum so that memory is
+        // read in order; the sums stay in the accumulators, which fit in L1.
+        std::fill( accRe_.begin(), accRe_.end(), 0.0f );
+        std::fill( accIm_.begin(), accIm_.end(), 0.0f );
+        const auto sign = T::set1( -0.0f );
+        size_t slot = head_;
+        for ( size_t p = 0; p < partitions_; p += 4 )
+        {
+          const size_t group = std::min<size_t>( partitions_ - p, 4 );
+          const float* x[4][2];
+          const float* h[4][2];
+          for ( size_t g = 0; g < 4; ++g )
+          {
+            x[g][0] = &delayRe_[slot * stride_];
+            x[g][1] = &delayIm_[slot * stride_];
+            if ( g < group )
+            {
+              h[g][0] = &kernelRe_[( p + g ) * stride_];
+              h[g][1] = &kernelIm_[( p + g ) * stride_];
+              slot = slot ? slot - 1 : partitions_ - 1;
+            }
+            else
+            {
+              // the last group pads with a zero kernel
+              h[g][0] = h[g][1] = zero_.data();
+            }
+          }
+          for ( size_t b = 0; b < stride_; b += 8 )
+          {
+            auto re = _mm256_load_ps( &accRe_[b] );
+            auto im = _mm256_load_ps( &accIm_[b] );
+            for ( size_t g = 0; g < 4; ++g )
+            {
+              const auto ar = _mm256_load_ps( x[g][0] + b ), ai = _mm256_load_ps( x[g][1] + b );
+              const auto br = _mm256_load_ps( h[g][0] + b ), bi = _mm256_load_ps( h[g][1] + b );
+              re = T::madd( ar, br, T::madd( T::xor_( ai, sign ), bi, re ) );
+              im = T::madd( ar, bi, T::madd( ai, br, im ) );
+            }
+            _mm256_store_ps( &accRe_[b], re );
+            _mm256_store_ps( &accIm_[b], im );
+          }
+        }
+        fft_.inverse( accRe_.data(), accIm_.data(), time_.data() );
+        // overlap-save: only the second half is free of circular wraparound
+        std::copy( time_.begin() + block_, time_.begin() + 2 * block_, output_.data() );
+        std::copy( window_.begin() + block_, window_.begin() + 2 * block_, window_.data() );
+        head_ = head_ + 1 < partitions_ ? head_ + 1 : 0;
+      }
+    public:
+      convolver() = default;
+      //! Convolution with the length samples of kernel in blocks of blockSize
+      //! samples, a power of two from 8. Smaller blocks lower the latency & raise
+      //! the cost per sample.
+      convolver( const float* kernel, const size_t length, const size_t blockSize )
+      {
+        set( kernel, length, blockSize );
+      }
+      //! Replace the kernel & clear the history
+      void set( const float* kernel, const size_t length, const size_t blockSize )
+      {
+        block_ = blockSize;
+        partitions_ = std::max<size_t>( ( length + blockSize - 1 ) / blockSize, 1 );
+        stride_ = ( blockSize + 1 + 7 ) / 8 * 8;
+        fft_.resize( 2 * blockSize );
+        kernelRe_.resize( 0 );
+        kernelIm_.resize( 0 );
+        kernelRe_.resize( partitions_ * stride_ );
+        kernelIm_.resize( partitions_ * stride_ );
+        buffer<float> padded( 2 * blockSize );
+        const float scale = 1.0f / static_cast<float>( 2 * blockSize );
+        for ( size_t p = 0; p < partitions_; ++p )
+        {
+          // each partition is zero padded to the fft size
+          const size_t first = p * blockSize;
+          const size_t n = first < length ? std::min( blockSize, length - first ) : 0;
+          std::fill( padded.begin(), padded.end(), 0.0f );
+          for ( size_t i = 0; i < n; ++i )
+            padded[i] = kernel[first + i] * scale;
+          fft_.forward( padded.data(), &kernelRe_[p * stride_], &kernelIm_[p * stride_] );
+        }
+        delayRe_.resize( partitions_ * stride_ );
+        delayIm_.resize( partitions_ * stride_ );
+        accRe_.resize( stride_ );
+        accIm_.resize( stride_ );
+        zero_.resize( stride_ );
+        window_.resize( 2 * blockSize );
+        time_.resize( 2 * blockSize );
+        output_.resize( blockSize );
+        reset();
+      }
+      size_t blockSize() const
+      {
+        return block_;
+      }
+      //! Samples of the kernel it can hold, its length rounded up to whole blocks
+      size_t length() const
+      {
+        return partitions_ * block_;
+      }
+      //! Output delay in samples, one block
+      size_t latency() const
+      {
+        return block_;
+      }
+      void reset()
+      {
+        std::fill( delayRe_.begin(), delayRe_.end(), 0.0f );
+        std::fill( delayIm_.begin(), delayIm_.end(), 0.0f );
+        std::fill( window_.begin(), window_.end(), 0.0f );
+        std::fill( output_.begin(), output_.end(), 0.0f );
+        head_ = 0;
+        fill_ = 0;
+      }
+      //! Convolve count samples from in to out, which may be the same buffer.
+      void process( const float* in, float* out, size_t count )
+      {
+        while ( count )
+        {
+          const size_t n = std::min( count, block_ - fill_ );
+          std::copy( in, in + n, window_.data() + block_ + fill_ );
+          std::copy( output_.data() + fill_, output_.data() + fill_ + n, out );
+          fill_ += n;
+          if ( fill_ == block_ )
+          {
+            convolveBlock();
+            fill_ = 0;
+          }
+          in += n;
+          out += n;
+          count -= n;
+        }
+      }
+    };
+
+  }
+
+}
+
+#endif
@@ -0,0 +1,183 @@
+#ifndef NM_CPU_H
+#define NM_CPU_H
+
+#include "nm_common.h"
+#include <utility>
+
+#ifndef NMATH_MSVC
+# include <cpuid.h>
+#endif
+
+namespace nmath {
+
+  //! Instruction set levels that nmath code paths are built for
+  enum class isa: int {
+    none = -1, //!< Below SSE4.1, no nmath code path runs
+    sse41 = 0, //!< SSE4.1
+    avx, //!< AVX (without AVX2 or FMA3)
+    avx2_fma, //!< AVX2 + FMA3
+    count
+  };
+
+  //! CPU features relevant to nmath, as reported by cpuid & xgetbv
+  struct cpuinfo {
+    bool sse41 = false;
+    bool avx = false;
+    bool avx2 = false;
+    bool fma = false;
+    //! Highest isa level fully supported by the cpu & operating system
+    isa best() const
+    {
+      if ( avx2 && fma )
+        return isa::avx2_fma;
+      if ( avx )
+        return isa::avx;
+      if ( sse41 )
+        return isa::sse41;
+      return isa::none;
+    }
+    //! Whether code built for the given isa level can run here
+    bool supports( isa level ) const
+    {
+      return ( static_cast<int>( level ) <= static_cast<int>( best() ) );
+    }
+  };
+
+  namespace detail {
+
+    inline void cpuid( uint32_t leaf, uint32_t subleaf, uint32_t regs[4] )
+    {
+#ifdef NMATH_MSVC
+      int tmp[4];
+      __cpuidex( tmp, static_cast<int>( leaf ), static_cast<int>( subleaf ) );
+      for ( int i = 0; i < 4; ++i )
+        regs[i] = static_cast<uint32_t>( tmp[i] );
+#else
+      __cpuid_count( leaf, subleaf, regs[0], regs[1], regs[2], regs[3] );
+#endif
+    }
+
+    inline uint64_t xgetbv0()
+    {
+#ifdef NMATH_MSVC
+      return _xgetbv( 0 );
+#else
+      // _xgetbv() would need -mxsave on the whole translation unit
+      uint32_t lo, hi;
+      __asm__ __volatile__( "xgetbv" : "=a"( lo ), "=d"( hi ) : "c"( 0 ) );
+      return ( static_cast<uint64_t>( hi ) << 32 ) | lo;
+#endif
+    }
+
+    inline cpuinfo detectCpu()
+    {
+      cpuinfo info;
+      uint32_t regs[4] = { 0 };
+      cpuid( 0, 0, regs );
+      const auto maxLeaf = regs[0];
+      if ( maxLeaf < 1 )
+        return info;
+      cpuid( 1, 0, regs );
+      info.sse41 = ( regs[2] & ( 1u << 19 ) ) != 0;
+      const bool osxsave = ( regs[2] & ( 1u << 27 ) ) != 0;
+      const bool avx = ( regs[2] & ( 1u << 28 ) ) != 0;
+      const bool fma = ( regs[2] & ( 1u << 12 ) ) != 0;
+      // the cpu supporting AVX means nothing if the OS doesn't save ymm state
+      const bool ymmState = osxsave && ( ( xgetbv0() & 0x6 ) == 0x6 );
+      info.avx = avx && ymmState;
+      info.fma = fma && info.avx;
+      if ( maxLeaf >= 7 )
+      {
+        cpuid( 7, 0, regs );
+        info.avx2 = info.avx && ( regs[1] & ( 1u << 5 ) ) != 0;
+      }
+      return info;
+    }
+
+  }
+
+  //! Features of the host cpu, detected once on first use
+  inline const cpuinfo& cpu()
+  {
+    static const cpuinfo info = detail::detectCpu();
+    return info;
+  }
+
+  inline namespace NMATH_ISA_NAMESPACE {
+
+    //! Isa level the current translation unit is compiled for
+#if defined( NMATH_HAS_AVX2 ) && defined( NMATH_HAS_FMA )
+    constexpr isa compiledIsa = isa::avx2_fma;
+#elif defined( NMATH_HAS_AVX )
+    constexpr isa compiledIsa = isa::avx;
+#else
+    constexpr isa compiledIsa = isa::sse41;
+#endif
+
+  }
+
+  //! Runtime selection between per-isa builds of the same function.
+  //! Compile the implementation once per isa level in its own translation unit
+  //! (say -msse4.1, -mavx, -mavx2 -mfma; /arch:AVX, /arch:AVX2 on MSVC) and
+  //! hand the resulting function pointers in here. The best level the host cpu
+  //! supports wins; levels that weren't built can be passed as nullptr. The
+  //! sse41 build can only use vec4f & vec4i, the rest of nmath needs AVX.
+  template <typename Fn>
+  class dispatcher {
+  private:
+    Fn impl_ = nullptr;
+    isa level_ = isa::none;
+  public:
+    dispatcher( Fn sse41, Fn avx, Fn avx2fma )
+    {
+      const Fn impls[static_cast<int>( isa::count )] = { sse41, avx, avx2fma };
+      for ( int i = static_cast<int>( cpu().best() ); i >= 0; --i )
+        if ( impls[i] )
+        {
+          impl_ = impls[i];
+          level_ = static_cast<isa>( i );
+          break;
+        }
+    }
+    //! Selected implementation, or nullptr if nothing usable was given
+    Fn get() const
+    {
+      return impl_;
+    }
+    //! Isa level of the selected implementation, or isa::none
+    isa level() const
+    {
+      return level_;
+    }
+    template <typename... Args>
+    nmath_inline auto operator () ( Args&&... args ) const
+    {
+      return impl_( std::forward<Args>( args )... );
+    }
+  };
+
+  //! Sets the FTZ & DAZ bits of the MXCSR for its lifetime, so that denormal
+  //! results flush to zero & denormal inputs read as zero, & restores the
+  //! previous mode after. Denormals otherwise take a microcode assist costing
+  //! around a hundred cycles per operation, which decaying tails of audio hit
+  //! all the time. The mode is per thread, so the guard belongs on the stack
+  //! of the thread doing the work.
+  class denormalGuard {
+  private:
+    unsigned int saved_;
+  public:
+    denormalGuard(): saved_( _mm_getcsr() )
+    {
+      _mm_setcsr( saved_ | 0x8040u );
+    }
+    ~denormalGuard()
+    {
+      _mm_setcsr( saved_ );
+    }
+    denormalGuard( const denormalGuard& ) = delete;
+    denormalGuard& operator = ( const denormalGuard& ) = delete;
+  };
+
+}
+
+#endif
@@ -0,0 +1,244 @@
+#ifndef NM_CULL_H
+#define NM_CULL_H
+
+#include "nm_common.h"
+#include "nm_vec4f.h"
+#include "nm_vec8f.h"
+#include "nm_mat4f.h"
+#include "nm_soa.h"
+#include <bit>
+#include <cmath>
+#include <limits>
+
+// Frustum culling of bounding spheres & boxes, eight objects at a time.
+//
+// The six planes are broadcast once per call, so an object costs three
+// multiply-adds per plane & one compare at the end, with no branches per
+// plane or per object. Results come out either as a compacted list of the
+// visible indices or as one bit per object.
+
+namespace nmath {
+
+  inline namespace NMATH_ISA_NAMESPACE {
+
+    //! Depth range of clip space, which decides where the near plane is
+    enum class clipDepth {
+      zeroToOne, //!< 0 <= z <= w, as in Direct3D, Vulkan & Metal
+      minusOneToOne //!< -w <= z <= w, as in OpenGL
+    };
+
+    //! Six planes bounding a view volume
+    struct frustumf {
+      //! (nx, ny, nz, d) with unit normals pointing inwards, so n.p + d is the
+      //! signed distance of p from the plane: left, right, bottom, top, near & far
+      vec4f planes[6];
+      //! The planes of a view-projection matrix, for objects in the space the matrix
+      //! transforms from (world space for view * projection, model space for the full chain)
+      nmath_inline static frustumf fromMatrix( const mat4f& viewProj, const clipDepth depth = clipDepth::zeroToOne )
+      {
+        // with row vectors clip = p * m, so each clip coordinate is p dotted with a column
+        const auto c = viewProj.transposed();
+        frustumf f;
+        f.planes[0].packed = _mm_add_ps( c.rows[3].packed, c.rows[0].packed );
+        f.planes[1].packed = _mm_sub_ps( c.rows[3].packed, c.rows[0].packed );
+        f.planes[2].packed = _mm_add_ps( c.rows[3].packed, c.rows[1].packed );
+        f.planes[3].packed = _mm_sub_ps( c.rows[3].packed, c.rows[1].packed );
+        f.planes[4].packed = ( depth == clipDepth::zeroToOne ? c.rows[2].packed : _mm_add_ps( c.rows[3].packed, c.rows[2].packed ) );
+        f.planes[5].packed = _mm_sub_ps( c.rows[3].packed, c.rows[2].packed );
+        for ( auto& p : f.planes )
+        {
+          const float length = std::sqrt( p.x * p.x + p.y * p.y + p.z * p.z );
+          p.packed = _mm_div_ps( p.packed, _mm_set1_ps( length ) );
+        }
+        return f;
+      }
+    };
+
+    namespace detail {
+
+      //! A frustum's planes broadcast to all lanes
+      struct frustum8f {
+        vec8f nx[6], ny[6], nz[6], d[6];
+        explicit frustum8f( const frustumf& f )
+        {
+          for ( int p = 0; p < 6; ++p )
+          {
+            nx[p] = vec8f( f.planes[p].x );
+            ny[p] = vec8f( f.planes[p].y );
+            nz[p] = vec8f( f.planes[p].z );
+            d[p] = vec8f( f.planes[p].w );
+          }
+        }
+        //! Signed distances of eight points from plane p
+        nmath_inline __m256 distance( const int p, const __m256 x, const __m256 y, const __m256 z ) const
+        {
+          return madd( nx[p].packed, x, madd( ny[p].packed, y, madd( nz[p].packed, z, d[p].packed ) ) );
+        }
+        //! Mask of the spheres not entirely outside any plane
+        nmath_inline int spheres( const __m256 x, const __m256 y, const __m256 z, const __m256 r ) const
+        {
+          // inside all planes when the nearest plane is no further than -r away
+          auto nearest = distance( 0, x, y, z );
+          for ( int p = 1; p < 6; ++p )
+            nearest = _mm256_min_ps( nearest, distance( p, x, y, z ) );
+          return _mm256_movemask_ps( _mm256_cmp_ps( nearest, _mm256_sub_ps( _mm256_setzero_ps(), r ), _CMP_GE_OQ ) );
+        }
+        //! Mask of the boxes, by center & half extents, not entirely outside any plane
+        nmath_inline int boxes( const __m256 cx, const __m256 cy, const __m256 cz, const __m256 ex, const __m256 ey, const __m256 ez ) const
+        {
+          // the corner furthest along a plane's normal is |n| . e beyond the center
+          const auto sign = _mm256_set1_ps( -0.0f );
+          auto nearest = _mm256_set1_ps( std::numeric_limits<float>::infinity() );
+          for ( int p = 0; p < 6; ++p )
+          {
+            const auto reach = madd( _mm256_andnot_ps( sign, nx[p].packed ), ex,
+              madd( _mm256_andnot_ps( sign, ny[p].packed ), ey, _mm256_mul_ps( _mm256_andnot_ps( sign, nz[p].packed ), ez ) ) );
+            nearest = _mm256_min_ps( nearest, _mm256_add_ps( distance( p, cx, cy, cz ), reach ) );
+          }
+          return _mm256_movemask_ps( _mm256_cmp_ps( nearest, _mm256_setzero_ps(), _CMP_GE_OQ ) );
+        }
+      };
+
+      //! Lanes of the set bits of each eight bit mask, lowest first, one per byte
+      struct compactTable {
+        uint64_t lanes[256];
+        constexpr compactTable(): lanes()
+        {
+          for ( int m = 0; m < 256; ++m )
+          {
+            int k = 0;
+            for ( int i = 0; i < 8; ++i )
+              if ( m & ( 1 << i ) )
+                lanes[m] |= static_cast<uint64_t>( i ) << ( 8 * k++ );
+          }
+        }
+      };
+
+      inline constexpr compactTable c_compactTable;
+
+      //! Append base + lane for each set bit of mask. Always writes eight indices,
+      //! so out must have room for eight even when fewer bits are set.
+      nmath_inline uint32_t* appendLanes( uint32_t* out, const int mask, const uint32_t base )
+      {
+        const auto lanes = _mm_loadl_epi64( reinterpret_cast<const __m128i*>( &c_compactTable.lanes[mask] ) );
+        const auto offset = _mm_set1_epi32( static_cast<int>( base ) );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( out ), _mm_add_epi32( _mm_cvtepu8_epi32( lanes ), offset ) );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( out + 4 ), _mm_add_epi32( _mm_cvtepu8_epi32( _mm_srli_si128( lanes, 4 ) ), offset ) );
+        return out + std::popcount( static_cast<unsigned>( mask ) );
+      }
+
+      //! Eight values from first on, zeroes past count
+      nmath_inline __m256 cullLoad( const float* values, const size_t first, const size_t count )
+      {
+        vec8f v;
+        if ( first + 8 <= count )
+          v.loadUnaligned( values + first );
+        else
+          v.loadPartial( values + first, count - first );
+        return v.packed;
+      }
+
+      //! Write the indices of the objects for which visible( first, count ) sets a
+      //! bit, eight objects per call, & return how many there are
+      template <class Visible>
+      nmath_inline size_t cullIndices( const size_t count, uint32_t* visible, const Visible& test )
+      {
+        auto out = visible;
+        size_t first = 0;
+        // whole groups of eight can write up to first + 8 <= count indices
+        for ( ; first + 8 <= count; first += 8 )
+          out = appendLanes( out, test( first, count ), static_cast<uint32_t>( first ) );
+        if ( first < count )
+        {
+          for ( int mask = test( first, count ) & ( ( 1 << ( count - first ) ) - 1 ); mask; mask &= mask - 1 )
+            *out++ = static_cast<uint32_t>( first ) + std::countr_zero( static_cast<unsigned>( mask ) );
+        }
+        return static_cast<size_t>( out - visible );
+      }
+
+      //! As cullIndices but one bit per object, bit i % 8 of byte i / 8
+      template <class Visible>
+      nmath_inline void cullBits( const size_t count, uint8_t* visible, const Visible& test )
+      {
+        for ( size_t first = 0; first < count; first += 8 )
+        {
+          const int mask = test( first, count );
+          visible[first / 8] = static_cast<uint8_t>( first + 8 <= count ? mask : mask & ( ( 1 << ( count - first ) ) - 1 ) );
+        }
+      }
+
+    }
+
+    //! Write the indices of the spheres at (x, y, z)[i] with radius[i] that touch the
+    //! frustum to visible, in increasing order, & return how many there are.
+    //! The test is conservative: spheres near a corner may pass without touching it.
+    //! visible needs room for count indices.
+    nmath_inline size_t cullSpheres( const frustumf& frustum, const float* x, const float* y, const float* z,
+      const float* radius, const size_t count, uint32_t* visible )
+    {
+      const detail::frustum8f f( frustum );
+      return detail::cullIndices( count, visible, [&]( const size_t first, const size_t n )
+      {
+        return f.spheres( detail::cullLoad( x, first, n ), detail::cullLoad( y, first, n ), detail::cullLoad( z, first, n ),
+          detail::cullLoad( radius, first, n ) );
+      } );
+    }
+
+    //! As cullSpheres, setting bit i % 8 of visible[i / 8] for visible spheres &
+    //! clearing it for the rest. visible needs room for ( count + 7 ) / 8 bytes.
+    nmath_inline void cullSpheresMask( const frustumf& frustum, const float* x, const float* y, const float* z,
+      const float* radius, const size_t count, uint8_t* visible )
+    {
+      const detail::frustum8f f( frustum );
+      detail::cullBits( count, visible, [&]( const size_t first, const size_t n )
+      {
+        return f.spheres( detail::cullLoad( x, first, n ), detail::cullLoad( y, first, n ), detail::cullLoad( z, first, n ),
+          detail::cullLoad( radius, first, n ) );
+      } );
+    }
+
+    //! Write the indices of the axis aligned boxes with centers (cx, cy, cz)[i] &
+    //! half extents (ex, ey, ez)[i] that touch the frustum to visible, in increasing
+    //! order, & return how many there are. Conservative like cullSpheres.
+    //! visible needs room for count indices.
+    nmath_inline size_t cullBoxes( const frustumf& frustum, const float* cx, const float* cy, const float* cz,
+      const float* ex, const float* ey, const float* ez, const size_t count, uint32_t* visible )
+    {
+      const detail::frustum8f f( frustum );
+      return detail::cullIndices( count, visible, [&]( const size_t first, const size_t n )
+      {
+        return f.boxes( detail::cullLoad( cx, first, n ), detail::cullLoad( cy, first, n ), detail::cullLoad( cz, first, n ),
+          detail::cullLoad( ex, first, n ), detail::cullLoad( ey, first, n ), detail::cullLoad( ez, first, n ) );
+      } );
+    }
+
+    //! As cullBoxes, one bit per box like cullSpheresMask
+    nmath_inline void cullBoxesMask( const frustumf& frustum, const float* cx, const float* cy, const float* cz,
+      const float* ex, const float* ey, const float* ez, const size_t count, uint8_t* visible )
+    {
+      const detail::frustum8f f( frustum );
+      detail::cullBits( count, visible, [&]( const size_t first, const size_t n )
+      {
+        return f.boxes( detail::cullLoad( cx, first, n ), detail::cullLoad( cy, first, n ), detail::cullLoad( cz, first, n ),
+          detail::cullLoad( ex, first, n ), detail::cullLoad( ey, first, n ), detail::cullLoad( ez, first, n ) );
+      } );
+    }
+
+    //! cullSpheres over a stream of spheres with centers in x, y & z & radii in w
+    nmath_inline size_t cullSpheres( const frustumf& frustum, const soa4f& spheres, uint32_t* visible )
+    {
+      return cullSpheres( frustum, spheres.x.data(), spheres.y.data(), spheres.z.data(), spheres.w.data(), spheres.size(), visible );
+    }
+
+    //! cullBoxes over streams of box centers & half extents of the same size
+    nmath_inline size_t cullBoxes( const frustumf& frustum, const soa3f& centers, const soa3f& extents, uint32_t* visible )
+    {
+      return cullBoxes( frustum, centers.x.data(), centers.y.data(), centers.z.data(),
+        extents.x.data(), extents.y.data(), extents.z.data(), centers.size(), visible );
+    }
+
+  }
+
+}
+
+#endif
@@ -0,0 +1,694 @@
+#ifndef NM_FFT_H
+#define NM_FFT_H
+
+#include "nm_common.h"
+#include "nm_vec8f.h"
+#include "nm_vec4d.h"
+#include "nm_vecmath.h"
+#include "nm_memory.h"
+#include "nm_soa.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <vector>
+
+// Fast Fourier transforms of power of two sizes, in single precision on vec8f
+// & double precision on vec4d.
+//
+// Complex data is kept split, real parts in one array & imaginary parts in
+// another, so that a vector of points fills a register without shuffling. The
+// transform is a Stockham autosort FFT: every pass reads one buffer & writes
+// the other in natural order, so there is no bit reversal pass & the inner
+// loops stream through memory.
+//
+// Most passes are radix 8, a third fewer trips through memory than radix 4,
+// with internal twiddles that are only sign flips, swaps & a multiply by
+// 1 / sqrt 2. The first pass has a stride of 1, shorter than a vector, so it is
+// radix 4 across butterflies & transposes its results on the way out; for
+// vec8f the second pass, stride 4, does the same two butterflies at a time.
+// What the radix 8 passes leave over takes one radix 4 or radix 2 pass. The
+// plan lays out each pass's twiddle factors in the order the pass reads them.
+//
+// Transforms are unnormalized: forward then inverse scales by size().
+
+namespace nmath {
+
+  inline namespace NMATH_ISA_NAMESPACE {
+
+    namespace detail {
+
+      //! Loads, stores & the shuffles of the FFT, on top of vecmath
+      template <typename V>
+      struct fftOps;
+
+      template <>
+      struct fftOps<vec8f> {
+        using scalar = float;
+        using reg = __m256;
+        static constexpr size_t lanes = 8;
+        static nmath_inline reg load( const float* p ) { return _mm256_loadu_ps( p ); }
+        static nmath_inline void store( float* p, const reg v ) { _mm256_storeu_ps( p, v ); }
+        static nmath_inline reg broadcast( const float* p ) { return _mm256_broadcast_ss( p ); }
+        //! The lanes of v in reverse
+        static nmath_inline reg reverse( const reg v )
+        {
+          return _mm256_permute_ps( _mm256_permute2f128_ps( v, v, 1 ), _MM_SHUFFLE( 0, 1, 2, 3 ) );
+        }
+        //! Sixteen values of x into the even ones & the odd ones
+        static nmath_inline void split( const float* x, reg& even, reg& odd )
+        {
+          const auto a = _mm256_loadu_ps( x );
+          const auto b = _mm256_loadu_ps( x + 8 );
+          const auto lo = _mm256_permute2f128_ps( a, b, 0x20 );
+          const auto hi = _mm256_permute2f128_ps( a, b, 0x31 );
+          even = _mm256_shuffle_ps( lo, hi, _MM_SHUFFLE( 2, 0, 2, 0 ) );
+          odd = _mm256_shuffle_ps( lo, hi, _MM_SHUFFLE( 3, 1, 3, 1 ) );
+        }
+        //! The reverse of split
+        static nmath_inline void join( const reg even, const reg odd, float* x )
+        {
+          const auto lo = _mm256_unpacklo_ps( even, odd );
+          const auto hi = _mm256_unpackhi_ps( even, odd );
+          _mm256_storeu_ps( x, _mm256_permute2f128_ps( lo, hi, 0x20 ) );
+          _mm256_storeu_ps( x + 8, _mm256_permute2f128_ps( lo, hi, 0x31 ) );
+        }
+        //! Four outputs of eight butterflies, one vector per output, to four in a
+        //! row per butterfly
+        static nmath_inline void transpose4( const reg y0, const reg y1, const reg y2, const reg y3, float* out )
+        {
+          transpose4x8( vec8f( y0 ), vec8f( y1 ), vec8f( y2 ), vec8f( y3 ), out );
+        }
+        //! Lanes 0-3 set to v0[0] & lanes 4-7 to v1[0]
+        static nmath_inline reg pair( const float* v0, const float* v1 )
+        {
+          return _mm256_insertf128_ps( _mm256_castps128_ps256( _mm_broadcast_ss( v0 ) ), _mm_broadcast_ss( v1 ), 1 );
+        }
+      };
+
+      template <>
+      struct fftOps<vec4d> {
+        using scalar = double;
+        using reg = __m256d;
+        static constexpr size_t lanes = 4;
+        static nmath_inline reg load( const double* p ) { return _mm256_loadu_pd( p ); }
+        static nmath_inline void store( double* p, const reg v ) { _mm256_storeu_pd( p, v ); }
+        static nmath_inline reg broadcast( const double* p ) { return _mm256_broadcast_sd( p ); }
+        static nmath_inline reg reverse( const reg v )
+        {
+          return _mm256_permute_pd( _mm256_permute2f128_pd( v, v, 1 ), 0b0101 );
+        }
+        static nmath_inline void split( const double* x, reg& even, reg& odd )
+        {
+          const auto a = _mm256_loadu_pd( x );
+          const auto b = _mm256_loadu_pd( x + 4 );
+          const auto lo = _mm256_permute2f128_pd( a, b, 0x20 );
+          const auto hi = _mm256_permute2f128_pd( a, b, 0x31 );
+          even = _mm256_unpacklo_pd( lo, hi );
+          odd = _mm256_unpackhi_pd( lo, hi );
+        }
+        static nmath_inline void join( const reg even, const reg odd, double* x )
+        {
+          const auto lo = _mm256_unpacklo_pd( even, odd );
+          const auto hi = _mm256_unpackhi_pd( even, odd );
+          _mm256_storeu_pd( x, _mm256_permute2f128_pd( lo, hi, 0x20 ) );
+          _mm256_storeu_pd( x + 4, _mm256_permute2f128_pd( lo, hi, 0x31 ) );
+        }
+        static nmath_inline void transpose4( const reg y0, const reg y1, const reg y2, const reg y3, double* out )
+        {
+          const auto t0 = _mm256_unpacklo_pd( y0, y1 ), t1 = _mm256_unpackhi_pd( y0, y1 );
+          const auto t2 = _mm256_unpacklo_pd( y2, y3 ), t3 = _mm256_unpackhi_pd( y2, y3 );
+          _mm256_storeu_pd( out, _mm256_permute2f128_pd( t0, t2, 0x20 ) );
+          _mm256_storeu_pd( out + 4, _mm256_permute2f128_pd( t1, t3, 0x20 ) );
+          _mm256_storeu_pd( out + 8, _mm256_permute2f128_pd( t0, t2, 0x31 ) );
+          _mm256_storeu_pd( out + 12, _mm256_permute2f128_pd( t1, t3, 0x31 ) );
+        }
+      };
+
+      //! A vector of complex values, split
+      template <typename V>
+      struct cvec {
+        typename vecmath<V>::reg re, im;
+      };
+
+      template <typename V>
+      nmath_inline cvec<V> fftLoad( const typename fftOps<V>::scalar* re, const typename fftOps<V>::scalar* im, const size_t i )
+      {
+        return { fftOps<V>::load( re + i ), fftOps<V>::load( im + i ) };
+      }
+
+      template <typename V>
+      nmath_inline void fftStore( typename fftOps<V>::scalar* re, typename fftOps<V>::scalar* im, const size_t i, const cvec<V>& v )
+      {
+        fftOps<V>::store( re + i, v.re );
+        fftOps<V>::store( im + i, v.im );
+      }
+
+      template <typename V>
+      nmath_inline cvec<V> fftMul( const cvec<V>& a, const cvec<V>& w )
+      {
+        using T = vecmath<V>;
+        return { T::sub( T::mul( a.re, w.re ), T::mul( a.im, w.im ) ), T::madd( a.re, w.im, T::mul( a.im, w.re ) ) };
+      }
+
+      //! A forward radix 4 butterfly, before the twiddles
+      template <typename V>
+      nmath_inline void fftButterfly4( const cvec<V>& a, const cvec<V>& b, const cvec<V>& c, const cvec<V>& d,
+        cvec<V>& y0, cvec<V>& y1, cvec<V>& y2, cvec<V>& y3 )
+      {
+        using T = vecmath<V>;
+        const cvec<V> apc = { T::add( a.re, c.re ), T::add( a.im, c.im ) };
+        const cvec<V> amc = { T::sub( a.re, c.re ), T::sub( a.im, c.im ) };
+        const cvec<V> bpd = { T::add( b.re, d.re ), T::add( b.im, d.im ) };
+        const cvec<V> bmd = { T::sub( b.re, d.re ), T::sub( b.im, d.im ) };
+        // -i (b - d) = (bmd.im, -bmd.re)
+        y0 = { T::add( apc.re, bpd.re ), T::add( apc.im, bpd.im ) };
+        y1 = { T::add( amc.re, bmd.im ), T::sub( amc.im, bmd.re ) };
+        y2 = { T::sub( apc.re, bpd.re ), T::sub( apc.im, bpd.im ) };
+        y3 = { T::sub( amc.re, bmd.im ), T::add( amc.im, bmd.re ) };
+      }
+
+      //! A forward radix 8 butterfly, before the twiddles, in place
+      template <typename V>
+      nmath_inline void fftButterfly8( cvec<V>* x )
+      {
+        using T = vecmath<V>;
+        const auto r = T::set1( static_cast<typename fftOps<V>::scalar>( 0.70710678118654752440 ) );
+        const cvec<V> b0 = { T::add( x[0].re, x[4].re ), T::add( x[0].im, x[4].im ) };
+        const cvec<V> b1 = { T::add( x[1].re, x[5].re ), T::add( x[1].im, x[5].im ) };
+        const cvec<V> b2 = { T::add( x[2].re, x[6].re ), T::add( x[2].im, x[6].im ) };
+        const cvec<V> b3 = { T::add( x[3].re, x[7].re ), T::add( x[3].im, x[7].im ) };
+        const cvec<V> d0 = { T::sub( x[0].re, x[4].re ), T::sub( x[0].im, x[4].im ) };
+        const cvec<V> d1 = { T::sub( x[1].re, x[5].re ), T::sub( x[1].im, x[5].im ) };
+        const cvec<V> d2 = { T::sub( x[2].re, x[6].re ), T::sub( x[2].im, x[6].im ) };
+        const cvec<V> d3 = { T::sub( x[3].re, x[7].re ), T::sub( x[3].im, x[7].im ) };
+        // even outputs are the radix 4 butterfly of the sums
+        fftButterfly4( b0, b1, b2, b3, x[0], x[2], x[4], x[6] );
+        // odd ones that of the differences times 1, (1 - i) / sqrt 2, -i & -(1 + i) / sqrt 2:
+        // d1 (1 - i) = (s1, t1) & d3 (-1 - i) = (t3, -s3) with these sums
+        const auto s1 = T::add( d1.re, d1.im ), t1 = T::sub( d1.im, d1.re );
+        const auto s3 = T::add( d3.re, d3.im ), t3 = T::sub( d3.im, d3.re );
+        // d0 + & - -i d2
+        const cvec<V> apc = { T::add( d0.re, d2.im ), T::sub( d0.im, d2.re ) };
+        const cvec<V> amc = { T::sub( d0.re, d2.im ), T::add( d0.im, d2.re ) };
+        const cvec<V> bpd = { T::mul( r, T::add( s1, t3 ) ), T::mul( r, T::sub( t1, s3 ) ) };
+        const cvec<V> bmd = { T::mul( r, T::sub( s1, t3 ) ), T::mul( r, T::add( t1, s3 ) ) };
+        x[1] = { T::add( apc.re, bpd.re ), T::add( apc.im, bpd.im ) };
+        x[3] = { T::add( amc.re, bmd.im ), T::sub( amc.im, bmd.re ) };
+        x[5] = { T::sub( apc.re, bpd.re ), T::sub( apc.im, bpd.im ) };
+        x[7] = { T::sub( amc.re, bmd.im ), T::add( amc.im, bmd.re ) };
+      }
+
+    }
+
+    //! A complex FFT of one size on split complex data, vec8f for float or vec4d
+    //! for double, with its twiddle factors computed up front. Transforms may be
+    //! in place or out of place; they use a work buffer of the plan, so one plan
+    //! can't run two transforms at the same time.
+    template <typename V>
+    class fft {
+    public:
+      using scalar = typename detail::fftOps<V>::scalar;
+    private:
+      using O = detail::fftOps<V>;
+      using C = detail::cvec<V>;
+      static constexpr size_t lanes = O::lanes;
+      enum class kind {
+        first, //!< radix 4, stride 1, lanes butterflies at a time
+        second, //!< radix 4, stride 4, two butterflies at a time (vec8f)
+        radix4, //!< stride of at least a vector
+        radix8, //!< stride of at least a vector
+        radix2, //!< the last pass, stride size / 2
+        scalar4 //!< radix 4, any stride, for sizes below four vectors
+      };
+      //! One pass of length n & stride s, with its twiddles from twiddles on
+      struct pass {
+        kind what;
+        size_t n, s, twiddles;
+      };
+      size_t size_ = 0;
+      std::vector<pass> passes_;
+      //! The twiddles of every pass: exp( -2 pi i k p s / size ) for output k of
+      //! butterfly p, k from 1, in [k - 1][p] order for the first pass & in
+      //! [p][k - 1] order for the others
+      buffer<scalar> twRe_, twIm_;
+      buffer<scalar> workRe_, workIm_;
+      //! A radix 4 pass of any stride
+      void scalar4( const pass& ps, const scalar* xr, const scalar* xi, scalar* yr, scalar* yi ) const
+      {
+        const size_t m = ps.n / 4, s = ps.s;
+        const size_t quarter = size_ / 4;
+        const scalar* wr = &twRe_[ps.twiddles];
+        const scalar* wi = &twIm_[ps.twiddles];
+        for ( size_t p = 0; p < m; ++p )
+        {
+          const scalar w1r = wr[3 * p], w1i = wi[3 * p];
+          const scalar w2r = wr[3 * p + 1], w2i = wi[3 * p + 1];
+          const scalar w3r = wr[3 * p + 2], w3i = wi[3 * p + 2];
+          for ( size_t q = 0; q < s; ++q )
+          {
+            const size_t i = q + s * p;
+            const scalar ar = xr[i], ai = xi[i];
+            const scalar br = xr[i + quarter], bi = xi[i + quarter];
+            const scalar cr = xr[i + 2 * quarter], ci = xi[i + 2 * quarter];
+            const scalar dr = xr[i + 3 * quarter], di = xi[i + 3 * quarter];
+            const scalar apcr = ar + cr, apci = ai + ci, amcr = ar - cr, amci = ai - ci;
+            const scalar bpdr = br + dr, bpdi = bi + di, bmdr = br - dr, bmdi = bi - di;
+            const scalar t1r = amcr + bmdi, t1i = amci - bmdr;
+            const scalar t2r = apcr - bpdr, t2i = apci - bpdi;
+            const scalar t3r = amcr - bmdi, t3i = amci + bmdr;
+            const size_t o = q + s * 4 * p;
+            yr[o] = apcr + bpdr;
+            yi[o] = apci + bpdi;
+            yr[o + s] = t1r * w1r - t1i * w1i;
+            yi[o + s] = t1r * w1i + t1i * w1r;
+            yr[o + 2 * s] = t2r * w2r - t2i * w2i;
+            yi[o + 2 * s] = t2r * w2i + t2i * w2r;
+            yr[o + 3 * s] = t3r * w3r - t3i * w3i;
+            yi[o + 3 * s] = t3r * w3i + t3i * w3r;
+          }
+        }
+      }
+      //! A radix 4 pass with a stride of at least a vector, vectorized along the stride
+      void radix4( const pass& ps, const scalar* xr, const scalar* xi, scalar* yr, scalar* yi ) const
+      {
+        using namespace detail;
+        const size_t m = ps.n / 4, s = ps.s;
+        const size_t quarter = size_ / 4;
+        const scalar* wr = &twRe_[ps.twiddles];
+        const scalar* wi = &twIm_[ps.twiddles];
+        for ( size_t p = 0; p < m; ++p )
+        {
+          const C w1 = { O::broadcast( wr + 3 * p ), O::broadcast( wi + 3 * p ) };
+          const C w2 = { O::broadcast( wr + 3 * p + 1 ), O::broadcast( wi + 3 * p + 1 ) };
+          const C w3 = { O::broadcast( wr + 3 * p + 2 ), O::broadcast( wi + 3 * p + 2 ) };
+          for ( size_t q = 0; q < s; q += lanes )
+          {
+            const size_t i = q + s * p;
+            C y0, y1, y2, y3;
+            fftButterfly4( fftLoad<V>( xr, xi, i ), fftLoad<V>( xr, xi, i + quarter ), fftLoad<V>( xr, xi, i + 2 * quarter ),
+              fftLoad<V>( xr, xi, i + 3 * quarter ), y0, y1, y2, y3 );
+            const size_t o = q + s * 4 * p;
+            fftStore( yr, yi, o, y0 );
+            fftStore( yr, yi, o + s, fftMul( y1, w1 ) );
+            fftStore( yr, yi, o + 2 * s, fftMul( y2, w2 ) );
+            fftStore( yr, yi, o + 3 * s, fftMul( y3, w3 ) );
+          }
+        }
+      }
+      //! A radix 8 pass with a stride of at least a vector, vectorized along the stride
+      void radix8( const pass& ps, const scalar* xr, const scalar* xi, scalar* yr, scalar* yi ) const
+      {
+        using namespace detail;
+        const size_t m = ps.n / 8, s = ps.s;
+        const size_t eighth = size_ / 8;
+        for ( size_t p = 0; p < m; ++p )
+        {
+          const scalar* wr = &twRe_[ps.twiddles + 7 * p];
+          const scalar* wi = &twIm_[ps.twiddles + 7 * p];
+          for ( size_t q = 0; q < s; q += lanes )
+          {
+            const size_t i = q + s * p;
+            C x[8] = { fftLoad<V>( xr, xi, i ), fftLoad<V>( xr, xi, i + eighth ), fftLoad<V>( xr, xi, i + 2 * eighth ),
+              fftLoad<V>( xr, xi, i + 3 * eighth ), fftLoad<V>( xr, xi, i + 4 * eighth ), fftLoad<V>( xr, xi, i + 5 * eighth ),
+              fftLoad<V>( xr, xi, i + 6 * eighth ), fftLoad<V>( xr, xi, i + 7 * eighth ) };
+            fftButterfly8( x );
+            const size_t o = q + s * 8 * p;
+            const auto out = [&]( const int k )
+            {
+              fftStore( yr, yi, o + k * s, fftMul( x[k], { O::broadcast( wr + k - 1 ), O::broadcast( wi + k - 1 ) } ) );
+            };
+            fftStore( yr, yi, o, x[0] );
+            out( 1 );
+            out( 2 );
+            out( 3 );
+            out( 4 );
+            out( 5 );
+            out( 6 );
+            out( 7 );
+          }
+        }
+      }
+      //! The first pass, stride 1, a vector of butterflies at a time
+      void first( const pass& ps, const scalar* xr, const scalar* xi, scalar* yr, scalar* yi ) const
+      {
+        using namespace detail;
+        const size_t quarter = size_ / 4;
+        const scalar* wr = &twRe_[ps.twiddles];
+        const scalar* wi = &twIm_[ps.twiddles];
+        for ( size_t p = 0; p < quarter; p += lanes )
+        {
+          C y0, y1, y2, y3;
+          fftButterfly4( fftLoad<V>( xr, xi, p ), fftLoad<V>( xr, xi, p + quarter ), fftLoad<V>( xr, xi, p + 2 * quarter ),
+            fftLoad<V>( xr, xi, p + 3 * quarter ), y0, y1, y2, y3 );
+          y1 = fftMul( y1, fftLoad<V>( wr, wi, p ) );
+          y2 = fftMul( y2, fftLoad<V>( wr, wi, p + quarter ) );
+          y3 = fftMul( y3, fftLoad<V>( wr, wi, p + 2 * quarter ) );
+          // butterfly p writes 4p to 4p + 3
+          O::transpose4( y0.re, y1.re, y2.re, y3.re, yr + 4 * p );
+          O::transpose4( y0.im, y1.im, y2.im, y3.im, yi + 4 * p );
+        }
+      }
+      //! The second pass of vec8f, stride 4, two butterflies of four points at a time
+      void second( const pass& ps, const scalar* xr, const scalar* xi, scalar* yr, scalar* yi ) const
+      {
+        using namespace detail;
+        const size_t quarter = size_ / 4;
+        const size_t m = size_ / 16;
+        const scalar* wr = &twRe_[ps.twiddles];
+        const scalar* wi = &twIm_[ps.twiddles];
+        for ( size_t p = 0; p < m; p += 2 )
+        {
+          const size_t i = 4 * p;
+          C y0, y1, y2, y3;
+          fftButterfly4( fftLoad<V>( xr, xi, i ), fftLoad<V>( xr, xi, i + quarter ), fftLoad<V>( xr, xi, i + 2 * quarter ),
+            fftLoad<V>( xr, xi, i + 3 * quarter ), y0, y1, y2, y3 );
+          const scalar* w = wr + 3 * p;
+          const scalar* v = wi + 3 * p;
+          y1 = fftMul( y1, { O::pair( w, w + 3 ), O::pair( v, v + 3 ) } );
+          y2 = fftMul( y2, { O::pair( w + 1, w + 4 ), O::pair( v + 1, v + 4 ) } );
+          y3 = fftMul( y3, { O::pair( w + 2, w + 5 ), O::pair( v + 2, v + 5 ) } );
+          // butterfly p writes 16p + 4k, butterfly p + 1 sixteen further on
+          const C* y[4] = { &y0, &y1, &y2, &y3 };
+          for ( int k = 0; k < 4; ++k )
+          {
+            const size_t o = 16 * p + 4 * k;
+            _mm_storeu_ps( yr + o, _mm256_castps256_ps128( y[k]->re ) );
+            _mm_storeu_ps( yi + o, _mm256_castps256_ps128( y[k]->im ) );
+            _mm_storeu_ps( yr + o + 16, _mm256_extractf128_ps( y[k]->re, 1 ) );
+            _mm_storeu_ps( yi + o + 16, _mm256_extractf128_ps( y[k]->im, 1 ) );
+          }
+        }
+      }
+      //! The last pass of length 2, stride size / 2
+      void radix2( const scalar* xr, const scalar* xi, scalar* yr, scalar* yi ) const
+      {
+        using T = detail::vecmath<V>;
+        const size_t half = size_ / 2;
+        size_t q = 0;
+        if ( half >= lanes )
+        {
+          for ( ; q < half; q += lanes )
+          {
+            const auto a = detail::fftLoad<V>( xr, xi, q );
+            const auto b = detail::fftLoad<V>( xr, xi, q + half );
+            detail::fftStore<V>( yr, yi, q, { T::add( a.re, b.re ), T::add( a.im, b.im ) } );
+            detail::fftStore<V>( yr, yi, q + half, { T::sub( a.re, b.re ), T::sub( a.im, b.im ) } );
+          }
+        }
+        for ( ; q < half; ++q )
+        {
+          const scalar ar = xr[q], ai = xi[q], br = xr[q + half], bi = xi[q + half];
+          yr[q] = ar + br;
+          yi[q] = ai + bi;
+          yr[q + half] = ar - br;
+          yi[q + half] = ai - bi;
+        }
+      }
+    public:
+      fft() = default;
+      //! A plan for size points, a power of two
+      explicit fft( const size_t size )
+      {
+        resize( size );
+      }
+      //! Plan for size points instead, a power of two
+      void resize( const size_t size )
+      {
+        size_ = size;
+        passes_.clear();
+        size_t n = size, s = 1, twiddles = 0;
+        const auto add = [&]( const kind what, const size_t radix )
+        {
+          passes_.push_back( { what, n, s, twiddles } );
+          twiddles += ( radix - 1 ) * ( n / radix );
+          n /= radix;
+          s *= radix;
+        };
+        if ( size >= 4 * lanes )
+        {
+          add( kind::first, 4 );
+          if ( s < lanes )
+            add( kind::second, 4 );
+          // radix 8 for all but one or two of the remaining bits
+          if ( std::countr_zero( n ) % 3 == 2 )
+            add( kind::radix4, 4 );
+          while ( n >= 8 )
+            add( kind::radix8, 8 );
+        }
+        else
+        {
+          while ( n >= 4 )
+            add( kind::scalar4, 4 );
+        }
+        if ( n == 2 )
+          add( kind::radix2, 2 );
+        twRe_.resize( std::max<size_t>( twiddles, 1 ) );
+        twIm_.resize( twRe_.size() );
+        const double step = -2.0 * 3.14159265358979323846 / static_cast<double>( size );
+        for ( const auto& ps : passes_ )
+        {
+          const size_t radix = ps.what == kind::radix8 ? 8 : ps.what == kind::radix2 ? 2 : 4;
+          const size_t m = ps.n / radix;
+          for ( size_t p = 0; p < m; ++p )
+          {
+            for ( size_t k = 1; k < radix; ++k )
+            {
+              const size_t at = ps.twiddles + ( ps.what == kind::first ? ( k - 1 ) * m + p : ( radix - 1 ) * p + k - 1 );
+              const double angle = step * static_cast<double>( k * p * ps.s );
+              twRe_[at] = static_cast<scalar>( std::cos( angle ) );
+              twIm_[at] = static_cast<scalar>( std::sin( angle ) );
+            }
+          }
+        }
+        workRe_.resize( size );
+        workIm_.resize( size );
+      }
+      size_t size() const
+      {
+        return size_;
+      }
+      //! X[k] = sum of x[j] exp( -2 pi i j k / size ), from (inRe, inIm) to (outRe, outIm),
+      //! which may be the same arrays
+      void forward( const scalar* inRe, const scalar* inIm, scalar* outRe, scalar* outIm )
+      {
+        const size_t count = passes_.size();
+        if ( count == 0 )
+        {
+          if ( size_ == 1 )
+          {
+            outRe[0] = inRe[0];
+            outIm[0] = inIm[0];
+          }
+          return;
+        }
+        const scalar* xr = inRe;
+        const scalar* xi = inIm;
+        if ( count % 2 == 1 && inRe == outRe )
+        {
+          // the first pass has to write to out, which still holds the input
+          std::copy( inRe, inRe + size_, workRe_.data() );
+          std::copy( inIm, inIm + size_, workIm_.data() );
+          xr = workRe_.data();
+          xi = workIm_.data();
+        }
+        for ( size_t i = 0; i < count; ++i )
+        {
+          // alternate so that the last pass lands in out
+          const bool toOut = ( count - i ) % 2 == 1;
+          scalar* yr = toOut ? outRe : workRe_.data();
+          scalar* yi = toOut ? outIm : workIm_.data();
+          const pass& ps = passes_[i];
+          switch ( ps.what )
+          {
+            case kind::first: first( ps, xr, xi, yr, yi ); break;
+            case kind::second:
+              if constexpr ( lanes == 8 )
+                second( ps, xr, xi, yr, yi );
+              break;
+            case kind::radix4: radix4( ps, xr, xi, yr, yi ); break;
+            case kind::radix8: radix8( ps, xr, xi, yr, yi ); break;
+            case kind::radix2: radix2( xr, xi, yr, yi ); break;
+            case kind::scalar4: scalar4( ps, xr, xi, yr, yi ); break;
+          }
+          xr = yr;
+          xi = yi;
+        }
+      }
+      //! x[j] = sum of X[k] exp( 2 pi i j k / size ), so forward then inverse scales by size()
+      void inverse( const scalar* inRe, const scalar* inIm, scalar* outRe, scalar* outIm )
+      {
+        // the inverse is the forward transform with real & imaginary parts swapped
+        // on the way in & out
+        forward( inIm, inRe, outIm, outRe );
+      }
+    };
+
+    //! An FFT of real signals of one size, through a complex FFT of half the size.
+    //! The spectrum of size points is the size / 2 + 1 bins from 0 to the Nyquist
+    //! frequency, the rest being their complex conjugates.
+    template <typename V>
+    class realFft {
+    public:
+      using scalar = typename detail::fftOps<V>::scalar;
+    private:
+      using O = detail::fftOps<V>;
+      using T = detail::vecmath<V>;
+      static constexpr size_t lanes = O::lanes;
+      fft<V> half_;
+      //! exp( -2 pi i k / size ) for k <= size / 2
+      buffer<scalar> twRe_, twIm_;
+      buffer<scalar> zRe_, zIm_;
+    public:
+      realFft() = default;
+      //! A plan for size points, a power of two from 2
+      explicit realFft( const size_t size )
+      {
+        resize( size );
+      }
+      void resize( const size_t size )
+      {
+        const size_t h = size / 2;
+        half_.resize( h );
+        twRe_.resize( h + 1 );
+        twIm_.resize( h + 1 );
+        const double step = -2.0 * 3.14159265358979323846 / static_cast<double>( size );
+        for ( size_t k = 0; k <= h; ++k )
+        {
+          twRe_[k] = static_cast<scalar>( std::cos( step * static_cast<double>( k ) ) );
+          twIm_[k] = static_cast<scalar>( std::sin( step * static_cast<double>( k ) ) );
+        }
+        zRe_.resize( h + 1 );
+        zIm_.resize( h + 1 );
+      }
+      size_t size() const
+      {
+        return half_.size() * 2;
+      }
+      //! size() / 2 + 1, the bins in a spectrum
+      size_t bins() const
+      {
+        return half_.size() + 1;
+      }
+      //! The spectrum of the size() samples of x, to bins() values in re & im
+      void forward( const scalar* x, scalar* re, scalar* im )
+      {
+        const size_t h = half_.size();
+        scalar* zr = zRe_.data();
+        scalar* zi = zIm_.data();
+        // even samples as real parts & odd ones as imaginary parts
+        size_t j = 0;
+        if ( h >= lanes )
+        {
+          for ( ; j < h; j += lanes )
+          {
+            typename T::reg even, odd;
+            O::split( x + 2 * j, even, odd );
+            O::store( zr + j, even );
+            O::store( zi + j, odd );
+          }
+        }
+        for ( ; j < h; ++j )
+        {
+          zr[j] = x[2 * j];
+          zi[j] = x[2 * j + 1];
+        }
+        half_.forward( zr, zi, zr, zi );
+        zr[h] = zr[0];
+        zi[h] = zi[0];
+        // with Z[k] = (a, b) & Z[h - k] = (c, d), the transforms of the even & odd
+        // samples are E = ((a + c) / 2, (b - d) / 2) & O = ((b + d) / 2, (c - a) / 2),
+        // & X[k] = E + W^k O
+        size_t k = 0;
+        if ( h >= lanes )
+        {
+          const auto half = T::set1( scalar( 0.5 ) );
+          for ( ; k + lanes <= h; k += lanes )
+          {
+            const auto a = O::load( zr + k );
+            const auto b = O::load( zi + k );
+            const auto c = O::reverse( O::load( zr + h - k - ( lanes - 1 ) ) );
+            const auto d = O::reverse( O::load( zi + h - k - ( lanes - 1 ) ) );
+            const auto wr = O::load( &twRe_[k] );
+            const auto wi = O::load( &twIm_[k] );
+            const auto er = T::add( a, c ), ei = T::sub( b, d );
+            const auto orr = T::add( b, d ), oi = T::sub( c, a );
+            O::store( re + k, T::mul( half, T::add( er, T::sub( T::mul( wr, orr ), T::mul( wi, oi ) ) ) ) );
+            O::store( im + k, T::mul( half, T::add( ei, T::madd( wr, oi, T::mul( wi, orr ) ) ) ) );
+          }
+        }
+        for ( ; k <= h; ++k )
+        {
+          const scalar a = zr[k], b = zi[k], c = zr[h - k], d = zi[h - k];
+          const scalar er = a + c, ei = b - d, orr = b + d, oi = c - a;
+          re[k] = scalar( 0.5 ) * ( er + twRe_[k] * orr - twIm_[k] * oi );
+          im[k] = scalar( 0.5 ) * ( ei + twRe_[k] * oi + twIm_[k] * orr );
+        }
+      }
+      //! The size() samples of the spectrum of bins() values in re & im to x, scaled
+      //! by size() like fft::inverse. The imaginary parts of the first & last bins
+      //! are taken to be 0.
+      void inverse( const scalar* re, const scalar* im, scalar* x )
+      {
+        const size_t h = half_.size();
+        scalar* zr = zRe_.data();
+        scalar* zi = zIm_.data();
+        // with X[k] = (a, b) & X[h - k] = (c, d), 2E = (a + c, b - d), 2O is
+        // conj( W^k ) (a - c, b + d) & Z[k] = 2E + i 2O
+        size_t k = 0;
+        if ( h >= lanes )
+        {
+          for ( ; k < h; k += lanes )
+          {
+            const auto a = O::load( re + k );
+            const auto b = O::load( im + k );
+            const auto c = O::reverse( O::load( re + h - k - ( lanes - 1 ) ) );
+            const auto d = O::reverse( O::load( im + h - k - ( lanes - 1 ) ) );
+            const auto wr = O::load( &twRe_[k] );
+            const auto wi = O::load( &twIm_[k] );
+            const auto dr = T::sub( a, c ), di = T::add( b, d );
+            const auto orr = T::madd( wr, dr, T::mul( wi, di ) );
+            const auto oi = T::sub( T::mul( wr, di ), T::mul( wi, dr ) );
+            O::store( zr + k, T::sub( T::add( a, c ), oi ) );
+            O::store( zi + k, T::add( T::sub( b, d ), orr ) );
+          }
+        }
+        for ( ; k < h; ++k )
+        {
+          const scalar a = re[k], b = k ? im[k] : scalar( 0 ), c = re[h - k], d = k ? im[h - k] : scalar( 0 );
+          const scalar dr = a - c, di = b + d;
+          const scalar orr = twRe_[k] * dr + twIm_[k] * di;
+          const scalar oi = twRe_[k] * di - twIm_[k] * dr;
+          zr[k] = a + c - oi;
+          zi[k] = b - d + orr;
+        }
+        if ( h >= lanes )
+        {
+          // the vector loop took the imaginary parts of bins 0 & h as they were
+          zr[0] = re[0] + re[h];
+          zi[0] = re[0] - re[h];
+        }
+        half_.inverse( zr, zi, zr, zi );
+        size_t j = 0;
+        if ( h >= lanes )
+        {
+          for ( ; j < h; j += lanes )
+            O::join( O::load( zr + j ), O::load( zi + j ), x + 2 * j );
+        }
+        for ( ; j < h; ++j )
+        {
+          x[2 * j] = zr[j];
+          x[2 * j + 1] = zi[j];
+        }
+      }
+    };
+
+    using fftf = fft<vec8f>;
+    using fftd = fft<vec4d>;
+    using realFftf = realFft<vec8f>;
+    using realFftd = realFft<vec4d>;
+
+  }
+
+}
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef NM_GATHER_H
+#define NM_GATHER_H
+
+#include "nm_common.h"
+#include "nm_vec8f.h"
+#include "nm_vec4d.h"
+#include "nm_vec4i.h"
+#include "nm_vec8i.h"
+
+namespace nmath {
+
+  inline namespace NMATH_ISA_NAMESPACE {
+
+    //! v[i] = base[index[i]]
+    //! Uses the AVX2 gather instruction when available, otherwise emulated
+    //! with scalar loads. Hardware gather is not much faster than the scalar
+    //! loads on most cores, but it saves the index round trip through memory.
+    nmath_inline vec8f gather( const float* base, const vec8i& index )
+    {
+#ifdef NMATH_HAS_AVX2
+      return _mm256_i32gather_ps( base, index.packed, 4 );
+#else
+      nmath_32b_align int32_t idx[8];
+      _mm256_store_si256( reinterpret_cast<__m256i*>( idx ), index.packed );
+      return _mm256_setr_ps(
+        base[idx[0]], base[idx[1]], base[idx[2]], base[idx[3]],
+        base[idx[4]], base[idx[5]], base[idx[6]], base[idx[7]] );
+#endif
+    }
+
+    //! v[i] = base[index[i]]
+    //! Four lanes, so the indices come in a vec4i rather than a vec8i.
+    nmath_inline vec4d gather( const double* base, const vec4i& index )
+    {
+#ifdef NMATH_HAS_AVX2
+      return _mm256_i32gather_pd( base, index.packed, 8 );
+#else
+      nmath_16b_align int32_t idx[4];
+      _mm_store_si128( reinterpret_cast<__m128i*>( idx ), index.packed );
+      return _mm256_setr_pd( base[idx[0]], base[idx[1]], base[idx[2]], base[idx[3]] );
+#endif
+    }
+
+    //! v[i] = mask[i] ? base[index[i]] : fallback[i]
+    //! Masked-off lanes don't read memory, so their indices may be garbage.
+    nmath_inline vec8f gather( const float* base, const vec8i& index, const vec8f& mask, const vec8f& fallback )
+    {
+#ifdef NMATH_HAS_AVX2
+      return _mm256_mask_i32gather_ps( fallback.packed, base, index.packed, mask.packed, 4 );
+#else
+      nmath_32b_align int32_t idx[8];
+      nmath_32b_align float ret[8];
+      _mm256_store_si256( reinterpret_cast<__m256i*>( idx ), index.packed );
+      _mm256_store_ps( ret, fallback.packed );
+      const int bits = mask.bitmask();
+      for ( int i = 0; i < 8; ++i )
+        if ( bits & ( 1 << i ) )
+          ret[i] = base[idx[i]];
+      return _mm256_load_ps( ret );
+#endif
+    }
+
+    //! v[i] = mask[i] ? base[index[i]] : fallback[i]
+    //! Masked-off lanes don't read memory, so their indices may be garbage.
+    nmath_inline vec4d gather( const double* base, const vec4i& index, const vec4d& mask, const vec4d& fallback )
+    {
+#ifdef NMATH_HAS_AVX2
+      return _mm256_mask_i32gather_pd( fallback.packed, base, index.packed, mask.packed, 8 );
+#else
+      nmath_16b_align int32_t idx[4];
+      nmath_32b_align double ret[4];
+      _mm_store_si128( reinterpret_cast<__m128i*>( idx ), index.packed );
+      _mm256_store_pd( ret, fallback.packed );
+      const int bits = mask.bitmask();
+      for ( int i = 0; i < 4; ++i )
+        if ( bits & ( 1 << i ) )
+          ret[i] = base[idx[i]];
+      return _mm256_load_pd( ret );
+#endif
+    }
+
+  }
+
+}
+
+#endif
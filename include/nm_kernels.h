@@ -0,0 +1,265 @@
+#ifndef NM_KERNELS_H
+#define NM_KERNELS_H
+
+#include "nm_common.h"
+#include "nm_vec8f.h"
+#include "nm_vec4d.h"
+#include <type_traits>
+
+// Bulk elementwise operations over float & double arrays.
+//
+// Every kernel writes dst[0..n) and reads its sources at the same indices.
+// dst may be the very same pointer as a source (in-place), but must not
+// otherwise overlap one. Nothing outside [0, n) is ever read or written:
+// the head up to the first vector-aligned dst element and the tail past the
+// last full vector go through masked partial loads & stores.
+//
+// Above nontemporalThreshold bytes of output the kernels stream their stores
+// past the cache; such a buffer wouldn't fit anyway, and streaming skips the
+// read-for-ownership of the destination lines. Callers that know better, like
+// the chunked parallel kernels in nm_parallel.h, can pick the stores explicitly.
+
+namespace nmath {
+
+  inline namespace NMATH_ISA_NAMESPACE {
+
+    namespace kernels {
+
+      //! Output size in bytes from which kernels switch to nontemporal stores.
+      //! About the last-level cache share of a core on current desktop parts.
+      constexpr size_t nontemporalThreshold = 4u << 20;
+
+      //! Which stores the elementwise kernels use for the aligned body
+      enum class stores {
+        automatic, //!< nontemporal from nontemporalThreshold bytes of output on
+        temporal, //!< always through the cache
+        nontemporal //!< always streamed past the cache
+      };
+
+      namespace detail {
+
+        template <typename S> struct lanes;
+        template <> struct lanes<float> {
+          using vec = vec8f;
+          static constexpr size_t count = 8;
+          //! Mask vector with the first n lanes set
+          static nmath_inline vec8f tailMask( const size_t n )
+          {
+            return _mm256_castsi256_ps( vec8f::tailMask( n ) );
+          }
+        };
+        template <> struct lanes<double> {
+          using vec = vec4d;
+          static constexpr size_t count = 4;
+          //! Mask vector with the first n lanes set
+          static nmath_inline vec4d tailMask( const size_t n )
+          {
+            return _mm256_castsi256_pd( vec4d::tailMask( n ) );
+          }
+        };
+
+        //! Scalar parameter type that doesn't take part in template deduction,
+        //! so scale( floats, 2.0, n ) works without a cast
+        template <typename S>
+        using scalar = typename std::type_identity<S>::type;
+
+        template <typename V>
+        struct fullLoad {
+          template <typename S>
+          nmath_inline V operator () ( const S* p ) const
+          {
+            V v;
+            v.loadUnaligned( p );
+            return v;
+          }
+        };
+
+        template <typename V>
+        struct partialLoad {
+          size_t count;
+          template <typename S>
+          nmath_inline V operator () ( const S* p ) const
+          {
+            V v;
+            v.loadPartial( p, count );
+            return v;
+          }
+        };
+
+        struct temporalStore {
+          template <typename V, typename S>
+          nmath_inline void operator () ( V& v, S* p ) const
+          {
+            v.storeTemporal( p );
+          }
+        };
+
+        struct nontemporalStore {
+          template <typename V, typename S>
+          nmath_inline void operator () ( V& v, S* p ) const
+          {
+            v.storeNontemporal( p );
+          }
+        };
+
+        struct unalignedStore {
+          template <typename V, typename S>
+          nmath_inline void operator () ( V& v, S* p ) const
+          {
+            v.storeUnaligned( p );
+          }
+        };
+
+        //! Full vectors from i while they fit, four at a time so that the
+        //! independent loads & ops of consecutive vectors overlap
+        template <typename S, typename Fn, typename Store>
+        nmath_inline size_t body( S* dst, size_t i, const size_t n, Fn& fn, const Store& store )
+        {
+          using V = typename lanes<S>::vec;
+          constexpr size_t W = lanes<S>::count;
+          const fullLoad<V> load;
+          for ( ; i + 4 * W <= n; i += 4 * W )
+          {
+            V r0 = fn( load, i );
+            V r1 = fn( load, i + W );
+            V r2 = fn( load, i + 2 * W );
+            V r3 = fn( load, i + 3 * W );
+            store( r0, dst + i );
+            store( r1, dst + i + W );
+            store( r2, dst + i + 2 * W );
+            store( r3, dst + i + 3 * W );
+          }
+          for ( ; i + W <= n; i += W )
+          {
+            V r = fn( load, i );
+            store( r, dst + i );
+          }
+          return i;
+        }
+
+        //! Drives fn( load, i ) -> vector of results for dst[i..i+W) over [0, n).
+        //! fn must read its sources only through load( source + i ), which is
+        //! what makes the masked head & tail possible.
+        template <typename S, typename Fn>
+        nmath_inline void transform( S* dst, const size_t n, const stores mode, Fn&& fn )
+        {
+          using V = typename lanes<S>::vec;
+          constexpr size_t W = lanes<S>::count;
+          constexpr size_t align = W * sizeof( S );
+          const size_t offset = reinterpret_cast<uintptr_t>( dst ) % align;
+          size_t i = 0;
+          if ( offset % sizeof( S ) != 0 )
+          {
+            // not even element aligned, so peeling can never reach alignment
+            i = body( dst, i, n, fn, unalignedStore() );
+          }
+          else
+          {
+            const size_t head = ( offset ? ( align - offset ) / sizeof( S ) : 0 );
+            if ( head )
+            {
+              const size_t count = ( head < n ? head : n );
+              V r = fn( partialLoad<V> { count }, 0 );
+              r.storePartial( dst, count );
+              i = count;
+            }
+            const bool stream = ( mode == stores::nontemporal || ( mode == stores::automatic && n * sizeof( S ) >= nontemporalThreshold ) );
+            if ( stream )
+            {
+              i = body( dst, i, n, fn, nontemporalStore() );
+              // streaming stores are weakly ordered; make them visible before returning
+              _mm_sfence();
+            }
+            else
+              i = body( dst, i, n, fn, temporalStore() );
+          }
+          if ( i < n )
+          {
+            V r = fn( partialLoad<V> { n - i }, i );
+            r.storePartial( dst + i, n - i );
+          }
+        }
+
+      }
+
+      //! dst = a + b
+      template <typename S>
+      inline void add( S* dst, const S* a, const S* b, const size_t n, const stores mode = stores::automatic )
+      {
+        detail::transform( dst, n, mode, [=]( const auto& load, size_t i )
+        {
+          return load( a + i ) + load( b + i );
+        } );
+      }
+
+      //! dst = a - b
+      template <typename S>
+      inline void sub( S* dst, const S* a, const S* b, const size_t n, const stores mode = stores::automatic )
+      {
+        detail::transform( dst, n, mode, [=]( const auto& load, size_t i )
+        {
+          return load( a + i ) - load( b + i );
+        } );
+      }
+
+      //! dst = a * b
+      template <typename S>
+      inline void mul( S* dst, const S* a, const S* b, const size_t n, const stores mode = stores::automatic )
+      {
+        detail::transform( dst, n, mode, [=]( const auto& load, size_t i )
+        {
+          return load( a + i ) * load( b + i );
+        } );
+      }
+
+      //! dst = src * s
+      template <typename S>
+      inline void scale( S* dst, const S* src, const detail::scalar<S> s, const size_t n, const stores mode = stores::automatic )
+      {
+        const typename detail::lanes<S>::vec factor( s );
+        detail::transform( dst, n, mode, [=]( const auto& load, size_t i )
+        {
+          return load( src + i ) * factor;
+        } );
+      }
+
+      //! y = alpha * x + y
+      template <typename S>
+      inline void axpy( S* y, const detail::scalar<S> alpha, const S* x, const size_t n, const stores mode = stores::automatic )
+      {
+        typename detail::lanes<S>::vec factor( alpha );
+        detail::transform( y, n, mode, [=]( const auto& load, size_t i ) mutable
+        {
+          return factor.fma( factor, load( x + i ), load( y + i ) );
+        } );
+      }
+
+      //! dst = a * b + c, fused when the target isa has FMA3
+      template <typename S>
+      inline void fma( S* dst, const S* a, const S* b, const S* c, const size_t n, const stores mode = stores::automatic )
+      {
+        detail::transform( dst, n, mode, [=]( const auto& load, size_t i )
+        {
+          auto va = load( a + i );
+          return va.fma( va, load( b + i ), load( c + i ) );
+        } );
+      }
+
+      //! dst = min(max(src, lo), hi)
+      template <typename S>
+      inline void clamp( S* dst, const S* src, const detail::scalar<S> lo, const detail::scalar<S> hi, const size_t n, const stores mode = stores::automatic )
+      {
+        const typename detail::lanes<S>::vec vlo( lo ), vhi( hi );
+        detail::transform( dst, n, mode, [=]( const auto& load, size_t i )
+        {
+          return load( src + i ).clamp( vlo, vhi );
+        } );
+      }
+
+    }
+
+  }
+
+}
+
+#endif
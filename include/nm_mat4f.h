@@ -0,0 +1,394 @@
+#ifndef NM_MAT4F_H
+#define NM_MAT4F_H
+
+#include "nm_common.h"
+#include "nm_vec4f.h"
+#include "nm_vec8f.h"
+
+// 4x4 float matrix stored as four vec4f rows.
+//
+// Vectors are rows that multiply from the left, v' = v * M, so transforms
+// chain left to right (v * A * B applies A first) and an affine matrix keeps
+// its translation in the last row with the first three rows' w at 0. This is
+// the layout where both matrix products and vector transforms reduce to
+// broadcasts & multiply-adds of whole rows, with no horizontal adds.
+
+namespace nmath {
+
+  inline namespace NMATH_ISA_NAMESPACE {
+
+    namespace detail {
+
+      //! Lane k of v in all four lanes
+      template <int k>
+      nmath_inline __m128 splat( const __m128 v )
+      {
+        return _mm_shuffle_ps( v, v, _MM_SHUFFLE( k, k, k, k ) );
+      }
+
+      //! v = a * b + c with or without FMA3
+      nmath_inline __m128 madd( const __m128 a, const __m128 b, const __m128 c )
+      {
+#ifdef NMATH_HAS_FMA
+        return _mm_fmadd_ps( a, b, c );
+#else
+        return _mm_add_ps( _mm_mul_ps( a, b ), c );
+#endif
+      }
+
+      nmath_inline __m256 madd( const __m256 a, const __m256 b, const __m256 c )
+      {
+#ifdef NMATH_HAS_FMA
+        return _mm256_fmadd_ps( a, b, c );
+#else
+        return _mm256_add_ps( _mm256_mul_ps( a, b ), c );
+#endif
+      }
+
+      //! Row vector v times the matrix with rows r
+      nmath_inline __m128 rowTimes( const __m128 v, const vec4f* r )
+      {
+        auto acc = _mm_mul_ps( splat<0>( v ), r[0].packed );
+        acc = madd( splat<1>( v ), r[1].packed, acc );
+        acc = madd( splat<2>( v ), r[2].packed, acc );
+        return madd( splat<3>( v ), r[3].packed, acc );
+      }
+
+      //! Cross product of the xyz parts, w comes out 0
+      nmath_inline __m128 cross3( const __m128 a, const __m128 b )
+      {
+        const auto ayzx = _mm_shuffle_ps( a, a, _MM_SHUFFLE( 3, 0, 2, 1 ) );
+        const auto byzx = _mm_shuffle_ps( b, b, _MM_SHUFFLE( 3, 0, 2, 1 ) );
+        const auto c = _mm_sub_ps( _mm_mul_ps( a, byzx ), _mm_mul_ps( ayzx, b ) );
+        return _mm_shuffle_ps( c, c, _MM_SHUFFLE( 3, 0, 2, 1 ) );
+      }
+
+      // 2x2 matrices packed row-major into one register as (m00, m01, m10, m11)
+
+      //! a * b
+      nmath_inline __m128 mat2Mul( const __m128 a, const __m128 b )
+      {
+        return _mm_add_ps( _mm_mul_ps( a, _mm_shuffle_ps( b, b, _MM_SHUFFLE( 3, 0, 3, 0 ) ) ),
+          _mm_mul_ps( _mm_shuffle_ps( a, a, _MM_SHUFFLE( 2, 3, 0, 1 ) ), _mm_shuffle_ps( b, b, _MM_SHUFFLE( 1, 2, 1, 2 ) ) ) );
+      }
+
+      //! adjugate(a) * b
+      nmath_inline __m128 mat2AdjMul( const __m128 a, const __m128 b )
+      {
+        return _mm_sub_ps( _mm_mul_ps( _mm_shuffle_ps( a, a, _MM_SHUFFLE( 0, 0, 3, 3 ) ), b ),
+          _mm_mul_ps( _mm_shuffle_ps( a, a, _MM_SHUFFLE( 2, 2, 1, 1 ) ), _mm_shuffle_ps( b, b, _MM_SHUFFLE( 1, 0, 3, 2 ) ) ) );
+      }
+
+      //! a * adjugate(b)
+      nmath_inline __m128 mat2MulAdj( const __m128 a, const __m128 b )
+      {
+        return _mm_sub_ps( _mm_mul_ps( a, _mm_shuffle_ps( b, b, _MM_SHUFFLE( 0, 3, 0, 3 ) ) ),
+          _mm_mul_ps( _mm_shuffle_ps( a, a, _MM_SHUFFLE( 2, 3, 0, 1 ) ), _mm_shuffle_ps( b, b, _MM_SHUFFLE( 1, 2, 1, 2 ) ) ) );
+      }
+
+    }
+
+    class nmath_32b_align mat4f {
+    public:
+      vec4f rows[4];
+      //! All zero
+      nmath_inline mat4f()
+      {
+      }
+      nmath_inline mat4f( const vec4f& r0, const vec4f& r1, const vec4f& r2, const vec4f& r3 )
+      {
+        rows[0].packed = r0.packed;
+        rows[1].packed = r1.packed;
+        rows[2].packed = r2.packed;
+        rows[3].packed = r3.packed;
+      }
+      //! From 16 row-major 32-byte boundary aligned values
+      nmath_inline mat4f( const float* __restrict values )
+      {
+        load( values );
+      }
+      nmath_inline static mat4f identity()
+      {
+        return mat4f( vec4f( 1.0f, 0.0f, 0.0f, 0.0f ), vec4f( 0.0f, 1.0f, 0.0f, 0.0f ), vec4f( 0.0f, 0.0f, 1.0f, 0.0f ), vec4f( 0.0f, 0.0f, 0.0f, 1.0f ) );
+      }
+      //! Affine matrix translating by (x, y, z)
+      nmath_inline static mat4f translation( float x, float y, float z )
+      {
+        return mat4f( vec4f( 1.0f, 0.0f, 0.0f, 0.0f ), vec4f( 0.0f, 1.0f, 0.0f, 0.0f ), vec4f( 0.0f, 0.0f, 1.0f, 0.0f ), vec4f( x, y, z, 1.0f ) );
+      }
+      //! Affine matrix scaling by (x, y, z)
+      nmath_inline static mat4f scaling( float x, float y, float z )
+      {
+        return mat4f( vec4f( x, 0.0f, 0.0f, 0.0f ), vec4f( 0.0f, y, 0.0f, 0.0f ), vec4f( 0.0f, 0.0f, z, 0.0f ), vec4f( 0.0f, 0.0f, 0.0f, 1.0f ) );
+      }
+      //! Load 16 row-major 16-byte boundary aligned values
+      nmath_inline void load( const float* __restrict values )
+      {
+        for ( int i = 0; i < 4; ++i )
+          rows[i].load( values + 4 * i );
+      }
+      //! Load 16 row-major unaligned values
+      nmath_inline void loadUnaligned( const float* __restrict values )
+      {
+        for ( int i = 0; i < 4; ++i )
+          rows[i].loadUnaligned( values + 4 * i );
+      }
+      //! Store 16 row-major values to 16-byte boundary aligned memory
+      nmath_inline void storeTemporal( float* __restrict values )
+      {
+        for ( int i = 0; i < 4; ++i )
+          rows[i].storeTemporal( values + 4 * i );
+      }
+      //! Store 16 row-major values to unaligned memory
+      nmath_inline void storeUnaligned( float* __restrict values )
+      {
+        for ( int i = 0; i < 4; ++i )
+          rows[i].storeUnaligned( values + 4 * i );
+      }
+      //! Element at row, column
+      nmath_inline float operator () ( const int row, const int column ) const
+      {
+        return reinterpret_cast<const float*>( rows )[row * 4 + column];
+      }
+      //! a == b
+      nmath_inline bool operator == ( const mat4f& rhs ) const
+      {
+        return ( rows[0] == rhs.rows[0] && rows[1] == rhs.rows[1] && rows[2] == rhs.rows[2] && rows[3] == rhs.rows[3] );
+      }
+      //! a != b
+      nmath_inline bool operator != ( const mat4f& rhs ) const
+      {
+        return !( *this == rhs );
+      }
+      //! m = a * b, applying a first
+      nmath_inline mat4f operator * ( const mat4f& rhs ) const
+      {
+        return mat4f(
+          detail::rowTimes( rows[0].packed, rhs.rows ),
+          detail::rowTimes( rows[1].packed, rhs.rows ),
+          detail::rowTimes( rows[2].packed, rhs.rows ),
+          detail::rowTimes( rows[3].packed, rhs.rows ) );
+      }
+      //! v' = v * m for a row vector v
+      nmath_inline vec4f transform( const vec4f& v ) const
+      {
+        return detail::rowTimes( v.packed, rows );
+      }
+      //! m = transpose(a)
+      nmath_inline mat4f transposed() const
+      {
+        auto r0 = rows[0].packed, r1 = rows[1].packed, r2 = rows[2].packed, r3 = rows[3].packed;
+        _MM_TRANSPOSE4_PS( r0, r1, r2, r3 );
+        return mat4f( r0, r1, r2, r3 );
+      }
+      //! Inverse of an affine matrix, one whose last column is (0, 0, 0, 1).
+      //! Cheaper than inverse: a 3x3 inverse from cross products plus the translation.
+      //! Singular matrices come out as infinities & NaNs.
+      nmath_inline mat4f inverseAffine() const
+      {
+        const auto a = rows[0].packed, b = rows[1].packed, c = rows[2].packed;
+        // the inverse of the 3x3 part has columns b x c, c x a, a x b over the determinant
+        auto bc = detail::cross3( b, c );
+        auto ca = detail::cross3( c, a );
+        auto ab = detail::cross3( a, b );
+        const auto det = _mm_dp_ps( a, bc, 0x7F );
+        auto zero = _mm_setzero_ps();
+        _MM_TRANSPOSE4_PS( bc, ca, ab, zero );
+        const auto rdet = _mm_div_ps( _mm_set1_ps( 1.0f ), det );
+        const auto i0 = _mm_mul_ps( bc, rdet );
+        const auto i1 = _mm_mul_ps( ca, rdet );
+        const auto i2 = _mm_mul_ps( ab, rdet );
+        // -t * inverse(L), with w = 1
+        const auto t = rows[3].packed;
+        auto tr = _mm_mul_ps( detail::splat<0>( t ), i0 );
+        tr = detail::madd( detail::splat<1>( t ), i1, tr );
+        tr = detail::madd( detail::splat<2>( t ), i2, tr );
+        return mat4f( i0, i1, i2, _mm_sub_ps( _mm_setr_ps( 0.0f, 0.0f, 0.0f, 1.0f ), tr ) );
+      }
+      //! General inverse by 2x2 blocks & their adjugates.
+      //! Singular matrices come out as infinities & NaNs.
+      nmath_inline mat4f inverse() const
+      {
+        const auto r0 = rows[0].packed, r1 = rows[1].packed, r2 = rows[2].packed, r3 = rows[3].packed;
+        // | A B |
+        // | C D |
+        const auto A = _mm_movelh_ps( r0, r1 );
+        const auto B = _mm_movehl_ps( r1, r0 );
+        const auto C = _mm_movelh_ps( r2, r3 );
+        const auto D = _mm_movehl_ps( r3, r2 );
+        // determinants of all four blocks at once as ( |A| |B| |C| |D| )
+        const auto detSub = _mm_sub_ps(
+          _mm_mul_ps( _mm_shuffle_ps( r0, r2, _MM_SHUFFLE( 2, 0, 2, 0 ) ), _mm_shuffle_ps( r1, r3, _MM_SHUFFLE( 3, 1, 3, 1 ) ) ),
+          _mm_mul_ps( _mm_shuffle_ps( r0, r2, _MM_SHUFFLE( 3, 1, 3, 1 ) ), _mm_shuffle_ps( r1, r3, _MM_SHUFFLE( 2, 0, 2, 0 ) ) ) );
+        const auto detA = detail::splat<0>( detSub );
+        const auto detB = detail::splat<1>( detSub );
+        const auto detC = detail::splat<2>( detSub );
+        const auto detD = detail::splat<3>( detSub );
+        const auto adjDC = detail::mat2AdjMul( D, C );
+        const auto adjAB = detail::mat2AdjMul( A, B );
+        // adjugates of the blocks of the inverse
+        auto X = _mm_sub_ps( _mm_mul_ps( detD, A ), detail::mat2Mul( B, adjDC ) );
+        auto W = _mm_sub_ps( _mm_mul_ps( detA, D ), detail::mat2Mul( C, adjAB ) );
+        auto Y = _mm_sub_ps( _mm_mul_ps( detB, C ), detail::mat2MulAdj( D, adjAB ) );
+        auto Z = _mm_sub_ps( _mm_mul_ps( detC, B ), detail::mat2MulAdj( A, adjDC ) );
+        // |M| = |A||D| + |B||C| - tr( adj(A)B adj(D)C )
+        auto tr = _mm_mul_ps( adjAB, _mm_shuffle_ps( adjDC, adjDC, _MM_SHUFFLE( 3, 1, 2, 0 ) ) );
+        tr = _mm_hadd_ps( tr, tr );
+        tr = _mm_hadd_ps( tr, tr );
+        const auto detM = _mm_sub_ps( _mm_add_ps( _mm_mul_ps( detA, detD ), _mm_mul_ps( detB, detC ) ), tr );
+        const auto rdet = _mm_div_ps( _mm_setr_ps( 1.0f, -1.0f, -1.0f, 1.0f ), detM );
+        X = _mm_mul_ps( X, rdet );
+        Y = _mm_mul_ps( Y, rdet );
+        Z = _mm_mul_ps( Z, rdet );
+        W = _mm_mul_ps( W, rdet );
+        // undo the adjugates & put the blocks back into rows in one shuffle each
+        return mat4f(
+          _mm_shuffle_ps( X, Y, _MM_SHUFFLE( 1, 3, 1, 3 ) ),
+          _mm_shuffle_ps( X, Y, _MM_SHUFFLE( 0, 2, 0, 2 ) ),
+          _mm_shuffle_ps( Z, W, _MM_SHUFFLE( 1, 3, 1, 3 ) ),
+          _mm_shuffle_ps( Z, W, _MM_SHUFFLE( 0, 2, 0, 2 ) ) );
+      }
+    };
+
+    //! dst[i] = a[i] * b[i] for count matrices, two at a time on AVX.
+    //! Each vec8f holds two rows of a product; a lane-wise permute of rows i & i+1
+    //! of a against row k of b broadcast to both halves gives a row pair in four
+    //! multiply-adds, half the instructions of the vec4f product.
+    //! dst may be the same array as a or b.
+    nmath_inline void multiply( mat4f* dst, const mat4f* a, const mat4f* b, const size_t count )
+    {
+      auto product = [&]( const size_t i, __m256& lo, __m256& hi )
+      {
+        const auto a01 = _mm256_load_ps( reinterpret_cast<const float*>( &a[i].rows[0] ) );
+        const auto a23 = _mm256_load_ps( reinterpret_cast<const float*>( &a[i].rows[2] ) );
+        const auto b0 = _mm256_broadcast_ps( &b[i].rows[0].packed );
+        const auto b1 = _mm256_broadcast_ps( &b[i].rows[1].packed );
+        const auto b2 = _mm256_broadcast_ps( &b[i].rows[2].packed );
+        const auto b3 = _mm256_broadcast_ps( &b[i].rows[3].packed );
+        lo = _mm256_mul_ps( _mm256_permute_ps( a01, 0x00 ), b0 );
+        hi = _mm256_mul_ps( _mm256_permute_ps( a23, 0x00 ), b0 );
+        lo = detail::madd( _mm256_permute_ps( a01, 0x55 ), b1, lo );
+        hi = detail::madd( _mm256_permute_ps( a23, 0x55 ), b1, hi );
+        lo = detail::madd( _mm256_permute_ps( a01, 0xAA ), b2, lo );
+        hi = detail::madd( _mm256_permute_ps( a23, 0xAA ), b2, hi );
+        lo = detail::madd( _mm256_permute_ps( a01, 0xFF ), b3, lo );
+        hi = detail::madd( _mm256_permute_ps( a23, 0xFF ), b3, hi );
+      };
+      size_t i = 0;
+      for ( ; i + 2 <= count; i += 2 )
+      {
+        __m256 lo0, hi0, lo1, hi1;
+        product( i, lo0, hi0 );
+        product( i + 1, lo1, hi1 );
+        _mm256_store_ps( reinterpret_cast<float*>( &dst[i].rows[0] ), lo0 );
+        _mm256_store_ps( reinterpret_cast<float*>( &dst[i].rows[2] ), hi0 );
+        _mm256_store_ps( reinterpret_cast<float*>( &dst[i + 1].rows[0] ), lo1 );
+        _mm256_store_ps( reinterpret_cast<float*>( &dst[i + 1].rows[2] ), hi1 );
+      }
+      if ( i < count )
+      {
+        __m256 lo, hi;
+        product( i, lo, hi );
+        _mm256_store_ps( reinterpret_cast<float*>( &dst[i].rows[0] ), lo );
+        _mm256_store_ps( reinterpret_cast<float*>( &dst[i].rows[2] ), hi );
+      }
+    }
+
+    //! What the w of the xyz triples taken by the batch transforms is
+    enum class homogeneous {
+      point, //!< w = 1: scaled, rotated & translated; w' is dropped, as for affine matrices
+      projected, //!< w = 1 & divided by w' after the transform, as for projection matrices
+      direction //!< w = 0: scaled & rotated, never translated
+    };
+
+    namespace detail {
+
+      //! Transform of structure-of-arrays xyz streams, eight triples per vec8f.
+      //! Every matrix element is broadcast to all lanes once up front, so a
+      //! column of the result is three multiply-adds with no shuffles at all,
+      //! and no lanes are spent on a w that is implied anyway.
+      template <homogeneous W>
+      nmath_inline void transformStreams( const mat4f& m, const float* x, const float* y, const float* z,
+        float* ox, float* oy, float* oz, const size_t count )
+      {
+        __m256 e[4][4];
+        for ( int r = 0; r < 4; ++r )
+          for ( int c = 0; c < 4; ++c )
+            e[r][c] = _mm256_set1_ps( m( r, c ) );
+        auto column = [&]( const int c, const __m256 vx, const __m256 vy, const __m256 vz )
+        {
+          auto acc = ( W == homogeneous::direction ? _mm256_mul_ps( vz, e[2][c] ) : madd( vz, e[2][c], e[3][c] ) );
+          acc = madd( vy, e[1][c], acc );
+          return madd( vx, e[0][c], acc );
+        };
+        auto apply = [&]( const vec8f& vx, const vec8f& vy, const vec8f& vz, vec8f& rx, vec8f& ry, vec8f& rz )
+        {
+          rx.packed = column( 0, vx.packed, vy.packed, vz.packed );
+          ry.packed = column( 1, vx.packed, vy.packed, vz.packed );
+          rz.packed = column( 2, vx.packed, vy.packed, vz.packed );
+          if constexpr ( W == homogeneous::projected )
+          {
+            const auto rw = _mm256_div_ps( _mm256_set1_ps( 1.0f ), column( 3, vx.packed, vy.packed, vz.packed ) );
+            rx.packed = _mm256_mul_ps( rx.packed, rw );
+            ry.packed = _mm256_mul_ps( ry.packed, rw );
+            rz.packed = _mm256_mul_ps( rz.packed, rw );
+          }
+        };
+        size_t i = 0;
+        for ( ; i + 8 <= count; i += 8 )
+        {
+          vec8f vx, vy, vz, rx, ry, rz;
+          vx.loadUnaligned( x + i );
+          vy.loadUnaligned( y + i );
+          vz.loadUnaligned( z + i );
+          apply( vx, vy, vz, rx, ry, rz );
+          rx.storeUnaligned( ox + i );
+          ry.storeUnaligned( oy + i );
+          rz.storeUnaligned( oz + i );
+        }
+        if ( i < count )
+        {
+          vec8f vx, vy, vz, rx, ry, rz;
+          vx.loadPartial( x + i, count - i );
+          vy.loadPartial( y + i, count - i );
+          vz.loadPartial( z + i, count - i );
+          apply( vx, vy, vz, rx, ry, rz );
+          rx.storePartial( ox + i, count - i );
+          ry.storePartial( oy + i, count - i );
+          rz.storePartial( oz + i, count - i );
+        }
+      }
+
+    }
+
+    //! (ox, oy, oz)[i] = (x, y, z, 1)[i] * m for count points in separate x, y & z
+    //! arrays, eight at a time. The last column of m is ignored, so this is for
+    //! affine matrices; use projectPoints for perspective. The outputs may be the inputs.
+    nmath_inline void transformPoints( const mat4f& m, const float* x, const float* y, const float* z,
+      float* ox, float* oy, float* oz, const size_t count )
+    {
+      detail::transformStreams<homogeneous::point>( m, x, y, z, ox, oy, oz, count );
+    }
+
+    //! As transformPoints, followed by the divide by w' of a projection.
+    //! Points where w' is 0 come out as infinities & NaNs.
+    nmath_inline void projectPoints( const mat4f& m, const float* x, const float* y, const float* z,
+      float* ox, float* oy, float* oz, const size_t count )
+    {
+      detail::transformStreams<homogeneous::projected>( m, x, y, z, ox, oy, oz, count );
+    }
+
+    //! (ox, oy, oz)[i] = (x, y, z, 0)[i] * m for count directions, which don't
+    //! pick up the translation. For normals pass the inverse transpose of m.
+    //! The outputs may be the inputs.
+    nmath_inline void transformDirections( const mat4f& m, const float* x, const float* y, const float* z,
+      float* ox, float* oy, float* oz, const size_t count )
+    {
+      detail::transformStreams<homogeneous::direction>( m, x, y, z, ox, oy, oz, count );
+    }
+
+  }
+
+}
+
+#endif
@@ -0,0 +1,299 @@
+#ifndef NM_MEMORY_H
+#define NM_MEMORY_H
+
+#include "nm_common.h"
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Aligned memory for the vector types & the arrays the kernels work on.
+//
+// The vector classes are declared with nmath_32b_align, but that only holds
+// where the compiler places them itself. std::vector's default allocator and
+// plain new[] of anything bigger than alignof(std::max_align_t) don't have to
+// honor it, and a _mm256_load_ps on the result may fault.
+
+namespace nmath {
+
+  //! Bytes in the widest vector type, the alignment & padding granularity below
+  constexpr size_t vectorBytes = 32;
+
+  //! Standard allocator handing out memory aligned to at least Align bytes
+  template <typename T, size_t Align = ( alignof( T ) > vectorBytes ? alignof( T ) : vectorBytes )>
+  class aligned_allocator {
+  public:
+    static_assert( Align >= alignof( T ) && ( Align & ( Align - 1 ) ) == 0, "Align must be a power of two no smaller than alignof(T)" );
+    using value_type = T;
+    template <typename U>
+    struct rebind {
+      using other = aligned_allocator<U, Align>;
+    };
+    aligned_allocator() noexcept = default;
+    template <typename U>
+    aligned_allocator( const aligned_allocator<U, Align>& ) noexcept
+    {
+    }
+    T* allocate( const size_t count )
+    {
+      return static_cast<T*>( ::operator new( count * sizeof( T ), std::align_val_t( Align ) ) );
+    }
+    void deallocate( T* p, const size_t ) noexcept
+    {
+      ::operator delete( p, std::align_val_t( Align ) );
+    }
+    template <typename U>
+    bool operator == ( const aligned_allocator<U, Align>& ) const noexcept
+    {
+      return true;
+    }
+    template <typename U>
+    bool operator != ( const aligned_allocator<U, Align>& ) const noexcept
+    {
+      return false;
+    }
+  };
+
+  //! std::vector that is safe for vec8f, vec4d & friends and for aligned loads of its data()
+  template <typename T>
+  using aligned_vector = std::vector<T, aligned_allocator<T>>;
+
+  //! Bump allocator over one aligned block, for scratch memory that lives a frame
+  //! (or any other well defined scope). Allocating is a pointer increment, freeing
+  //! happens all at once with reset or rewind. Not thread safe; use one per thread.
+  class arena {
+  private:
+    unsigned char* base_ = nullptr;
+    size_t capacity_ = 0;
+    size_t used_ = 0;
+  public:
+    //! Arena of capacity bytes, allocated once up front
+    explicit arena( const size_t capacity ):
+      base_( static_cast<unsigned char*>( ::operator new( capacity, std::align_val_t( vectorBytes ) ) ) ),
+      capacity_( capacity )
+    {
+    }
+    ~arena()
+    {
+      ::operator delete( base_, std::align_val_t( vectorBytes ) );
+    }
+    arena( const arena& ) = delete;
+    arena& operator = ( const arena& ) = delete;
+    //! Raw memory for bytes aligned to align (a power of two), or nullptr when
+    //! the arena is out of room. Every allocation is also rounded up to whole
+    //! vectors, so full vector loads & stores over its end stay inside it.
+    void* allocate( const size_t bytes, const size_t align = vectorBytes )
+    {
+      // the block itself is only vectorBytes aligned, so larger alignments round the address
+      const uintptr_t base = reinterpret_cast<uintptr_t>( base_ );
+      const size_t start = ( ( base + used_ + align - 1 ) & ~uintptr_t( align - 1 ) ) - base;
+      const size_t end = start + ( ( bytes + vectorBytes - 1 ) & ~( vectorBytes - 1 ) );
+      if ( end > capacity_ || end < start )
+        return nullptr;
+      used_ = end;
+      return base_ + start;
+    }
+    //! Uninitialized room for count Ts, or nullptr when the arena is out of room
+    template <typename T>
+    T* allocate( const size_t count )
+    {
+      constexpr size_t align = ( alignof( T ) > vectorBytes ? alignof( T ) : vectorBytes );
+      if ( count > ( ~size_t( 0 ) ) / sizeof( T ) )
+        return nullptr;
+      return static_cast<T*>( allocate( count * sizeof( T ), align ) );
+    }
+    //! Current fill level, for rewinding back to later
+    size_t marker() const
+    {
+      return used_;
+    }
+    //! Free everything allocated since marker was taken
+    void rewind( const size_t marker )
+    {
+      used_ = marker;
+    }
+    //! Free everything
+    void reset()
+    {
+      used_ = 0;
+    }
+    size_t used() const
+    {
+      return used_;
+    }
+    size_t capacity() const
+    {
+      return capacity_;
+    }
+  };
+
+  //! Standard allocator drawing from an arena, for containers that live no longer
+  //! than the arena's current scope. Deallocation is a no-op; running out of
+  //! room throws std::bad_alloc like any other allocator would.
+  template <typename T>
+  class arena_allocator {
+  private:
+    template <typename U> friend class arena_allocator;
+    arena* arena_;
+  public:
+    using value_type = T;
+    explicit arena_allocator( arena& source ) noexcept: arena_( &source )
+    {
+    }
+    template <typename U>
+    arena_allocator( const arena_allocator<U>& rhs ) noexcept: arena_( rhs.arena_ )
+    {
+    }
+    T* allocate( const size_t count )
+    {
+      T* p = arena_->allocate<T>( count );
+      if ( !p )
+        throw std::bad_alloc();
+      return p;
+    }
+    void deallocate( T*, const size_t ) noexcept
+    {
+    }
+    template <typename U>
+    bool operator == ( const arena_allocator<U>& rhs ) const noexcept
+    {
+      return arena_ == rhs.arena_;
+    }
+    template <typename U>
+    bool operator != ( const arena_allocator<U>& rhs ) const noexcept
+    {
+      return arena_ != rhs.arena_;
+    }
+  };
+
+  //! Aligned array of float or double whose storage is padded with zeroes up to
+  //! whole vectors. Kernels & hand written loops can go over padded() elements
+  //! with full aligned loads & stores, and never need a tail. Stores may leave
+  //! garbage in the padding; resize clears it again before it comes into view.
+  //! Shrinking keeps the storage, so a buffer resized every frame to a size it
+  //! has seen before never touches the heap again.
+  template <typename S>
+  class buffer {
+  private:
+    static_assert( std::is_trivially_copyable_v<S>, "buffer is for plain scalar types" );
+    S* data_ = nullptr;
+    size_t size_ = 0;
+    size_t capacity_ = 0;
+    static constexpr size_t lanes = vectorBytes / sizeof( S );
+    static size_t roundUp( const size_t count )
+    {
+      return ( count + lanes - 1 ) / lanes * lanes;
+    }
+    void release()
+    {
+      if ( data_ )
+        aligned_allocator<S>().deallocate( data_, capacity_ );
+    }
+  public:
+    buffer() = default;
+    //! count zeroed elements
+    explicit buffer( const size_t count )
+    {
+      resize( count );
+    }
+    buffer( const buffer& rhs ): buffer( rhs.size_ )
+    {
+      if ( size_ )
+        memcpy( data_, rhs.data_, size_ * sizeof( S ) );
+    }
+    buffer( buffer&& rhs ) noexcept: data_( rhs.data_ ), size_( rhs.size_ ), capacity_( rhs.capacity_ )
+    {
+      rhs.data_ = nullptr;
+      rhs.size_ = rhs.capacity_ = 0;
+    }
+    buffer& operator = ( buffer rhs ) noexcept
+    {
+      std::swap( data_, rhs.data_ );
+      std::swap( size_, rhs.size_ );
+      std::swap( capacity_, rhs.capacity_ );
+      return *this;
+    }
+    ~buffer()
+    {
+      release();
+    }
+    //! Change the size to count. Elements that come into view are zero, including
+    //! the padding past the new size. Contents up to the old size are kept.
+    void resize( const size_t count )
+    {
+      const size_t padded = roundUp( count );
+      // whatever stores left in the old padding; everything past it is zero already
+      if ( size_ )
+        memset( data_ + size_, 0, ( roundUp( size_ ) - size_ ) * sizeof( S ) );
+      if ( padded > capacity_ )
+      {
+        S* grown = aligned_allocator<S>().allocate( padded );
+        if ( size_ )
+          memcpy( grown, data_, size_ * sizeof( S ) );
+        memset( grown + size_, 0, ( padded - size_ ) * sizeof( S ) );
+        release();
+        data_ = grown;
+        capacity_ = padded;
+      }
+      else if ( count < size_ )
+      {
+        // everything past size_ is kept zero, so growing back needs no clearing
+        memset( data_ + count, 0, ( size_ - count ) * sizeof( S ) );
+      }
+      size_ = count;
+    }
+    //! Number of elements
+    size_t size() const
+    {
+      return size_;
+    }
+    //! Number of elements rounded up to whole vectors; [size(), padded()) is zero
+    //! unless something stored there since the last resize
+    size_t padded() const
+    {
+      return roundUp( size_ );
+    }
+    bool empty() const
+    {
+      return ( size_ == 0 );
+    }
+    //! vectorBytes aligned storage
+    S* data()
+    {
+      return data_;
+    }
+    const S* data() const
+    {
+      return data_;
+    }
+    S& operator [] ( const size_t i )
+    {
+      return data_[i];
+    }
+    const S& operator [] ( const size_t i ) const
+    {
+      return data_[i];
+    }
+    S* begin()
+    {
+      return data_;
+    }
+    S* end()
+    {
+      return data_ + size_;
+    }
+    const S* begin() const
+    {
+      return data_;
+    }
+    const S* end() const
+    {
+      return data_ + size_;
+    }
+  };
+
+}
+
+#endif
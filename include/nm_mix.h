@@ -0,0 +1,184 @@
+#ifndef NM_MIX_H
+#define NM_MIX_H
+
+#include "nm_common.h"
+#include "nm_cpu.h"
+#include "nm_vec8f.h"
+#include "nm_vecmath.h"
+
+// Mixing buses together, gain ramps & crossfades.
+//
+// A mix adds every bus into the output, each scaled by its gain. One bus at a
+// time, as axpy would, the output makes a round trip through memory per bus;
+// mix keeps 32 samples of the output in registers while it runs through all
+// the buses, so the inner loop is nothing but loads & FMAs & the output is
+// read & written once.
+//
+// Gain changes jump & click unless they ramp over a block. ramp & mixRamp move
+// the gain from one value to another over the block, either linearly or along
+// an equal-power curve, whose squared gain is linear so that two uncorrelated
+// signals fading opposite ways keep a constant loudness; crossfade fades from
+// one signal to another. At sample i of count, a ramp's gain is the fraction
+// i / count of the way, so a long ramp split over blocks at the gains in
+// between joins up without a step.
+//
+// Decaying tails feeding a mix end up as denormals, which take the slow path
+// of the FPU on every operation. Mixing under a denormalGuard (nm_cpu.h)
+// flushes them to zero instead.
+
+namespace nmath {
+
+  inline namespace NMATH_ISA_NAMESPACE {
+
+    //! How gain moves along a ramp
+    enum class fadeCurve {
+      linear, //!< gain linear in time; opposite ramps keep a constant amplitude
+      equalPower //!< squared gain linear in time; opposite ramps keep a constant power
+    };
+
+    namespace detail {
+
+      //! Drives fn( load, t, i ) -> outputs i to i + 7 over [0, count), t holding
+      //! the fractions of the way those samples are. fn reads its sources only
+      //! through load( source + i ), masked on the last partial vector.
+      template <class Fn>
+      nmath_inline void ramped( float* out, const size_t count, const Fn& fn )
+      {
+        using T = vecmath<vec8f>;
+        const auto lanes = _mm256_setr_ps( 0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f );
+        const auto step = T::set1( 1.0f / static_cast<float>( count ) );
+        const auto full = []( const float* p )
+        {
+          return _mm256_loadu_ps( p );
+        };
+        size_t i = 0;
+        for ( ; i + 8 <= count; i += 8 )
+          _mm256_storeu_ps( out + i, fn( full, T::mul( T::add( T::set1( static_cast<float>( i ) ), lanes ), step ), i ) );
+        if ( i < count )
+        {
+          const auto mask = vec8f::tailMask( count - i );
+          const auto partial = [mask]( const float* p )
+          {
+            return _mm256_maskload_ps( p, mask );
+          };
+          _mm256_maskstore_ps( out + i, mask, fn( partial, T::mul( T::add( T::set1( static_cast<float>( i ) ), lanes ), step ), i ) );
+        }
+      }
+
+      //! fn( gain ) with gain( t ) -> the gains a ramp from from to to has at t
+      template <class Fn>
+      nmath_inline void withCurve( const fadeCurve curve, const float from, const float to, const Fn& fn )
+      {
+        using T = vecmath<vec8f>;
+        if ( curve == fadeCurve::linear )
+        {
+          const auto base = T::set1( from ), delta = T::set1( to - from );
+          fn( [=]( const __m256 t )
+          {
+            return T::madd( delta, t, base );
+          } );
+        }
+        else
+        {
+          // the clamp keeps rounding from taking the root of a tiny negative
+          const auto base = T::set1( from * from ), delta = T::set1( to * to - from * from ), zero = T::set1( 0.0f );
+          fn( [=]( const __m256 t )
+          {
+            return _mm256_sqrt_ps( T::max( T::madd( delta, t, base ), zero ) );
+          } );
+        }
+      }
+
+    }
+
+    //! out += gains[b] * in[b] for each of buses buses, over count samples.
+    //! out may be one of the inputs, but not overlap one otherwise.
+    inline void mix( const float* const* in, const float* gains, const size_t buses, float* out, const size_t count )
+    {
+      using T = detail::vecmath<vec8f>;
+      size_t i = 0;
+      for ( ; i + 32 <= count; i += 32 )
+      {
+        auto a0 = _mm256_loadu_ps( out + i ), a1 = _mm256_loadu_ps( out + i + 8 );
+        auto a2 = _mm256_loadu_ps( out + i + 16 ), a3 = _mm256_loadu_ps( out + i + 24 );
+        for ( size_t b = 0; b < buses; ++b )
+        {
+          const float* x = in[b] + i;
+          const auto g = T::set1( gains[b] );
+          a0 = T::madd( g, _mm256_loadu_ps( x ), a0 );
+          a1 = T::madd( g, _mm256_loadu_ps( x + 8 ), a1 );
+          a2 = T::madd( g, _mm256_loadu_ps( x + 16 ), a2 );
+          a3 = T::madd( g, _mm256_loadu_ps( x + 24 ), a3 );
+        }
+        _mm256_storeu_ps( out + i, a0 );
+        _mm256_storeu_ps( out + i + 8, a1 );
+        _mm256_storeu_ps( out + i + 16, a2 );
+        _mm256_storeu_ps( out + i + 24, a3 );
+      }
+      for ( ; i < count; i += 8 )
+      {
+        const auto mask = vec8f::tailMask( count - i );
+        auto a = _mm256_maskload_ps( out + i, mask );
+        for ( size_t b = 0; b < buses; ++b )
+          a = T::madd( T::set1( gains[b] ), _mm256_maskload_ps( in[b] + i, mask ), a );
+        _mm256_maskstore_ps( out + i, mask, a );
+      }
+    }
+
+    //! out = in with its gain ramping from from to to over count samples. in
+    //! & out may be the same buffer. Equal-power ramps take gains of 0 or more.
+    inline void ramp( const float* in, float* out, const float from, const float to, const size_t count,
+      const fadeCurve curve = fadeCurve::linear )
+    {
+      using T = detail::vecmath<vec8f>;
+      detail::withCurve( curve, from, to, [&]( const auto& gain )
+      {
+        detail::ramped( out, count, [&]( const auto& load, const __m256 t, const size_t i )
+        {
+          return T::mul( gain( t ), load( in + i ) );
+        } );
+      } );
+    }
+
+    //! out += in with its gain ramping from from to to over count samples, the
+    //! ramped counterpart of mixing in a single bus
+    inline void mixRamp( const float* in, float* out, const float from, const float to, const size_t count,
+      const fadeCurve curve = fadeCurve::linear )
+    {
+      using T = detail::vecmath<vec8f>;
+      detail::withCurve( curve, from, to, [&]( const auto& gain )
+      {
+        detail::ramped( out, count, [&]( const auto& load, const __m256 t, const size_t i )
+        {
+          return T::madd( gain( t ), load( in + i ), load( out + i ) );
+        } );
+      } );
+    }
+
+    //! out = a fading out & b fading in over count samples; the same as ramping
+    //! a from 1 to 0 & b from 0 to 1 & adding them. out may be either input.
+    inline void crossfade( const float* a, const float* b, float* out, const size_t count,
+      const fadeCurve curve = fadeCurve::linear )
+    {
+      using T = detail::vecmath<vec8f>;
+      if ( curve == fadeCurve::linear )
+        detail::ramped( out, count, [&]( const auto& load, const __m256 t, const size_t i )
+        {
+          const auto x = load( a + i );
+          return T::madd( T::sub( load( b + i ), x ), t, x );
+        } );
+      else
+      {
+        const auto one = T::set1( 1.0f );
+        detail::ramped( out, count, [&]( const auto& load, const __m256 t, const size_t i )
+        {
+          return T::madd( _mm256_sqrt_ps( T::sub( one, t ) ), load( a + i ), T::mul( _mm256_sqrt_ps( t ), load( b + i ) ) );
+        } );
+      }
+    }
+
+  }
+
+}
+
+#endif
@@ -0,0 +1,365 @@
+#ifndef NM_PARALLEL_H
+#define NM_PARALLEL_H
+
+#include "nm_common.h"
+#include "nm_kernels.h"
+#include "nm_reduce.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A small work-stealing thread pool & chunked parallel versions of the
+// elementwise kernels and reductions.
+//
+// A job is a number of equal chunks. Each worker starts out owning a
+// contiguous run of them, the same run every time for the same chunk & thread
+// count, and takes chunks off its front. A worker that runs out steals the
+// back half of another's remaining run. Work thus stays on the thread that
+// touched it last unless the load is uneven, which is what keeps pages on the
+// NUMA node that first touched them (see kernels::firstTouch).
+//
+// Reductions sum fixed-size chunks into partials and combine those in chunk
+// order on the calling thread, so their results don't depend on the thread
+// count or on who ran which chunk.
+
+namespace nmath {
+
+  class threadpool {
+  private:
+    //! Remaining chunks [lo, hi) of one worker packed as lo | hi << 32,
+    //! so the owner & thieves can both update it with a single compare-exchange
+    struct alignas( 64 ) slot {
+      std::atomic<uint64_t> range { 0 };
+    };
+    struct job {
+      void ( *call )( void* context, size_t chunk, size_t worker );
+      void* context;
+    };
+    std::vector<std::thread> threads_;
+    std::unique_ptr<slot[]> slots_;
+    size_t size_;
+    std::mutex runLock_;
+    std::mutex lock_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    job job_ = { nullptr, nullptr };
+    uint64_t generation_ = 0;
+    size_t pending_ = 0;
+    bool quit_ = false;
+    static uint64_t pack( uint64_t lo, uint64_t hi )
+    {
+      return lo | ( hi << 32 );
+    }
+    //! Take the next chunk of our own run
+    bool pop( size_t worker, size_t& chunk )
+    {
+      auto& range = slots_[worker].range;
+      auto r = range.load( std::memory_order_relaxed );
+      while ( ( r & 0xFFFFFFFFu ) < ( r >> 32 ) )
+        if ( range.compare_exchange_weak( r, r + 1, std::memory_order_acquire, std::memory_order_relaxed ) )
+        {
+          chunk = static_cast<size_t>( r & 0xFFFFFFFFu );
+          return true;
+        }
+      return false;
+    }
+    //! Move the back half of some other worker's run over to ours
+    bool steal( size_t worker )
+    {
+      for ( size_t i = 1; i < size_; ++i )
+      {
+        auto& range = slots_[( worker + i ) % size_].range;
+        auto r = range.load( std::memory_order_relaxed );
+        for ( ;; )
+        {
+          const auto lo = r & 0xFFFFFFFFu;
+          const auto hi = r >> 32;
+          if ( lo >= hi )
+            break;
+          const auto mid = lo + ( hi - lo ) / 2;
+          if ( range.compare_exchange_weak( r, pack( lo, mid ), std::memory_order_acquire, std::memory_order_relaxed ) )
+          {
+            slots_[worker].range.store( pack( mid, hi ), std::memory_order_release );
+            return true;
+          }
+        }
+      }
+      return false;
+    }
+    void work( size_t worker )
+    {
+      size_t chunk;
+      do
+      {
+        while ( pop( worker, chunk ) )
+          job_.call( job_.context, chunk, worker );
+      } while ( steal( worker ) );
+    }
+    void loop( size_t worker )
+    {
+      uint64_t seen = 0;
+      for ( ;; )
+      {
+        {
+          std::unique_lock<std::mutex> guard( lock_ );
+          wake_.wait( guard, [&] { return quit_ || generation_ != seen; } );
+          if ( quit_ )
+            return;
+          seen = generation_;
+        }
+        work( worker );
+        std::lock_guard<std::mutex> guard( lock_ );
+        if ( --pending_ == 0 )
+          done_.notify_one();
+      }
+    }
+  public:
+    //! Pool of the given number of workers, the thread calling run included,
+    //! so threads - 1 threads are actually started. Defaults to one per hardware thread.
+    explicit threadpool( size_t threads = std::thread::hardware_concurrency() ):
+      size_( threads ? threads : 1 )
+    {
+      slots_.reset( new slot[size_] );
+      threads_.reserve( size_ - 1 );
+      for ( size_t i = 1; i < size_; ++i )
+        threads_.emplace_back( [this, i] { loop( i ); } );
+    }
+    ~threadpool()
+    {
+      {
+        std::lock_guard<std::mutex> guard( lock_ );
+        quit_ = true;
+      }
+      wake_.notify_all();
+      for ( auto& thread : threads_ )
+        thread.join();
+    }
+    threadpool( const threadpool& ) = delete;
+    threadpool& operator = ( const threadpool& ) = delete;
+    //! Number of workers, the calling thread included
+    size_t size() const
+    {
+      return size_;
+    }
+    //! Calls fn( chunk, worker ) for every chunk in [0, chunks) & returns once all are done.
+    //! worker is in [0, size()), 0 being the calling thread. fn must not throw.
+    //! Jobs from several threads are run one after another. chunks must fit in 32 bits.
+    template <typename Fn>
+    void run( const size_t chunks, Fn&& fn )
+    {
+      if ( chunks == 0 )
+        return;
+      if ( chunks == 1 || size_ == 1 )
+      {
+        for ( size_t c = 0; c < chunks; ++c )
+          fn( c, size_t( 0 ) );
+        return;
+      }
+      std::lock_guard<std::mutex> serial( runLock_ );
+      using F = typename std::remove_reference<Fn>::type;
+      job_ = { []( void* context, size_t chunk, size_t worker )
+      {
+        ( *static_cast<F*>( context ) )( chunk, worker );
+      }, const_cast<void*>( static_cast<const void*>( &fn ) ) };
+      for ( size_t w = 0; w < size_; ++w )
+        slots_[w].range.store( pack( chunks * w / size_, chunks * ( w + 1 ) / size_ ), std::memory_order_relaxed );
+      {
+        std::lock_guard<std::mutex> guard( lock_ );
+        pending_ = size_ - 1;
+        ++generation_;
+      }
+      wake_.notify_all();
+      work( 0 );
+      std::unique_lock<std::mutex> guard( lock_ );
+      done_.wait( guard, [&] { return pending_ == 0; } );
+    }
+  };
+
+  //! Calls fn( first, last ) over [0, n) in ranges of grain elements (the last one
+  //! possibly shorter) spread over the pool's workers. A grain of 0 is taken as 1.
+  template <typename Fn>
+  inline void parallel_for( threadpool& pool, const size_t n, size_t grain, Fn&& fn )
+  {
+    grain = std::max( grain, size_t( 1 ) );
+    pool.run( ( n + grain - 1 ) / grain, [&]( size_t chunk, size_t )
+    {
+      const size_t first = chunk * grain;
+      fn( first, ( n - first < grain ? n : first + grain ) );
+    } );
+  }
+
+  inline namespace NMATH_ISA_NAMESPACE {
+
+    namespace kernels {
+
+      //! Bytes of output per chunk for the parallel kernels. Small enough that a
+      //! chunk's sources & destination sit in L2 together, and a multiple of the
+      //! page size so that chunks of page aligned buffers don't share pages.
+      constexpr size_t parallelChunk = 128u << 10;
+
+      namespace detail {
+
+        template <typename S>
+        constexpr size_t chunkElements = parallelChunk / sizeof( S );
+
+        //! Runs fn( first, count, stores ) over the chunks of [0, n). The store
+        //! policy is decided on the whole size, since every chunk on its own is
+        //! below nontemporalThreshold.
+        template <typename S, typename Fn>
+        inline void chunked( threadpool& pool, const size_t n, const stores mode, Fn&& fn )
+        {
+          const stores chunkMode = ( mode != stores::automatic ? mode : ( n * sizeof( S ) >= nontemporalThreshold ? stores::nontemporal : stores::temporal ) );
+          parallel_for( pool, n, chunkElements<S>, [&]( size_t first, size_t last )
+          {
+            fn( first, last - first, chunkMode );
+          } );
+        }
+
+        //! Reduces every chunk with fn( first, count ) & combines the partials in chunk order
+        template <typename S, accumulate Mode, typename Fn>
+        inline auto chunkedReduce( threadpool& pool, const size_t n, Fn&& fn )
+        {
+          using R = decltype( fn( size_t( 0 ), size_t( 0 ) ) );
+          constexpr size_t grain = chunkElements<S>;
+          std::vector<R> partials( ( n + grain - 1 ) / grain );
+          parallel_for( pool, n, grain, [&]( size_t first, size_t last )
+          {
+            partials[first / grain] = fn( first, last - first );
+          } );
+          R s = 0, c = 0;
+          for ( const auto x : partials )
+          {
+            if constexpr ( Mode == accumulate::compensated )
+            {
+              const R t = s + x;
+              c += ( std::fabs( s ) >= std::fabs( x ) ? ( s - t ) + x : ( x - t ) + s );
+              s = t;
+            }
+            else
+              s += x;
+          }
+          return s + c;
+        }
+
+      }
+
+      //! Zero dst[0..n) from the workers that the parallel kernels will hand
+      //! the same chunks to. On a NUMA system, calling this on freshly allocated
+      //! memory places each page on the node of the thread that will use it.
+      template <typename S>
+      inline void firstTouch( threadpool& pool, S* dst, const size_t n )
+      {
+        parallel_for( pool, n, detail::chunkElements<S>, [=]( size_t first, size_t last )
+        {
+          std::fill( dst + first, dst + last, S( 0 ) );
+        } );
+      }
+
+      //! dst = a + b, in parallel
+      template <typename S>
+      inline void add( threadpool& pool, S* dst, const S* a, const S* b, const size_t n, const stores mode = stores::automatic )
+      {
+        detail::chunked<S>( pool, n, mode, [=]( size_t first, size_t count, stores chunkMode )
+        {
+          add( dst + first, a + first, b + first, count, chunkMode );
+        } );
+      }
+
+      //! dst = a - b, in parallel
+      template <typename S>
+      inline void sub( threadpool& pool, S* dst, const S* a, const S* b, const size_t n, const stores mode = stores::automatic )
+      {
+        detail::chunked<S>( pool, n, mode, [=]( size_t first, size_t count, stores chunkMode )
+        {
+          sub( dst + first, a + first, b + first, count, chunkMode );
+        } );
+      }
+
+      //! dst = a * b, in parallel
+      template <typename S>
+      inline void mul( threadpool& pool, S* dst, const S* a, const S* b, const size_t n, const stores mode = stores::automatic )
+      {
+        detail::chunked<S>( pool, n, mode, [=]( size_t first, size_t count, stores chunkMode )
+        {
+          mul( dst + first, a + first, b + first, count, chunkMode );
+        } );
+      }
+
+      //! dst = src * s, in parallel
+      template <typename S>
+      inline void scale( threadpool& pool, S* dst, const S* src, const detail::scalar<S> s, const size_t n, const stores mode = stores::automatic )
+      {
+        detail::chunked<S>( pool, n, mode, [=]( size_t first, size_t count, stores chunkMode )
+        {
+          scale( dst + first, src + first, s, count, chunkMode );
+        } );
+      }
+
+      //! y = alpha * x + y, in parallel
+      template <typename S>
+      inline void axpy( threadpool& pool, S* y, const detail::scalar<S> alpha, const S* x, const size_t n, const stores mode = stores::automatic )
+      {
+        detail::chunked<S>( pool, n, mode, [=]( size_t first, size_t count, stores chunkMode )
+        {
+          axpy( y + first, alpha, x + first, count, chunkMode );
+        } );
+      }
+
+      //! dst = a * b + c, in parallel
+      template <typename S>
+      inline void fma( threadpool& pool, S* dst, const S* a, const S* b, const S* c, const size_t n, const stores mode = stores::automatic )
+      {
+        detail::chunked<S>( pool, n, mode, [=]( size_t first, size_t count, stores chunkMode )
+        {
+          fma( dst + first, a + first, b + first, c + first, count, chunkMode );
+        } );
+      }
+
+      //! dst = min(max(src, lo), hi), in parallel
+      template <typename S>
+      inline void clamp( threadpool& pool, S* dst, const S* src, const detail::scalar<S> lo, const detail::scalar<S> hi, const size_t n, const stores mode = stores::automatic )
+      {
+        detail::chunked<S>( pool, n, mode, [=]( size_t first, size_t count, stores chunkMode )
+        {
+          clamp( dst + first, src + first, lo, hi, count, chunkMode );
+        } );
+      }
+
+      //! Sum of src[0..n), in parallel. Same result for any thread count.
+      template <accumulate Mode = accumulate::fast, typename S>
+      inline auto sum( threadpool& pool, const S* src, const size_t n )
+      {
+        return detail::chunkedReduce<S, Mode>( pool, n, [=]( size_t first, size_t count )
+        {
+          return sum<Mode>( src + first, count );
+        } );
+      }
+
+      //! Dot product of a[0..n) & b[0..n), in parallel. Same result for any thread count.
+      template <accumulate Mode = accumulate::fast, typename S>
+      inline auto dot( threadpool& pool, const S* a, const S* b, const size_t n )
+      {
+        return detail::chunkedReduce<S, Mode>( pool, n, [=]( size_t first, size_t count )
+        {
+          return dot<Mode>( a + first, b + first, count );
+        } );
+      }
+
+      //! Euclidean norm of src[0..n), in parallel. Same result for any thread count.
+      template <accumulate Mode = accumulate::fast, typename S>
+      inline auto l2norm( threadpool& pool, const S* src, const size_t n )
+      {
+        return std::sqrt( dot<Mode>( pool, src, src, n ) );
+      }
+
+    }
+
+  }
+
+}
+
+#endif
@@ -0,0 +1,306 @@
+#ifndef NM_PCM_H
+#define NM_PCM_H
+
+#include "nm_common.h"
+#include "nm_vec8f.h"
+#include "nm_vec8i.h"
+#include "nm_memory.h"
+#include <cstring>
+
+// Conversion between integer PCM samples & float, eight samples at a time.
+//
+// Floats are full scale at [-1, 1): int16 sample s is s / 32768, int24 is
+// s / 8388608 & int32 is s / 2^31. Integers convert to float exactly, except
+// int32, which rounds to float's 24 bits. Floats convert to integers rounding
+// to nearest & saturating at the ends of the range. Going down to 16 or 24
+// bits can add TPDF dither first, triangular noise of +-1 LSB that turns the
+// rounding error into a steady noise floor instead of distortion.
+//
+// int24 samples are packed, three little endian bytes each. Samples may be
+// interleaved frames or a single channel; the conversion doesn't care.
+
+namespace nmath {
+
+  inline namespace NMATH_ISA_NAMESPACE {
+
+    //! Triangular dither of +-1 LSB from sixteen xorshift32 generators, two per lane
+    class tpdfDither {
+    private:
+      //! The two uniform variables come from separate generators, so that their
+      //! dependency chains run side by side
+      vec8i state_[2];
+      //! Step generator g & make a float uniform in [1, 2) from its top 23 bits
+      nmath_inline __m256 uniform( const int g )
+      {
+        auto x = state_[g];
+        x = x ^ ( x << 13 );
+        x = x ^ x.shiftRightLogical( 17 );
+        x = x ^ ( x << 5 );
+        state_[g] = x;
+        return ( x.shiftRightLogical( 9 ) | vec8i( 0x3F800000 ) ).asFloat().packed;
+      }
+    public:
+      //! Generators are seeded with different odd values derived from seed
+      explicit tpdfDither( const uint32_t seed = 1 )
+      {
+        reset( seed );
+      }
+      void reset( const uint32_t seed )
+      {
+        int32_t lanes[16];
+        uint32_t s = seed;
+        for ( auto& lane : lanes )
+        {
+          // splitmix32 style scrambling, so nearby seeds give unrelated streams
+          s += 0x9E3779B9u;
+          uint32_t z = s;
+          z = ( z ^ ( z >> 16 ) ) * 0x85EBCA6Bu;
+          z = ( z ^ ( z >> 13 ) ) * 0xC2B2AE35u;
+          z ^= z >> 16;
+          lane = static_cast<int32_t>( z | 1u );
+        }
+        state_[0].loadUnaligned( lanes );
+        state_[1].loadUnaligned( lanes + 8 );
+      }
+      //! Eight values in (-1, 1) with a triangular distribution, the difference of
+      //! two uniform variables
+      nmath_inline vec8f next()
+      {
+        return vec8f( _mm256_sub_ps( uniform( 0 ), uniform( 1 ) ) );
+      }
+    };
+
+    namespace detail {
+
+      //! Scale to the integer range, clamp to [lo, hi] & round
+      nmath_inline __m256i pcmQuantize( const __m256 x, const float scale, const float lo, const float hi )
+      {
+        const auto scaled = _mm256_mul_ps( x, _mm256_set1_ps( scale ) );
+        // max first so that NaN ends up at lo
+        return _mm256_cvtps_epi32( _mm256_min_ps( _mm256_max_ps( scaled, _mm256_set1_ps( lo ) ), _mm256_set1_ps( hi ) ) );
+      }
+
+      //! pcmQuantize with dither added after scaling
+      nmath_inline __m256i pcmQuantize( const __m256 x, const float scale, const float lo, const float hi, tpdfDither& dither )
+      {
+        const auto scaled = _mm256_add_ps( _mm256_mul_ps( x, _mm256_set1_ps( scale ) ), dither.next().packed );
+        return _mm256_cvtps_epi32( _mm256_min_ps( _mm256_max_ps( scaled, _mm256_set1_ps( lo ) ), _mm256_set1_ps( hi ) ) );
+      }
+
+      //! Eight int32 saturated to int16
+      nmath_inline __m128i pcmPack16( const __m256i v )
+      {
+        return _mm_packs_epi32( _mm256_castsi256_si128( v ), _mm256_extractf128_si256( v, 1 ) );
+      }
+
+      //! The low three bytes of each of four int32 in the first 12 bytes
+      nmath_inline __m128i pcmPack24( const __m128i v )
+      {
+        return _mm_shuffle_epi8( v, _mm_setr_epi8( 0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1 ) );
+      }
+
+      //! Four packed int24 from the first 12 bytes, as int32 shifted up 8 bits
+      nmath_inline __m128i pcmUnpack24( const __m128i v )
+      {
+        return _mm_shuffle_epi8( v, _mm_setr_epi8( -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11 ) );
+      }
+
+      nmath_inline int32_t pcmRead24( const uint8_t* p )
+      {
+        // into the top three bytes so that the shift back down extends the sign
+        const uint32_t u = ( static_cast<uint32_t>( p[0] ) << 8 ) | ( static_cast<uint32_t>( p[1] ) << 16 ) | ( static_cast<uint32_t>( p[2] ) << 24 );
+        return static_cast<int32_t>( u ) >> 8;
+      }
+
+      //! Convert count floats with quantize( __m256 ) -> __m256i & write each group
+      //! of eight with store( int32 vector, first, n ), n < 8 only for the last
+      template <class Quantize, class Store>
+      nmath_inline void pcmFromFloat( const float* in, const size_t count, const Quantize& quantize, const Store& store )
+      {
+        size_t i = 0;
+        for ( ; i + 8 <= count; i += 8 )
+          store( quantize( _mm256_loadu_ps( in + i ) ), i, size_t( 8 ) );
+        if ( i < count )
+        {
+          vec8f tail;
+          tail.loadPartial( in + i, count - i );
+          store( quantize( tail.packed ), i, count - i );
+        }
+      }
+
+    }
+
+    //! count int16 samples to float
+    nmath_inline void int16ToFloat( const int16_t* in, float* out, const size_t count )
+    {
+      const auto scale = _mm256_set1_ps( 1.0f / 32768.0f );
+      size_t i = 0;
+      for ( ; i + 8 <= count; i += 8 )
+      {
+        const auto s = _mm_loadu_si128( reinterpret_cast<const __m128i*>( in + i ) );
+#ifdef NMATH_HAS_AVX2
+        const auto v = _mm256_cvtepi16_epi32( s );
+#else
+        const auto lo = _mm_cvtepi16_epi32( s );
+        const auto hi = _mm_cvtepi16_epi32( _mm_srli_si128( s, 8 ) );
+        const auto v = _mm256_insertf128_si256( _mm256_castsi128_si256( lo ), hi, 1 );
+#endif
+        _mm256_storeu_ps( out + i, _mm256_mul_ps( _mm256_cvtepi32_ps( v ), scale ) );
+      }
+      for ( ; i < count; ++i )
+        out[i] = static_cast<float>( in[i] ) * ( 1.0f / 32768.0f );
+    }
+
+    //! count packed int24 samples, 3 * count bytes, to float
+    nmath_inline void int24ToFloat( const uint8_t* in, float* out, const size_t count )
+    {
+      // the samples come out shifted up 8 bits, which the scale undoes
+      const auto scale = _mm256_set1_ps( 1.0f / 2147483648.0f );
+      size_t i = 0;
+      // eight samples are 24 bytes, read as 16 at 0 & 16 at 12, four bytes past the group
+      for ( ; i + 10 <= count; i += 8 )
+      {
+        const uint8_t* p = in + 3 * i;
+        const auto lo = detail::pcmUnpack24( _mm_loadu_si128( reinterpret_cast<const __m128i*>( p ) ) );
+        const auto hi = detail::pcmUnpack24( _mm_loadu_si128( reinterpret_cast<const __m128i*>( p + 12 ) ) );
+        const auto v = _mm256_insertf128_si256( _mm256_castsi128_si256( lo ), hi, 1 );
+        _mm256_storeu_ps( out + i, _mm256_mul_ps( _mm256_cvtepi32_ps( v ), scale ) );
+      }
+      for ( ; i < count; ++i )
+        out[i] = static_cast<float>( detail::pcmRead24( in + 3 * i ) ) * ( 1.0f / 8388608.0f );
+    }
+
+    //! count int32 samples to float, rounding to 24 bits
+    nmath_inline void int32ToFloat( const int32_t* in, float* out, const size_t count )
+    {
+      const auto scale = _mm256_set1_ps( 1.0f / 2147483648.0f );
+      size_t i = 0;
+      for ( ; i + 8 <= count; i += 8 )
+      {
+        const auto v = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( in + i ) );
+        _mm256_storeu_ps( out + i, _mm256_mul_ps( _mm256_cvtepi32_ps( v ), scale ) );
+      }
+      for ( ; i < count; ++i )
+        out[i] = static_cast<float>( in[i] ) * ( 1.0f / 2147483648.0f );
+    }
+
+    //! int16ToFloat into an aligned buffer, resized to count
+    inline void int16ToFloat( const int16_t* in, const size_t count, buffer<float>& out )
+    {
+      out.resize( count );
+      int16ToFloat( in, out.data(), count );
+    }
+
+    //! int24ToFloat into an aligned buffer, resized to count
+    inline void int24ToFloat( const uint8_t* in, const size_t count, buffer<float>& out )
+    {
+      out.resize( count );
+      int24ToFloat( in, out.data(), count );
+    }
+
+    //! int32ToFloat into an aligned buffer, resized to count
+    inline void int32ToFloat( const int32_t* in, const size_t count, buffer<float>& out )
+    {
+      out.resize( count );
+      int32ToFloat( in, out.data(), count );
+    }
+
+    namespace detail {
+
+      template <class Quantize>
+      nmath_inline void floatToInt16( const float* in, int16_t* out, const size_t count, const Quantize& quantize )
+      {
+        pcmFromFloat( in, count, quantize, [out]( const __m256i v, const size_t first, const size_t n )
+        {
+          const auto packed = pcmPack16( v );
+          if ( n == 8 )
+            _mm_storeu_si128( reinterpret_cast<__m128i*>( out + first ), packed );
+          else
+          {
+            int16_t lanes[8];
+            _mm_storeu_si128( reinterpret_cast<__m128i*>( lanes ), packed );
+            memcpy( out + first, lanes, n * sizeof( int16_t ) );
+          }
+        } );
+      }
+
+      template <class Quantize>
+      nmath_inline void floatToInt24( const float* in, uint8_t* out, const size_t count, const Quantize& quantize )
+      {
+        pcmFromFloat( in, count, quantize, [out, count]( const __m256i v, const size_t first, const size_t n )
+        {
+          const auto lo = pcmPack24( _mm256_castsi256_si128( v ) );
+          const auto hi = pcmPack24( _mm256_extractf128_si256( v, 1 ) );
+          uint8_t* p = out + 3 * first;
+          // 16 bytes at 0 & at 12 spill four bytes into the next group, so a group
+          // without two samples after it goes through a copy
+          if ( first + 10 <= count )
+          {
+            _mm_storeu_si128( reinterpret_cast<__m128i*>( p ), lo );
+            _mm_storeu_si128( reinterpret_cast<__m128i*>( p + 12 ), hi );
+          }
+          else
+          {
+            uint8_t bytes[32];
+            _mm_storeu_si128( reinterpret_cast<__m128i*>( bytes ), lo );
+            _mm_storeu_si128( reinterpret_cast<__m128i*>( bytes + 12 ), hi );
+            memcpy( p, bytes, 3 * n );
+          }
+        } );
+      }
+
+    }
+
+    //! count floats to int16, rounding to nearest & saturating
+    nmath_inline void floatToInt16( const float* in, int16_t* out, const size_t count )
+    {
+      detail::floatToInt16( in, out, count, []( const __m256 x ) { return detail::pcmQuantize( x, 32768.0f, -32768.0f, 32767.0f ); } );
+    }
+
+    //! floatToInt16 with TPDF dither
+    nmath_inline void floatToInt16( const float* in, int16_t* out, const size_t count, tpdfDither& dither )
+    {
+      // a local copy keeps the generators in registers, where stores to out could alias them
+      tpdfDither local = dither;
+      detail::floatToInt16( in, out, count, [&local]( const __m256 x ) { return detail::pcmQuantize( x, 32768.0f, -32768.0f, 32767.0f, local ); } );
+      dither = local;
+    }
+
+    //! count floats to packed int24, 3 * count bytes, rounding to nearest & saturating
+    nmath_inline void floatToInt24( const float* in, uint8_t* out, const size_t count )
+    {
+      detail::floatToInt24( in, out, count, []( const __m256 x ) { return detail::pcmQuantize( x, 8388608.0f, -8388608.0f, 8388607.0f ); } );
+    }
+
+    //! floatToInt24 with TPDF dither
+    nmath_inline void floatToInt24( const float* in, uint8_t* out, const size_t count, tpdfDither& dither )
+    {
+      // a local copy keeps the generators in registers, where stores to out could alias them
+      tpdfDither local = dither;
+      detail::floatToInt24( in, out, count, [&local]( const __m256 x ) { return detail::pcmQuantize( x, 8388608.0f, -8388608.0f, 8388607.0f, local ); } );
+      dither = local;
+    }
+
+    //! count floats to int32, saturating. Float's 24 bits leave nothing to dither.
+    nmath_inline void floatToInt32( const float* in, int32_t* out, const size_t count )
+    {
+      // 2147483520 is the largest float below 2^31
+      detail::pcmFromFloat( in, count, []( const __m256 x ) { return detail::pcmQuantize( x, 2147483648.0f, -2147483648.0f, 2147483520.0f ); },
+        [out]( const __m256i v, const size_t first, const size_t n )
+      {
+        if ( n == 8 )
+          _mm256_storeu_si256( reinterpret_cast<__m256i*>( out + first ), v );
+        else
+        {
+          int32_t lanes[8];
+          _mm256_storeu_si256( reinterpret_cast<__m256i*>( lanes ), v );
+          memcpy( out + first, lanes, n * sizeof( int32_t ) );
+        }
+      } );
+    }
+
+  }
+
+}
+
+#endif
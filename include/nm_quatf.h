@@ -0,0 +1,306 @@
+#ifndef NM_QUATF_H
+#define NM_QUATF_H
+
+#include "nm_common.h"
+#include "nm_vec4f.h"
+#include "nm_vec8f.h"
+#include "nm_vecmath.h"
+#include "nm_mat4f.h"
+#include "nm_soa.h"
+#include <algorithm>
+#include <cmath>
+
+// Rotation quaternions: quatf for one at a time in a vec4f, quat8f for eight
+// at a time as one vec8f per component.
+//
+// Components are stored (x, y, z, w) with the real part last. Products follow
+// Hamilton's convention, so a * b rotates by b first and then by a, while
+// mat4f chains the other way around: toMatrix( a * b ) equals
+// toMatrix( b ) * toMatrix( a ).
+
+namespace nmath {
+
+  inline namespace NMATH_ISA_NAMESPACE {
+
+    class nmath_16b_align quatf {
+    public:
+      vec4f v;
+      //! All zero, which is no rotation; see identity
+      nmath_inline quatf()
+      {
+      }
+      nmath_inline quatf( float x, float y, float z, float w )
+      {
+        v.packed = _mm_setr_ps( x, y, z, w );
+      }
+      nmath_inline explicit quatf( const vec4f& xyzw )
+      {
+        v.packed = xyzw.packed;
+      }
+      nmath_inline static quatf identity()
+      {
+        return quatf( 0.0f, 0.0f, 0.0f, 1.0f );
+      }
+      //! Rotation by angle radians around the unit length axis (x, y, z)
+      nmath_inline static quatf axisAngle( float x, float y, float z, float angle )
+      {
+        const float s = std::sin( angle * 0.5f );
+        return quatf( x * s, y * s, z * s, std::cos( angle * 0.5f ) );
+      }
+      //! Rotation of the upper 3x3 part of m, which must be orthonormal
+      nmath_inline static quatf fromMatrix( const mat4f& m )
+      {
+        // Shepperd: divide by the largest of the four possible denominators
+        const float trace = m( 0, 0 ) + m( 1, 1 ) + m( 2, 2 );
+        if ( trace > 0.0f )
+        {
+          const float s = std::sqrt( trace + 1.0f ) * 2.0f;
+          return quatf( ( m( 1, 2 ) - m( 2, 1 ) ) / s, ( m( 2, 0 ) - m( 0, 2 ) ) / s, ( m( 0, 1 ) - m( 1, 0 ) ) / s, 0.25f * s );
+        }
+        if ( m( 0, 0 ) > m( 1, 1 ) && m( 0, 0 ) > m( 2, 2 ) )
+        {
+          const float s = std::sqrt( 1.0f + m( 0, 0 ) - m( 1, 1 ) - m( 2, 2 ) ) * 2.0f;
+          return quatf( 0.25f * s, ( m( 0, 1 ) + m( 1, 0 ) ) / s, ( m( 0, 2 ) + m( 2, 0 ) ) / s, ( m( 1, 2 ) - m( 2, 1 ) ) / s );
+        }
+        if ( m( 1, 1 ) > m( 2, 2 ) )
+        {
+          const float s = std::sqrt( 1.0f + m( 1, 1 ) - m( 0, 0 ) - m( 2, 2 ) ) * 2.0f;
+          return quatf( ( m( 0, 1 ) + m( 1, 0 ) ) / s, 0.25f * s, ( m( 1, 2 ) + m( 2, 1 ) ) / s, ( m( 2, 0 ) - m( 0, 2 ) ) / s );
+        }
+        const float s = std::sqrt( 1.0f + m( 2, 2 ) - m( 0, 0 ) - m( 1, 1 ) ) * 2.0f;
+        return quatf( ( m( 0, 2 ) + m( 2, 0 ) ) / s, ( m( 1, 2 ) + m( 2, 1 ) ) / s, 0.25f * s, ( m( 0, 1 ) - m( 1, 0 ) ) / s );
+      }
+      //! Rotation matrix for row vectors, v * toMatrix() == rotate( v )
+      nmath_inline mat4f toMatrix() const
+      {
+        const float x = v.x, y = v.y, z = v.z, w = v.w;
+        const float xx = 2.0f * x * x, yy = 2.0f * y * y, zz = 2.0f * z * z;
+        const float xy = 2.0f * x * y, xz = 2.0f * x * z, yz = 2.0f * y * z;
+        const float wx = 2.0f * w * x, wy = 2.0f * w * y, wz = 2.0f * w * z;
+        return mat4f(
+          vec4f( 1.0f - yy - zz, xy + wz, xz - wy, 0.0f ),
+          vec4f( xy - wz, 1.0f - xx - zz, yz + wx, 0.0f ),
+          vec4f( xz + wy, yz - wx, 1.0f - xx - yy, 0.0f ),
+          vec4f( 0.0f, 0.0f, 0.0f, 1.0f ) );
+      }
+      //! q = a * b, the rotation by b followed by a
+      nmath_inline quatf operator * ( const quatf& rhs ) const
+      {
+        const auto a = v.packed, b = rhs.v.packed;
+        // w * b plus the x, y & z terms as sign flipped permutations of b
+        auto r = _mm_mul_ps( detail::splat<3>( a ), b );
+        const auto bx = _mm_xor_ps( _mm_shuffle_ps( b, b, _MM_SHUFFLE( 0, 1, 2, 3 ) ), _mm_setr_ps( 0.0f, -0.0f, 0.0f, -0.0f ) );
+        const auto by = _mm_xor_ps( _mm_shuffle_ps( b, b, _MM_SHUFFLE( 1, 0, 3, 2 ) ), _mm_setr_ps( 0.0f, 0.0f, -0.0f, -0.0f ) );
+        const auto bz = _mm_xor_ps( _mm_shuffle_ps( b, b, _MM_SHUFFLE( 2, 3, 0, 1 ) ), _mm_setr_ps( -0.0f, 0.0f, 0.0f, -0.0f ) );
+        r = detail::madd( detail::splat<0>( a ), bx, r );
+        r = detail::madd( detail::splat<1>( a ), by, r );
+        r = detail::madd( detail::splat<2>( a ), bz, r );
+        return quatf( vec4f( r ) );
+      }
+      //! q = (-x, -y, -z, w), the inverse of a unit quaternion
+      nmath_inline quatf conjugate() const
+      {
+        return quatf( vec4f( _mm_xor_ps( v.packed, _mm_setr_ps( -0.0f, -0.0f, -0.0f, 0.0f ) ) ) );
+      }
+      //! f = a . b over all four components
+      nmath_inline float dot( const quatf& rhs ) const
+      {
+        return _mm_cvtss_f32( _mm_dp_ps( v.packed, rhs.v.packed, 0xF1 ) );
+      }
+      //! q scaled to unit length
+      nmath_inline quatf normalized() const
+      {
+        return quatf( vec4f( _mm_div_ps( v.packed, _mm_sqrt_ps( _mm_dp_ps( v.packed, v.packed, 0xFF ) ) ) ) );
+      }
+      //! The xyz part of p rotated by this unit quaternion, w passed through
+      nmath_inline vec4f rotate( const vec4f& p ) const
+      {
+        // p + w * t + u x t with t = 2 * ( u x p ), u the vector part
+        // cross3 zeroes w, so p's w comes through untouched
+        const auto u = v.packed;
+        auto t = detail::cross3( u, p.packed );
+        t = _mm_add_ps( t, t );
+        return detail::madd( detail::splat<3>( u ), t, _mm_add_ps( p.packed, detail::cross3( u, t ) ) );
+      }
+      //! a == b
+      nmath_inline bool operator == ( const quatf& rhs ) const
+      {
+        return ( v == rhs.v );
+      }
+      //! a != b
+      nmath_inline bool operator != ( const quatf& rhs ) const
+      {
+        return ( v != rhs.v );
+      }
+    };
+
+    //! Normalized linear interpolation from a at t = 0 to b at t = 1 along the shorter arc.
+    //! Cheaper than slerp, but the angular speed is not constant over t.
+    nmath_inline quatf nlerp( const quatf& a, const quatf& b, float t )
+    {
+      const float tb = ( a.dot( b ) < 0.0f ? -t : t );
+      return quatf( vec4f( detail::madd( _mm_set1_ps( tb ), b.v.packed, _mm_mul_ps( _mm_set1_ps( 1.0f - t ), a.v.packed ) ) ) ).normalized();
+    }
+
+    //! Spherical linear interpolation from a at t = 0 to b at t = 1 along the shorter arc
+    nmath_inline quatf slerp( const quatf& a, const quatf& b, float t )
+    {
+      float d = a.dot( b );
+      const float sign = ( d < 0.0f ? -1.0f : 1.0f );
+      d = std::fabs( d );
+      float wa = 1.0f - t, wb = t;
+      // nearly equal rotations would divide by ~0 below, and lerp is exact enough there
+      if ( d < 0.9995f )
+      {
+        const float theta = std::acos( d );
+        const float rs = 1.0f / std::sin( theta );
+        wa = std::sin( wa * theta ) * rs;
+        wb = std::sin( wb * theta ) * rs;
+      }
+      return quatf( vec4f( detail::madd( _mm_set1_ps( wb * sign ), b.v.packed, _mm_mul_ps( _mm_set1_ps( wa ), a.v.packed ) ) ) );
+    }
+
+    //! Eight quaternions as one vec8f per component
+    struct quat8f {
+      vec8f x, y, z, w;
+    };
+
+    namespace detail {
+
+      //! acos(x) for x in [0, 1], Abramowitz & Stegun 4.4.46.
+      //! Max absolute error 2e-8 in exact arithmetic, ~1e-7 (a few float ulps of pi/2) in floats.
+      nmath_inline __m256 acosPositive( const __m256 x )
+      {
+        auto p = _mm256_set1_ps( -0.0012624911f );
+        p = madd( p, x, _mm256_set1_ps( 0.0066700901f ) );
+        p = madd( p, x, _mm256_set1_ps( -0.0170881256f ) );
+        p = madd( p, x, _mm256_set1_ps( 0.0308918810f ) );
+        p = madd( p, x, _mm256_set1_ps( -0.0501743046f ) );
+        p = madd( p, x, _mm256_set1_ps( 0.0889789874f ) );
+        p = madd( p, x, _mm256_set1_ps( -0.2145988016f ) );
+        p = madd( p, x, _mm256_set1_ps( 1.5707963050f ) );
+        return _mm256_mul_ps( p, _mm256_sqrt_ps( _mm256_sub_ps( _mm256_set1_ps( 1.0f ), x ) ) );
+      }
+
+      //! d = a . b per lane, and b negated in lanes where that is negative so that
+      //! the interpolation takes the shorter arc
+      nmath_inline __m256 shorterArc( const quat8f& a, quat8f& b )
+      {
+        auto d = _mm256_mul_ps( a.x.packed, b.x.packed );
+        d = madd( a.y.packed, b.y.packed, d );
+        d = madd( a.z.packed, b.z.packed, d );
+        d = madd( a.w.packed, b.w.packed, d );
+        const auto sign = _mm256_and_ps( d, _mm256_set1_ps( -0.0f ) );
+        b.x.packed = _mm256_xor_ps( b.x.packed, sign );
+        b.y.packed = _mm256_xor_ps( b.y.packed, sign );
+        b.z.packed = _mm256_xor_ps( b.z.packed, sign );
+        b.w.packed = _mm256_xor_ps( b.w.packed, sign );
+        return _mm256_xor_ps( d, sign );
+      }
+
+      //! wa * a + wb * b per component
+      nmath_inline quat8f blend( const quat8f& a, const quat8f& b, const __m256 wa, const __m256 wb )
+      {
+        quat8f r;
+        r.x.packed = madd( wb, b.x.packed, _mm256_mul_ps( wa, a.x.packed ) );
+        r.y.packed = madd( wb, b.y.packed, _mm256_mul_ps( wa, a.y.packed ) );
+        r.z.packed = madd( wb, b.z.packed, _mm256_mul_ps( wa, a.z.packed ) );
+        r.w.packed = madd( wb, b.w.packed, _mm256_mul_ps( wa, a.w.packed ) );
+        return r;
+      }
+
+      //! Eight quaternions from component streams at i
+      nmath_inline quat8f loadQuat8( const soa4f& s, const size_t i )
+      {
+        quat8f q;
+        q.x.load( s.x.data() + i );
+        q.y.load( s.y.data() + i );
+        q.z.load( s.z.data() + i );
+        q.w.load( s.w.data() + i );
+        return q;
+      }
+
+      //! Eight quaternions into component streams at i, only the first count of them
+      //! when that is less than eight so the zero padding stays intact
+      nmath_inline void storeQuat8( quat8f q, soa4f& s, const size_t i, const size_t count )
+      {
+        if ( count >= 8 )
+        {
+          q.x.storeTemporal( s.x.data() + i );
+          q.y.storeTemporal( s.y.data() + i );
+          q.z.storeTemporal( s.z.data() + i );
+          q.w.storeTemporal( s.w.data() + i );
+        }
+        else
+        {
+          q.x.storePartial( s.x.data() + i, count );
+          q.y.storePartial( s.y.data() + i, count );
+          q.z.storePartial( s.z.data() + i, count );
+          q.w.storePartial( s.w.data() + i, count );
+        }
+      }
+
+    }
+
+    //! nlerp of eight quaternion pairs at once, see nlerp of quatf
+    nmath_inline quat8f nlerp( const quat8f& a, quat8f b, const vec8f& t )
+    {
+      detail::shorterArc( a, b );
+      auto r = detail::blend( a, b, _mm256_sub_ps( _mm256_set1_ps( 1.0f ), t.packed ), t.packed );
+      auto len2 = _mm256_mul_ps( r.x.packed, r.x.packed );
+      len2 = detail::madd( r.y.packed, r.y.packed, len2 );
+      len2 = detail::madd( r.z.packed, r.z.packed, len2 );
+      len2 = detail::madd( r.w.packed, r.w.packed, len2 );
+      // one Newton-Raphson step puts the length within ~3e-7 of 1
+      const auto rlen = vec8f( len2 ).rsqrt<1>().packed;
+      r.x.packed = _mm256_mul_ps( r.x.packed, rlen );
+      r.y.packed = _mm256_mul_ps( r.y.packed, rlen );
+      r.z.packed = _mm256_mul_ps( r.z.packed, rlen );
+      r.w.packed = _mm256_mul_ps( r.w.packed, rlen );
+      return r;
+    }
+
+    //! slerp of eight quaternion pairs at once, see slerp of quatf.
+    //! The angle comes from a polynomial acos & the vecmath sin, within ~1e-6 of
+    //! the scalar slerp.
+    nmath_inline quat8f slerp( const quat8f& a, quat8f b, const vec8f& t )
+    {
+      const auto one = _mm256_set1_ps( 1.0f );
+      const auto d = _mm256_min_ps( detail::shorterArc( a, b ), one );
+      const auto theta = detail::acosPositive( d );
+      const auto rs = _mm256_div_ps( one, _mm256_sqrt_ps( _mm256_sub_ps( one, _mm256_mul_ps( d, d ) ) ) );
+      const auto ta = _mm256_sub_ps( one, t.packed );
+      const auto sa = _mm256_mul_ps( sin( vec8f( _mm256_mul_ps( ta, theta ) ) ).packed, rs );
+      const auto sb = _mm256_mul_ps( sin( vec8f( _mm256_mul_ps( t.packed, theta ) ) ).packed, rs );
+      // nearly equal rotations would divide by ~0, and lerp is exact enough there
+      const auto nearly = _mm256_cmp_ps( d, _mm256_set1_ps( 0.9995f ), _CMP_GE_OQ );
+      return detail::blend( a, b, _mm256_blendv_ps( sa, ta, nearly ), _mm256_blendv_ps( sb, t.packed, nearly ) );
+    }
+
+    //! dst[i] = nlerp( a[i], b[i], t ) for the quaternions a & b both have, eight
+    //! at a time. dst is resized to the smaller of their sizes and may be a or b.
+    nmath_inline void nlerp( soa4f& dst, const soa4f& a, const soa4f& b, const float t )
+    {
+      const size_t count = std::min( a.size(), b.size() );
+      dst.resize( count );
+      const vec8f vt( t );
+      for ( size_t i = 0; i < count; i += 8 )
+        detail::storeQuat8( nlerp( detail::loadQuat8( a, i ), detail::loadQuat8( b, i ), vt ), dst, i, count - i );
+    }
+
+    //! dst[i] = slerp( a[i], b[i], t ) for the quaternions a & b both have, eight
+    //! at a time. dst is resized to the smaller of their sizes and may be a or b.
+    nmath_inline void slerp( soa4f& dst, const soa4f& a, const soa4f& b, const float t )
+    {
+      const size_t count = std::min( a.size(), b.size() );
+      dst.resize( count );
+      const vec8f vt( t );
+      for ( size_t i = 0; i < count; i += 8 )
+        detail::storeQuat8( slerp( detail::loadQuat8( a, i ), detail::loadQuat8( b, i ), vt ), dst, i, count - i );
+    }
+
+  }
+
+}
+
+#endif
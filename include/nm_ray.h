@@ -0,0 +1,273 @@
+#ifndef NM_RAY_H
+#define NM_RAY_H
+
+#include "nm_common.h"
+#include "nm_vec8f.h"
+#include <limits>
+
+// Ray packets & axis aligned boxes eight at a time, and the branchless slab
+// test between them.
+//
+// Both sides are structure-of-arrays, one vec8f per component, so the same
+// test covers eight rays against one box (splat the box) and one ray against
+// eight boxes (splat the ray) - the two shapes of packet & wide BVH traversal.
+
+namespace nmath {
+
+  inline namespace NMATH_ISA_NAMESPACE {
+
+    //! One ray, origin + t * direction for t in [tmin, tmax]
+    struct rayf {
+      float origin[3];
+      float direction[3];
+      float tmin = 0.0f;
+      float tmax = std::numeric_limits<float>::infinity();
+    };
+
+    namespace detail {
+
+      //! 1 / d, with the infinities of zero components clamped to +-FLT_MAX.
+      //! ( box - origin ) * inf would be NaN for a ray in the plane of a face,
+      //! while the finite product is 0 and the closed slab test stays exact.
+      nmath_inline __m256 slabReciprocal( const __m256 d )
+      {
+        const auto big = _mm256_set1_ps( std::numeric_limits<float>::max() );
+        const auto r = _mm256_div_ps( _mm256_set1_ps( 1.0f ), d );
+        return _mm256_min_ps( _mm256_max_ps( r, _mm256_sub_ps( _mm256_setzero_ps(), big ) ), big );
+      }
+
+    }
+
+    //! Eight rays with reciprocal directions, ready for slab tests
+    struct ray8f {
+      vec8f ox, oy, oz; //!< origins
+      vec8f dx, dy, dz; //!< directions
+      vec8f rdx, rdy, rdz; //!< 1 / direction, +-FLT_MAX along axes the ray doesn't move on
+      vec8f tmin, tmax;
+      //! The same ray in all eight lanes, for testing it against eight boxes
+      nmath_inline static ray8f splat( const rayf& ray )
+      {
+        ray8f r;
+        r.ox = vec8f( ray.origin[0] );
+        r.oy = vec8f( ray.origin[1] );
+        r.oz = vec8f( ray.origin[2] );
+        r.dx = vec8f( ray.direction[0] );
+        r.dy = vec8f( ray.direction[1] );
+        r.dz = vec8f( ray.direction[2] );
+        r.rdx.packed = detail::slabReciprocal( r.dx.packed );
+        r.rdy.packed = detail::slabReciprocal( r.dy.packed );
+        r.rdz.packed = detail::slabReciprocal( r.dz.packed );
+        r.tmin = vec8f( ray.tmin );
+        r.tmax = vec8f( ray.tmax );
+        return r;
+      }
+      //! The ray in lane i of rays in all eight lanes
+      nmath_inline static ray8f splat( const ray8f& rays, const int i )
+      {
+        auto lane = [i]( const vec8f& v )
+        {
+          return vec8f( reinterpret_cast<const float*>( &v )[i] );
+        };
+        ray8f r;
+        r.ox = lane( rays.ox );
+        r.oy = lane( rays.oy );
+        r.oz = lane( rays.oz );
+        r.dx = lane( rays.dx );
+        r.dy = lane( rays.dy );
+        r.dz = lane( rays.dz );
+        r.rdx = lane( rays.rdx );
+        r.rdy = lane( rays.rdy );
+        r.rdz = lane( rays.rdz );
+        r.tmin = lane( rays.tmin );
+        r.tmax = lane( rays.tmax );
+        return r;
+      }
+      //! Eight consecutive rays, one per lane
+      nmath_inline static ray8f gather( const rayf* rays )
+      {
+        nmath_32b_align float c[8][8];
+        for ( int i = 0; i < 8; ++i )
+        {
+          c[0][i] = rays[i].origin[0];
+          c[1][i] = rays[i].origin[1];
+          c[2][i] = rays[i].origin[2];
+          c[3][i] = rays[i].direction[0];
+          c[4][i] = rays[i].direction[1];
+          c[5][i] = rays[i].direction[2];
+          c[6][i] = rays[i].tmin;
+          c[7][i] = rays[i].tmax;
+        }
+        ray8f r;
+        r.ox.load( c[0] );
+        r.oy.load( c[1] );
+        r.oz.load( c[2] );
+        r.dx.load( c[3] );
+        r.dy.load( c[4] );
+        r.dz.load( c[5] );
+        r.rdx.packed = detail::slabReciprocal( r.dx.packed );
+        r.rdy.packed = detail::slabReciprocal( r.dy.packed );
+        r.rdz.packed = detail::slabReciprocal( r.dz.packed );
+        r.tmin.load( c[6] );
+        r.tmax.load( c[7] );
+        return r;
+      }
+    };
+
+    //! Eight axis aligned boxes, one per lane
+    struct aabb8f {
+      vec8f minX, minY, minZ;
+      vec8f maxX, maxY, maxZ;
+      //! The same box in all eight lanes, for testing it against eight rays
+      nmath_inline static aabb8f splat( const float* lo, const float* hi )
+      {
+        aabb8f b;
+        b.minX = vec8f( lo[0] );
+        b.minY = vec8f( lo[1] );
+        b.minZ = vec8f( lo[2] );
+        b.maxX = vec8f( hi[0] );
+        b.maxY = vec8f( hi[1] );
+        b.maxZ = vec8f( hi[2] );
+        return b;
+      }
+      //! The box in lane i of boxes in all eight lanes, for testing one child of a
+      //! wide BVH node against a packet of rays
+      nmath_inline static aabb8f splat( const aabb8f& boxes, const int i )
+      {
+        aabb8f b;
+        b.minX = vec8f( reinterpret_cast<const float*>( &boxes.minX )[i] );
+        b.minY = vec8f( reinterpret_cast<const float*>( &boxes.minY )[i] );
+        b.minZ = vec8f( reinterpret_cast<const float*>( &boxes.minZ )[i] );
+        b.maxX = vec8f( reinterpret_cast<const float*>( &boxes.maxX )[i] );
+        b.maxY = vec8f( reinterpret_cast<const float*>( &boxes.maxY )[i] );
+        b.maxZ = vec8f( reinterpret_cast<const float*>( &boxes.maxZ )[i] );
+        return b;
+      }
+      //! Set lane i to the box from lo to hi
+      nmath_inline void set( const int i, const float* lo, const float* hi )
+      {
+        reinterpret_cast<float*>( &minX )[i] = lo[0];
+        reinterpret_cast<float*>( &minY )[i] = lo[1];
+        reinterpret_cast<float*>( &minZ )[i] = lo[2];
+        reinterpret_cast<float*>( &maxX )[i] = hi[0];
+        reinterpret_cast<float*>( &maxY )[i] = hi[1];
+        reinterpret_cast<float*>( &maxZ )[i] = hi[2];
+      }
+      //! Make lane i a box no ray can hit, for unused slots
+      nmath_inline void clear( const int i )
+      {
+        const float lo[3] = { std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity() };
+        const float hi[3] = { -lo[0], -lo[1], -lo[2] };
+        set( i, lo, hi );
+      }
+    };
+
+    //! Eight triangles, one per lane, as a vertex & the two edges leaving it
+    struct tri8f {
+      vec8f v0x, v0y, v0z;
+      vec8f e1x, e1y, e1z; //!< v1 - v0
+      vec8f e2x, e2y, e2z; //!< v2 - v0
+      //! The triangle in lane i of tris in all eight lanes, for testing it against
+      //! a packet of rays
+      nmath_inline static tri8f splat( const tri8f& tris, const int i )
+      {
+        tri8f t;
+        t.v0x = vec8f( reinterpret_cast<const float*>( &tris.v0x )[i] );
+        t.v0y = vec8f( reinterpret_cast<const float*>( &tris.v0y )[i] );
+        t.v0z = vec8f( reinterpret_cast<const float*>( &tris.v0z )[i] );
+        t.e1x = vec8f( reinterpret_cast<const float*>( &tris.e1x )[i] );
+        t.e1y = vec8f( reinterpret_cast<const float*>( &tris.e1y )[i] );
+        t.e1z = vec8f( reinterpret_cast<const float*>( &tris.e1z )[i] );
+        t.e2x = vec8f( reinterpret_cast<const float*>( &tris.e2x )[i] );
+        t.e2y = vec8f( reinterpret_cast<const float*>( &tris.e2y )[i] );
+        t.e2z = vec8f( reinterpret_cast<const float*>( &tris.e2z )[i] );
+        return t;
+      }
+      //! Set lane i to the triangle a, b, c
+      nmath_inline void set( const int i, const float* a, const float* b, const float* c )
+      {
+        reinterpret_cast<float*>( &v0x )[i] = a[0];
+        reinterpret_cast<float*>( &v0y )[i] = a[1];
+        reinterpret_cast<float*>( &v0z )[i] = a[2];
+        reinterpret_cast<float*>( &e1x )[i] = b[0] - a[0];
+        reinterpret_cast<float*>( &e1y )[i] = b[1] - a[1];
+        reinterpret_cast<float*>( &e1z )[i] = b[2] - a[2];
+        reinterpret_cast<float*>( &e2x )[i] = c[0] - a[0];
+        reinterpret_cast<float*>( &e2y )[i] = c[1] - a[1];
+        reinterpret_cast<float*>( &e2z )[i] = c[2] - a[2];
+      }
+      //! Make lane i a degenerate triangle no ray can hit, for unused slots
+      nmath_inline void clear( const int i )
+      {
+        const float zero[3] = { 0.0f, 0.0f, 0.0f };
+        set( i, zero, zero, zero );
+      }
+    };
+
+    //! Slab test of each lane's ray against the same lane's box. Returns the mask of
+    //! hits, bit i for lane i, and writes the entry distances to tnear: the larger
+    //! of tmin & where the ray enters the box for hits, +infinity for misses.
+    //! Boxes are closed, so rays that only graze a face or edge hit.
+    nmath_inline int intersect( const ray8f& rays, const aabb8f& boxes, vec8f& tnear )
+    {
+      auto lo = rays.tmin.packed, hi = rays.tmax.packed;
+      auto slab = [&]( const vec8f& o, const vec8f& rd, const vec8f& mn, const vec8f& mx )
+      {
+        // the near face is picked by the direction's sign bit rather than by sorting
+        // the two distances, so that inverted (cleared) boxes can never be entered
+        const auto t0 = _mm256_mul_ps( _mm256_sub_ps( _mm256_blendv_ps( mn.packed, mx.packed, rd.packed ), o.packed ), rd.packed );
+        const auto t1 = _mm256_mul_ps( _mm256_sub_ps( _mm256_blendv_ps( mx.packed, mn.packed, rd.packed ), o.packed ), rd.packed );
+        lo = _mm256_max_ps( t0, lo );
+        hi = _mm256_min_ps( t1, hi );
+      };
+      slab( rays.ox, rays.rdx, boxes.minX, boxes.maxX );
+      slab( rays.oy, rays.rdy, boxes.minY, boxes.maxY );
+      slab( rays.oz, rays.rdz, boxes.minZ, boxes.maxZ );
+      const auto hit = _mm256_cmp_ps( lo, hi, _CMP_LE_OQ );
+      tnear.packed = _mm256_blendv_ps( _mm256_set1_ps( std::numeric_limits<float>::infinity() ), lo, hit );
+      return _mm256_movemask_ps( hit );
+    }
+
+    //! Moller-Trumbore test of each lane's ray against the same lane's triangle,
+    //! both sides hit. Returns the mask of hits within [tmin, tmax], bit i for
+    //! lane i, & writes the distances to t and the barycentrics of v1 & v2 to u & v.
+    //! Those are only meaningful in hit lanes.
+    nmath_inline int intersect( const ray8f& rays, const tri8f& tris, vec8f& t, vec8f& u, vec8f& v )
+    {
+      auto cross = []( const __m256 ax, const __m256 ay, const __m256 az, const __m256 bx, const __m256 by, const __m256 bz,
+        __m256& cx, __m256& cy, __m256& cz )
+      {
+        cx = _mm256_sub_ps( _mm256_mul_ps( ay, bz ), _mm256_mul_ps( az, by ) );
+        cy = _mm256_sub_ps( _mm256_mul_ps( az, bx ), _mm256_mul_ps( ax, bz ) );
+        cz = _mm256_sub_ps( _mm256_mul_ps( ax, by ), _mm256_mul_ps( ay, bx ) );
+      };
+      auto dot = []( const __m256 ax, const __m256 ay, const __m256 az, const __m256 bx, const __m256 by, const __m256 bz )
+      {
+        return _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( ax, bx ), _mm256_mul_ps( ay, by ) ), _mm256_mul_ps( az, bz ) );
+      };
+      __m256 px, py, pz, qx, qy, qz;
+      cross( rays.dx.packed, rays.dy.packed, rays.dz.packed, tris.e2x.packed, tris.e2y.packed, tris.e2z.packed, px, py, pz );
+      const auto det = dot( tris.e1x.packed, tris.e1y.packed, tris.e1z.packed, px, py, pz );
+      const auto rdet = _mm256_div_ps( _mm256_set1_ps( 1.0f ), det );
+      const auto sx = _mm256_sub_ps( rays.ox.packed, tris.v0x.packed );
+      const auto sy = _mm256_sub_ps( rays.oy.packed, tris.v0y.packed );
+      const auto sz = _mm256_sub_ps( rays.oz.packed, tris.v0z.packed );
+      u.packed = _mm256_mul_ps( dot( sx, sy, sz, px, py, pz ), rdet );
+      cross( sx, sy, sz, tris.e1x.packed, tris.e1y.packed, tris.e1z.packed, qx, qy, qz );
+      v.packed = _mm256_mul_ps( dot( rays.dx.packed, rays.dy.packed, rays.dz.packed, qx, qy, qz ), rdet );
+      t.packed = _mm256_mul_ps( dot( tris.e2x.packed, tris.e2y.packed, tris.e2z.packed, qx, qy, qz ), rdet );
+      // degenerate triangles & rays in their plane have det 0 and come out as inf / NaN,
+      // which fail the ordered comparisons below
+      const auto zero = _mm256_setzero_ps();
+      auto hit = _mm256_and_ps( _mm256_cmp_ps( u.packed, zero, _CMP_GE_OQ ), _mm256_cmp_ps( v.packed, zero, _CMP_GE_OQ ) );
+      hit = _mm256_and_ps( hit, _mm256_cmp_ps( _mm256_add_ps( u.packed, v.packed ), _mm256_set1_ps( 1.0f ), _CMP_LE_OQ ) );
+      hit = _mm256_and_ps( hit, _mm256_cmp_ps( t.packed, rays.tmin.packed, _CMP_GE_OQ ) );
+      hit = _mm256_and_ps( hit, _mm256_cmp_ps( t.packed, rays.tmax.packed, _CMP_LE_OQ ) );
+      hit = _mm256_and_ps( hit, _mm256_cmp_ps( det, zero, _CMP_NEQ_OQ ) );
+      return _mm256_movemask_ps( hit );
+    }
+
+  }
+
+}
+
+#endif
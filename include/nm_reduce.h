@@ -0,0 +1,396 @@
+#ifndef NM_REDUCE_H
+#define NM_REDUCE_H
+
+#include "nm_common.h"
+#include "nm_vec4f.h"
+#include "nm_vec8f.h"
+#include "nm_vec4d.h"
+#include "nm_kernels.h"
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+// Reductions over float & double arrays.
+//
+// A single vector accumulator makes every add wait on the previous one, which
+// leaves a loop latency-bound at a fraction of what the cpu can issue. These
+// spread consecutive vectors over several independent accumulators instead and
+// only combine them at the end, in a fixed order, so results are reproducible
+// for a given n but differ from a sequential scalar loop by rounding.
+//
+// Sums & dot products come in three modes (see accumulate). Like the
+// elementwise kernels, nothing outside [0, n) is ever read.
+
+namespace nmath {
+
+  inline namespace NMATH_ISA_NAMESPACE {
+
+    namespace kernels {
+
+      //! How sum, dot & l2norm accumulate
+      enum class accumulate {
+        fast, //!< eight plain vector accumulators, error grows with n
+        compensated, //!< Neumaier compensated summation, about 2x the work, error independent of n
+        wide //!< float input accumulated in double precision (vec4d), returns double
+      };
+
+      namespace detail {
+
+        //! Neumaier step sum += x, collecting the rounding error of the add into comp.
+        //! Unlike plain Kahan this stays exact when x is the larger of the two.
+        template <typename V>
+        nmath_inline void neumaier( V& sum, V& comp, const V& x )
+        {
+          // copying whole vectors goes through the union members, which GCC
+          // spills to the stack; moving just the packed registers doesn't
+          const V t = sum + x;
+          const V sumBigger = ( sum.abs() >= x.abs() );
+          comp.packed = ( comp + select( sumBigger, ( sum - t ) + x, ( x - t ) + sum ) ).packed;
+          sum.packed = t.packed;
+        }
+
+        template <typename V>
+        struct plainSum {
+          V sum;
+          nmath_inline void add( const V& x )
+          {
+            sum = sum + x;
+          }
+          nmath_inline void addProduct( const V& a, const V& b )
+          {
+            sum = sum.fma( a, b, sum );
+          }
+          nmath_inline void merge( const plainSum& rhs )
+          {
+            sum = sum + rhs.sum;
+          }
+          nmath_inline auto total() const
+          {
+            return sum.sum();
+          }
+        };
+
+        template <typename V>
+        struct compensatedSum {
+          V sum, comp;
+          nmath_inline void add( const V& x )
+          {
+            neumaier( sum, comp, x );
+          }
+          nmath_inline void addProduct( const V& a, const V& b )
+          {
+            const V p = a * b;
+#ifdef NMATH_HAS_FMA
+            // with FMA the rounding error of the product is exactly a * b - p
+            comp = comp + comp.fms( a, b, p );
+#endif
+            neumaier( sum, comp, p );
+          }
+          nmath_inline void merge( const compensatedSum& rhs )
+          {
+            neumaier( sum, comp, rhs.sum );
+            comp = comp + rhs.comp;
+          }
+          nmath_inline auto total() const
+          {
+            using S = decltype( sum.sum() );
+            constexpr size_t W = sizeof( V ) / sizeof( S );
+            V lanes = sum;
+            S values[W];
+            lanes.storeUnaligned( values );
+            S s = values[0];
+            S c = comp.sum();
+            for ( size_t i = 1; i < W; ++i )
+            {
+              const S t = s + values[i];
+              c += ( std::fabs( s ) >= std::fabs( values[i] ) ? ( s - t ) + values[i] : ( values[i] - t ) + s );
+              s = t;
+            }
+            return s + c;
+          }
+        };
+
+        //! Loads four floats widened to double
+        struct wideLoad {
+          nmath_inline vec4d operator () ( const float* p ) const
+          {
+            return _mm256_cvtps_pd( _mm_loadu_ps( p ) );
+          }
+        };
+
+        struct widePartialLoad {
+          size_t count;
+          nmath_inline vec4d operator () ( const float* p ) const
+          {
+            vec4f v;
+            v.loadPartial( p, count );
+            return _mm256_cvtps_pd( v.packed );
+          }
+        };
+
+        //! Partial load with the missing lanes set to NaN, which min & max skip
+        template <typename S>
+        struct nanPaddedLoad {
+          size_t count;
+          nmath_inline typename lanes<S>::vec operator () ( const S* p ) const
+          {
+            typename lanes<S>::vec v;
+            v.loadPartial( p, count );
+            return select( lanes<S>::tailMask( count ), v, typename lanes<S>::vec( std::numeric_limits<S>::quiet_NaN() ) );
+          }
+        };
+
+        //! How a reduction over S in the given mode loads & accumulates
+        template <typename S, accumulate Mode>
+        struct reduction {
+          using vec = typename lanes<S>::vec;
+          static constexpr size_t count = lanes<S>::count;
+          using load = fullLoad<vec>;
+          using partialLoad = detail::partialLoad<vec>;
+          using accumulator = plainSum<vec>;
+          //! enough independent adds in flight to cover latency on both fp ports
+          static constexpr size_t accumulators = 8;
+        };
+
+        template <typename S>
+        struct reduction<S, accumulate::compensated>: reduction<S, accumulate::fast> {
+          using accumulator = compensatedSum<typename lanes<S>::vec>;
+          //! each step is a chain of several ops already
+          static constexpr size_t accumulators = 4;
+        };
+
+        template <>
+        struct reduction<float, accumulate::wide> {
+          using vec = vec4d;
+          static constexpr size_t count = 4;
+          using load = wideLoad;
+          using partialLoad = widePartialLoad;
+          using accumulator = plainSum<vec4d>;
+          static constexpr size_t accumulators = 8;
+        };
+
+        template <typename S>
+        struct extrema {
+          using vec = typename lanes<S>::vec;
+          static constexpr size_t count = lanes<S>::count;
+          using load = fullLoad<vec>;
+          using partialLoad = nanPaddedLoad<S>;
+          static constexpr size_t accumulators = 4;
+        };
+
+        //! One step per accumulator, unrolled so that the accumulators can live in registers
+        template <size_t W, typename Acc, typename Load, typename Step, size_t... K>
+        nmath_inline void stepEach( Acc* acc, const Load& load, const size_t i, Step& step, std::index_sequence<K...> )
+        {
+          ( step( acc[K], load, i + K * W ), ... );
+        }
+
+        //! The remaining full vectors after the unrolled loop, fewer than one per accumulator
+        template <size_t W, typename Acc, typename Load, typename Step, size_t... K>
+        nmath_inline size_t stepRemaining( Acc* acc, const Load& load, size_t i, const size_t n, Step& step, std::index_sequence<K...> )
+        {
+          ( ( i + W <= n ? ( step( acc[K], load, i ), i += W ) : i ), ... );
+          return i;
+        }
+
+        //! Drives step( acc, load, i ) over [0, n), handing consecutive vectors
+        //! to the Count accumulators in turn so that their dependency chains
+        //! interleave. The tail comes through R::partialLoad.
+        template <typename R, size_t Count, typename Acc, typename Step>
+        nmath_inline void fold( Acc* acc, const size_t n, Step&& step )
+        {
+          constexpr size_t W = R::count;
+          const typename R::load load;
+          size_t i = 0;
+          for ( ; i + Count * W <= n; i += Count * W )
+            stepEach<W>( acc, load, i, step, std::make_index_sequence<Count>() );
+          i = stepRemaining<W>( acc, load, i, n, step, std::make_index_sequence<Count - 1>() );
+          if ( i < n )
+            step( acc[Count - 1], typename R::partialLoad { n - i }, i );
+        }
+
+        //! Folds with the accumulators of the mode & combines them pairwise
+        template <typename S, accumulate Mode, typename Step>
+        inline auto reduce( const size_t n, Step&& step )
+        {
+          using R = reduction<S, Mode>;
+          constexpr size_t count = R::accumulators;
+          typename R::accumulator acc[count];
+          fold<R, count>( acc, n, step );
+          for ( size_t stride = 1; stride < count; stride *= 2 )
+            for ( size_t k = 0; k + stride < count; k += 2 * stride )
+              acc[k].merge( acc[k + stride] );
+          return acc[0].total();
+        }
+
+        template <typename S, accumulate Mode>
+        constexpr void checkMode()
+        {
+          static_assert( Mode != accumulate::wide || std::is_same_v<S, float>, "accumulate::wide is for float input" );
+        }
+
+        //! Smallest lane of v
+        template <typename V>
+        nmath_inline auto lowest( V v )
+        {
+          using S = decltype( v.sum() );
+          S values[sizeof( V ) / sizeof( S )];
+          v.storeUnaligned( values );
+          S r = values[0];
+          for ( const auto x : values )
+            r = ( x < r ? x : r );
+          return r;
+        }
+
+        //! Largest lane of v
+        template <typename V>
+        nmath_inline auto highest( V v )
+        {
+          using S = decltype( v.sum() );
+          S values[sizeof( V ) / sizeof( S )];
+          v.storeUnaligned( values );
+          S r = values[0];
+          for ( const auto x : values )
+            r = ( x > r ? x : r );
+          return r;
+        }
+
+        //! Largest of src[0..n) skipping NaNs, -inf if there is none
+        template <typename S>
+        inline S maxOf( const S* src, const size_t n )
+        {
+          using V = typename lanes<S>::vec;
+          constexpr size_t count = extrema<S>::accumulators;
+          V acc[count];
+          for ( auto& a : acc )
+            a = V( -std::numeric_limits<S>::infinity() );
+          fold<extrema<S>, count>( acc, n, [=]( V& a, const auto& load, size_t i )
+          {
+            a = load( src + i ).max( a );
+          } );
+          for ( size_t k = 1; k < count; ++k )
+            acc[0] = acc[0].max( acc[k] );
+          return highest( acc[0] );
+        }
+
+      }
+
+      //! Sum of src[0..n)
+      template <accumulate Mode = accumulate::fast, typename S>
+      inline auto sum( const S* src, const size_t n )
+      {
+        detail::checkMode<S, Mode>();
+        return detail::reduce<S, Mode>( n, [=]( auto& acc, const auto& load, size_t i )
+        {
+          acc.add( load( src + i ) );
+        } );
+      }
+
+      //! Dot product of a[0..n) & b[0..n).
+      //! The compensated mode also recovers the rounding error of each product
+      //! when the target isa has FMA3; accumulate::wide products are exact.
+      template <accumulate Mode = accumulate::fast, typename S>
+      inline auto dot( const S* a, const S* b, const size_t n )
+      {
+        detail::checkMode<S, Mode>();
+        return detail::reduce<S, Mode>( n, [=]( auto& acc, const auto& load, size_t i )
+        {
+          acc.addProduct( load( a + i ), load( b + i ) );
+        } );
+      }
+
+      //! Euclidean norm sqrt(sum of src[i]^2). Squares aren't rescaled, so this
+      //! overflows for magnitudes past the square root of the type's max
+      //! (about 1.8e19 for float, unless accumulated wide).
+      template <accumulate Mode = accumulate::fast, typename S>
+      inline auto l2norm( const S* src, const size_t n )
+      {
+        return std::sqrt( dot<Mode>( src, src, n ) );
+      }
+
+      //! Smallest & largest of src[0..n), NaNs skipped.
+      //! With nothing but NaNs (or n = 0) lo comes out +inf & hi -inf.
+      template <typename S>
+      inline void minmax( const S* src, const size_t n, S& lo, S& hi )
+      {
+        using V = typename detail::lanes<S>::vec;
+        struct bounds {
+          V lo, hi;
+        };
+        constexpr size_t count = detail::extrema<S>::accumulators;
+        bounds acc[count];
+        for ( auto& a : acc )
+        {
+          a.lo = V( std::numeric_limits<S>::infinity() );
+          a.hi = V( -std::numeric_limits<S>::infinity() );
+        }
+        detail::fold<detail::extrema<S>, count>( acc, n, [=]( bounds& a, const auto& load, size_t i )
+        {
+          // min & max return their second operand when either is NaN
+          const V v = load( src + i );
+          a.lo = v.min( a.lo );
+          a.hi = v.max( a.hi );
+        } );
+        for ( size_t k = 1; k < count; ++k )
+        {
+          acc[0].lo = acc[0].lo.min( acc[k].lo );
+          acc[0].hi = acc[0].hi.max( acc[k].hi );
+        }
+        lo = detail::lowest( acc[0].lo );
+        hi = detail::highest( acc[0].hi );
+      }
+
+      //! Index of the first largest element of src[0..n), NaNs skipped;
+      //! n if there is nothing but NaNs. Goes through the array in blocks
+      //! that stay in L1, and only rescans a block for the index when its
+      //! max beats the best so far.
+      template <typename S>
+      inline size_t argmax( const S* src, const size_t n )
+      {
+        using V = typename detail::lanes<S>::vec;
+        constexpr size_t W = detail::lanes<S>::count;
+        constexpr size_t block = 16384 / sizeof( S );
+        S best = -std::numeric_limits<S>::infinity();
+        size_t index = n;
+        for ( size_t start = 0; start < n; start += block )
+        {
+          const S* p = src + start;
+          const size_t count = ( n - start < block ? n - start : block );
+          const S top = detail::maxOf( p, count );
+          if ( !( top > best || index == n ) )
+            continue;
+          const V target( top );
+          for ( size_t i = 0; i < count; i += W )
+          {
+            V v;
+            int hits;
+            if ( i + W <= count )
+            {
+              v.loadUnaligned( p + i );
+              hits = v.eq( target ).bitmask();
+            }
+            else
+            {
+              // the zeroed lanes past the end mustn't match a max of 0
+              v.loadPartial( p + i, count - i );
+              hits = v.eq( target ).bitmask() & ( ( 1 << ( count - i ) ) - 1 );
+            }
+            if ( hits )
+            {
+              best = top;
+              index = start + i + std::countr_zero( static_cast<unsigned>( hits ) );
+              break;
+            }
+          }
+        }
+        return index;
+      }
+
+    }
+
+  }
+
+}
+
+#endif
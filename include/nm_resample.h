@@ -0,0 +1,252 @@
+#ifndef NM_RESAMPLE_H
+#define NM_RESAMPLE_H
+
+#include "nm_common.h"
+#include "nm_vec8f.h"
+#include "nm_vecmath.h"
+#include "nm_memory.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+// Sample rate conversion by rational ratios with a polyphase FIR filter.
+//
+// Converting from rate a to rate b is upsampling by L = b / gcd( a, b ),
+// lowpass filtering below the lower of the two Nyquist frequencies &
+// downsampling by M = a / gcd( a, b ). Only every Mth sample of the filter's
+// output is kept & all but one in L of its inputs are zeros, so an output is
+// the dot product of one of the L phases of the filter with the last few
+// input samples, & nothing is computed at the upsampled rate.
+//
+// The table holds the phases one after the other, each reversed so that the
+// dot product runs forward through the input, in whole vectors. Outputs are
+// computed eight at a time, one accumulator each, & summed horizontally
+// together into one vector of outputs.
+
+namespace nmath {
+
+  inline namespace NMATH_ISA_NAMESPACE {
+
+    //! Length & stopband attenuation of the resampler's filter, trading cost
+    //! for passband width & aliasing. Taps are counted at the lower of the two
+    //! rates; passbands within 0.1 dB are for 44.1k to 48k.
+    enum class resampleQuality {
+      fast, //!< 16 taps, 60 dB, flat to 12.8 kHz
+      good, //!< 32 taps, 80 dB, flat to 15.9 kHz
+      best //!< 64 taps, 100 dB, flat to 18.3 kHz
+    };
+
+    namespace detail {
+
+      //! The eight sums of the lanes of a0 to a7, in order
+      nmath_inline __m256 sum8( const __m256 a0, const __m256 a1, const __m256 a2, const __m256 a3,
+        const __m256 a4, const __m256 a5, const __m256 a6, const __m256 a7 )
+      {
+        // pairs, then quads of each 128-bit half; the halves add up last
+        const auto q0 = _mm256_hadd_ps( _mm256_hadd_ps( a0, a1 ), _mm256_hadd_ps( a2, a3 ) );
+        const auto q1 = _mm256_hadd_ps( _mm256_hadd_ps( a4, a5 ), _mm256_hadd_ps( a6, a7 ) );
+        return _mm256_add_ps( _mm256_permute2f128_ps( q0, q1, 0x20 ), _mm256_permute2f128_ps( q0, q1, 0x31 ) );
+      }
+
+      //! The zeroth order modified Bessel function of the first kind, for the Kaiser window
+      inline double besselI0( const double x )
+      {
+        double sum = 1.0, term = 1.0;
+        for ( int k = 1; term > sum * 1e-17; ++k )
+        {
+          const double f = x / ( 2.0 * k );
+          term *= f * f;
+          sum += term;
+        }
+        return sum;
+      }
+
+    }
+
+    //! A streaming sample rate converter for one channel. Input comes in blocks
+    //! of any size; the converter keeps the history its filter needs between them.
+    class resampler {
+    private:
+      static constexpr size_t c_chunk = 1024;
+      size_t up_ = 1, down_ = 1;
+      //! Taps per phase, a multiple of 8
+      size_t taps_ = 0;
+      //! up_ phases of taps_ coefficients, each reversed
+      buffer<float> phases_;
+      //! taps_ - 1 samples of history, then the chunk being resampled
+      buffer<float> line_;
+      //! Where the window of the next output starts in line_, & its phase
+      size_t start_ = 0, phase_ = 0;
+      nmath_inline void advance( size_t& start, size_t& phase ) const
+      {
+        start += down_ / up_;
+        phase += down_ % up_;
+        if ( phase >= up_ )
+        {
+          phase -= up_;
+          ++start;
+        }
+      }
+      //! All outputs whose window ends before available, into out
+      size_t run( const size_t available, float* out )
+      {
+        using T = detail::vecmath<vec8f>;
+        const float* x = line_.data();
+        const float* h = phases_.data();
+        const size_t taps = taps_;
+        size_t produced = 0;
+        for ( ;; )
+        {
+          size_t s[8], p[8];
+          size_t start = start_, phase = phase_;
+          for ( int j = 0; j < 8; ++j )
+          {
+            s[j] = start;
+            p[j] = phase * taps;
+            advance( start, phase );
+          }
+          if ( s[7] + taps > available )
+            break;
+          auto a0 = T::set1( 0.0f ), a1 = a0, a2 = a0, a3 = a0, a4 = a0, a5 = a0, a6 = a0, a7 = a0;
+          for ( size_t k = 0; k < taps; k += 8 )
+          {
+            a0 = T::madd( _mm256_loadu_ps( x + s[0] + k ), _mm256_load_ps( h + p[0] + k ), a0 );
+            a1 = T::madd( _mm256_loadu_ps( x + s[1] + k ), _mm256_load_ps( h + p[1] + k ), a1 );
+            a2 = T::madd( _mm256_loadu_ps( x + s[2] + k ), _mm256_load_ps( h + p[2] + k ), a2 );
+            a3 = T::madd( _mm256_loadu_ps( x + s[3] + k ), _mm256_load_ps( h + p[3] + k ), a3 );
+            a4 = T::madd( _mm256_loadu_ps( x + s[4] + k ), _mm256_load_ps( h + p[4] + k ), a4 );
+            a5 = T::madd( _mm256_loadu_ps( x + s[5] + k ), _mm256_load_ps( h + p[5] + k ), a5 );
+            a6 = T::madd( _mm256_loadu_ps( x + s[6] + k ), _mm256_load_ps( h + p[6] + k ), a6 );
+            a7 = T::madd( _mm256_loadu_ps( x + s[7] + k ), _mm256_load_ps( h + p[7] + k ), a7 );
+          }
+          _mm256_storeu_ps( out + produced, detail::sum8( a0, a1, a2, a3, a4, a5, a6, a7 ) );
+          produced += 8;
+          start_ = start;
+          phase_ = phase;
+        }
+        while ( start_ + taps <= available )
+        {
+          auto a = T::set1( 0.0f );
+          for ( size_t k = 0; k < taps; k += 8 )
+            a = T::madd( _mm256_loadu_ps( x + start_ + k ), _mm256_load_ps( h + phase_ * taps + k ), a );
+          _mm_store_ss( out + produced, _mm256_castps256_ps128( detail::sum8( a, a, a, a, a, a, a, a ) ) );
+          ++produced;
+          advance( start_, phase_ );
+        }
+        return produced;
+      }
+    public:
+      resampler() = default;
+      //! Conversion from inRate to outRate, in Hz or any other unit as long as
+      //! both are whole numbers; the table has outRate / gcd( inRate, outRate )
+      //! phases, so rates close to each other without a large common divisor
+      //! make for a large table
+      resampler( const size_t inRate, const size_t outRate, const resampleQuality quality = resampleQuality::good )
+      {
+        set( inRate, outRate, quality );
+      }
+      //! Replace the ratio & filter, & clear the history
+      void set( const size_t inRate, const size_t outRate, const resampleQuality quality = resampleQuality::good )
+      {
+        const size_t divisor = std::gcd( inRate, outRate );
+        up_ = outRate / divisor;
+        down_ = inRate / divisor;
+        const double length = quality == resampleQuality::fast ? 16.0 : quality == resampleQuality::good ? 32.0 : 64.0;
+        const double attenuation = quality == resampleQuality::fast ? 60.0 : quality == resampleQuality::good ? 80.0 : 100.0;
+        // the presets are taps at the lower rate; downsampling needs more of the input's
+        const double scale = std::min( 1.0, static_cast<double>( up_ ) / static_cast<double>( down_ ) );
+        taps_ = ( static_cast<size_t>( std::ceil( length / scale ) ) + 7 ) / 8 * 8;
+        // Kaiser's estimates of the window's shape & transition width, the width
+        // in units of the lower Nyquist frequency; the stopband starts at that
+        // frequency so that nothing above it aliases
+        const double beta = 0.1102 * ( attenuation - 8.7 );
+        const double width = ( attenuation - 7.95 ) / ( 2.285 * 3.14159265358979323846 * length );
+        const double cutoff = scale * ( 1.0 - width / 2.0 );
+        const size_t total = up_ * taps_;
+        const double center = static_cast<double>( total - 1 ) / 2.0;
+        const double i0Beta = detail::besselI0( beta );
+        phases_.resize( 0 );
+        phases_.resize( total );
+        for ( size_t p = 0; p < up_; ++p )
+        {
+          // phase p holds taps p, p + L, p + 2L & so on of the prototype, which runs
+          // at the upsampled rate, time in input samples
+          double sum = 0.0;
+          float* phase = &phases_[p * taps_];
+          for ( size_t k = 0; k < taps_; ++k )
+          {
+            const double t = ( static_cast<double>( k * up_ + p ) - center ) / static_cast<double>( up_ );
+            const double x = 3.14159265358979323846 * cutoff * t;
+            const double sinc = std::fabs( x ) < 1e-12 ? 1.0 : std::sin( x ) / x;
+            const double r = ( static_cast<double>( k * up_ + p ) - center ) / center;
+            const double window = detail::besselI0( beta * std::sqrt( std::max( 0.0, 1.0 - r * r ) ) ) / i0Beta;
+            const double tap = sinc * window;
+            phase[taps_ - 1 - k] = static_cast<float>( tap );
+            sum += tap;
+          }
+          // unity gain at DC in every phase, so that constant input stays constant
+          for ( size_t k = 0; k < taps_; ++k )
+            phase[k] = static_cast<float>( phase[k] / sum );
+        }
+        line_.resize( 0 );
+        line_.resize( taps_ - 1 + c_chunk );
+        reset();
+      }
+      //! The ratio in lowest terms: up() outputs for every down() inputs
+      size_t up() const
+      {
+        return up_;
+      }
+      size_t down() const
+      {
+        return down_;
+      }
+      //! Taps per phase, the input samples each output is a dot product of
+      size_t taps() const
+      {
+        return taps_;
+      }
+      //! Delay of the filter's center, in input samples
+      double latency() const
+      {
+        return static_cast<double>( up_ * taps_ - 1 ) / ( 2.0 * static_cast<double>( up_ ) );
+      }
+      //! The most outputs process can write for count inputs
+      size_t maxOutput( const size_t count ) const
+      {
+        return ( count * up_ + down_ - 1 ) / down_ + 1;
+      }
+      void reset()
+      {
+        std::fill( line_.begin(), line_.end(), 0.0f );
+        start_ = 0;
+        phase_ = 0;
+      }
+      //! Resample count samples from in, writing the outputs they complete to out
+      //! & returning how many, at most maxOutput( count ). Over a stream, there are
+      //! up() outputs for every down() inputs.
+      size_t process( const float* in, size_t count, float* out )
+      {
+        const size_t history = taps_ - 1;
+        size_t produced = 0;
+        while ( count )
+        {
+          const size_t chunk = std::min( count, c_chunk );
+          std::copy( in, in + chunk, line_.data() + history );
+          produced += run( history + chunk, out + produced );
+          // the windows left all start after this chunk's first sample
+          std::memmove( line_.data(), line_.data() + chunk, history * sizeof( float ) );
+          start_ -= chunk;
+          in += chunk;
+          count -= chunk;
+        }
+        return produced;
+      }
+    };
+
+  }
+
+}
+
+#endif
@@ -0,0 +1,253 @@
+#ifndef NM_SOA_H
+#define NM_SOA_H
+
+#include "nm_common.h"
+#include "nm_vec8f.h"
+#include "nm_memory.h"
+
+// Structure-of-arrays streams of 3 & 4 component vectors, and the transposes
+// between them & interleaved xyz / xyzw arrays.
+//
+// Geometry usually arrives interleaved, one point after the other, while vec8f
+// only pays off with eight x's in one register. The transposes below convert
+// eight points at a time in registers, so hot loops can stay SoA and only the
+// edges of a pipeline see the interleaved layout.
+
+namespace nmath {
+
+  inline namespace NMATH_ISA_NAMESPACE {
+
+    //! Eight interleaved xyz triples from 24 unaligned floats into x, y & z
+    nmath_inline void transpose8x3( const float* __restrict xyz, vec8f& x, vec8f& y, vec8f& z )
+    {
+      // points 0..3 in the low lanes, 4..7 in the high lanes:
+      // m03 = x0 y0 z0 x1, m14 = y1 z1 x2 y2, m25 = z2 x3 y3 z3
+      auto m03 = _mm256_castps128_ps256( _mm_loadu_ps( xyz ) );
+      auto m14 = _mm256_castps128_ps256( _mm_loadu_ps( xyz + 4 ) );
+      auto m25 = _mm256_castps128_ps256( _mm_loadu_ps( xyz + 8 ) );
+      m03 = _mm256_insertf128_ps( m03, _mm_loadu_ps( xyz + 12 ), 1 );
+      m14 = _mm256_insertf128_ps( m14, _mm_loadu_ps( xyz + 16 ), 1 );
+      m25 = _mm256_insertf128_ps( m25, _mm_loadu_ps( xyz + 20 ), 1 );
+      const auto xy = _mm256_shuffle_ps( m14, m25, _MM_SHUFFLE( 2, 1, 3, 2 ) ); // x2 y2 x3 y3
+      const auto yz = _mm256_shuffle_ps( m03, m14, _MM_SHUFFLE( 1, 0, 2, 1 ) ); // y0 z0 y1 z1
+      x.packed = _mm256_shuffle_ps( m03, xy, _MM_SHUFFLE( 2, 0, 3, 0 ) );
+      y.packed = _mm256_shuffle_ps( yz, xy, _MM_SHUFFLE( 3, 1, 2, 0 ) );
+      z.packed = _mm256_shuffle_ps( yz, m25, _MM_SHUFFLE( 3, 0, 3, 1 ) );
+    }
+
+    //! x, y & z back into eight interleaved xyz triples at 24 unaligned floats
+    nmath_inline void transpose3x8( const vec8f& x, const vec8f& y, const vec8f& z, float* __restrict xyz )
+    {
+      const auto xy = _mm256_shuffle_ps( x.packed, y.packed, _MM_SHUFFLE( 2, 0, 2, 0 ) ); // x0 x2 y0 y2
+      const auto yz = _mm256_shuffle_ps( y.packed, z.packed, _MM_SHUFFLE( 3, 1, 3, 1 ) ); // y1 y3 z1 z3
+      const auto zx = _mm256_shuffle_ps( z.packed, x.packed, _MM_SHUFFLE( 3, 1, 2, 0 ) ); // z0 z2 x1 x3
+      const auto m03 = _mm256_shuffle_ps( xy, zx, _MM_SHUFFLE( 2, 0, 2, 0 ) );
+      const auto m14 = _mm256_shuffle_ps( yz, xy, _MM_SHUFFLE( 3, 1, 2, 0 ) );
+      const auto m25 = _mm256_shuffle_ps( zx, yz, _MM_SHUFFLE( 3, 1, 3, 1 ) );
+      _mm256_storeu_ps( xyz, _mm256_permute2f128_ps( m03, m14, 0x20 ) );
+      _mm256_storeu_ps( xyz + 8, _mm256_permute2f128_ps( m25, m03, 0x30 ) );
+      _mm256_storeu_ps( xyz + 16, _mm256_permute2f128_ps( m14, m25, 0x31 ) );
+    }
+
+    //! Eight interleaved xyzw quadruples from 32 unaligned floats into x, y, z & w
+    nmath_inline void transpose8x4( const float* __restrict xyzw, vec8f& x, vec8f& y, vec8f& z, vec8f& w )
+    {
+      // point i in the low lanes & point i + 4 in the high lanes, then a
+      // regular 4x4 transpose in both halves at once
+      const auto r0 = _mm256_insertf128_ps( _mm256_castps128_ps256( _mm_loadu_ps( xyzw ) ), _mm_loadu_ps( xyzw + 16 ), 1 );
+      const auto r1 = _mm256_insertf128_ps( _mm256_castps128_ps256( _mm_loadu_ps( xyzw + 4 ) ), _mm_loadu_ps( xyzw + 20 ), 1 );
+      const auto r2 = _mm256_insertf128_ps( _mm256_castps128_ps256( _mm_loadu_ps( xyzw + 8 ) ), _mm_loadu_ps( xyzw + 24 ), 1 );
+      const auto r3 = _mm256_insertf128_ps( _mm256_castps128_ps256( _mm_loadu_ps( xyzw + 12 ) ), _mm_loadu_ps( xyzw + 28 ), 1 );
+      const auto t0 = _mm256_unpacklo_ps( r0, r1 ); // x0 x1 y0 y1
+      const auto t1 = _mm256_unpackhi_ps( r0, r1 ); // z0 z1 w0 w1
+      const auto t2 = _mm256_unpacklo_ps( r2, r3 ); // x2 x3 y2 y3
+      const auto t3 = _mm256_unpackhi_ps( r2, r3 ); // z2 z3 w2 w3
+      x.packed = _mm256_shuffle_ps( t0, t2, _MM_SHUFFLE( 1, 0, 1, 0 ) );
+      y.packed = _mm256_shuffle_ps( t0, t2, _MM_SHUFFLE( 3, 2, 3, 2 ) );
+      z.packed = _mm256_shuffle_ps( t1, t3, _MM_SHUFFLE( 1, 0, 1, 0 ) );
+      w.packed = _mm256_shuffle_ps( t1, t3, _MM_SHUFFLE( 3, 2, 3, 2 ) );
+    }
+
+    //! x, y, z & w back into eight interleaved xyzw quadruples at 32 unaligned floats
+    nmath_inline void transpose4x8( const vec8f& x, const vec8f& y, const vec8f& z, const vec8f& w, float* __restrict xyzw )
+    {
+      const auto t0 = _mm256_unpacklo_ps( x.packed, y.packed ); // x0 y0 x1 y1
+      const auto t1 = _mm256_unpackhi_ps( x.packed, y.packed ); // x2 y2 x3 y3
+      const auto t2 = _mm256_unpacklo_ps( z.packed, w.packed ); // z0 w0 z1 w1
+      const auto t3 = _mm256_unpackhi_ps( z.packed, w.packed ); // z2 w2 z3 w3
+      const auto p04 = _mm256_shuffle_ps( t0, t2, _MM_SHUFFLE( 1, 0, 1, 0 ) );
+      const auto p15 = _mm256_shuffle_ps( t0, t2, _MM_SHUFFLE( 3, 2, 3, 2 ) );
+      const auto p26 = _mm256_shuffle_ps( t1, t3, _MM_SHUFFLE( 1, 0, 1, 0 ) );
+      const auto p37 = _mm256_shuffle_ps( t1, t3, _MM_SHUFFLE( 3, 2, 3, 2 ) );
+      _mm256_storeu_ps( xyzw, _mm256_permute2f128_ps( p04, p15, 0x20 ) );
+      _mm256_storeu_ps( xyzw + 8, _mm256_permute2f128_ps( p26, p37, 0x20 ) );
+      _mm256_storeu_ps( xyzw + 16, _mm256_permute2f128_ps( p04, p15, 0x31 ) );
+      _mm256_storeu_ps( xyzw + 24, _mm256_permute2f128_ps( p26, p37, 0x31 ) );
+    }
+
+    //! count interleaved xyz triples into separate x, y & z arrays
+    nmath_inline void deinterleave3( const float* __restrict xyz, float* __restrict x, float* __restrict y, float* __restrict z, const size_t count )
+    {
+      size_t i = 0;
+      for ( ; i + 8 <= count; i += 8 )
+      {
+        vec8f vx, vy, vz;
+        transpose8x3( xyz + 3 * i, vx, vy, vz );
+        vx.storeUnaligned( x + i );
+        vy.storeUnaligned( y + i );
+        vz.storeUnaligned( z + i );
+      }
+      for ( ; i < count; ++i )
+      {
+        x[i] = xyz[3 * i];
+        y[i] = xyz[3 * i + 1];
+        z[i] = xyz[3 * i + 2];
+      }
+    }
+
+    //! count x, y & z from separate arrays into interleaved xyz triples
+    nmath_inline void interleave3( const float* __restrict x, const float* __restrict y, const float* __restrict z, float* __restrict xyz, const size_t count )
+    {
+      size_t i = 0;
+      for ( ; i + 8 <= count; i += 8 )
+      {
+        vec8f vx, vy, vz;
+        vx.loadUnaligned( x + i );
+        vy.loadUnaligned( y + i );
+        vz.loadUnaligned( z + i );
+        transpose3x8( vx, vy, vz, xyz + 3 * i );
+      }
+      for ( ; i < count; ++i )
+      {
+        xyz[3 * i] = x[i];
+        xyz[3 * i + 1] = y[i];
+        xyz[3 * i + 2] = z[i];
+      }
+    }
+
+    //! count interleaved xyzw quadruples into separate x, y, z & w arrays
+    nmath_inline void deinterleave4( const float* __restrict xyzw, float* __restrict x, float* __restrict y, float* __restrict z, float* __restrict w, const size_t count )
+    {
+      size_t i = 0;
+      for ( ; i + 8 <= count; i += 8 )
+      {
+        vec8f vx, vy, vz, vw;
+        transpose8x4( xyzw + 4 * i, vx, vy, vz, vw );
+        vx.storeUnaligned( x + i );
+        vy.storeUnaligned( y + i );
+        vz.storeUnaligned( z + i );
+        vw.storeUnaligned( w + i );
+      }
+      for ( ; i < count; ++i )
+      {
+        x[i] = xyzw[4 * i];
+        y[i] = xyzw[4 * i + 1];
+        z[i] = xyzw[4 * i + 2];
+        w[i] = xyzw[4 * i + 3];
+      }
+    }
+
+    //! count x, y, z & w from separate arrays into interleaved xyzw quadruples
+    nmath_inline void interleave4( const float* __restrict x, const float* __restrict y, const float* __restrict z, const float* __restrict w, float* __restrict xyzw, const size_t count )
+    {
+      size_t i = 0;
+      for ( ; i + 8 <= count; i += 8 )
+      {
+        vec8f vx, vy, vz, vw;
+        vx.loadUnaligned( x + i );
+        vy.loadUnaligned( y + i );
+        vz.loadUnaligned( z + i );
+        vw.loadUnaligned( w + i );
+        transpose4x8( vx, vy, vz, vw, xyzw + 4 * i );
+      }
+      for ( ; i < count; ++i )
+      {
+        xyzw[4 * i] = x[i];
+        xyzw[4 * i + 1] = y[i];
+        xyzw[4 * i + 2] = z[i];
+        xyzw[4 * i + 3] = w[i];
+      }
+    }
+
+    //! Stream of 3 component vectors as one aligned, zero padded buffer per component.
+    //! Loops can run over padded() elements in whole vec8f loads & stores of
+    //! x, y & z without a tail, e.g. into transformPoints.
+    class soa3f {
+    public:
+      buffer<float> x, y, z;
+      soa3f() = default;
+      //! count zeroed vectors
+      explicit soa3f( const size_t count ): x( count ), y( count ), z( count )
+      {
+      }
+      void resize( const size_t count )
+      {
+        x.resize( count );
+        y.resize( count );
+        z.resize( count );
+      }
+      size_t size() const
+      {
+        return x.size();
+      }
+      //! size() rounded up to whole vectors
+      size_t padded() const
+      {
+        return x.padded();
+      }
+      //! Replace the contents with count interleaved xyz triples
+      void assignInterleaved( const float* __restrict xyz, const size_t count )
+      {
+        resize( count );
+        deinterleave3( xyz, x.data(), y.data(), z.data(), count );
+      }
+      //! Write all size() vectors out as interleaved xyz triples
+      void storeInterleaved( float* __restrict xyz ) const
+      {
+        interleave3( x.data(), y.data(), z.data(), xyz, size() );
+      }
+    };
+
+    //! Stream of 4 component vectors as one aligned, zero padded buffer per component
+    class soa4f {
+    public:
+      buffer<float> x, y, z, w;
+      soa4f() = default;
+      //! count zeroed vectors
+      explicit soa4f( const size_t count ): x( count ), y( count ), z( count ), w( count )
+      {
+      }
+      void resize( const size_t count )
+      {
+        x.resize( count );
+        y.resize( count );
+        z.resize( count );
+        w.resize( count );
+      }
+      size_t size() const
+      {
+        return x.size();
+      }
+      //! size() rounded up to whole vectors
+      size_t padded() const
+      {
+        return x.padded();
+      }
+      //! Replace the contents with count interleaved xyzw quadruples
+      void assignInterleaved( const float* __restrict xyzw, const size_t count )
+      {
+        resize( count );
+        deinterleave4( xyzw, x.data(), y.data(), z.data(), w.data(), count );
+      }
+      //! Write all size() vectors out as interleaved xyzw quadruples
+      void storeInterleaved( float* __restrict xyzw ) const
+      {
+        interleave4( x.data(), y.data(), z.data(), w.data(), xyzw, size() );
+      }
+    };
+
+  }
+
+}
+
+#endif
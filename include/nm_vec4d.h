@@ -3,178 +3,340 @@
 
 #include "nm_common.h"
 
+#ifndef NMATH_HAS_AVX
+# error "nm_vec4d.h needs AVX: build this translation unit with -mavx, /arch:AVX or higher. Only vec4f & vec4i work at the SSE4.1 level."
+#endif
+
 namespace nmath {
 
-  nmath_32b_align class vec4d {
-  public:
-    union {
-      struct {
-        double x, y, z, w;
+  inline namespace NMATH_ISA_NAMESPACE {
+
+    class nmath_32b_align vec4d {
+    public:
+      union {
+        struct {
+          double x, y, z, w;
+        };
+        __m256d packed;
       };
-      __m256d packed;
+      nmath_inline vec4d()
+      {
+        packed = _mm256_setzero_pd();
+      }
+      nmath_inline vec4d( const double value )
+      {
+        packed = _mm256_broadcast_sd( &value );
+      }
+      nmath_inline vec4d( const double* __restrict values )
+      {
+        packed = _mm256_load_pd( values );
+      }
+      nmath_inline vec4d( const __m256d& rhs ): packed( rhs )
+      {
+      }
+      nmath_inline vec4d( double _x, double _y, double _z, double _w )
+      {
+        packed = _mm256_setr_pd( _x, _y, _z, _w );
+      }
+      //! Load four 32-byte boundary aligned sample values into vector
+      nmath_inline void load( const double* __restrict values )
+      {
+        packed = _mm256_load_pd( values );
+      }
+      //! Load four unaligned sample values into vector
+      nmath_inline void loadUnaligned( const double* __restrict values )
+      {
+        packed = _mm256_loadu_pd( values );
+      }
+      //! Integer lane mask with the first count lanes set, for maskload & maskstore
+      static nmath_inline __m256i tailMask( const size_t count )
+      {
+        return _mm256_castpd_si256( _mm256_cmp_pd( _mm256_set1_pd( static_cast<double>( count ) ), _mm256_setr_pd( 0.0, 1.0, 2.0, 3.0 ), _CMP_GT_OQ ) );
+      }
+      //! Load the first count of four unaligned sample values into vector, zeroing the rest.
+      //! Memory past the first count values is never touched, so this is safe at the end of an array.
+      nmath_inline void loadPartial( const double* __restrict values, const size_t count )
+      {
+        packed = _mm256_maskload_pd( values, tailMask( count ) );
+      }
+      //! Store four sample values from vector to 32-byte boundary aligned memory
+      //! using a non-temporal usage hint (data not reused, don't cache in SSB)
+      //! treating nontemporal data as temporal would be cache pollution = bad
+      nmath_inline void storeNontemporal( double* __restrict values )
+      {
+        _mm256_stream_pd( values, packed );
+      }
+      //! Store four sample values from vector to 32-byte boundary aligned memory
+      //! using a temporal usage hint (data is reused, maybe cache in SSB)
+      //! subsequent stores of values cached in SSB can bypass L1, L2 & memctrl = nice
+      nmath_inline void storeTemporal( double* __restrict values )
+      {
+        _mm256_store_pd( values, packed );
+      }
+      //! Store four sample values from vector to unaligned memory
+      nmath_inline void storeUnaligned( double* __restrict values )
+      {
+        _mm256_storeu_pd( values, packed );
+      }
+      //! Store the first count of four sample values from vector to unaligned memory.
+      //! Memory past the first count values is never touched.
+      nmath_inline void storePartial( double* __restrict values, const size_t count )
+      {
+        _mm256_maskstore_pd( values, tailMask( count ), packed );
+      }
+      //! Set all vector members to single value
+      nmath_inline void set( const double* value )
+      {
+        packed = _mm256_broadcast_sd( value );
+      }
+      //! Set vector members individually
+      nmath_inline void set( double _x, double _y, double _z, double _w )
+      {
+        packed = _mm256_setr_pd( _x, _y, _z, _w );
+      }
+      //! v = a + b
+      nmath_inline vec4d operator + ( const vec4d& rhs ) const
+      {
+        return _mm256_add_pd( packed, rhs.packed );
+      }
+      //! v = a - b
+      nmath_inline vec4d operator - ( const vec4d& rhs ) const
+      {
+        return _mm256_sub_pd( packed, rhs.packed );
+      }
+      //! v = a & b (bitwise and)
+      nmath_inline vec4d operator & ( const vec4d& rhs ) const
+      {
+        return _mm256_and_pd( packed, rhs.packed );
+      }
+      //! v = a | b (bitwise or)
+      nmath_inline vec4d operator | ( const vec4d& rhs ) const
+      {
+        return _mm256_or_pd( packed, rhs.packed );
+      }
+      //! v = a ^ b (bitwise xor)
+      nmath_inline vec4d operator ^ ( const vec4d& rhs ) const
+      {
+        return _mm256_xor_pd( packed, rhs.packed );
+      }
+      //! v = a * b
+      nmath_inline vec4d operator * ( const double scalar ) const
+      {
+        const auto im = _mm256_set1_pd( scalar );
+        return _mm256_mul_pd( packed, im );
+      }
+      //! v = a * b
+      nmath_inline vec4d operator * ( const vec4d& rhs ) const
+      {
+        return _mm256_mul_pd( packed, rhs.packed );
+      }
+      //! v = a / b
+      nmath_inline vec4d operator / ( const double scalar ) const
+      {
+        const auto im = _mm256_set1_pd( scalar );
+        return _mm256_div_pd( packed, im );
+      }
+      //! v = a / b
+      nmath_inline vec4d operator / ( const vec4d& rhs ) const
+      {
+        return _mm256_div_pd( packed, rhs.packed );
+      }
+      //! a == b
+      nmath_inline bool operator == ( const vec4d& rhs ) const
+      {
+        const auto ret = _mm256_cmp_pd( packed, rhs.packed, _CMP_NEQ_OS );
+        return ( _mm256_movemask_pd( ret ) == 0 );
+      }
+      //! a != b
+      nmath_inline bool operator != ( const vec4d& rhs ) const
+      {
+        const auto ret = _mm256_cmp_pd( packed, rhs.packed, _CMP_NEQ_OS );
+        return ( _mm256_movemask_pd( ret ) != 0 );
+      }
+      //! Per-lane a < b, all bits set in lanes where true
+      nmath_inline vec4d operator < ( const vec4d& rhs ) const
+      {
+        return _mm256_cmp_pd( packed, rhs.packed, _CMP_LT_OQ );
+      }
+      //! Per-lane a <= b, all bits set in lanes where true
+      nmath_inline vec4d operator <= ( const vec4d& rhs ) const
+      {
+        return _mm256_cmp_pd( packed, rhs.packed, _CMP_LE_OQ );
+      }
+      //! Per-lane a > b, all bits set in lanes where true
+      nmath_inline vec4d operator > ( const vec4d& rhs ) const
+      {
+        return _mm256_cmp_pd( packed, rhs.packed, _CMP_GT_OQ );
+      }
+      //! Per-lane a >= b, all bits set in lanes where true
+      nmath_inline vec4d operator >= ( const vec4d& rhs ) const
+      {
+        return _mm256_cmp_pd( packed, rhs.packed, _CMP_GE_OQ );
+      }
+      //! Per-lane a == b, all bits set in lanes where true
+      //! (operator == compares the whole vector instead)
+      nmath_inline vec4d eq( const vec4d& rhs ) const
+      {
+        return _mm256_cmp_pd( packed, rhs.packed, _CMP_EQ_OQ );
+      }
+      //! Per-lane a != b, all bits set in lanes where true (NaN never equals anything)
+      //! (operator != compares the whole vector instead)
+      nmath_inline vec4d neq( const vec4d& rhs ) const
+      {
+        return _mm256_cmp_pd( packed, rhs.packed, _CMP_NEQ_UQ );
+      }
+      //! Sign bits of all lanes packed into an int, lane 0 in bit 0
+      nmath_inline int bitmask() const
+      {
+        return _mm256_movemask_pd( packed );
+      }
+      //! Whether any lane of a mask is set
+      nmath_inline bool any() const
+      {
+        return ( _mm256_movemask_pd( packed ) != 0 );
+      }
+      //! Whether all lanes of a mask are set
+      nmath_inline bool all() const
+      {
+        return ( _mm256_movemask_pd( packed ) == 0xF );
+      }
+      //! Whether no lane of a mask is set
+      nmath_inline bool none() const
+      {
+        return ( _mm256_movemask_pd( packed ) == 0 );
+      }
+      //! v = round(a)
+      nmath_inline vec4d round() const
+      {
+        return _mm256_round_pd( packed, _MM_FROUND_NINT );
+      }
+      //! v = ceil(a)
+      nmath_inline vec4d ceil() const
+      {
+        return _mm256_round_pd( packed, _MM_FROUND_CEIL );
+      }
+      //! v = floor(a)
+      nmath_inline vec4d floor() const
+      {
+        return _mm256_round_pd( packed, _MM_FROUND_FLOOR );
+      }
+      //! v = trunc(a)
+      nmath_inline vec4d trunc() const
+      {
+        return _mm256_round_pd( packed, _MM_FROUND_TRUNC );
+      }
+      //! v = sqrt(a)
+      nmath_inline vec4d sqrt() const
+      {
+        return _mm256_sqrt_pd( packed );
+      }
+      //! v = 1 / a. There is no double precision estimate instruction before AVX512,
+      //! so this starts from the float estimate and refines it with Steps Newton-Raphson
+      //! iterations, each roughly doubling the correct bits.
+      //! Max relative error: 0 steps 3.0e-4, 1 step 9.1e-8, 2 steps 8.2e-15, 3 steps 2.8e-16 (~1 ulp).
+      //! Only valid within float range; zero & infinite lanes come out as NaN once refined.
+      template <int Steps = 2>
+      nmath_inline vec4d rcp() const
+      {
+        static_assert( Steps >= 0 && Steps <= 3, "rcp supports 0 to 3 refinement steps" );
+        auto x = _mm256_cvtps_pd( _mm_rcp_ps( _mm256_cvtpd_ps( packed ) ) );
+        for ( int i = 0; i < Steps; ++i )
+        {
+          // x' = x * ( 2 - a * x )
+#ifdef NMATH_HAS_FMA
+          x = _mm256_mul_pd( x, _mm256_fnmadd_pd( packed, x, _mm256_set1_pd( 2.0 ) ) );
+#else
+          x = _mm256_mul_pd( x, _mm256_sub_pd( _mm256_set1_pd( 2.0 ), _mm256_mul_pd( packed, x ) ) );
+#endif
+        }
+        return x;
+      }
+      //! v = 1 / sqrt(a), from the float estimate refined with Steps Newton-Raphson iterations.
+      //! Max relative error: 0 steps 3.3e-4, 1 step 1.6e-7, 2 steps 3.9e-14, 3 steps 2.7e-16 (~1 ulp).
+      //! Only valid within float range; zero & infinite lanes come out as NaN once refined.
+      template <int Steps = 2>
+      nmath_inline vec4d rsqrt() const
+      {
+        static_assert( Steps >= 0 && Steps <= 3, "rsqrt supports 0 to 3 refinement steps" );
+        auto y = _mm256_cvtps_pd( _mm_rsqrt_ps( _mm256_cvtpd_ps( packed ) ) );
+        for ( int i = 0; i < Steps; ++i )
+        {
+          // y' = 0.5 * y * ( 3 - a * y * y )
+          const auto ay = _mm256_mul_pd( packed, y );
+          const auto hy = _mm256_mul_pd( y, _mm256_set1_pd( 0.5 ) );
+#ifdef NMATH_HAS_FMA
+          y = _mm256_mul_pd( hy, _mm256_fnmadd_pd( ay, y, _mm256_set1_pd( 3.0 ) ) );
+#else
+          y = _mm256_mul_pd( hy, _mm256_sub_pd( _mm256_set1_pd( 3.0 ), _mm256_mul_pd( ay, y ) ) );
+#endif
+        }
+        return y;
+      }
+      //! v = a / b as a * rcp<Steps>(b), see rcp for accuracy
+      template <int Steps = 2>
+      nmath_inline vec4d fastDiv( const vec4d& rhs ) const
+      {
+        return _mm256_mul_pd( packed, rhs.rcp<Steps>().packed );
+      }
+      //! v = |a|
+      nmath_inline vec4d abs() const
+      {
+        return _mm256_andnot_pd( _mm256_set1_pd( -0.0 ), packed );
+      }
+      //! v = min(a, b), b where either is NaN
+      nmath_inline vec4d min( const vec4d& rhs ) const
+      {
+        return _mm256_min_pd( packed, rhs.packed );
+      }
+      //! v = max(a, b), b where either is NaN
+      nmath_inline vec4d max( const vec4d& rhs ) const
+      {
+        return _mm256_max_pd( packed, rhs.packed );
+      }
+      //! v = min(max(a, lo), hi), NaN lanes end up as lo
+      nmath_inline vec4d clamp( const vec4d& lo, const vec4d& hi ) const
+      {
+        return _mm256_min_pd( _mm256_max_pd( packed, lo.packed ), hi.packed );
+      }
+      //! f = x + y + z + w
+      nmath_inline double sum() const
+      {
+        const auto hadd = _mm256_hadd_pd( packed, packed );
+        const auto hi = _mm256_extractf128_pd( hadd, 1 );
+        const auto lo = _mm256_castpd256_pd128( hadd );
+        const auto ret = _mm_add_sd( lo, hi );
+        return _mm_cvtsd_f64( ret );
+      }
+      //! v = a * b + c (fused multiply & add)
+      //! Without FMA3 in the target isa this is a separate multiply & add.
+      nmath_inline vec4d fma( const vec4d& a, const vec4d& b, const vec4d& c )
+      {
+#ifdef NMATH_HAS_FMA
+        return _mm256_fmadd_pd( a.packed, b.packed, c.packed );
+#else
+        return _mm256_add_pd( _mm256_mul_pd( a.packed, b.packed ), c.packed );
+#endif
+      }
+      //! v = a * b - c (fused multiply & subtract)
+      //! Without FMA3 in the target isa this is a separate multiply & subtract.
+      nmath_inline vec4d fms( const vec4d& a, const vec4d& b, const vec4d& c )
+      {
+#ifdef NMATH_HAS_FMA
+        return _mm256_fmsub_pd( a.packed, b.packed, c.packed );
+#else
+        return _mm256_sub_pd( _mm256_mul_pd( a.packed, b.packed ), c.packed );
+#endif
+      }
     };
-    nmath_inline vec4d()
-    {
-      packed = _mm256_setzero_pd();
-    }
-    nmath_inline vec4d( const double value )
-    {
-      packed = _mm256_broadcast_sd( &value );
-    }
-    nmath_inline vec4d( const double* __restrict values )
-    {
-      packed = _mm256_load_pd( values );
-    }
-    nmath_inline vec4d( const __m256d& rhs ): packed( rhs )
-    {
-    }
-    nmath_inline vec4d( double _x, double _y, double _z, double _w )
-    {
-      packed = _mm256_setr_pd( _x, _y, _z, _w );
-    }
-    //! Load four 32-byte boundary aligned sample values into vector
-    nmath_inline void load( const double* __restrict values )
-    {
-      packed = _mm256_load_pd( values );
-    }
-    //! Load four unaligned sample values into vector
-    nmath_inline void loadUnaligned( const double* __restrict values )
-    {
-      packed = _mm256_loadu_pd( values );
-    }
-    //! Store four sample values from vector to 32-byte boundary aligned memory
-    //! using a non-temporal usage hint (data not reused, don't cache in SSB)
-    //! treating nontemporal data as temporal would be cache pollution = bad
-    nmath_inline void storeNontemporal( double* __restrict values )
-    {
-      _mm256_stream_pd( values, packed );
-    }
-    //! Store four sample values from vector to 32-byte boundary aligned memory
-    //! using a temporal usage hint (data is reused, maybe cache in SSB)
-    //! subsequent stores of values cached in SSB can bypass L1, L2 & memctrl = nice
-    nmath_inline void storeTemporal( double* __restrict values )
-    {
-      _mm256_store_pd( values, packed );
-    }
-    //! Store four sample values from vector to unaligned memory
-    nmath_inline void storeUnaligned( double* __restrict values )
-    {
-      _mm256_storeu_pd( values, packed );
-    }
-    //! Set all vector members to single value
-    nmath_inline void set( const double* value )
-    {
-      packed = _mm256_broadcast_sd( value );
-    }
-    //! Set vector members individually
-    nmath_inline void set( double _x, double _y, double _z, double _w )
-    {
-      packed = _mm256_setr_pd( _x, _y, _z, _w );
-    }
-    //! v = a + b
-    nmath_inline vec4d operator + ( const vec4d& rhs ) const
-    {
-      return _mm256_add_pd( packed, rhs.packed );
-    }
-    //! v = a - b
-    nmath_inline vec4d operator - ( const vec4d& rhs ) const
-    {
-      return _mm256_sub_pd( packed, rhs.packed );
-    }
-    //! v = a & b (bitwise and)
-    nmath_inline vec4d operator & ( const vec4d& rhs ) const
-    {
-      return _mm256_and_pd( packed, rhs.packed );
-    }
-    //! v = a | b (bitwise or)
-    nmath_inline vec4d operator | ( const vec4d& rhs ) const
-    {
-      return _mm256_or_pd( packed, rhs.packed );
-    }
-    //! v = a ^ b (bitwise xor)
-    nmath_inline vec4d operator ^ ( const vec4d& rhs ) const
-    {
-      return _mm256_xor_pd( packed, rhs.packed );
-    }
-    //! v = a * b
-    nmath_inline vec4d operator * ( const double scalar ) const
-    {
-      const auto im = _mm256_set1_pd( scalar );
-      return _mm256_mul_pd( packed, im );
-    }
-    //! v = a * b
-    nmath_inline vec4d operator * ( const vec4d& rhs ) const
-    {
-      return _mm256_mul_pd( packed, rhs.packed );
-    }
-    //! v = a / b
-    nmath_inline vec4d operator / ( const double scalar ) const
-    {
-      const auto im = _mm256_set1_pd( scalar );
-      return _mm256_div_pd( packed, im );
-    }
-    //! v = a / b
-    nmath_inline vec4d operator / ( const vec4d& rhs ) const
-    {
-      return _mm256_div_pd( packed, rhs.packed );
-    }
-    //! a == b
-    nmath_inline bool operator == ( const vec4d& rhs ) const
-    {
-      const auto ret = _mm256_cmp_pd( packed, rhs.packed, _CMP_NEQ_OS );
-      return ( _mm256_movemask_pd( ret ) == 0 );
-    }
-    //! a != b
-    nmath_inline bool operator != ( const vec4d& rhs ) const
-    {
-      const auto ret = _mm256_cmp_pd( packed, rhs.packed, _CMP_NEQ_OS );
-      return ( _mm256_movemask_pd( ret ) != 0 );
-    }
-    //! v = round(a)
-    nmath_inline vec4d round() const
-    {
-      return _mm256_round_pd( packed, _MM_FROUND_NINT );
-    }
-    //! v = ceil(a)
-    nmath_inline vec4d ceil() const
-    {
-      return _mm256_round_pd( packed, _MM_FROUND_CEIL );
-    }
-    //! v = floor(a)
-    nmath_inline vec4d floor() const
-    {
-      return _mm256_round_pd( packed, _MM_FROUND_FLOOR );
-    }
-    //! v = trunc(a)
-    nmath_inline vec4d trunc() const
-    {
-      return _mm256_round_pd( packed, _MM_FROUND_TRUNC );
-    }
-    //! v = sqrt(a)
-    nmath_inline vec4d sqrt() const
-    {
-      return _mm256_sqrt_pd( packed );
-    }
-    //! f = x + y + z + w
-    nmath_inline double sum() const
-    {
-      const auto hadd = _mm256_hadd_pd( packed, packed );
-      const auto hi = _mm256_extractf128_pd( hadd, 1 );
-      const auto lo = _mm256_castpd256_pd128( hadd );
-      const auto ret = _mm_add_sd( lo, hi );
-      return _mm_cvtsd_f64( ret );
-    }
-    //! v = a * b + c (fused multiply & add)
-    nmath_inline vec4d fma( const vec4d& a, const vec4d& b, const vec4d& c )
-    {
-      return _mm256_fmadd_pd( a.packed, b.packed, c.packed );
-    }
-    //! v = a * b - c (fused multiply & subtract)
-    nmath_inline vec4d fms( const vec4d& a, const vec4d& b, const vec4d& c )
+
+    //! Per-lane mask ? a : b. Only the sign bit of each mask lane is looked at,
+    //! so comparison results and plain sign tests both work.
+    nmath_inline vec4d select( const vec4d& mask, const vec4d& a, const vec4d& b )
     {
-      return _mm256_fmsub_pd( a.packed, b.packed, c.packed );
+      return _mm256_blendv_pd( b.packed, a.packed, mask.packed );
     }
-  };
+
+  }
 
 }
 
@@ -5,175 +5,355 @@
 
 namespace nmath {
 
-  nmath_16b_align class vec4f {
-  public:
-    union {
-      struct {
-        float x, y, z, w;
+  inline namespace NMATH_ISA_NAMESPACE {
+
+    class nmath_16b_align vec4f {
+    public:
+      union {
+        struct {
+          float x, y, z, w;
+        };
+        __m128 packed;
       };
-      __m128 packed;
+      nmath_inline vec4f()
+      {
+        packed = _mm_setzero_ps();
+      }
+      nmath_inline vec4f( const float value )
+      {
+        packed = _mm_set1_ps( value );
+      }
+      nmath_inline vec4f( const float* __restrict values )
+      {
+        packed = _mm_load_ps( values );
+      }
+      nmath_inline vec4f( const __m128& rhs ): packed( rhs )
+      {
+      }
+      nmath_inline vec4f( float _x, float _y, float _z, float _w )
+      {
+        packed = _mm_setr_ps( _x, _y, _z, _w );
+      }
+      //! Load four 16-byte boundary aligned sample values into vector
+      nmath_inline void load( const float* __restrict values )
+      {
+        packed = _mm_load_ps( values );
+      }
+      //! Load four unaligned sample values into vector
+      nmath_inline void loadUnaligned( const float* __restrict values )
+      {
+        packed = _mm_loadu_ps( values );
+      }
+      //! Integer lane mask with the first count lanes set, for maskload & maskstore
+      static nmath_inline __m128i tailMask( const size_t count )
+      {
+        return _mm_castps_si128( _mm_cmpgt_ps( _mm_set1_ps( static_cast<float>( count ) ), _mm_setr_ps( 0.0f, 1.0f, 2.0f, 3.0f ) ) );
+      }
+      //! Load the first count of four unaligned sample values into vector, zeroing the rest.
+      //! Memory past the first count values is never touched, so this is safe at the end of an array.
+      nmath_inline void loadPartial( const float* __restrict values, const size_t count )
+      {
+#ifdef NMATH_HAS_AVX
+        packed = _mm_maskload_ps( values, tailMask( count ) );
+#else
+        nmath_16b_align float tmp[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        for ( size_t i = 0; i < count && i < 4; ++i )
+          tmp[i] = values[i];
+        packed = _mm_load_ps( tmp );
+#endif
+      }
+      //! Store four sample values from vector to 32-byte boundary aligned memory
+      //! using a non-temporal usage hint (data not reused, don't cache in SSB)
+      //! treating nontemporal data as temporal would be cache pollution = bad
+      nmath_inline void storeNontemporal( float* __restrict values )
+      {
+        _mm_stream_ps( values, packed );
+      }
+      //! Store four sample values from vector to 32-byte boundary aligned memory
+      //! using a temporal usage hint (data is reused, maybe cache in SSB)
+      //! subsequent stores of values cached in SSB can bypass L1, L2 & memctrl = nice
+      nmath_inline void storeTemporal( float* __restrict values )
+      {
+        _mm_store_ps( values, packed );
+      }
+      //! Store four sample values from vector to unaligned memory
+      nmath_inline void storeUnaligned( float* __restrict values )
+      {
+        _mm_storeu_ps( values, packed );
+      }
+      //! Store the first count of four sample values from vector to unaligned memory.
+      //! Memory past the first count values is never touched.
+      nmath_inline void storePartial( float* __restrict values, const size_t count )
+      {
+#ifdef NMATH_HAS_AVX
+        _mm_maskstore_ps( values, tailMask( count ), packed );
+#else
+        nmath_16b_align float tmp[4];
+        _mm_store_ps( tmp, packed );
+        for ( size_t i = 0; i < count && i < 4; ++i )
+          values[i] = tmp[i];
+#endif
+      }
+      //! Set all vector members to single value
+      nmath_inline void set( const float* value )
+      {
+        packed = _mm_set1_ps( *value );
+      }
+      //! Set vector members individually
+      nmath_inline void set( float _x, float _y, float _z, float _w )
+      {
+        packed = _mm_setr_ps( _x, _y, _z, _w );
+      }
+      //! v = a + b
+      nmath_inline vec4f operator + ( const vec4f& rhs ) const
+      {
+        return _mm_add_ps( packed, rhs.packed );
+      }
+      //! v = a - b
+      nmath_inline vec4f operator - ( const vec4f& rhs ) const
+      {
+        return _mm_sub_ps( packed, rhs.packed );
+      }
+      //! v = a & b (bitwise and)
+      nmath_inline vec4f operator & ( const vec4f& rhs ) const
+      {
+        return _mm_and_ps( packed, rhs.packed );
+      }
+      //! v = a | b (bitwise or)
+      nmath_inline vec4f operator | ( const vec4f& rhs ) const
+      {
+        return _mm_or_ps( packed, rhs.packed );
+      }
+      //! v = a ^ b (bitwise xor)
+      nmath_inline vec4f operator ^ ( const vec4f& rhs ) const
+      {
+        return _mm_xor_ps( packed, rhs.packed );
+      }
+      //! v = a * b
+      nmath_inline vec4f operator * ( const float scalar ) const
+      {
+        const auto im = _mm_set1_ps( scalar );
+        return _mm_mul_ps( packed, im );
+      }
+      //! v = a * b
+      nmath_inline vec4f operator * ( const vec4f& rhs ) const
+      {
+        return _mm_mul_ps( packed, rhs.packed );
+      }
+      //! v = a / b
+      nmath_inline vec4f operator / ( const float scalar ) const
+      {
+        const auto im = _mm_set1_ps( scalar );
+        return _mm_div_ps( packed, im );
+      }
+      //! v = a / b
+      nmath_inline vec4f operator / ( const vec4f& rhs ) const
+      {
+        return _mm_div_ps( packed, rhs.packed );
+      }
+      //! a == b
+      nmath_inline bool operator == ( const vec4f& rhs ) const
+      {
+#ifdef NMATH_HAS_AVX
+        const auto ret = _mm_cmp_ps( packed, rhs.packed, _CMP_NEQ_OS );
+#else
+        // no ordered not-equal predicate before AVX, but lt | gt is one
+        const auto ret = _mm_or_ps( _mm_cmplt_ps( packed, rhs.packed ), _mm_cmpgt_ps( packed, rhs.packed ) );
+#endif
+        return ( _mm_movemask_ps( ret ) == 0 );
+      }
+      //! a != b
+      nmath_inline bool operator != ( const vec4f& rhs ) const
+      {
+#ifdef NMATH_HAS_AVX
+        const auto ret = _mm_cmp_ps( packed, rhs.packed, _CMP_NEQ_OS );
+#else
+        // no ordered not-equal predicate before AVX, but lt | gt is one
+        const auto ret = _mm_or_ps( _mm_cmplt_ps( packed, rhs.packed ), _mm_cmpgt_ps( packed, rhs.packed ) );
+#endif
+        return ( _mm_movemask_ps( ret ) != 0 );
+      }
+      //! Per-lane a < b, all bits set in lanes where true
+      nmath_inline vec4f operator < ( const vec4f& rhs ) const
+      {
+        return _mm_cmplt_ps( packed, rhs.packed );
+      }
+      //! Per-lane a <= b, all bits set in lanes where true
+      nmath_inline vec4f operator <= ( const vec4f& rhs ) const
+      {
+        return _mm_cmple_ps( packed, rhs.packed );
+      }
+      //! Per-lane a > b, all bits set in lanes where true
+      nmath_inline vec4f operator > ( const vec4f& rhs ) const
+      {
+        return _mm_cmpgt_ps( packed, rhs.packed );
+      }
+      //! Per-lane a >= b, all bits set in lanes where true
+      nmath_inline vec4f operator >= ( const vec4f& rhs ) const
+      {
+        return _mm_cmpge_ps( packed, rhs.packed );
+      }
+      //! Per-lane a == b, all bits set in lanes where true
+      //! (operator == compares the whole vector instead)
+      nmath_inline vec4f eq( const vec4f& rhs ) const
+      {
+        return _mm_cmpeq_ps( packed, rhs.packed );
+      }
+      //! Per-lane a != b, all bits set in lanes where true (NaN never equals anything)
+      //! (operator != compares the whole vector instead)
+      nmath_inline vec4f neq( const vec4f& rhs ) const
+      {
+        return _mm_cmpneq_ps( packed, rhs.packed );
+      }
+      //! Sign bits of all lanes packed into an int, lane 0 in bit 0
+      nmath_inline int bitmask() const
+      {
+        return _mm_movemask_ps( packed );
+      }
+      //! Whether any lane of a mask is set
+      nmath_inline bool any() const
+      {
+        return ( _mm_movemask_ps( packed ) != 0 );
+      }
+      //! Whether all lanes of a mask are set
+      nmath_inline bool all() const
+      {
+        return ( _mm_movemask_ps( packed ) == 0xF );
+      }
+      //! Whether no lane of a mask is set
+      nmath_inline bool none() const
+      {
+        return ( _mm_movemask_ps( packed ) == 0 );
+      }
+      //! v = round(a)
+      nmath_inline vec4f round() const
+      {
+        return _mm_round_ps( packed, _MM_FROUND_NINT );
+      }
+      //! v = ceil(a)
+      nmath_inline vec4f ceil() const
+      {
+        return _mm_round_ps( packed, _MM_FROUND_CEIL );
+      }
+      //! v = floor(a)
+      nmath_inline vec4f floor() const
+      {
+        return _mm_round_ps( packed, _MM_FROUND_FLOOR );
+      }
+      //! v = trunc(a)
+      nmath_inline vec4f trunc() const
+      {
+        return _mm_round_ps( packed, _MM_FROUND_TRUNC );
+      }
+      //! v = sqrt(a)
+      nmath_inline vec4f sqrt() const
+      {
+        return _mm_sqrt_ps( packed );
+      }
+      //! v = 1 / a, approximated & refined with Steps Newton-Raphson iterations.
+      //! Max relative error: 0 steps 3.0e-4 (~12 bits), 1 step 2.0e-7, 2 steps 1.4e-7 (~1 ulp).
+      //! Zero & infinite lanes come out as NaN once refined.
+      template <int Steps = 1>
+      nmath_inline vec4f rcp() const
+      {
+        static_assert( Steps >= 0 && Steps <= 2, "rcp supports 0 to 2 refinement steps" );
+        auto x = _mm_rcp_ps( packed );
+        for ( int i = 0; i < Steps; ++i )
+        {
+          // x' = x * ( 2 - a * x )
+#ifdef NMATH_HAS_FMA
+          x = _mm_mul_ps( x, _mm_fnmadd_ps( packed, x, _mm_set1_ps( 2.0f ) ) );
+#else
+          x = _mm_mul_ps( x, _mm_sub_ps( _mm_set1_ps( 2.0f ), _mm_mul_ps( packed, x ) ) );
+#endif
+        }
+        return x;
+      }
+      //! v = 1 / sqrt(a), approximated & refined with Steps Newton-Raphson iterations.
+      //! Max relative error: 0 steps 3.3e-4 (~12 bits), 1 step 2.7e-7, 2 steps 1.4e-7 (~1 ulp).
+      //! Zero & infinite lanes come out as NaN once refined.
+      template <int Steps = 1>
+      nmath_inline vec4f rsqrt() const
+      {
+        static_assert( Steps >= 0 && Steps <= 2, "rsqrt supports 0 to 2 refinement steps" );
+        auto y = _mm_rsqrt_ps( packed );
+        for ( int i = 0; i < Steps; ++i )
+        {
+          // y' = 0.5 * y * ( 3 - a * y * y )
+          const auto ay = _mm_mul_ps( packed, y );
+          const auto hy = _mm_mul_ps( y, _mm_set1_ps( 0.5f ) );
+#ifdef NMATH_HAS_FMA
+          y = _mm_mul_ps( hy, _mm_fnmadd_ps( ay, y, _mm_set1_ps( 3.0f ) ) );
+#else
+          y = _mm_mul_ps( hy, _mm_sub_ps( _mm_set1_ps( 3.0f ), _mm_mul_ps( ay, y ) ) );
+#endif
+        }
+        return y;
+      }
+      //! v = a / b as a * rcp<Steps>(b), see rcp for accuracy
+      template <int Steps = 1>
+      nmath_inline vec4f fastDiv( const vec4f& rhs ) const
+      {
+        return _mm_mul_ps( packed, rhs.rcp<Steps>().packed );
+      }
+      //! v = |a|
+      nmath_inline vec4f abs() const
+      {
+        return _mm_andnot_ps( _mm_set1_ps( -0.0f ), packed );
+      }
+      //! v = min(a, b), b where either is NaN
+      nmath_inline vec4f min( const vec4f& rhs ) const
+      {
+        return _mm_min_ps( packed, rhs.packed );
+      }
+      //! v = max(a, b), b where either is NaN
+      nmath_inline vec4f max( const vec4f& rhs ) const
+      {
+        return _mm_max_ps( packed, rhs.packed );
+      }
+      //! v = min(max(a, lo), hi), NaN lanes end up as lo
+      nmath_inline vec4f clamp( const vec4f& lo, const vec4f& hi ) const
+      {
+        return _mm_min_ps( _mm_max_ps( packed, lo.packed ), hi.packed );
+      }
+      //! f = x + y + z + w
+      nmath_inline float sum() const
+      {
+        // hadd_ps used to be discouraged, dunno what the consensus is today.
+        const auto tmp = _mm_hadd_ps( packed, packed );
+        const auto ret = _mm_hadd_ps( tmp, tmp );
+        return _mm_cvtss_f32( ret );
+      }
+      //! v = a * b + c (fused multiply & add)
+      //! Without FMA3 in the target isa this is a separate multiply & add.
+      nmath_inline vec4f fma( const vec4f& a, const vec4f& b, const vec4f& c )
+      {
+#ifdef NMATH_HAS_FMA
+        return _mm_fmadd_ps( a.packed, b.packed, c.packed );
+#else
+        return _mm_add_ps( _mm_mul_ps( a.packed, b.packed ), c.packed );
+#endif
+      }
+      //! v = a * b - c (fused multiply & subtract)
+      //! Without FMA3 in the target isa this is a separate multiply & subtract.
+      nmath_inline vec4f fms( const vec4f& a, const vec4f& b, const vec4f& c )
+      {
+#ifdef NMATH_HAS_FMA
+        return _mm_fmsub_ps( a.packed, b.packed, c.packed );
+#else
+        return _mm_sub_ps( _mm_mul_ps( a.packed, b.packed ), c.packed );
+#endif
+      }
     };
-    nmath_inline vec4f()
-    {
-      packed = _mm_setzero_ps();
-    }
-    nmath_inline vec4f( const float value )
-    {
-      packed = _mm_broadcast_ss( &value );
-    }
-    nmath_inline vec4f( const float* __restrict values )
-    {
-      packed = _mm_load_ps( values );
-    }
-    nmath_inline vec4f( const __m128& rhs ): packed( rhs )
-    {
-    }
-    nmath_inline vec4f( float _x, float _y, float _z, float _w )
-    {
-      packed = _mm_setr_ps( _x, _y, _z, _w );
-    }
-    //! Load four 16-byte boundary aligned sample values into vector
-    nmath_inline void load( const float* __restrict values )
-    {
-      packed = _mm_load_ps( values );
-    }
-    //! Load four unaligned sample values into vector
-    nmath_inline void loadUnaligned( const float* __restrict values )
-    {
-      packed = _mm_loadu_ps( values );
-    }
-    //! Store four sample values from vector to 32-byte boundary aligned memory
-    //! using a non-temporal usage hint (data not reused, don't cache in SSB)
-    //! treating nontemporal data as temporal would be cache pollution = bad
-    nmath_inline void storeNontemporal( float* __restrict values )
-    {
-      _mm_stream_ps( values, packed );
-    }
-    //! Store four sample values from vector to 32-byte boundary aligned memory
-    //! using a temporal usage hint (data is reused, maybe cache in SSB)
-    //! subsequent stores of values cached in SSB can bypass L1, L2 & memctrl = nice
-    nmath_inline void storeTemporal( float* __restrict values )
-    {
-      _mm_store_ps( values, packed );
-    }
-    //! Store four sample values from vector to unaligned memory
-    nmath_inline void storeUnaligned( float* __restrict values )
-    {
-      _mm_storeu_ps( values, packed );
-    }
-    //! Set all vector members to single value
-    nmath_inline void set( const float* value )
-    {
-      packed = _mm_broadcast_ss( value );
-    }
-    //! Set vector members individually
-    nmath_inline void set( float _x, float _y, float _z, float _w )
-    {
-      packed = _mm_setr_ps( _x, _y, _z, _w );
-    }
-    //! v = a + b
-    nmath_inline vec4f operator + ( const vec4f& rhs ) const
-    {
-      return _mm_add_ps( packed, rhs.packed );
-    }
-    //! v = a - b
-    nmath_inline vec4f operator - ( const vec4f& rhs ) const
-    {
-      return _mm_sub_ps( packed, rhs.packed );
-    }
-    //! v = a & b (bitwise and)
-    nmath_inline vec4f operator & ( const vec4f& rhs ) const
-    {
-      return _mm_and_ps( packed, rhs.packed );
-    }
-    //! v = a | b (bitwise or)
-    nmath_inline vec4f operator | ( const vec4f& rhs ) const
-    {
-      return _mm_or_ps( packed, rhs.packed );
-    }
-    //! v = a ^ b (bitwise xor)
-    nmath_inline vec4f operator ^ ( const vec4f& rhs ) const
-    {
-      return _mm_xor_ps( packed, rhs.packed );
-    }
-    //! v = a * b
-    nmath_inline vec4f operator * ( const float scalar ) const
-    {
-      const auto im = _mm_set1_ps( scalar );
-      return _mm_mul_ps( packed, im );
-    }
-    //! v = a * b
-    nmath_inline vec4f operator * ( const vec4f& rhs ) const
-    {
-      return _mm_mul_ps( packed, rhs.packed );
-    }
-    //! v = a / b
-    nmath_inline vec4f operator / ( const float scalar ) const
-    {
-      const auto im = _mm_set1_ps( scalar );
-      return _mm_div_ps( packed, im );
-    }
-    //! v = a / b
-    nmath_inline vec4f operator / ( const vec4f& rhs ) const
-    {
-      return _mm_div_ps( packed, rhs.packed );
-    }
-    //! a == b
-    nmath_inline bool operator == ( const vec4f& rhs ) const
-    {
-      const auto ret = _mm_cmp_ps( packed, rhs.packed, _CMP_NEQ_OS );
-      return ( _mm_movemask_ps( ret ) == 0 );
-    }
-    //! a != b
-    nmath_inline bool operator != ( const vec4f& rhs ) const
-    {
-      const auto ret = _mm_cmp_ps( packed, rhs.packed, _CMP_NEQ_OS );
-      return ( _mm_movemask_ps( ret ) != 0 );
-    }
-    //! v = round(a)
-    nmath_inline vec4f round() const
-    {
-      return _mm_round_ps( packed, _MM_FROUND_NINT );
-    }
-    //! v = ceil(a)
-    nmath_inline vec4f ceil() const
-    {
-      return _mm_round_ps( packed, _MM_FROUND_CEIL );
-    }
-    //! v = floor(a)
-    nmath_inline vec4f floor() const
-    {
-      return _mm_round_ps( packed, _MM_FROUND_FLOOR );
-    }
-    //! v = trunc(a)
-    nmath_inline vec4f trunc() const
-    {
-      return _mm_round_ps( packed, _MM_FROUND_TRUNC );
-    }
-    //! v = sqrt(a)
-    nmath_inline vec4f sqrt() const
-    {
-      return _mm_sqrt_ps( packed );
-    }
-    //! f = x + y + z + w
-    nmath_inline float sum() const
-    {
-      // hadd_ps used to be discouraged, dunno what the consensus is today.
-      const auto tmp = _mm_hadd_ps( packed, packed );
-      const auto ret = _mm_hadd_ps( tmp, tmp );
-      return _mm_cvtss_f32( ret );
-    }
-    //! v = a * b + c (fused multiply & add)
-    nmath_inline vec4f fma( const vec4f& a, const vec4f& b, const vec4f& c )
-    {
-      return _mm_fmadd_ps( a.packed, b.packed, c.packed );
-    }
-    //! v = a * b - c (fused multiply & subtract)
-    nmath_inline vec4f fms( const vec4f& a, const vec4f& b, const vec4f& c )
+
+    //! Per-lane mask ? a : b. Only the sign bit of each mask lane is looked at,
+    //! so comparison results and plain sign tests both work.
+    nmath_inline vec4f select( const vec4f& mask, const vec4f& a, const vec4f& b )
     {
-      return _mm_fmsub_ps( a.packed, b.packed, c.packed );
+      return _mm_blendv_ps( b.packed, a.packed, mask.packed );
     }
-  };
+
+  }
 
 }
 
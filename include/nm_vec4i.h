@@ -0,0 +1,248 @@
+#ifndef NM_VEC4I_H
+#define NM_VEC4I_H
+
+#include "nm_common.h"
+#include "nm_vec4f.h"
+
+namespace nmath {
+
+  inline namespace NMATH_ISA_NAMESPACE {
+
+    class nmath_16b_align vec4i {
+    public:
+      union {
+        struct {
+          int32_t x, y, z, w;
+        };
+        __m128i packed;
+      };
+      nmath_inline vec4i()
+      {
+        packed = _mm_setzero_si128();
+      }
+      nmath_inline vec4i( const int32_t value )
+      {
+        packed = _mm_set1_epi32( value );
+      }
+      nmath_inline vec4i( const int32_t* __restrict values )
+      {
+        packed = _mm_load_si128( reinterpret_cast<const __m128i*>( values ) );
+      }
+      nmath_inline vec4i( const __m128i& rhs ): packed( rhs )
+      {
+      }
+      nmath_inline vec4i( int32_t _x, int32_t _y, int32_t _z, int32_t _w )
+      {
+        packed = _mm_setr_epi32( _x, _y, _z, _w );
+      }
+      //! v = (int)round(a), rounding to nearest even like the current MXCSR mode
+      static nmath_inline vec4i convert( const vec4f& rhs )
+      {
+        return _mm_cvtps_epi32( rhs.packed );
+      }
+      //! v = (int)a, rounding towards zero like a C cast
+      static nmath_inline vec4i truncate( const vec4f& rhs )
+      {
+        return _mm_cvttps_epi32( rhs.packed );
+      }
+      //! Reinterpret the bits of a float vector as integers, no conversion
+      static nmath_inline vec4i bitcast( const vec4f& rhs )
+      {
+        return _mm_castps_si128( rhs.packed );
+      }
+      //! v = (float)a
+      nmath_inline vec4f toFloat() const
+      {
+        return _mm_cvtepi32_ps( packed );
+      }
+      //! Reinterpret the bits as a float vector, no conversion
+      nmath_inline vec4f asFloat() const
+      {
+        return _mm_castsi128_ps( packed );
+      }
+      //! Load four 16-byte boundary aligned values into vector
+      nmath_inline void load( const int32_t* __restrict values )
+      {
+        packed = _mm_load_si128( reinterpret_cast<const __m128i*>( values ) );
+      }
+      //! Load four unaligned values into vector
+      nmath_inline void loadUnaligned( const int32_t* __restrict values )
+      {
+        packed = _mm_loadu_si128( reinterpret_cast<const __m128i*>( values ) );
+      }
+      //! Store four values from vector to 16-byte boundary aligned memory
+      //! using a non-temporal usage hint (data not reused, don't cache in SSB)
+      nmath_inline void storeNontemporal( int32_t* __restrict values )
+      {
+        _mm_stream_si128( reinterpret_cast<__m128i*>( values ), packed );
+      }
+      //! Store four values from vector to 16-byte boundary aligned memory
+      //! using a temporal usage hint (data is reused, maybe cache in SSB)
+      nmath_inline void storeTemporal( int32_t* __restrict values )
+      {
+        _mm_store_si128( reinterpret_cast<__m128i*>( values ), packed );
+      }
+      //! Store four values from vector to unaligned memory
+      nmath_inline void storeUnaligned( int32_t* __restrict values )
+      {
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( values ), packed );
+      }
+      //! Set all vector members to single value
+      nmath_inline void set( const int32_t* value )
+      {
+        packed = _mm_set1_epi32( *value );
+      }
+      //! Set vector members individually
+      nmath_inline void set( int32_t _x, int32_t _y, int32_t _z, int32_t _w )
+      {
+        packed = _mm_setr_epi32( _x, _y, _z, _w );
+      }
+      //! v = a + b (wrapping)
+      nmath_inline vec4i operator + ( const vec4i& rhs ) const
+      {
+        return _mm_add_epi32( packed, rhs.packed );
+      }
+      //! v = a - b (wrapping)
+      nmath_inline vec4i operator - ( const vec4i& rhs ) const
+      {
+        return _mm_sub_epi32( packed, rhs.packed );
+      }
+      //! v = a * b (low 32 bits of the product)
+      nmath_inline vec4i operator * ( const vec4i& rhs ) const
+      {
+        return _mm_mullo_epi32( packed, rhs.packed );
+      }
+      //! v = a & b (bitwise and)
+      nmath_inline vec4i operator & ( const vec4i& rhs ) const
+      {
+        return _mm_and_si128( packed, rhs.packed );
+      }
+      //! v = a | b (bitwise or)
+      nmath_inline vec4i operator | ( const vec4i& rhs ) const
+      {
+        return _mm_or_si128( packed, rhs.packed );
+      }
+      //! v = a ^ b (bitwise xor)
+      nmath_inline vec4i operator ^ ( const vec4i& rhs ) const
+      {
+        return _mm_xor_si128( packed, rhs.packed );
+      }
+      //! v = a << n
+      nmath_inline vec4i operator << ( const int count ) const
+      {
+        return _mm_sll_epi32( packed, _mm_cvtsi32_si128( count ) );
+      }
+      //! v = a >> n (arithmetic, sign-extending)
+      nmath_inline vec4i operator >> ( const int count ) const
+      {
+        return _mm_sra_epi32( packed, _mm_cvtsi32_si128( count ) );
+      }
+      //! v = a >> n (logical, shifting in zeroes)
+      nmath_inline vec4i shiftRightLogical( const int count ) const
+      {
+        return _mm_srl_epi32( packed, _mm_cvtsi32_si128( count ) );
+      }
+      //! a == b
+      nmath_inline bool operator == ( const vec4i& rhs ) const
+      {
+        const auto ret = _mm_cmpeq_epi32( packed, rhs.packed );
+        return ( _mm_movemask_ps( _mm_castsi128_ps( ret ) ) == 0xF );
+      }
+      //! a != b
+      nmath_inline bool operator != ( const vec4i& rhs ) const
+      {
+        const auto ret = _mm_cmpeq_epi32( packed, rhs.packed );
+        return ( _mm_movemask_ps( _mm_castsi128_ps( ret ) ) != 0xF );
+      }
+      //! Per-lane a < b, all bits set in lanes where true
+      nmath_inline vec4i operator < ( const vec4i& rhs ) const
+      {
+        return _mm_cmplt_epi32( packed, rhs.packed );
+      }
+      //! Per-lane a <= b, all bits set in lanes where true
+      nmath_inline vec4i operator <= ( const vec4i& rhs ) const
+      {
+        return _mm_xor_si128( _mm_cmpgt_epi32( packed, rhs.packed ), _mm_set1_epi32( -1 ) );
+      }
+      //! Per-lane a > b, all bits set in lanes where true
+      nmath_inline vec4i operator > ( const vec4i& rhs ) const
+      {
+        return _mm_cmpgt_epi32( packed, rhs.packed );
+      }
+      //! Per-lane a >= b, all bits set in lanes where true
+      nmath_inline vec4i operator >= ( const vec4i& rhs ) const
+      {
+        return _mm_xor_si128( _mm_cmplt_epi32( packed, rhs.packed ), _mm_set1_epi32( -1 ) );
+      }
+      //! Per-lane a == b, all bits set in lanes where true
+      //! (operator == compares the whole vector instead)
+      nmath_inline vec4i eq( const vec4i& rhs ) const
+      {
+        return _mm_cmpeq_epi32( packed, rhs.packed );
+      }
+      //! Per-lane a != b, all bits set in lanes where true
+      //! (operator != compares the whole vector instead)
+      nmath_inline vec4i neq( const vec4i& rhs ) const
+      {
+        return _mm_xor_si128( _mm_cmpeq_epi32( packed, rhs.packed ), _mm_set1_epi32( -1 ) );
+      }
+      //! Sign bits of all lanes packed into an int, lane 0 in bit 0
+      nmath_inline int bitmask() const
+      {
+        return _mm_movemask_ps( _mm_castsi128_ps( packed ) );
+      }
+      //! Whether any lane of a mask is set
+      nmath_inline bool any() const
+      {
+        return ( bitmask() != 0 );
+      }
+      //! Whether all lanes of a mask are set
+      nmath_inline bool all() const
+      {
+        return ( bitmask() == 0xF );
+      }
+      //! Whether no lane of a mask is set
+      nmath_inline bool none() const
+      {
+        return ( bitmask() == 0 );
+      }
+      //! v = |a|, INT32_MIN stays INT32_MIN
+      nmath_inline vec4i abs() const
+      {
+        return _mm_abs_epi32( packed );
+      }
+      //! v = min(a, b)
+      nmath_inline vec4i min( const vec4i& rhs ) const
+      {
+        return _mm_min_epi32( packed, rhs.packed );
+      }
+      //! v = max(a, b)
+      nmath_inline vec4i max( const vec4i& rhs ) const
+      {
+        return _mm_max_epi32( packed, rhs.packed );
+      }
+      //! v = min(max(a, lo), hi)
+      nmath_inline vec4i clamp( const vec4i& lo, const vec4i& hi ) const
+      {
+        return _mm_min_epi32( _mm_max_epi32( packed, lo.packed ), hi.packed );
+      }
+      //! i = x + y + z + w (wrapping)
+      nmath_inline int32_t sum() const
+      {
+        const auto tmp = _mm_add_epi32( packed, _mm_shuffle_epi32( packed, _MM_SHUFFLE( 1, 0, 3, 2 ) ) );
+        const auto ret = _mm_add_epi32( tmp, _mm_shuffle_epi32( tmp, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+        return _mm_cvtsi128_si32( ret );
+      }
+    };
+
+    //! Per-lane mask ? a : b. Only the sign bit of each mask lane is looked at.
+    nmath_inline vec4i select( const vec4i& mask, const vec4i& a, const vec4i& b )
+    {
+      return _mm_castps_si128( _mm_blendv_ps( _mm_castsi128_ps( b.packed ), _mm_castsi128_ps( a.packed ), _mm_castsi128_ps( mask.packed ) ) );
+    }
+
+  }
+
+}
+
+#endif
@@ -2,228 +2,389 @@
 #define NM_VEC8F_H
 
 #include "nm_common.h"
+#include "nm_vec4f.h"
+
+#ifndef NMATH_HAS_AVX
+# error "nm_vec8f.h needs AVX: build this translation unit with -mavx, /arch:AVX or higher. Only vec4f & vec4i work at the SSE4.1 level."
+#endif
 
 namespace nmath {
 
-  nmath_32b_align class vec8f {
-  public:
-    union {
-      struct {
-        float e0, e1, e2, e3, e4, e5, e6, e7;
+  inline namespace NMATH_ISA_NAMESPACE {
+
+    class nmath_32b_align vec8f {
+    public:
+      union {
+        struct {
+          float e0, e1, e2, e3, e4, e5, e6, e7;
+        };
+        __m256 packed;
       };
-      __m256 packed;
+      nmath_inline vec8f()
+      {
+        packed = _mm256_setzero_ps();
+      }
+      nmath_inline vec8f( const float value )
+      {
+        packed = _mm256_broadcast_ss( &value );
+      }
+      nmath_inline vec8f( const float* __restrict values )
+      {
+        packed = _mm256_load_ps( values );
+      }
+      nmath_inline vec8f( const __m256& rhs ): packed( rhs )
+      {
+      }
+      nmath_inline vec8f( float _e0, float _e1, float _e2, float _e3, float _e4, float _e5, float _e6, float _e7 )
+      {
+        packed = _mm256_setr_ps( _e0, _e1, _e2, _e3, _e4, _e5, _e6, _e7 );
+      }
+      nmath_inline vec8f( const vec4f& lo, const vec4f& hi )
+      {
+        packed = _mm256_insertf128_ps( _mm256_castps128_ps256( lo.packed ), ( hi.packed ), 1 );
+      }
+      //! Load eight 32-byte boundary aligned sample values into vector
+      nmath_inline void load( const float* __restrict values )
+      {
+        packed = _mm256_load_ps( values );
+      }
+      //! Load eight unaligned sample values into vector
+      nmath_inline void loadUnaligned( const float* __restrict values )
+      {
+        packed = _mm256_loadu_ps( values );
+      }
+      //! Integer lane mask with the first count lanes set, for maskload & maskstore
+      static nmath_inline __m256i tailMask( const size_t count )
+      {
+        return _mm256_castps_si256( _mm256_cmp_ps( _mm256_set1_ps( static_cast<float>( count ) ), _mm256_setr_ps( 0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f ), _CMP_GT_OQ ) );
+      }
+      //! Load the first count of eight unaligned sample values into vector, zeroing the rest.
+      //! Memory past the first count values is never touched, so this is safe at the end of an array.
+      nmath_inline void loadPartial( const float* __restrict values, const size_t count )
+      {
+        packed = _mm256_maskload_ps( values, tailMask( count ) );
+      }
+      //! Store eight sample values from vector to 32-byte boundary aligned memory
+      //! using a non-temporal usage hint (data not reused, don't cache in SSB)
+      //! treating nontemporal data as temporal would be cache pollution = bad
+      nmath_inline void storeNontemporal( float* __restrict values )
+      {
+        _mm256_stream_ps( values, packed );
+      }
+      //! Store eight sample values from vector to 32-byte boundary aligned memory
+      //! using a temporal usage hint (data is reused, maybe cache in SSB)
+      //! subsequent stores of values cached in SSB can bypass L1, L2 & memctrl = nice
+      nmath_inline void storeTemporal( float* __restrict values )
+      {
+        _mm256_store_ps( values, packed );
+      }
+      //! Store eight sample values from vector to unaligned memory
+      nmath_inline void storeUnaligned( float* __restrict values )
+      {
+        _mm256_storeu_ps( values, packed );
+      }
+      //! Store the first count of eight sample values from vector to unaligned memory.
+      //! Memory past the first count values is never touched.
+      nmath_inline void storePartial( float* __restrict values, const size_t count )
+      {
+        _mm256_maskstore_ps( values, tailMask( count ), packed );
+      }
+      //! Set all vector members to single value
+      nmath_inline void set( const float* value )
+      {
+        packed = _mm256_broadcast_ss( value );
+      }
+      //! Set vector members individually
+      nmath_inline void set( float _e0, float _e1, float _e2, float _e3, float _e4, float _e5, float _e6, float _e7 )
+      {
+        packed = _mm256_setr_ps( _e0, _e1, _e2, _e3, _e4, _e5, _e6, _e7 );
+      }
+      //! v = a + b
+      nmath_inline vec8f operator + ( const vec8f& rhs ) const
+      {
+        return _mm256_add_ps( packed, rhs.packed );
+      }
+      //! v = a - b
+      nmath_inline vec8f operator - ( const vec8f& rhs ) const
+      {
+        return _mm256_sub_ps( packed, rhs.packed );
+      }
+      //! v = a & b (bitwise and)
+      nmath_inline vec8f operator & ( const vec8f& rhs ) const
+      {
+        return _mm256_and_ps( packed, rhs.packed );
+      }
+      //! v = a | b (bitwise or)
+      nmath_inline vec8f operator | ( const vec8f& rhs ) const
+      {
+        return _mm256_or_ps( packed, rhs.packed );
+      }
+      //! v = a ^ b (bitwise xor)
+      nmath_inline vec8f operator ^ ( const vec8f& rhs ) const
+      {
+        return _mm256_xor_ps( packed, rhs.packed );
+      }
+      //! v = a * b
+      nmath_inline vec8f operator * ( const float scalar ) const
+      {
+        const auto im = _mm256_set1_ps( scalar );
+        return _mm256_mul_ps( packed, im );
+      }
+      //! v = a * b
+      nmath_inline vec8f operator * ( const vec8f& rhs ) const
+      {
+        return _mm256_mul_ps( packed, rhs.packed );
+      }
+      //! v = a / b
+      nmath_inline vec8f operator / ( const float scalar ) const
+      {
+        const auto im = _mm256_set1_ps( scalar );
+        return _mm256_div_ps( packed, im );
+      }
+      //! v = a / b
+      nmath_inline vec8f operator / ( const vec8f& rhs ) const
+      {
+        return _mm256_div_ps( packed, rhs.packed );
+      }
+      //! a == b
+      nmath_inline bool operator == ( const vec8f& rhs ) const
+      {
+        const auto ret = _mm256_cmp_ps( packed, rhs.packed, _CMP_NEQ_OS );
+        return ( _mm256_movemask_ps( ret ) == 0 );
+      }
+      //! a != b
+      nmath_inline bool operator != ( const vec8f& rhs ) const
+      {
+        const auto ret = _mm256_cmp_ps( packed, rhs.packed, _CMP_NEQ_OS );
+        return ( _mm256_movemask_ps( ret ) != 0 );
+      }
+      //! Per-lane a < b, all bits set in lanes where true
+      nmath_inline vec8f operator < ( const vec8f& rhs ) const
+      {
+        return _mm256_cmp_ps( packed, rhs.packed, _CMP_LT_OQ );
+      }
+      //! Per-lane a <= b, all bits set in lanes where true
+      nmath_inline vec8f operator <= ( const vec8f& rhs ) const
+      {
+        return _mm256_cmp_ps( packed, rhs.packed, _CMP_LE_OQ );
+      }
+      //! Per-lane a > b, all bits set in lanes where true
+      nmath_inline vec8f operator > ( const vec8f& rhs ) const
+      {
+        return _mm256_cmp_ps( packed, rhs.packed, _CMP_GT_OQ );
+      }
+      //! Per-lane a >= b, all bits set in lanes where true
+      nmath_inline vec8f operator >= ( const vec8f& rhs ) const
+      {
+        return _mm256_cmp_ps( packed, rhs.packed, _CMP_GE_OQ );
+      }
+      //! Per-lane a == b, all bits set in lanes where true
+      //! (operator == compares the whole vector instead)
+      nmath_inline vec8f eq( const vec8f& rhs ) const
+      {
+        return _mm256_cmp_ps( packed, rhs.packed, _CMP_EQ_OQ );
+      }
+      //! Per-lane a != b, all bits set in lanes where true (NaN never equals anything)
+      //! (operator != compares the whole vector instead)
+      nmath_inline vec8f neq( const vec8f& rhs ) const
+      {
+        return _mm256_cmp_ps( packed, rhs.packed, _CMP_NEQ_UQ );
+      }
+      //! Sign bits of all lanes packed into an int, lane 0 in bit 0
+      nmath_inline int bitmask() const
+      {
+        return _mm256_movemask_ps( packed );
+      }
+      //! Whether any lane of a mask is set
+      nmath_inline bool any() const
+      {
+        return ( _mm256_movemask_ps( packed ) != 0 );
+      }
+      //! Whether all lanes of a mask are set
+      nmath_inline bool all() const
+      {
+        return ( _mm256_movemask_ps( packed ) == 0xFF );
+      }
+      //! Whether no lane of a mask is set
+      nmath_inline bool none() const
+      {
+        return ( _mm256_movemask_ps( packed ) == 0 );
+      }
+      //! v = round(a)
+      nmath_inline vec8f round() const
+      {
+        return _mm256_round_ps( packed, _MM_FROUND_NINT );
+      }
+      //! v = ceil(a)
+      nmath_inline vec8f ceil() const
+      {
+        return _mm256_round_ps( packed, _MM_FROUND_CEIL );
+      }
+      //! v = floor(a)
+      nmath_inline vec8f floor() const
+      {
+        return _mm256_round_ps( packed, _MM_FROUND_FLOOR );
+      }
+      //! v = trunc(a)
+      nmath_inline vec8f trunc() const
+      {
+        return _mm256_round_ps( packed, _MM_FROUND_TRUNC );
+      }
+      //! v = sqrt(a)
+      nmath_inline vec8f sqrt() const
+      {
+        return _mm256_sqrt_ps( packed );
+      }
+      //! v = 1 / a, approximated & refined with Steps Newton-Raphson iterations.
+      //! Max relative error: 0 steps 3.0e-4 (~12 bits), 1 step 2.0e-7, 2 steps 1.4e-7 (~1 ulp).
+      //! Zero & infinite lanes come out as NaN once refined.
+      template <int Steps = 1>
+      nmath_inline vec8f rcp() const
+      {
+        static_assert( Steps >= 0 && Steps <= 2, "rcp supports 0 to 2 refinement steps" );
+        auto x = _mm256_rcp_ps( packed );
+        for ( int i = 0; i < Steps; ++i )
+        {
+          // x' = x * ( 2 - a * x )
+#ifdef NMATH_HAS_FMA
+          x = _mm256_mul_ps( x, _mm256_fnmadd_ps( packed, x, _mm256_set1_ps( 2.0f ) ) );
+#else
+          x = _mm256_mul_ps( x, _mm256_sub_ps( _mm256_set1_ps( 2.0f ), _mm256_mul_ps( packed, x ) ) );
+#endif
+        }
+        return x;
+      }
+      //! v = 1 / sqrt(a), approximated & refined with Steps Newton-Raphson iterations.
+      //! Max relative error: 0 steps 3.3e-4 (~12 bits), 1 step 2.7e-7, 2 steps 1.4e-7 (~1 ulp).
+      //! Zero & infinite lanes come out as NaN once refined.
+      template <int Steps = 1>
+      nmath_inline vec8f rsqrt() const
+      {
+        static_assert( Steps >= 0 && Steps <= 2, "rsqrt supports 0 to 2 refinement steps" );
+        auto y = _mm256_rsqrt_ps( packed );
+        for ( int i = 0; i < Steps; ++i )
+        {
+          // y' = 0.5 * y * ( 3 - a * y * y )
+          const auto ay = _mm256_mul_ps( packed, y );
+          const auto hy = _mm256_mul_ps( y, _mm256_set1_ps( 0.5f ) );
+#ifdef NMATH_HAS_FMA
+          y = _mm256_mul_ps( hy, _mm256_fnmadd_ps( ay, y, _mm256_set1_ps( 3.0f ) ) );
+#else
+          y = _mm256_mul_ps( hy, _mm256_sub_ps( _mm256_set1_ps( 3.0f ), _mm256_mul_ps( ay, y ) ) );
+#endif
+        }
+        return y;
+      }
+      //! v = a / b as a * rcp<Steps>(b), see rcp for accuracy
+      template <int Steps = 1>
+      nmath_inline vec8f fastDiv( const vec8f& rhs ) const
+      {
+        return _mm256_mul_ps( packed, rhs.rcp<Steps>().packed );
+      }
+      //! v = |a|
+      nmath_inline vec8f abs() const
+      {
+        return _mm256_andnot_ps( _mm256_set1_ps( -0.0f ), packed );
+      }
+      //! v = min(a, b), b where either is NaN
+      nmath_inline vec8f min( const vec8f& rhs ) const
+      {
+        return _mm256_min_ps( packed, rhs.packed );
+      }
+      //! v = max(a, b), b where either is NaN
+      nmath_inline vec8f max( const vec8f& rhs ) const
+      {
+        return _mm256_max_ps( packed, rhs.packed );
+      }
+      //! v = min(max(a, lo), hi), NaN lanes end up as lo
+      nmath_inline vec8f clamp( const vec8f& lo, const vec8f& hi ) const
+      {
+        return _mm256_min_ps( _mm256_max_ps( packed, lo.packed ), hi.packed );
+      }
+      //! f = e0 + e1 + e2 + e3 + e4 + e5 + e6 + e7
+      nmath_inline float sum() const
+      {
+        // this would be much more compact using permute2f128_ps and hadd_ps,
+        // but that combo is (or used to be?) less performant.
+        const auto hi = _mm256_extractf128_ps( packed, 1 );
+        const auto lo = _mm256_castps256_ps128( packed );
+        const auto qsum = _mm_add_ps( lo, hi );
+        const auto dlo = qsum;
+        const auto dhi = _mm_movehl_ps( qsum, qsum );
+        const auto dsum = _mm_add_ps( dlo, dhi );
+        const auto rlo = dsum;
+        const auto rhi = _mm_shuffle_ps( dsum, dsum, 1 );
+        const auto rsum = _mm_add_ss( rlo, rhi );
+        return _mm_cvtss_f32( rsum );
+      }
+      //! Distribute each of the 8 elements into blocks of four:
+      //! [1,2,3,4,5,6,7,8]
+      //! =>
+      //! a [1,1,1,1,2,2,2,2]
+      //! b [3,3,3,3,4,4,4,4]
+      //! c [5,5,5,5,6,6,6,6]
+      //! d [7,7,7,7,8,8,8,8]
+      nmath_inline void unpack8x4( vec8f& a, vec8f& b, vec8f& c, vec8f& d )
+      {
+        const auto hipart = _mm256_extractf128_ps( packed, 1 );
+        const auto lopart = _mm256_castps256_ps128( packed );
+        auto d0 = _mm_permute_ps( lopart, 0b00000000 );
+        auto d1 = _mm_permute_ps( lopart, 0b01010101 );
+        auto dummy256 = _mm256_castps128_ps256( d0 );
+        a.packed = _mm256_insertf128_ps( dummy256, d1, 1 );
+        d0 = _mm_permute_ps( lopart, 0b10101010 );
+        d1 = _mm_permute_ps( lopart, 0b11111111 );
+        dummy256 = _mm256_castps128_ps256( d0 );
+        b.packed = _mm256_insertf128_ps( dummy256, d1, 1 );
+        d0 = _mm_permute_ps( hipart, 0b00000000 );
+        d1 = _mm_permute_ps( hipart, 0b01010101 );
+        dummy256 = _mm256_castps128_ps256( d0 );
+        c.packed = _mm256_insertf128_ps( dummy256, d1, 1 );
+        d0 = _mm_permute_ps( hipart, 0b10101010 );
+        d1 = _mm_permute_ps( hipart, 0b11111111 );
+        dummy256 = _mm256_castps128_ps256( d0 );
+        d.packed = _mm256_insertf128_ps( dummy256, d1, 1 );
+      }
+      //! v = a * b + c (fused multiply & add)
+      //! Without FMA3 in the target isa this is a separate multiply & add.
+      nmath_inline vec8f fma( const vec8f& a, const vec8f& b, const vec8f& c )
+      {
+#ifdef NMATH_HAS_FMA
+        return _mm256_fmadd_ps( a.packed, b.packed, c.packed );
+#else
+        return _mm256_add_ps( _mm256_mul_ps( a.packed, b.packed ), c.packed );
+#endif
+      }
+      //! v = a * b - c (fused multiply & subtract)
+      //! Without FMA3 in the target isa this is a separate multiply & subtract.
+      nmath_inline vec8f fms( const vec8f& a, const vec8f& b, const vec8f& c )
+      {
+#ifdef NMATH_HAS_FMA
+        return _mm256_fmsub_ps( a.packed, b.packed, c.packed );
+#else
+        return _mm256_sub_ps( _mm256_mul_ps( a.packed, b.packed ), c.packed );
+#endif
+      }
+      //! Extract the lower vec4
+      nmath_inline vec4f low()
+      {
+        return vec4f( _mm256_castps256_ps128( packed ) );
+      }
+      //! Extract the higher vec4
+      nmath_inline vec4f high()
+      {
+        return vec4f( _mm256_extractf128_ps( packed, 1 ) );
+      }
     };
-    nmath_inline vec8f()
-    {
-      packed = _mm256_setzero_ps();
-    }
-    nmath_inline vec8f( const float value )
-    {
-      packed = _mm256_broadcast_ss( &value );
-    }
-    nmath_inline vec8f( const float* __restrict values )
-    {
-      packed = _mm256_load_ps( values );
-    }
-    nmath_inline vec8f( const __m256& rhs ): packed( rhs )
-    {
-    }
-    nmath_inline vec8f( float _e0, float _e1, float _e2, float _e3, float _e4, float _e5, float _e6, float _e7 )
-    {
-      packed = _mm256_setr_ps( _e0, _e1, _e2, _e3, _e4, _e5, _e6, _e7 );
-    }
-    nmath_inline vec8f( const vec4f& lo, const vec4f& hi )
-    {
-      packed = _mm256_insertf128_ps( _mm256_castps128_ps256( lo.packed ), ( hi.packed ), 1 );
-    }
-    //! Load eight 32-byte boundary aligned sample values into vector
-    nmath_inline void load( const float* __restrict values )
-    {
-      packed = _mm256_load_ps( values );
-    }
-    //! Load eight unaligned sample values into vector
-    nmath_inline void loadUnaligned( const float* __restrict values )
-    {
-      packed = _mm256_loadu_ps( values );
-    }
-    //! Store eight sample values from vector to 32-byte boundary aligned memory
-    //! using a non-temporal usage hint (data not reused, don't cache in SSB)
-    //! treating nontemporal data as temporal would be cache pollution = bad
-    nmath_inline void storeNontemporal( float* __restrict values )
-    {
-      _mm256_stream_ps( values, packed );
-    }
-    //! Store eight sample values from vector to 32-byte boundary aligned memory
-    //! using a temporal usage hint (data is reused, maybe cache in SSB)
-    //! subsequent stores of values cached in SSB can bypass L1, L2 & memctrl = nice
-    nmath_inline void storeTemporal( float* __restrict values )
-    {
-      _mm256_store_ps( values, packed );
-    }
-    //! Store eight sample values from vector to unaligned memory
-    nmath_inline void storeUnaligned( float* __restrict values )
-    {
-      _mm256_storeu_ps( values, packed );
-    }
-    //! Set all vector members to single value
-    nmath_inline void set( const float* value )
-    {
-      packed = _mm256_broadcast_ss( value );
-    }
-    //! Set vector members individually
-    nmath_inline void set( float _e0, float _e1, float _e2, float _e3, float _e4, float _e5, float _e6, float _e7 )
-    {
-      packed = _mm256_setr_ps( _e0, _e1, _e2, _e3, _e4, _e5, _e6, _e7 );
-    }
-    //! v = a + b
-    nmath_inline vec8f operator + ( const vec8f& rhs ) const
-    {
-      return _mm256_add_ps( packed, rhs.packed );
-    }
-    //! v = a - b
-    nmath_inline vec8f operator - ( const vec8f& rhs ) const
-    {
-      return _mm256_sub_ps( packed, rhs.packed );
-    }
-    //! v = a & b (bitwise and)
-    nmath_inline vec8f operator & ( const vec8f& rhs ) const
-    {
-      return _mm256_and_ps( packed, rhs.packed );
-    }
-    //! v = a | b (bitwise or)
-    nmath_inline vec8f operator | ( const vec8f& rhs ) const
-    {
-      return _mm256_or_ps( packed, rhs.packed );
-    }
-    //! v = a ^ b (bitwise xor)
-    nmath_inline vec8f operator ^ ( const vec8f& rhs ) const
-    {
-      return _mm256_xor_ps( packed, rhs.packed );
-    }
-    //! v = a * b
-    nmath_inline vec8f operator * ( const float scalar ) const
-    {
-      const auto im = _mm256_set1_ps( scalar );
-      return _mm256_mul_ps( packed, im );
-    }
-    //! v = a * b
-    nmath_inline vec8f operator * ( const vec8f& rhs ) const
-    {
-      return _mm256_mul_ps( packed, rhs.packed );
-    }
-    //! v = a / b
-    nmath_inline vec8f operator / ( const float scalar ) const
-    {
-      const auto im = _mm256_set1_ps( scalar );
-      return _mm256_div_ps( packed, im );
-    }
-    //! v = a / b
-    nmath_inline vec8f operator / ( const vec8f& rhs ) const
-    {
-      return _mm256_div_ps( packed, rhs.packed );
-    }
-    //! a == b
-    nmath_inline bool operator == ( const vec8f& rhs ) const
-    {
-      const auto ret = _mm256_cmp_ps( packed, rhs.packed, _CMP_NEQ_OS );
-      return ( _mm256_movemask_ps( ret ) == 0 );
-    }
-    //! a != b
-    nmath_inline bool operator != ( const vec8f& rhs ) const
-    {
-      const auto ret = _mm256_cmp_ps( packed, rhs.packed, _CMP_NEQ_OS );
-      return ( _mm256_movemask_ps( ret ) != 0 );
-    }
-    //! v = round(a)
-    nmath_inline vec8f round() const
-    {
-      return _mm256_round_ps( packed, _MM_FROUND_NINT );
-    }
-    //! v = ceil(a)
-    nmath_inline vec8f ceil() const
-    {
-      return _mm256_round_ps( packed, _MM_FROUND_CEIL );
-    }
-    //! v = floor(a)
-    nmath_inline vec8f floor() const
-    {
-      return _mm256_round_ps( packed, _MM_FROUND_FLOOR );
-    }
-    //! v = trunc(a)
-    nmath_inline vec8f trunc() const
-    {
-      return _mm256_round_ps( packed, _MM_FROUND_TRUNC );
-    }
-    //! v = sqrt(a)
-    nmath_inline vec8f sqrt() const
-    {
-      return _mm256_sqrt_ps( packed );
-    }
-    //! f = e0 + e1 + e2 + e3 + e4 + e5 + e6 + e7
-    nmath_inline float sum() const
-    {
-      // this would be much more compact using permute2f128_ps and hadd_ps,
-      // but that combo is (or used to be?) less performant.
-      const auto hi = _mm256_extractf128_ps( packed, 1 );
-      const auto lo = _mm256_castps256_ps128( packed );
-      const auto qsum = _mm_add_ps( lo, hi );
-      const auto dlo = qsum;
-      const auto dhi = _mm_movehl_ps( qsum, qsum );
-      const auto dsum = _mm_add_ps( dlo, dhi );
-      const auto rlo = dsum;
-      const auto rhi = _mm_shuffle_ps( dsum, dsum, 1 );
-      const auto rsum = _mm_add_ss( rlo, rhi );
-      return _mm_cvtss_f32( rsum );
-    }
-    //! Distribute each of the 8 elements into blocks of four:
-    //! [1,2,3,4,5,6,7,8]
-    //! =>
-    //! a [1,1,1,1,2,2,2,2]
-    //! b [3,3,3,3,4,4,4,4]
-    //! c [5,5,5,5,6,6,6,6]
-    //! d [7,7,7,7,8,8,8,8]
-    nmath_inline void unpack8x4( vec8f& a, vec8f& b, vec8f& c, vec8f& d )
-    {
-      const auto hipart = _mm256_extractf128_ps( packed, 1 );
-      const auto lopart = _mm256_castps256_ps128( packed );
-      auto d0 = _mm_permute_ps( lopart, 0b00000000 );
-      auto d1 = _mm_permute_ps( lopart, 0b01010101 );
-      auto dummy256 = _mm256_castps128_ps256( d0 );
-      a.packed = _mm256_insertf128_ps( dummy256, d1, 1 );
-      d0 = _mm_permute_ps( lopart, 0b10101010 );
-      d1 = _mm_permute_ps( lopart, 0b11111111 );
-      dummy256 = _mm256_castps128_ps256( d0 );
-      b.packed = _mm256_insertf128_ps( dummy256, d1, 1 );
-      d0 = _mm_permute_ps( hipart, 0b00000000 );
-      d1 = _mm_permute_ps( hipart, 0b01010101 );
-      dummy256 = _mm256_castps128_ps256( d0 );
-      c.packed = _mm256_insertf128_ps( dummy256, d1, 1 );
-      d0 = _mm_permute_ps( hipart, 0b10101010 );
-      d1 = _mm_permute_ps( hipart, 0b11111111 );
-      dummy256 = _mm256_castps128_ps256( d0 );
-      d.packed = _mm256_insertf128_ps( dummy256, d1, 1 );
-    }
-    //! v = a * b + c (fused multiply & add)
-    nmath_inline vec8f fma( const vec8f& a, const vec8f& b, const vec8f& c )
-    {
-      return _mm256_fmadd_ps( a.packed, b.packed, c.packed );
-    }
-    //! v = a * b - c (fused multiply & subtract)
-    nmath_inline vec8f fms( const vec8f& a, const vec8f& b, const vec8f& c )
-    {
-      return _mm256_fmsub_ps( a.packed, b.packed, c.packed );
-    }
-    //! Extract the lower vec4
-    nmath_inline vec4f low()
-    {
-      return vec4f( _mm256_castps256_ps128( packed ) );
-    }
-    //! Extract the higher vec4
-    nmath_inline vec4f high()
+
+    //! Per-lane mask ? a : b. Only the sign bit of each mask lane is looked at,
+    //! so comparison results and plain sign tests both work.
+    nmath_inline vec8f select( const vec8f& mask, const vec8f& a, const vec8f& b )
     {
-      return vec4f( _mm256_extractf128_ps( packed, 1 ) );
+      return _mm256_blendv_ps( b.packed, a.packed, mask.packed );
     }
-  };
+
+  }
 
 }
 
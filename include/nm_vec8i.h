@@ -0,0 +1,337 @@
+#ifndef NM_VEC8I_H
+#define NM_VEC8I_H
+
+#include "nm_common.h"
+#include "nm_vec4i.h"
+#include "nm_vec8f.h"
+
+namespace nmath {
+
+  inline namespace NMATH_ISA_NAMESPACE {
+
+    namespace detail {
+
+      //! Apply a 128-bit integer op to both halves, for AVX targets without AVX2
+      template <typename Op>
+      nmath_inline __m256i split256( const __m256i& a, const __m256i& b, Op op )
+      {
+        const auto lo = op( _mm256_castsi256_si128( a ), _mm256_castsi256_si128( b ) );
+        const auto hi = op( _mm256_extractf128_si256( a, 1 ), _mm256_extractf128_si256( b, 1 ) );
+        return _mm256_insertf128_si256( _mm256_castsi128_si256( lo ), hi, 1 );
+      }
+
+    }
+
+    //! Integer arithmetic, shifts & comparisons need AVX2 to run eight wide.
+    //! On plain AVX targets they fall back to two 128-bit halves.
+    class nmath_32b_align vec8i {
+    public:
+      union {
+        struct {
+          int32_t e0, e1, e2, e3, e4, e5, e6, e7;
+        };
+        __m256i packed;
+      };
+      nmath_inline vec8i()
+      {
+        packed = _mm256_setzero_si256();
+      }
+      nmath_inline vec8i( const int32_t value )
+      {
+        packed = _mm256_set1_epi32( value );
+      }
+      nmath_inline vec8i( const int32_t* __restrict values )
+      {
+        packed = _mm256_load_si256( reinterpret_cast<const __m256i*>( values ) );
+      }
+      nmath_inline vec8i( const __m256i& rhs ): packed( rhs )
+      {
+      }
+      nmath_inline vec8i( int32_t _e0, int32_t _e1, int32_t _e2, int32_t _e3, int32_t _e4, int32_t _e5, int32_t _e6, int32_t _e7 )
+      {
+        packed = _mm256_setr_epi32( _e0, _e1, _e2, _e3, _e4, _e5, _e6, _e7 );
+      }
+      nmath_inline vec8i( const vec4i& lo, const vec4i& hi )
+      {
+        packed = _mm256_insertf128_si256( _mm256_castsi128_si256( lo.packed ), hi.packed, 1 );
+      }
+      //! v = (int)round(a), rounding to nearest even like the current MXCSR mode
+      static nmath_inline vec8i convert( const vec8f& rhs )
+      {
+        return _mm256_cvtps_epi32( rhs.packed );
+      }
+      //! v = (int)a, rounding towards zero like a C cast
+      static nmath_inline vec8i truncate( const vec8f& rhs )
+      {
+        return _mm256_cvttps_epi32( rhs.packed );
+      }
+      //! Reinterpret the bits of a float vector as integers, no conversion
+      static nmath_inline vec8i bitcast( const vec8f& rhs )
+      {
+        return _mm256_castps_si256( rhs.packed );
+      }
+      //! v = (float)a
+      nmath_inline vec8f toFloat() const
+      {
+        return _mm256_cvtepi32_ps( packed );
+      }
+      //! Reinterpret the bits as a float vector, no conversion
+      nmath_inline vec8f asFloat() const
+      {
+        return _mm256_castsi256_ps( packed );
+      }
+      //! Load eight 32-byte boundary aligned values into vector
+      nmath_inline void load( const int32_t* __restrict values )
+      {
+        packed = _mm256_load_si256( reinterpret_cast<const __m256i*>( values ) );
+      }
+      //! Load eight unaligned values into vector
+      nmath_inline void loadUnaligned( const int32_t* __restrict values )
+      {
+        packed = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( values ) );
+      }
+      //! Store eight values from vector to 32-byte boundary aligned memory
+      //! using a non-temporal usage hint (data not reused, don't cache in SSB)
+      nmath_inline void storeNontemporal( int32_t* __restrict values )
+      {
+        _mm256_stream_si256( reinterpret_cast<__m256i*>( values ), packed );
+      }
+      //! Store eight values from vector to 32-byte boundary aligned memory
+      //! using a temporal usage hint (data is reused, maybe cache in SSB)
+      nmath_inline void storeTemporal( int32_t* __restrict values )
+      {
+        _mm256_store_si256( reinterpret_cast<__m256i*>( values ), packed );
+      }
+      //! Store eight values from vector to unaligned memory
+      nmath_inline void storeUnaligned( int32_t* __restrict values )
+      {
+        _mm256_storeu_si256( reinterpret_cast<__m256i*>( values ), packed );
+      }
+      //! Set all vector members to single value
+      nmath_inline void set( const int32_t* value )
+      {
+        packed = _mm256_set1_epi32( *value );
+      }
+      //! Set vector members individually
+      nmath_inline void set( int32_t _e0, int32_t _e1, int32_t _e2, int32_t _e3, int32_t _e4, int32_t _e5, int32_t _e6, int32_t _e7 )
+      {
+        packed = _mm256_setr_epi32( _e0, _e1, _e2, _e3, _e4, _e5, _e6, _e7 );
+      }
+      //! v = a + b (wrapping)
+      nmath_inline vec8i operator + ( const vec8i& rhs ) const
+      {
+#ifdef NMATH_HAS_AVX2
+        return _mm256_add_epi32( packed, rhs.packed );
+#else
+        return detail::split256( packed, rhs.packed, []( __m128i l, __m128i r ) { return _mm_add_epi32( l, r ); } );
+#endif
+      }
+      //! v = a - b (wrapping)
+      nmath_inline vec8i operator - ( const vec8i& rhs ) const
+      {
+#ifdef NMATH_HAS_AVX2
+        return _mm256_sub_epi32( packed, rhs.packed );
+#else
+        return detail::split256( packed, rhs.packed, []( __m128i l, __m128i r ) { return _mm_sub_epi32( l, r ); } );
+#endif
+      }
+      //! v = a * b (low 32 bits of the product)
+      nmath_inline vec8i operator * ( const vec8i& rhs ) const
+      {
+#ifdef NMATH_HAS_AVX2
+        return _mm256_mullo_epi32( packed, rhs.packed );
+#else
+        return detail::split256( packed, rhs.packed, []( __m128i l, __m128i r ) { return _mm_mullo_epi32( l, r ); } );
+#endif
+      }
+      //! v = a & b (bitwise and)
+      nmath_inline vec8i operator & ( const vec8i& rhs ) const
+      {
+        return _mm256_castps_si256( _mm256_and_ps( _mm256_castsi256_ps( packed ), _mm256_castsi256_ps( rhs.packed ) ) );
+      }
+      //! v = a | b (bitwise or)
+      nmath_inline vec8i operator | ( const vec8i& rhs ) const
+      {
+        return _mm256_castps_si256( _mm256_or_ps( _mm256_castsi256_ps( packed ), _mm256_castsi256_ps( rhs.packed ) ) );
+      }
+      //! v = a ^ b (bitwise xor)
+      nmath_inline vec8i operator ^ ( const vec8i& rhs ) const
+      {
+        return _mm256_castps_si256( _mm256_xor_ps( _mm256_castsi256_ps( packed ), _mm256_castsi256_ps( rhs.packed ) ) );
+      }
+      //! v = a << n
+      nmath_inline vec8i operator << ( const int count ) const
+      {
+        const auto n = _mm_cvtsi32_si128( count );
+#ifdef NMATH_HAS_AVX2
+        return _mm256_sll_epi32( packed, n );
+#else
+        return detail::split256( packed, packed, [n]( __m128i l, __m128i ) { return _mm_sll_epi32( l, n ); } );
+#endif
+      }
+      //! v = a >> n (arithmetic, sign-extending)
+      nmath_inline vec8i operator >> ( const int count ) const
+      {
+        const auto n = _mm_cvtsi32_si128( count );
+#ifdef NMATH_HAS_AVX2
+        return _mm256_sra_epi32( packed, n );
+#else
+        return detail::split256( packed, packed, [n]( __m128i l, __m128i ) { return _mm_sra_epi32( l, n ); } );
+#endif
+      }
+      //! v = a >> n (logical, shifting in zeroes)
+      nmath_inline vec8i shiftRightLogical( const int count ) const
+      {
+        const auto n = _mm_cvtsi32_si128( count );
+#ifdef NMATH_HAS_AVX2
+        return _mm256_srl_epi32( packed, n );
+#else
+        return detail::split256( packed, packed, [n]( __m128i l, __m128i ) { return _mm_srl_epi32( l, n ); } );
+#endif
+      }
+      //! a == b
+      nmath_inline bool operator == ( const vec8i& rhs ) const
+      {
+        return eq( rhs ).all();
+      }
+      //! a != b
+      nmath_inline bool operator != ( const vec8i& rhs ) const
+      {
+        return !eq( rhs ).all();
+      }
+      //! Per-lane a < b, all bits set in lanes where true
+      nmath_inline vec8i operator < ( const vec8i& rhs ) const
+      {
+#ifdef NMATH_HAS_AVX2
+        return _mm256_cmpgt_epi32( rhs.packed, packed );
+#else
+        return detail::split256( rhs.packed, packed, []( __m128i l, __m128i r ) { return _mm_cmpgt_epi32( l, r ); } );
+#endif
+      }
+      //! Per-lane a <= b, all bits set in lanes where true
+      nmath_inline vec8i operator <= ( const vec8i& rhs ) const
+      {
+#ifdef NMATH_HAS_AVX2
+        return _mm256_xor_si256( _mm256_cmpgt_epi32( packed, rhs.packed ), _mm256_set1_epi32( -1 ) );
+#else
+        return detail::split256( packed, rhs.packed, []( __m128i l, __m128i r ) { return _mm_xor_si128( _mm_cmpgt_epi32( l, r ), _mm_set1_epi32( -1 ) ); } );
+#endif
+      }
+      //! Per-lane a > b, all bits set in lanes where true
+      nmath_inline vec8i operator > ( const vec8i& rhs ) const
+      {
+#ifdef NMATH_HAS_AVX2
+        return _mm256_cmpgt_epi32( packed, rhs.packed );
+#else
+        return detail::split256( packed, rhs.packed, []( __m128i l, __m128i r ) { return _mm_cmpgt_epi32( l, r ); } );
+#endif
+      }
+      //! Per-lane a >= b, all bits set in lanes where true
+      nmath_inline vec8i operator >= ( const vec8i& rhs ) const
+      {
+#ifdef NMATH_HAS_AVX2
+        return _mm256_xor_si256( _mm256_cmpgt_epi32( rhs.packed, packed ), _mm256_set1_epi32( -1 ) );
+#else
+        return detail::split256( rhs.packed, packed, []( __m128i l, __m128i r ) { return _mm_xor_si128( _mm_cmpgt_epi32( l, r ), _mm_set1_epi32( -1 ) ); } );
+#endif
+      }
+      //! Per-lane a == b, all bits set in lanes where true
+      //! (operator == compares the whole vector instead)
+      nmath_inline vec8i eq( const vec8i& rhs ) const
+      {
+#ifdef NMATH_HAS_AVX2
+        return _mm256_cmpeq_epi32( packed, rhs.packed );
+#else
+        return detail::split256( packed, rhs.packed, []( __m128i l, __m128i r ) { return _mm_cmpeq_epi32( l, r ); } );
+#endif
+      }
+      //! Per-lane a != b, all bits set in lanes where true
+      //! (operator != compares the whole vector instead)
+      nmath_inline vec8i neq( const vec8i& rhs ) const
+      {
+#ifdef NMATH_HAS_AVX2
+        return _mm256_xor_si256( _mm256_cmpeq_epi32( packed, rhs.packed ), _mm256_set1_epi32( -1 ) );
+#else
+        return detail::split256( packed, rhs.packed, []( __m128i l, __m128i r ) { return _mm_xor_si128( _mm_cmpeq_epi32( l, r ), _mm_set1_epi32( -1 ) ); } );
+#endif
+      }
+      //! Sign bits of all lanes packed into an int, lane 0 in bit 0
+      nmath_inline int bitmask() const
+      {
+        return _mm256_movemask_ps( _mm256_castsi256_ps( packed ) );
+      }
+      //! Whether any lane of a mask is set
+      nmath_inline bool any() const
+      {
+        return ( bitmask() != 0 );
+      }
+      //! Whether all lanes of a mask are set
+      nmath_inline bool all() const
+      {
+        return ( bitmask() == 0xFF );
+      }
+      //! Whether no lane of a mask is set
+      nmath_inline bool none() const
+      {
+        return ( bitmask() == 0 );
+      }
+      //! v = |a|, INT32_MIN stays INT32_MIN
+      nmath_inline vec8i abs() const
+      {
+#ifdef NMATH_HAS_AVX2
+        return _mm256_abs_epi32( packed );
+#else
+        return detail::split256( packed, packed, []( __m128i l, __m128i ) { return _mm_abs_epi32( l ); } );
+#endif
+      }
+      //! v = min(a, b)
+      nmath_inline vec8i min( const vec8i& rhs ) const
+      {
+#ifdef NMATH_HAS_AVX2
+        return _mm256_min_epi32( packed, rhs.packed );
+#else
+        return detail::split256( packed, rhs.packed, []( __m128i l, __m128i r ) { return _mm_min_epi32( l, r ); } );
+#endif
+      }
+      //! v = max(a, b)
+      nmath_inline vec8i max( const vec8i& rhs ) const
+      {
+#ifdef NMATH_HAS_AVX2
+        return _mm256_max_epi32( packed, rhs.packed );
+#else
+        return detail::split256( packed, rhs.packed, []( __m128i l, __m128i r ) { return _mm_max_epi32( l, r ); } );
+#endif
+      }
+      //! v = min(max(a, lo), hi)
+      nmath_inline vec8i clamp( const vec8i& lo, const vec8i& hi ) const
+      {
+        return max( lo ).min( hi );
+      }
+      //! i = e0 + e1 + e2 + e3 + e4 + e5 + e6 + e7 (wrapping)
+      nmath_inline int32_t sum() const
+      {
+        return ( low() + high() ).sum();
+      }
+      //! Extract the lower vec4
+      nmath_inline vec4i low() const
+      {
+        return vec4i( _mm256_castsi256_si128( packed ) );
+      }
+      //! Extract the higher vec4
+      nmath_inline vec4i high() const
+      {
+        return vec4i( _mm256_extractf128_si256( packed, 1 ) );
+      }
+    };
+
+    //! Per-lane mask ? a : b. Only the sign bit of each mask lane is looked at.
+    nmath_inline vec8i select( const vec8i& mask, const vec8i& a, const vec8i& b )
+    {
+      return _mm256_castps_si256( _mm256_blendv_ps( _mm256_castsi256_ps( b.packed ), _mm256_castsi256_ps( a.packed ), _mm256_castsi256_ps( mask.packed ) ) );
+    }
+
+  }
+
+}
+
+#endif
@@ -0,0 +1,645 @@
+#ifndef NM_VECMATH_H
+#define NM_VECMATH_H
+
+#include "nm_common.h"
+#include "nm_vec4f.h"
+#include "nm_vec8f.h"
+#include "nm_vec4d.h"
+#include <limits>
+
+// Componentwise transcendental functions for vec4f, vec8f & vec4d.
+// Polynomial approximations after Cephes (float, double sin/cos/exp/atan)
+// and fdlibm (double log), evaluated branchlessly across all lanes.
+//
+// Max error measured against long double libm, with & without FMA3:
+//   function   float       double      notes
+//   exp        1 ulp       2 ulp       denormal results included, overflow gives inf
+//   log        1 ulp       1 ulp       denormal inputs included
+//   sin, cos   2 ulp       2 ulp       for |x| <= pi; past that the error is absolute,
+//                                      1e-7 up to |x| = 8192 (float), 2e-16 up to 1e8 (double)
+//   tan        4 ulp       4 ulp       for |x| < pi/2, sin / cos beyond that
+//   atan2      4 ulp       2 ulp       atan2( +-inf, +-inf ) gives NaN
+// pow is exp( y * log( x ) ), so its error grows with the magnitude of
+// y * log( x ): at most 1 + |y * log( x )| ulp. Negative x gives NaN, x = 0
+// gives 0 or inf depending on the sign of y, and y = 0 always gives 1.
+
+namespace nmath {
+
+  inline namespace NMATH_ISA_NAMESPACE {
+
+    namespace detail {
+
+      //! Register-level primitives the generic approximations are written in
+      template <typename V>
+      struct vecmath;
+
+      template <>
+      struct vecmath<vec4f> {
+        using reg = __m128;
+        static nmath_inline reg set1( float v ) { return _mm_set1_ps( v ); }
+        static nmath_inline reg bits( uint32_t v ) { return _mm_castsi128_ps( _mm_set1_epi32( static_cast<int>( v ) ) ); }
+        static nmath_inline reg add( reg a, reg b ) { return _mm_add_ps( a, b ); }
+        static nmath_inline reg sub( reg a, reg b ) { return _mm_sub_ps( a, b ); }
+        static nmath_inline reg mul( reg a, reg b ) { return _mm_mul_ps( a, b ); }
+        static nmath_inline reg div( reg a, reg b ) { return _mm_div_ps( a, b ); }
+        static nmath_inline reg madd( reg a, reg b, reg c )
+        {
+#ifdef NMATH_HAS_FMA
+          return _mm_fmadd_ps( a, b, c );
+#else
+          return _mm_add_ps( _mm_mul_ps( a, b ), c );
+#endif
+        }
+        static nmath_inline reg and_( reg a, reg b ) { return _mm_and_ps( a, b ); }
+        static nmath_inline reg or_( reg a, reg b ) { return _mm_or_ps( a, b ); }
+        static nmath_inline reg xor_( reg a, reg b ) { return _mm_xor_ps( a, b ); }
+        static nmath_inline reg andnot( reg a, reg b ) { return _mm_andnot_ps( a, b ); }
+        static nmath_inline reg min( reg a, reg b ) { return _mm_min_ps( a, b ); }
+        static nmath_inline reg max( reg a, reg b ) { return _mm_max_ps( a, b ); }
+        static nmath_inline reg lt( reg a, reg b ) { return _mm_cmplt_ps( a, b ); }
+        static nmath_inline reg eq( reg a, reg b ) { return _mm_cmpeq_ps( a, b ); }
+        static nmath_inline reg unord( reg a, reg b ) { return _mm_cmpunord_ps( a, b ); }
+        static nmath_inline reg select( reg mask, reg a, reg b ) { return _mm_blendv_ps( b, a, mask ); }
+        static nmath_inline reg round( reg a ) { return _mm_round_ps( a, _MM_FROUND_NINT ); }
+        static nmath_inline reg floor( reg a ) { return _mm_round_ps( a, _MM_FROUND_FLOOR ); }
+        template <int N>
+        static nmath_inline reg shl( reg a ) { return _mm_castsi128_ps( _mm_slli_epi32( _mm_castps_si128( a ), N ) ); }
+        template <int N>
+        static nmath_inline reg shr( reg a ) { return _mm_castsi128_ps( _mm_srli_epi32( _mm_castps_si128( a ), N ) ); }
+      };
+
+      template <>
+      struct vecmath<vec8f> {
+        using reg = __m256;
+        static nmath_inline reg set1( float v ) { return _mm256_set1_ps( v ); }
+        static nmath_inline reg bits( uint32_t v ) { return _mm256_castsi256_ps( _mm256_set1_epi32( static_cast<int>( v ) ) ); }
+        static nmath_inline reg add( reg a, reg b ) { return _mm256_add_ps( a, b ); }
+        static nmath_inline reg sub( reg a, reg b ) { return _mm256_sub_ps( a, b ); }
+        static nmath_inline reg mul( reg a, reg b ) { return _mm256_mul_ps( a, b ); }
+        static nmath_inline reg div( reg a, reg b ) { return _mm256_div_ps( a, b ); }
+        static nmath_inline reg madd( reg a, reg b, reg c )
+        {
+#ifdef NMATH_HAS_FMA
+          return _mm256_fmadd_ps( a, b, c );
+#else
+          return _mm256_add_ps( _mm256_mul_ps( a, b ), c );
+#endif
+        }
+        static nmath_inline reg and_( reg a, reg b ) { return _mm256_and_ps( a, b ); }
+        static nmath_inline reg or_( reg a, reg b ) { return _mm256_or_ps( a, b ); }
+        static nmath_inline reg xor_( reg a, reg b ) { return _mm256_xor_ps( a, b ); }
+        static nmath_inline reg andnot( reg a, reg b ) { return _mm256_andnot_ps( a, b ); }
+        static nmath_inline reg min( reg a, reg b ) { return _mm256_min_ps( a, b ); }
+        static nmath_inline reg max( reg a, reg b ) { return _mm256_max_ps( a, b ); }
+        static nmath_inline reg lt( reg a, reg b ) { return _mm256_cmp_ps( a, b, _CMP_LT_OQ ); }
+        static nmath_inline reg eq( reg a, reg b ) { return _mm256_cmp_ps( a, b, _CMP_EQ_OQ ); }
+        static nmath_inline reg unord( reg a, reg b ) { return _mm256_cmp_ps( a, b, _CMP_UNORD_Q ); }
+        static nmath_inline reg select( reg mask, reg a, reg b ) { return _mm256_blendv_ps( b, a, mask ); }
+        static nmath_inline reg round( reg a ) { return _mm256_round_ps( a, _MM_FROUND_NINT ); }
+        static nmath_inline reg floor( reg a ) { return _mm256_round_ps( a, _MM_FROUND_FLOOR ); }
+        template <int N>
+        static nmath_inline reg shl( reg a )
+        {
+#ifdef NMATH_HAS_AVX2
+          return _mm256_castsi256_ps( _mm256_slli_epi32( _mm256_castps_si256( a ), N ) );
+#else
+          const auto lo = _mm_slli_epi32( _mm_castps_si128( _mm256_castps256_ps128( a ) ), N );
+          const auto hi = _mm_slli_epi32( _mm_castps_si128( _mm256_extractf128_ps( a, 1 ) ), N );
+          return _mm256_insertf128_ps( _mm256_castps128_ps256( _mm_castsi128_ps( lo ) ), _mm_castsi128_ps( hi ), 1 );
+#endif
+        }
+        template <int N>
+        static nmath_inline reg shr( reg a )
+        {
+#ifdef NMATH_HAS_AVX2
+          return _mm256_castsi256_ps( _mm256_srli_epi32( _mm256_castps_si256( a ), N ) );
+#else
+          const auto lo = _mm_srli_epi32( _mm_castps_si128( _mm256_castps256_ps128( a ) ), N );
+          const auto hi = _mm_srli_epi32( _mm_castps_si128( _mm256_extractf128_ps( a, 1 ) ), N );
+          return _mm256_insertf128_ps( _mm256_castps128_ps256( _mm_castsi128_ps( lo ) ), _mm_castsi128_ps( hi ), 1 );
+#endif
+        }
+      };
+
+      template <>
+      struct vecmath<vec4d> {
+        using reg = __m256d;
+        static nmath_inline reg set1( double v ) { return _mm256_set1_pd( v ); }
+        static nmath_inline reg bits( uint64_t v ) { return _mm256_castsi256_pd( _mm256_set1_epi64x( static_cast<long long>( v ) ) ); }
+        static nmath_inline reg add( reg a, reg b ) { return _mm256_add_pd( a, b ); }
+        static nmath_inline reg sub( reg a, reg b ) { return _mm256_sub_pd( a, b ); }
+        static nmath_inline reg mul( reg a, reg b ) { return _mm256_mul_pd( a, b ); }
+        static nmath_inline reg div( reg a, reg b ) { return _mm256_div_pd( a, b ); }
+        static nmath_inline reg madd( reg a, reg b, reg c )
+        {
+#ifdef NMATH_HAS_FMA
+          return _mm256_fmadd_pd( a, b, c );
+#else
+          return _mm256_add_pd( _mm256_mul_pd( a, b ), c );
+#endif
+        }
+        static nmath_inline reg and_( reg a, reg b ) { return _mm256_and_pd( a, b ); }
+        static nmath_inline reg or_( reg a, reg b ) { return _mm256_or_pd( a, b ); }
+        static nmath_inline reg xor_( reg a, reg b ) { return _mm256_xor_pd( a, b ); }
+        static nmath_inline reg andnot( reg a, reg b ) { return _mm256_andnot_pd( a, b ); }
+        static nmath_inline reg min( reg a, reg b ) { return _mm256_min_pd( a, b ); }
+        static nmath_inline reg max( reg a, reg b ) { return _mm256_max_pd( a, b ); }
+        static nmath_inline reg lt( reg a, reg b ) { return _mm256_cmp_pd( a, b, _CMP_LT_OQ ); }
+        static nmath_inline reg eq( reg a, reg b ) { return _mm256_cmp_pd( a, b, _CMP_EQ_OQ ); }
+        static nmath_inline reg unord( reg a, reg b ) { return _mm256_cmp_pd( a, b, _CMP_UNORD_Q ); }
+        static nmath_inline reg select( reg mask, reg a, reg b ) { return _mm256_blendv_pd( b, a, mask ); }
+        static nmath_inline reg round( reg a ) { return _mm256_round_pd( a, _MM_FROUND_NINT ); }
+        static nmath_inline reg floor( reg a ) { return _mm256_round_pd( a, _MM_FROUND_FLOOR ); }
+        template <int N>
+        static nmath_inline reg shl( reg a )
+        {
+#ifdef NMATH_HAS_AVX2
+          return _mm256_castsi256_pd( _mm256_slli_epi64( _mm256_castpd_si256( a ), N ) );
+#else
+          const auto lo = _mm_slli_epi64( _mm_castpd_si128( _mm256_castpd256_pd128( a ) ), N );
+          const auto hi = _mm_slli_epi64( _mm_castpd_si128( _mm256_extractf128_pd( a, 1 ) ), N );
+          return _mm256_insertf128_pd( _mm256_castpd128_pd256( _mm_castsi128_pd( lo ) ), _mm_castsi128_pd( hi ), 1 );
+#endif
+        }
+        template <int N>
+        static nmath_inline reg shr( reg a )
+        {
+#ifdef NMATH_HAS_AVX2
+          return _mm256_castsi256_pd( _mm256_srli_epi64( _mm256_castpd_si256( a ), N ) );
+#else
+          const auto lo = _mm_srli_epi64( _mm_castpd_si128( _mm256_castpd256_pd128( a ) ), N );
+          const auto hi = _mm_srli_epi64( _mm_castpd_si128( _mm256_extractf128_pd( a, 1 ) ), N );
+          return _mm256_insertf128_pd( _mm256_castpd128_pd256( _mm_castsi128_pd( lo ) ), _mm_castsi128_pd( hi ), 1 );
+#endif
+        }
+      };
+
+      //! IEEE layout constants per scalar type
+      template <typename S>
+      struct ieee;
+
+      template <>
+      struct ieee<float> {
+        using bits = uint32_t;
+        static constexpr int mantissaBits = 23;
+        static constexpr bits sign = 0x80000000u;
+        static constexpr bits exponent = 0x7F800000u;
+        static constexpr bits mantissa = 0x007FFFFFu;
+        static constexpr bits half = 0x3F000000u; //!< 0.5
+        static constexpr bits magic = 0x4B000000u; //!< 2^23
+        static constexpr float magicValue = 8388608.0f;
+        static constexpr int bias = 127;
+        static constexpr float minNormal = 1.17549435e-38f;
+      };
+
+      template <>
+      struct ieee<double> {
+        using bits = uint64_t;
+        static constexpr int mantissaBits = 52;
+        static constexpr bits sign = 0x8000000000000000ull;
+        static constexpr bits exponent = 0x7FF0000000000000ull;
+        static constexpr bits mantissa = 0x000FFFFFFFFFFFFFull;
+        static constexpr bits half = 0x3FE0000000000000ull; //!< 0.5
+        static constexpr bits magic = 0x4330000000000000ull; //!< 2^52
+        static constexpr double magicValue = 4503599627370496.0;
+        static constexpr int bias = 1023;
+        static constexpr double minNormal = 2.2250738585072014e-308;
+      };
+
+      //! 2^n for integral n within the normal exponent range
+      template <typename V, typename S, typename T = vecmath<V>, typename R = typename T::reg>
+      nmath_inline R pow2i( R n )
+      {
+        using F = ieee<S>;
+        // n + bias lands in the low mantissa bits of magic, shift it up into the exponent
+        const auto biased = T::add( n, T::set1( static_cast<S>( F::bias ) + F::magicValue ) );
+        return T::template shl<F::mantissaBits>( biased );
+      }
+
+      //! Unbiased exponent of x as a real number, x positive & normal
+      template <typename V, typename S, typename T = vecmath<V>, typename R = typename T::reg>
+      nmath_inline R exponentOf( R x )
+      {
+        using F = ieee<S>;
+        const auto biased = T::template shr<F::mantissaBits>( T::and_( x, T::bits( F::exponent ) ) );
+        const auto magic = T::bits( F::magic );
+        return T::sub( T::sub( T::or_( biased, magic ), magic ), T::set1( static_cast<S>( F::bias ) ) );
+      }
+
+      //! Scale y by 2^n, split in two steps so that n may exceed the normal exponent range
+      template <typename V, typename S, typename T = vecmath<V>, typename R = typename T::reg>
+      nmath_inline R ldexp( R y, R n )
+      {
+        const auto n1 = T::floor( T::mul( n, T::set1( static_cast<S>( 0.5 ) ) ) );
+        const auto n2 = T::sub( n, n1 );
+        return T::mul( T::mul( y, pow2i<V, S>( n1 ) ), pow2i<V, S>( n2 ) );
+      }
+
+      //! Split positive x into mantissa m in [sqrt(0.5), sqrt(2)) and exponent e so that x = m * 2^e.
+      //! Denormals are normalized first.
+      template <typename V, typename S, typename T = vecmath<V>, typename R = typename T::reg>
+      nmath_inline void frexp( R x, R& m, R& e )
+      {
+        using F = ieee<S>;
+        const auto denormal = T::lt( x, T::set1( F::minNormal ) );
+        x = T::select( denormal, T::mul( x, T::set1( F::magicValue ) ), x );
+        e = T::add( exponentOf<V, S>( x ), T::select( denormal, T::set1( -static_cast<S>( F::mantissaBits ) ), T::set1( static_cast<S>( 0 ) ) ) );
+        // mantissa in [1, 2)
+        m = T::or_( T::and_( x, T::bits( F::mantissa ) ), T::set1( static_cast<S>( 1 ) ) );
+        const auto big = T::lt( T::set1( static_cast<S>( 1.41421356237309504880 ) ), m );
+        m = T::select( big, T::mul( m, T::set1( static_cast<S>( 0.5 ) ) ), m );
+        e = T::select( big, T::add( e, T::set1( static_cast<S>( 1 ) ) ), e );
+      }
+
+      //! Patch in the IEEE results for log at zero, negative, infinite & NaN inputs
+      template <typename V, typename S, typename T = vecmath<V>, typename R = typename T::reg>
+      nmath_inline R logSpecials( R x, R y )
+      {
+        const auto zero = T::set1( static_cast<S>( 0 ) );
+        const auto inf = T::bits( ieee<S>::exponent );
+        y = T::select( T::eq( x, inf ), inf, y );
+        y = T::select( T::eq( x, zero ), T::or_( inf, T::bits( ieee<S>::sign ) ), y );
+        y = T::select( T::or_( T::lt( x, zero ), T::unord( x, x ) ), T::set1( std::numeric_limits<S>::quiet_NaN() ), y );
+        return y;
+      }
+
+      //! Reduce |x| by multiples of pi/4 to [-pi/4, pi/4], returning j/2 for the octant index j
+      //! (always even) and writing out the reduced argument.
+      template <typename V, typename S, typename T = vecmath<V>, typename R = typename T::reg>
+      nmath_inline R reduceQuarterPi( R ax, R& r, const S dp1, const S dp2, const S dp3 )
+      {
+        const auto y = T::mul( ax, T::set1( static_cast<S>( 1.27323954473516268615 ) ) );
+        // j = ( (int)y + 1 ) & ~1, kept in the float domain
+        const auto q = T::floor( T::madd( y, T::set1( static_cast<S>( 0.5 ) ), T::set1( static_cast<S>( 0.5 ) ) ) );
+        const auto j = T::add( q, q );
+        r = T::madd( j, T::set1( -dp1 ), ax );
+        r = T::madd( j, T::set1( -dp2 ), r );
+        r = T::madd( j, T::set1( -dp3 ), r );
+        return q;
+      }
+
+      //! Whether each integral lane of q is odd, as a mask
+      template <typename V, typename S, typename T = vecmath<V>, typename R = typename T::reg>
+      nmath_inline R isOdd( R q )
+      {
+        const auto half = T::floor( T::mul( q, T::set1( static_cast<S>( 0.5 ) ) ) );
+        return T::eq( T::sub( q, T::add( half, half ) ), T::set1( static_cast<S>( 1 ) ) );
+      }
+
+      template <typename V, typename T = vecmath<V>, typename R = typename T::reg>
+      nmath_inline R expf( R x )
+      {
+        x = T::min( T::set1( 89.0f ), T::max( T::set1( -104.0f ), x ) );
+        const auto n = T::round( T::mul( x, T::set1( 1.44269504088896341f ) ) );
+        auto r = T::madd( n, T::set1( -0.693359375f ), x );
+        r = T::madd( n, T::set1( 2.12194440e-4f ), r );
+        auto p = T::set1( 1.9875691500e-4f );
+        p = T::madd( p, r, T::set1( 1.3981999507e-3f ) );
+        p = T::madd( p, r, T::set1( 8.3334519073e-3f ) );
+        p = T::madd( p, r, T::set1( 4.1665795894e-2f ) );
+        p = T::madd( p, r, T::set1( 1.6666665459e-1f ) );
+        p = T::madd( p, r, T::set1( 5.0000001201e-1f ) );
+        const auto y = T::add( T::madd( p, T::mul( r, r ), r ), T::set1( 1.0f ) );
+        return ldexp<V, float>( y, n );
+      }
+
+      template <typename V, typename T = vecmath<V>, typename R = typename T::reg>
+      nmath_inline R logf( R x )
+      {
+        R m, e;
+        frexp<V, float>( x, m, e );
+        m = T::sub( m, T::set1( 1.0f ) );
+        const auto z = T::mul( m, m );
+        auto p = T::set1( 7.0376836292e-2f );
+        p = T::madd( p, m, T::set1( -1.1514610310e-1f ) );
+        p = T::madd( p, m, T::set1( 1.1676998740e-1f ) );
+        p = T::madd( p, m, T::set1( -1.2420140846e-1f ) );
+        p = T::madd( p, m, T::set1( 1.4249322787e-1f ) );
+        p = T::madd( p, m, T::set1( -1.6668057665e-1f ) );
+        p = T::madd( p, m, T::set1( 2.0000714765e-1f ) );
+        p = T::madd( p, m, T::set1( -2.4999993993e-1f ) );
+        p = T::madd( p, m, T::set1( 3.3333331174e-1f ) );
+        auto y = T::mul( T::mul( p, m ), z );
+        y = T::madd( e, T::set1( -2.12194440e-4f ), y );
+        y = T::madd( z, T::set1( -0.5f ), y );
+        y = T::add( m, y );
+        y = T::madd( e, T::set1( 0.693359375f ), y );
+        return logSpecials<V, float>( x, y );
+      }
+
+      template <typename V, typename T = vecmath<V>, typename R = typename T::reg>
+      nmath_inline void sincosf( R x, R& s, R& c )
+      {
+        const auto signMask = T::bits( ieee<float>::sign );
+        const auto ax = T::andnot( signMask, x );
+        R r;
+        const auto q = reduceQuarterPi<V, float>( ax, r, 0.78515625f, 2.4187564849853515625e-4f, 3.77489497744594108e-8f );
+        const auto z = T::mul( r, r );
+        auto pc = T::set1( 2.443315711809948e-5f );
+        pc = T::madd( pc, z, T::set1( -1.388731625493765e-3f ) );
+        pc = T::madd( pc, z, T::set1( 4.166664568298827e-2f ) );
+        pc = T::madd( T::mul( pc, z ), z, T::madd( z, T::set1( -0.5f ), T::set1( 1.0f ) ) );
+        auto ps = T::set1( -1.9515295891e-4f );
+        ps = T::madd( ps, z, T::set1( 8.3321608736e-3f ) );
+        ps = T::madd( ps, z, T::set1( -1.6666654611e-1f ) );
+        ps = T::madd( T::mul( ps, z ), r, r );
+        // octant j = 2q: bit 1 swaps the polynomials, bit 2 flips the sign
+        const auto swap = isOdd<V, float>( q );
+        const auto qh = T::floor( T::mul( q, T::set1( 0.5f ) ) );
+        const auto flip = T::and_( isOdd<V, float>( qh ), signMask );
+        s = T::xor_( T::xor_( T::select( swap, pc, ps ), flip ), T::and_( x, signMask ) );
+        // cos(x) = sin(x + pi/2): bit 2 of j - 2 decides the sign
+        const auto cflip = T::and_( isOdd<V, float>( T::floor( T::mul( T::add( q, T::set1( 1.0f ) ), T::set1( 0.5f ) ) ) ), signMask );
+        c = T::xor_( T::select( swap, ps, pc ), cflip );
+      }
+
+      template <typename V, typename T = vecmath<V>, typename R = typename T::reg>
+      nmath_inline R atan2f( R y, R x )
+      {
+        const auto signMask = T::bits( ieee<float>::sign );
+        const auto ax = T::andnot( signMask, x );
+        const auto ay = T::andnot( signMask, y );
+        const auto hi = T::max( ax, ay );
+        const auto lo = T::min( ax, ay );
+        const auto zero = T::set1( 0.0f );
+        // t in [0, 1], atan2(0, 0) = 0
+        auto t = T::select( T::eq( hi, zero ), zero, T::div( lo, hi ) );
+        const auto big = T::lt( T::set1( 0.4142135623730950f ), t );
+        t = T::select( big, T::div( T::sub( t, T::set1( 1.0f ) ), T::add( t, T::set1( 1.0f ) ) ), t );
+        const auto z = T::mul( t, t );
+        auto p = T::set1( 8.05374449538e-2f );
+        p = T::madd( p, z, T::set1( -1.38776856032e-1f ) );
+        p = T::madd( p, z, T::set1( 1.99777106478e-1f ) );
+        p = T::madd( p, z, T::set1( -3.33329491539e-1f ) );
+        auto r = T::madd( T::mul( p, z ), t, t );
+        r = T::add( r, T::and_( big, T::set1( 0.78539816339744830962f ) ) );
+        r = T::select( T::lt( ax, ay ), T::sub( T::set1( 1.57079632679489661923f ), r ), r );
+        // negative x (including -0) mirrors across the y axis, blendv only looks at the sign bit
+        r = T::select( x, T::sub( T::set1( 3.14159265358979323846f ), r ), r );
+        r = T::or_( r, T::and_( y, signMask ) );
+        return T::select( T::or_( T::unord( x, x ), T::unord( y, y ) ), T::add( x, y ), r );
+      }
+
+      template <typename V, typename T = vecmath<V>, typename R = typename T::reg>
+      nmath_inline R expd( R x )
+      {
+        x = T::min( T::set1( 710.0 ), T::max( T::set1( -746.0 ), x ) );
+        const auto n = T::round( T::mul( x, T::set1( 1.4426950408889634073599 ) ) );
+        auto r = T::madd( n, T::set1( -6.93145751953125e-1 ), x );
+        r = T::madd( n, T::set1( -1.42860682030941723212e-6 ), r );
+        const auto rr = T::mul( r, r );
+        auto p = T::set1( 1.26177193074810590878e-4 );
+        p = T::madd( p, rr, T::set1( 3.02994407707441961300e-2 ) );
+        p = T::madd( p, rr, T::set1( 9.99999999999999999910e-1 ) );
+        p = T::mul( p, r );
+        auto q = T::set1( 3.00198505138664455042e-6 );
+        q = T::madd( q, rr, T::set1( 2.52448340349684104192e-3 ) );
+        q = T::madd( q, rr, T::set1( 2.27265548208155028766e-1 ) );
+        q = T::madd( q, rr, T::set1( 2.00000000000000000009e0 ) );
+        auto y = T::div( p, T::sub( q, p ) );
+        y = T::madd( y, T::set1( 2.0 ), T::set1( 1.0 ) );
+        return ldexp<V, double>( y, n );
+      }
+
+      template <typename V, typename T = vecmath<V>, typename R = typename T::reg>
+      nmath_inline R logd( R x )
+      {
+        R m, e;
+        frexp<V, double>( x, m, e );
+        const auto f = T::sub( m, T::set1( 1.0 ) );
+        const auto s = T::div( f, T::add( f, T::set1( 2.0 ) ) );
+        const auto z = T::mul( s, s );
+        auto p = T::set1( 1.479819860511658591e-01 );
+        p = T::madd( p, z, T::set1( 1.531383769920937332e-01 ) );
+        p = T::madd( p, z, T::set1( 1.818357216161805012e-01 ) );
+        p = T::madd( p, z, T::set1( 2.222219843214978396e-01 ) );
+        p = T::madd( p, z, T::set1( 2.857142874366239149e-01 ) );
+        p = T::madd( p, z, T::set1( 3.999999999940941908e-01 ) );
+        p = T::madd( p, z, T::set1( 6.666666666666735130e-01 ) );
+        p = T::mul( p, z );
+        const auto hfsq = T::mul( T::mul( f, f ), T::set1( 0.5 ) );
+        // log = e * ln2_hi - ( ( hfsq - ( s * ( hfsq + R ) + e * ln2_lo ) ) - f )
+        auto y = T::madd( s, T::add( hfsq, p ), T::mul( e, T::set1( 1.90821492927058770002e-10 ) ) );
+        y = T::sub( T::sub( hfsq, y ), f );
+        y = T::sub( T::mul( e, T::set1( 6.93147180369123816490e-01 ) ), y );
+        return logSpecials<V, double>( x, y );
+      }
+
+      template <typename V, typename T = vecmath<V>, typename R = typename T::reg>
+      nmath_inline void sincosd( R x, R& s, R& c )
+      {
+        const auto signMask = T::bits( ieee<double>::sign );
+        const auto ax = T::andnot( signMask, x );
+        R r;
+        const auto q = reduceQuarterPi<V, double>( ax, r, 7.85398125648498535156e-1, 3.77489470793079817668e-8, 2.69515142907905952645e-15 );
+        const auto z = T::mul( r, r );
+        auto pc = T::set1( -1.13585365213876817300e-11 );
+        pc = T::madd( pc, z, T::set1( 2.08757008419747316778e-9 ) );
+        pc = T::madd( pc, z, T::set1( -2.75573141792967388112e-7 ) );
+        pc = T::madd( pc, z, T::set1( 2.48015872888517045348e-5 ) );
+        pc = T::madd( pc, z, T::set1( -1.38888888888730564116e-3 ) );
+        pc = T::madd( pc, z, T::set1( 4.16666666666665929218e-2 ) );
+        pc = T::madd( T::mul( pc, z ), z, T::madd( z, T::set1( -0.5 ), T::set1( 1.0 ) ) );
+        auto ps = T::set1( 1.58962301576546568060e-10 );
+        ps = T::madd( ps, z, T::set1( -2.50507477628578072866e-8 ) );
+        ps = T::madd( ps, z, T::set1( 2.75573136213857245213e-6 ) );
+        ps = T::madd( ps, z, T::set1( -1.98412698295895385996e-4 ) );
+        ps = T::madd( ps, z, T::set1( 8.33333333332211858878e-3 ) );
+        ps = T::madd( ps, z, T::set1( -1.66666666666666307295e-1 ) );
+        ps = T::madd( T::mul( ps, z ), r, r );
+        const auto swap = isOdd<V, double>( q );
+        const auto qh = T::floor( T::mul( q, T::set1( 0.5 ) ) );
+        const auto flip = T::and_( isOdd<V, double>( qh ), signMask );
+        s = T::xor_( T::xor_( T::select( swap, pc, ps ), flip ), T::and_( x, signMask ) );
+        const auto cflip = T::and_( isOdd<V, double>( T::floor( T::mul( T::add( q, T::set1( 1.0 ) ), T::set1( 0.5 ) ) ) ), signMask );
+        c = T::xor_( T::select( swap, ps, pc ), cflip );
+      }
+
+      template <typename V, typename T = vecmath<V>, typename R = typename T::reg>
+      nmath_inline R atan2d( R y, R x )
+      {
+        const auto signMask = T::bits( ieee<double>::sign );
+        const auto ax = T::andnot( signMask, x );
+        const auto ay = T::andnot( signMask, y );
+        const auto hi = T::max( ax, ay );
+        const auto lo = T::min( ax, ay );
+        const auto zero = T::set1( 0.0 );
+        auto t = T::select( T::eq( hi, zero ), zero, T::div( lo, hi ) );
+        const auto big = T::lt( T::set1( 0.66 ), t );
+        t = T::select( big, T::div( T::sub( t, T::set1( 1.0 ) ), T::add( t, T::set1( 1.0 ) ) ), t );
+        const auto z = T::mul( t, t );
+        auto p = T::set1( -8.750608600031904122785e-1 );
+        p = T::madd( p, z, T::set1( -1.615753718733365076637e1 ) );
+        p = T::madd( p, z, T::set1( -7.500855792314704667340e1 ) );
+        p = T::madd( p, z, T::set1( -1.228866684490136173410e2 ) );
+        p = T::madd( p, z, T::set1( -6.485021904942025371773e1 ) );
+        auto q = T::add( z, T::set1( 2.485846490142306297962e1 ) );
+        q = T::madd( q, z, T::set1( 1.650270098316988542046e2 ) );
+        q = T::madd( q, z, T::set1( 4.328810604912902668951e2 ) );
+        q = T::madd( q, z, T::set1( 4.853903996359136964868e2 ) );
+        q = T::madd( q, z, T::set1( 1.945506571482613964425e2 ) );
+        auto r = T::madd( T::div( T::mul( p, z ), q ), t, t );
+        // pi/4 split in two to keep the low bits
+        r = T::add( r, T::and_( big, T::set1( 3.061616997868382943065e-17 ) ) );
+        r = T::add( r, T::and_( big, T::set1( 7.85398163397448309616e-1 ) ) );
+        r = T::select( T::lt( ax, ay ), T::add( T::sub( T::set1( 1.57079632679489661923 ), r ), T::set1( 6.123233995736765886130e-17 ) ), r );
+        r = T::select( x, T::add( T::sub( T::set1( 3.14159265358979323846 ), r ), T::set1( 1.2246467991473531772e-16 ) ), r );
+        r = T::or_( r, T::and_( y, signMask ) );
+        return T::select( T::or_( T::unord( x, x ), T::unord( y, y ) ), T::add( x, y ), r );
+      }
+
+      //! pow is exp( y * log( x ) ) apart from x^0 = 1, see the error notes at the top
+      template <typename V, typename S, typename T = vecmath<V>, typename R = typename T::reg>
+      nmath_inline R powFixup( R y, R e )
+      {
+        return T::select( T::eq( y, T::set1( static_cast<S>( 0 ) ) ), T::set1( static_cast<S>( 1 ) ), e );
+      }
+
+    }
+
+    //! v = e^x
+    nmath_inline vec4f exp( const vec4f& x )
+    {
+      return detail::expf<vec4f>( x.packed );
+    }
+    //! v = e^x
+    nmath_inline vec8f exp( const vec8f& x )
+    {
+      return detail::expf<vec8f>( x.packed );
+    }
+    //! v = e^x
+    nmath_inline vec4d exp( const vec4d& x )
+    {
+      return detail::expd<vec4d>( x.packed );
+    }
+    //! v = ln(x)
+    nmath_inline vec4f log( const vec4f& x )
+    {
+      return detail::logf<vec4f>( x.packed );
+    }
+    //! v = ln(x)
+    nmath_inline vec8f log( const vec8f& x )
+    {
+      return detail::logf<vec8f>( x.packed );
+    }
+    //! v = ln(x)
+    nmath_inline vec4d log( const vec4d& x )
+    {
+      return detail::logd<vec4d>( x.packed );
+    }
+    //! s = sin(x), c = cos(x) for the price of one
+    nmath_inline void sincos( const vec4f& x, vec4f& s, vec4f& c )
+    {
+      detail::sincosf<vec4f>( x.packed, s.packed, c.packed );
+    }
+    //! s = sin(x), c = cos(x) for the price of one
+    nmath_inline void sincos( const vec8f& x, vec8f& s, vec8f& c )
+    {
+      detail::sincosf<vec8f>( x.packed, s.packed, c.packed );
+    }
+    //! s = sin(x), c = cos(x) for the price of one
+    nmath_inline void sincos( const vec4d& x, vec4d& s, vec4d& c )
+    {
+      detail::sincosd<vec4d>( x.packed, s.packed, c.packed );
+    }
+    //! v = sin(x)
+    nmath_inline vec4f sin( const vec4f& x )
+    {
+      vec4f s, c;
+      sincos( x, s, c );
+      return s;
+    }
+    //! v = sin(x)
+    nmath_inline vec8f sin( const vec8f& x )
+    {
+      vec8f s, c;
+      sincos( x, s, c );
+      return s;
+    }
+    //! v = sin(x)
+    nmath_inline vec4d sin( const vec4d& x )
+    {
+      vec4d s, c;
+      sincos( x, s, c );
+      return s;
+    }
+    //! v = cos(x)
+    nmath_inline vec4f cos( const vec4f& x )
+    {
+      vec4f s, c;
+      sincos( x, s, c );
+      return c;
+    }
+    //! v = cos(x)
+    nmath_inline vec8f cos( const vec8f& x )
+    {
+      vec8f s, c;
+      sincos( x, s, c );
+      return c;
+    }
+    //! v = cos(x)
+    nmath_inline vec4d cos( const vec4d& x )
+    {
+      vec4d s, c;
+      sincos( x, s, c );
+      return c;
+    }
+    //! v = tan(x)
+    nmath_inline vec4f tan( const vec4f& x )
+    {
+      vec4f s, c;
+      sincos( x, s, c );
+      return s / c;
+    }
+    //! v = tan(x)
+    nmath_inline vec8f tan( const vec8f& x )
+    {
+      vec8f s, c;
+      sincos( x, s, c );
+      return s / c;
+    }
+    //! v = tan(x)
+    nmath_inline vec4d tan( const vec4d& x )
+    {
+      vec4d s, c;
+      sincos( x, s, c );
+      return s / c;
+    }
+    //! v = atan2(y, x), angle of the point (x, y) in [-pi, pi]
+    nmath_inline vec4f atan2( const vec4f& y, const vec4f& x )
+    {
+      return detail::atan2f<vec4f>( y.packed, x.packed );
+    }
+    //! v = atan2(y, x), angle of the point (x, y) in [-pi, pi]
+    nmath_inline vec8f atan2( const vec8f& y, const vec8f& x )
+    {
+      return detail::atan2f<vec8f>( y.packed, x.packed );
+    }
+    //! v = atan2(y, x), angle of the point (x, y) in [-pi, pi]
+    nmath_inline vec4d atan2( const vec4d& y, const vec4d& x )
+    {
+      return detail::atan2d<vec4d>( y.packed, x.packed );
+    }
+    //! v = x^y for x >= 0
+    nmath_inline vec4f pow( const vec4f& x, const vec4f& y )
+    {
+      const auto e = detail::expf<vec4f>( ( y * vec4f( detail::logf<vec4f>( x.packed ) ) ).packed );
+      return detail::powFixup<vec4f, float>( y.packed, e );
+    }
+    //! v = x^y for x >= 0
+    nmath_inline vec8f pow( const vec8f& x, const vec8f& y )
+    {
+      const auto e = detail::expf<vec8f>( ( y * vec8f( detail::logf<vec8f>( x.packed ) ) ).packed );
+      return detail::powFixup<vec8f, float>( y.packed, e );
+    }
+    //! v = x^y for x >= 0
+    nmath_inline vec4d pow( const vec4d& x, const vec4d& y )
+    {
+      const auto e = detail::expd<vec4d>( ( y * vec4d( detail::logd<vec4d>( x.packed ) ) ).packed );
+      return detail::powFixup<vec4d, double>( y.packed, e );
+    }
+  }
+
+}
+
+#endif
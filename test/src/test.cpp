@@ -2,6 +2,32 @@
 #include "nm_vec4f.h"
 #include "nm_vec4d.h"
 #include "nm_vec8f.h"
+#include "nm_vec4i.h"
+#include "nm_vec8i.h"
+#include "nm_cpu.h"
+#include "nm_vecmath.h"
+#include "nm_gather.h"
+#include "nm_kernels.h"
+#include "nm_reduce.h"
+#include "nm_parallel.h"
+#include "nm_memory.h"
+#include "nm_mat4f.h"
+#include "nm_soa.h"
+#include "nm_quatf.h"
+#include "nm_ray.h"
+#include "nm_bvh.h"
+#include "nm_cull.h"
+#include "nm_broadphase.h"
+#include "nm_biquad.h"
+#include "nm_convolve.h"
+#include "nm_pcm.h"
+#include "nm_channels.h"
+#include "nm_resample.h"
+#include "nm_mix.h"
+#include <vector>
+#include <cmath>
+#include <atomic>
+#include <complex>
 
 using namespace snowhouse;
 using namespace bandit;
@@ -234,6 +260,86 @@ go_bandit( []()
         vec4f b( 0.0001f, -2355.5f, 42872.0f, 0.29343f );
         nm_assert_float( b.sum(), 40516.79353f );
       } );
+      it( "compares per lane into masks", [&]()
+      {
+        vec4f a( 1.0f, 2.0f, 3.0f, 4.0f );
+        vec4f b( 2.0f, 2.0f, 2.0f, NAN );
+        AssertThat( ( a < b ).bitmask(), Equals( 0b0001 ) );
+        AssertThat( ( a <= b ).bitmask(), Equals( 0b0011 ) );
+        AssertThat( ( a > b ).bitmask(), Equals( 0b0100 ) );
+        AssertThat( ( a >= b ).bitmask(), Equals( 0b0110 ) );
+        AssertThat( a.eq( b ).bitmask(), Equals( 0b0010 ) );
+        AssertThat( a.neq( b ).bitmask(), Equals( 0b1101 ) );
+        AssertThat( ( a < b ).any(), Is().True() );
+        AssertThat( ( a < b ).all(), Is().False() );
+        AssertThat( ( a > vec4f( 10.0f ) ).none(), Is().True() );
+        AssertThat( ( a > vec4f( 0.0f ) ).all(), Is().True() );
+      } );
+      it( "selects by mask", [&]()
+      {
+        vec4f a( 1.0f, -2.0f, 3.0f, -4.0f );
+        vec4f b( 10.0f, 20.0f, 30.0f, 40.0f );
+        auto v = select( a > vec4f( 0.0f ), a, b );
+        nm_assert_float( v.x, 1.0f );
+        nm_assert_float( v.y, 20.0f );
+        nm_assert_float( v.z, 3.0f );
+        nm_assert_float( v.w, 40.0f );
+      } );
+      it( "computes abs, min, max & clamp", [&]()
+      {
+        vec4f a( -1.5f, 2.0f, -0.0f, 7.0f );
+        vec4f b( 0.0f, 3.0f, 1.0f, -7.0f );
+        auto v = a.abs();
+        nm_assert_float( v.x, 1.5f );
+        nm_assert_float( v.y, 2.0f );
+        nm_assert_float_zero( v.z );
+        AssertThat( std::signbit( v.z ), Is().False() );
+        v = a.min( b );
+        nm_assert_float( v.x, -1.5f );
+        nm_assert_float( v.w, -7.0f );
+        v = a.max( b );
+        nm_assert_float( v.y, 3.0f );
+        nm_assert_float( v.w, 7.0f );
+        v = a.clamp( vec4f( -1.0f ), vec4f( 5.0f ) );
+        nm_assert_float( v.x, -1.0f );
+        nm_assert_float( v.y, 2.0f );
+        nm_assert_float( v.w, 5.0f );
+      } );
+      it( "approximates reciprocal & rsqrt", [&]()
+      {
+        vec4f a( 0.5f, 3.0f, 1000.0f, 0.001f );
+        float in[4], r0[4], r2[4], s1[4], d1[4];
+        a.storeUnaligned( in );
+        a.rcp<0>().storeUnaligned( r0 );
+        a.rcp<2>().storeUnaligned( r2 );
+        a.rsqrt<1>().storeUnaligned( s1 );
+        vec4f( 2.0f ).fastDiv( a ).storeUnaligned( d1 );
+        for ( int i = 0; i < 4; ++i )
+        {
+          AssertThat( r0[i] * in[i], EqualsWithDelta( 1.0f, 4e-4f ) );
+          AssertThat( r2[i] * in[i], EqualsWithDelta( 1.0f, 2e-7f ) );
+          AssertThat( s1[i] * std::sqrt( in[i] ), EqualsWithDelta( 1.0f, 4e-7f ) );
+          AssertThat( d1[i] * in[i], EqualsWithDelta( 2.0f, 8e-7f ) );
+        }
+      } );
+      it( "can load & store partial vectors", [&]()
+      {
+        float src[3] = { 1.0f, 2.0f, 3.0f };
+        float dst[4] = { 9.0f, 9.0f, 9.0f, 9.0f };
+        vec4f v;
+        v.loadPartial( src, 3 );
+        AssertThat( v.z, Equals( 3.0f ) );
+        AssertThat( v.w, Equals( 0.0f ) );
+        v.loadPartial( src, 0 );
+        AssertThat( v.x, Equals( 0.0f ) );
+        v.loadPartial( src, 1 );
+        v.storePartial( dst, 2 );
+        AssertThat( dst[0], Equals( 1.0f ) );
+        AssertThat( dst[1], Equals( 0.0f ) );
+        AssertThat( dst[2], Equals( 9.0f ) );
+        AssertThat( _mm_movemask_ps( _mm_castsi128_ps( vec4f::tailMask( 2 ) ) ), Equals( 0x3 ) );
+        AssertThat( _mm_movemask_ps( _mm_castsi128_ps( vec4f::tailMask( 100 ) ) ), Equals( 0xF ) );
+      } );
     } );
 
     // VEC4D ------------------------------------------------------------------
@@ -443,6 +549,94 @@ go_bandit( []()
         vec4d b( 0.0001, -2355.5, 42872.0, 0.29343 );
         nm_assert_double( b.sum(), 40516.79353 );
       } );
+      it( "compares per lane into masks", [&]()
+      {
+        vec4d a( 1.0, 2.0, 3.0, 4.0 );
+        vec4d b( 2.0, 2.0, 2.0, NAN );
+        AssertThat( ( a < b ).bitmask(), Equals( 0b0001 ) );
+        AssertThat( ( a <= b ).bitmask(), Equals( 0b0011 ) );
+        AssertThat( ( a > b ).bitmask(), Equals( 0b0100 ) );
+        AssertThat( ( a >= b ).bitmask(), Equals( 0b0110 ) );
+        AssertThat( a.eq( b ).bitmask(), Equals( 0b0010 ) );
+        AssertThat( a.neq( b ).bitmask(), Equals( 0b1101 ) );
+        AssertThat( ( a < b ).any(), Is().True() );
+        AssertThat( ( a < b ).all(), Is().False() );
+        AssertThat( ( a > vec4d( 10.0 ) ).none(), Is().True() );
+        AssertThat( ( a > vec4d( 0.0 ) ).all(), Is().True() );
+      } );
+      it( "selects by mask", [&]()
+      {
+        vec4d a( 1.0, -2.0, 3.0, -4.0 );
+        vec4d b( 10.0, 20.0, 30.0, 40.0 );
+        auto v = select( a > vec4d( 0.0 ), a, b );
+        nm_assert_double( v.x, 1.0 );
+        nm_assert_double( v.y, 20.0 );
+        nm_assert_double( v.z, 3.0 );
+        nm_assert_double( v.w, 40.0 );
+      } );
+      it( "computes abs, min, max & clamp", [&]()
+      {
+        vec4d a( -1.5, 2.0, -0.0, 7.0 );
+        vec4d b( 0.0, 3.0, 1.0, -7.0 );
+        auto v = a.abs();
+        nm_assert_double( v.x, 1.5 );
+        nm_assert_double( v.y, 2.0 );
+        nm_assert_double_zero( v.z );
+        AssertThat( std::signbit( v.z ), Is().False() );
+        v = a.min( b );
+        nm_assert_double( v.x, -1.5 );
+        nm_assert_double( v.w, -7.0 );
+        v = a.max( b );
+        nm_assert_double( v.y, 3.0 );
+        nm_assert_double( v.w, 7.0 );
+        v = a.clamp( vec4d( -1.0 ), vec4d( 5.0 ) );
+        nm_assert_double( v.x, -1.0 );
+        nm_assert_double( v.y, 2.0 );
+        nm_assert_double( v.w, 5.0 );
+      } );
+      it( "approximates reciprocal & rsqrt", [&]()
+      {
+        vec4d a( 0.5, 3.0, 1000.0, 0.001 );
+        double in[4], r0[4], r3[4], s2[4], d2[4];
+        a.storeUnaligned( in );
+        a.rcp<0>().storeUnaligned( r0 );
+        a.rcp<3>().storeUnaligned( r3 );
+        a.rsqrt<2>().storeUnaligned( s2 );
+        vec4d( 2.0 ).fastDiv( a ).storeUnaligned( d2 );
+        for ( int i = 0; i < 4; ++i )
+        {
+          AssertThat( r0[i] * in[i], EqualsWithDelta( 1.0, 4e-4 ) );
+          AssertThat( r3[i] * in[i], EqualsWithDelta( 1.0, 4e-16 ) );
+          AssertThat( s2[i] * std::sqrt( in[i] ), EqualsWithDelta( 1.0, 5e-14 ) );
+          AssertThat( d2[i] * in[i], EqualsWithDelta( 2.0, 2e-14 ) );
+        }
+      } );
+      it( "can load & store partial vectors", [&]()
+      {
+        double src[2] = { 1.0, 2.0 };
+        double dst[4] = { 9.0, 9.0, 9.0, 9.0 };
+        vec4d v;
+        v.loadPartial( src, 2 );
+        AssertThat( v.y, Equals( 2.0 ) );
+        AssertThat( v.z, Equals( 0.0 ) );
+        v.storePartial( dst, 3 );
+        AssertThat( dst[1], Equals( 2.0 ) );
+        AssertThat( dst[2], Equals( 0.0 ) );
+        AssertThat( dst[3], Equals( 9.0 ) );
+      } );
+      it( "can gather by index", [&]()
+      {
+        double table[8] = { 0.0, 1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0 };
+        auto v = gather( table, vec4i( 7, 0, 5, 5 ) );
+        AssertThat( v.x, Equals( 7.0 ) );
+        AssertThat( v.y, Equals( 0.0 ) );
+        AssertThat( v.w, Equals( 5.0 ) );
+        auto mask = vec4d( 1.0, -1.0, 1.0, -1.0 ) > vec4d( 0.0 );
+        v = gather( table, vec4i( 3, -100000, 4, -100000 ), mask, vec4d( -1.0 ) );
+        AssertThat( v.x, Equals( 3.0 ) );
+        AssertThat( v.y, Equals( -1.0 ) );
+        AssertThat( v.z, Equals( 4.0 ) );
+      } );
     } );
 
     // VEC8F ------------------------------------------------------------------
@@ -776,8 +970,2098 @@ go_bandit( []()
           nm_assert_float( parts[i].e7, values[i * 2 + 1] );
         }
       } );
+      it( "compares per lane into masks", [&]()
+      {
+        vec8f a( 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f, 8.0f );
+        vec8f b( 2.0f, 2.0f, 2.0f, NAN, 5.0f, 7.0f, 0.0f, 8.0f );
+        AssertThat( ( a < b ).bitmask(), Equals( 0b00100001 ) );
+        AssertThat( ( a <= b ).bitmask(), Equals( 0b10110011 ) );
+        AssertThat( ( a > b ).bitmask(), Equals( 0b01000100 ) );
+        AssertThat( ( a >= b ).bitmask(), Equals( 0b11010110 ) );
+        AssertThat( a.eq( b ).bitmask(), Equals( 0b10010010 ) );
+        AssertThat( a.neq( b ).bitmask(), Equals( 0b01101101 ) );
+        AssertThat( ( a > vec8f( 7.5f ) ).any(), Is().True() );
+        AssertThat( ( a > vec8f( 0.0f ) ).all(), Is().True() );
+        AssertThat( ( a > vec8f( 8.0f ) ).none(), Is().True() );
+      } );
+      it( "selects by mask", [&]()
+      {
+        vec8f a( 1.0f, -2.0f, 3.0f, -4.0f, -5.0f, 6.0f, -7.0f, 8.0f );
+        vec8f b( 0.0f );
+        auto v = select( a > b, a, b );
+        nm_assert_float( v.e0, 1.0f );
+        nm_assert_float_zero( v.e1 );
+        nm_assert_float( v.e5, 6.0f );
+        nm_assert_float_zero( v.e6 );
+        nm_assert_float( v.e7, 8.0f );
+      } );
+      it( "computes abs, min, max & clamp", [&]()
+      {
+        vec8f a( -1.5f, 2.0f, -3.0f, 7.0f, 0.25f, -0.5f, 100.0f, -100.0f );
+        auto v = a.abs();
+        nm_assert_float( v.e0, 1.5f );
+        nm_assert_float( v.e2, 3.0f );
+        nm_assert_float( v.e7, 100.0f );
+        v = a.min( vec8f( 0.0f ) );
+        nm_assert_float( v.e0, -1.5f );
+        nm_assert_float_zero( v.e1 );
+        v = a.max( vec8f( 0.0f ) );
+        nm_assert_float_zero( v.e0 );
+        nm_assert_float( v.e6, 100.0f );
+        v = a.clamp( vec8f( -1.0f ), vec8f( 1.0f ) );
+        nm_assert_float( v.e0, -1.0f );
+        nm_assert_float( v.e4, 0.25f );
+        nm_assert_float( v.e6, 1.0f );
+        nm_assert_float( v.e7, -1.0f );
+      } );
+      it( "approximates reciprocal & rsqrt", [&]()
+      {
+        vec8f a( 0.5f, 3.0f, 1000.0f, 0.001f, 7.0f, 1e6f, 1e-6f, 1.0f );
+        float in[8], r0[8], r2[8], s1[8], d1[8];
+        a.storeUnaligned( in );
+        a.rcp<0>().storeUnaligned( r0 );
+        a.rcp<2>().storeUnaligned( r2 );
+        a.rsqrt<1>().storeUnaligned( s1 );
+        vec8f( 2.0f ).fastDiv( a ).storeUnaligned( d1 );
+        for ( int i = 0; i < 8; ++i )
+        {
+          AssertThat( r0[i] * in[i], EqualsWithDelta( 1.0f, 4e-4f ) );
+          AssertThat( r2[i] * in[i], EqualsWithDelta( 1.0f, 2e-7f ) );
+          AssertThat( s1[i] * std::sqrt( in[i] ), EqualsWithDelta( 1.0f, 4e-7f ) );
+          AssertThat( d1[i] * in[i], EqualsWithDelta( 2.0f, 8e-7f ) );
+        }
+      } );
+      it( "can load & store partial vectors", [&]()
+      {
+        float src[5] = { 1.0f, 2.0f, 3.0f, 4.0f, 5.0f };
+        float dst[8] = { 9.0f, 9.0f, 9.0f, 9.0f, 9.0f, 9.0f, 9.0f, 9.0f };
+        vec8f v;
+        v.loadPartial( src, 5 );
+        AssertThat( v.e4, Equals( 5.0f ) );
+        AssertThat( v.e5, Equals( 0.0f ) );
+        AssertThat( v.e7, Equals( 0.0f ) );
+        v.storePartial( dst, 6 );
+        AssertThat( dst[4], Equals( 5.0f ) );
+        AssertThat( dst[5], Equals( 0.0f ) );
+        AssertThat( dst[6], Equals( 9.0f ) );
+      } );
+      it( "can gather by index", [&]()
+      {
+        float table[16];
+        for ( int i = 0; i < 16; ++i )
+          table[i] = static_cast<float>( i * 10 );
+        auto v = gather( table, vec8i( 15, 0, 3, 3, 7, 1, 8, 2 ) );
+        AssertThat( v.e0, Equals( 150.0f ) );
+        AssertThat( v.e1, Equals( 0.0f ) );
+        AssertThat( v.e3, Equals( 30.0f ) );
+        AssertThat( v.e6, Equals( 80.0f ) );
+        auto mask = vec8f( 0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f ) < vec8f( 4.0f );
+        v = gather( table, vec8i( 1, 2, 3, 4, -100000, -100000, -100000, -100000 ), mask, vec8f( -1.0f ) );
+        AssertThat( v.e3, Equals( 40.0f ) );
+        AssertThat( v.e4, Equals( -1.0f ) );
+        AssertThat( v.e7, Equals( -1.0f ) );
+      } );
+    } );
+
+    // VEC4I ------------------------------------------------------------------
+    describe( "vec4i", []()
+    {
+      it( "defaults to zero constructor", [&]()
+      {
+        vec4i v;
+        AssertThat( v.x, Equals( 0 ) );
+        AssertThat( v.y, Equals( 0 ) );
+        AssertThat( v.z, Equals( 0 ) );
+        AssertThat( v.w, Equals( 0 ) );
+      } );
+      it( "can load & store values", [&]()
+      {
+        nmath_16b_align int32_t vals[4] = { 1, -2, 300000, -2147483647 - 1 };
+        int32_t out[5] = { 0 };
+        vec4i v( vals );
+        AssertThat( v.x, Equals( 1 ) );
+        AssertThat( v.w, Equals( vals[3] ) );
+        v.storeUnaligned( out + 1 );
+        AssertThat( out[2], Equals( -2 ) );
+        AssertThat( out[3], Equals( 300000 ) );
+        v.loadUnaligned( out );
+        AssertThat( v.x, Equals( 0 ) );
+        AssertThat( v.y, Equals( 1 ) );
+      } );
+      it( "does wrapping arithmetic", [&]()
+      {
+        vec4i a( 1, -2, 2147483647, 100 );
+        vec4i b( 3, 5, 1, -7 );
+        auto v = a + b;
+        AssertThat( v.x, Equals( 4 ) );
+        AssertThat( v.z, Equals( -2147483647 - 1 ) );
+        v = a - b;
+        AssertThat( v.y, Equals( -7 ) );
+        AssertThat( v.w, Equals( 107 ) );
+        v = a * b;
+        AssertThat( v.y, Equals( -10 ) );
+        AssertThat( v.w, Equals( -700 ) );
+        AssertThat( a.sum(), Equals( static_cast<int32_t>( 1u - 2u + 2147483647u + 100u ) ) );
+      } );
+      it( "shifts arithmetically & logically", [&]()
+      {
+        vec4i a( 1, -16, 0x40000000, -1 );
+        auto v = a << 2;
+        AssertThat( v.x, Equals( 4 ) );
+        AssertThat( v.y, Equals( -64 ) );
+        AssertThat( v.z, Equals( 0 ) );
+        v = a >> 2;
+        AssertThat( v.y, Equals( -4 ) );
+        AssertThat( v.w, Equals( -1 ) );
+        v = a.shiftRightLogical( 28 );
+        AssertThat( v.y, Equals( 15 ) );
+        AssertThat( v.w, Equals( 15 ) );
+      } );
+      it( "compares per lane into masks", [&]()
+      {
+        vec4i a( 1, 2, 3, 4 );
+        vec4i b( 2, 2, 2, 2 );
+        AssertThat( ( a < b ).bitmask(), Equals( 0b0001 ) );
+        AssertThat( ( a <= b ).bitmask(), Equals( 0b0011 ) );
+        AssertThat( ( a > b ).bitmask(), Equals( 0b1100 ) );
+        AssertThat( ( a >= b ).bitmask(), Equals( 0b1110 ) );
+        AssertThat( a.eq( b ).bitmask(), Equals( 0b0010 ) );
+        AssertThat( a.neq( b ).bitmask(), Equals( 0b1101 ) );
+        AssertThat( a == vec4i( 1, 2, 3, 4 ), Is().True() );
+        AssertThat( a != b, Is().True() );
+        auto v = select( a > b, a, b );
+        AssertThat( v.x, Equals( 2 ) );
+        AssertThat( v.w, Equals( 4 ) );
+      } );
+      it( "computes abs, min, max & clamp", [&]()
+      {
+        vec4i a( -5, 3, -100, 100 );
+        AssertThat( a.abs().x, Equals( 5 ) );
+        AssertThat( a.min( vec4i( 0 ) ).y, Equals( 0 ) );
+        AssertThat( a.max( vec4i( 0 ) ).x, Equals( 0 ) );
+        auto v = a.clamp( vec4i( -10 ), vec4i( 10 ) );
+        AssertThat( v.z, Equals( -10 ) );
+        AssertThat( v.w, Equals( 10 ) );
+      } );
+      it( "converts to & from vec4f", [&]()
+      {
+        vec4f f( 1.5f, -2.5f, 2.7f, -3.7f );
+        auto r = vec4i::convert( f );
+        AssertThat( r.x, Equals( 2 ) );
+        AssertThat( r.y, Equals( -2 ) );
+        AssertThat( r.z, Equals( 3 ) );
+        AssertThat( r.w, Equals( -4 ) );
+        auto t = vec4i::truncate( f );
+        AssertThat( t.x, Equals( 1 ) );
+        AssertThat( t.w, Equals( -3 ) );
+        auto back = t.toFloat();
+        nm_assert_float( back.y, -2.0f );
+        // exponent manipulation: 1.0f * 2^3 by adding to the exponent bits
+        auto bits = vec4i::bitcast( vec4f( 1.0f ) ) + ( vec4i( 3 ) << 23 );
+        nm_assert_float( bits.asFloat().z, 8.0f );
+      } );
+    } );
+
+    // VEC8I ------------------------------------------------------------------
+    describe( "vec8i", []()
+    {
+      it( "can load & store values", [&]()
+      {
+        nmath_32b_align int32_t vals[8] = { 1, -2, 3, -4, 5, -6, 7, -8 };
+        int32_t out[8] = { 0 };
+        vec8i v( vals );
+        AssertThat( v.e0, Equals( 1 ) );
+        AssertThat( v.e7, Equals( -8 ) );
+        v.storeUnaligned( out );
+        AssertThat( out[5], Equals( -6 ) );
+        AssertThat( v.low().w, Equals( -4 ) );
+        AssertThat( v.high().x, Equals( 5 ) );
+        vec8i w( v.high(), v.low() );
+        AssertThat( w.e0, Equals( 5 ) );
+        AssertThat( w.e4, Equals( 1 ) );
+      } );
+      it( "does wrapping arithmetic", [&]()
+      {
+        vec8i a( 1, 2, 3, 4, 5, 6, 7, 2147483647 );
+        vec8i b( 10 );
+        auto v = a + b;
+        AssertThat( v.e0, Equals( 11 ) );
+        AssertThat( v.e7, Equals( -2147483647 + 8 ) );
+        v = a - b;
+        AssertThat( v.e3, Equals( -6 ) );
+        v = a * b;
+        AssertThat( v.e6, Equals( 70 ) );
+        AssertThat( vec8i( 1, 2, 3, 4, 5, 6, 7, 8 ).sum(), Equals( 36 ) );
+      } );
+      it( "shifts arithmetically & logically", [&]()
+      {
+        vec8i a( 1, -16, 3, 4, 5, 6, 7, -1 );
+        AssertThat( ( a << 4 ).e6, Equals( 112 ) );
+        AssertThat( ( a >> 2 ).e1, Equals( -4 ) );
+        AssertThat( a.shiftRightLogical( 31 ).e7, Equals( 1 ) );
+      } );
+      it( "compares per lane into masks", [&]()
+      {
+        vec8i a( 1, 2, 3, 4, 5, 6, 7, 8 );
+        vec8i b( 4 );
+        AssertThat( ( a < b ).bitmask(), Equals( 0b00000111 ) );
+        AssertThat( ( a <= b ).bitmask(), Equals( 0b00001111 ) );
+        AssertThat( ( a > b ).bitmask(), Equals( 0b11110000 ) );
+        AssertThat( ( a >= b ).bitmask(), Equals( 0b11111000 ) );
+        AssertThat( a.eq( b ).bitmask(), Equals( 0b00001000 ) );
+        AssertThat( a.neq( b ).bitmask(), Equals( 0b11110111 ) );
+        AssertThat( ( a > vec8i( 0 ) ).all(), Is().True() );
+        AssertThat( a == b, Is().False() );
+        auto v = select( a < b, b, a ).min( vec8i( 6 ) ).abs();
+        AssertThat( v.e0, Equals( 4 ) );
+        AssertThat( v.e5, Equals( 6 ) );
+        AssertThat( v.e7, Equals( 6 ) );
+      } );
+      it( "converts to & from vec8f", [&]()
+      {
+        vec8f f( 0.4f, 0.6f, -0.4f, -0.6f, 100.5f, 101.5f, -1e6f, 3.99f );
+        auto r = vec8i::convert( f );
+        AssertThat( r.e1, Equals( 1 ) );
+        AssertThat( r.e3, Equals( -1 ) );
+        AssertThat( r.e4, Equals( 100 ) );
+        AssertThat( r.e5, Equals( 102 ) );
+        AssertThat( r.e6, Equals( -1000000 ) );
+        auto t = vec8i::truncate( f );
+        AssertThat( t.e7, Equals( 3 ) );
+        nm_assert_float( t.toFloat().e6, -1e6f );
+        // lut indexing: low bits of the mantissa survive the round trip
+        AssertThat( vec8i::bitcast( vec8f( 1.0f ) ).e2, Equals( 0x3F800000 ) );
+        nm_assert_float( vec8i( 0x40000000 ).asFloat().e0, 2.0f );
+      } );
+    } );
+
+    // CPU --------------------------------------------------------------------
+    describe( "cpu", []()
+    {
+      it( "reports a consistent feature hierarchy", [&]()
+      {
+        const auto& info = cpu();
+        if ( info.avx2 )
+          AssertThat( info.avx, Is().True() );
+        if ( info.fma )
+          AssertThat( info.avx, Is().True() );
+        if ( info.avx )
+          AssertThat( info.sse41, Is().True() );
+      } );
+      it( "reports no isa level without SSE4.1", [&]()
+      {
+        cpuinfo info;
+        AssertThat( info.best(), Equals( isa::none ) );
+        AssertThat( info.supports( isa::sse41 ), Is().False() );
+        info.sse41 = true;
+        AssertThat( info.best(), Equals( isa::sse41 ) );
+        AssertThat( info.supports( isa::avx ), Is().False() );
+      } );
+      it( "supports the isa the tests were compiled for", [&]()
+      {
+        AssertThat( cpu().supports( compiledIsa ), Is().True() );
+      } );
+      it( "dispatches to the best available implementation", [&]()
+      {
+        using fn = int ( * )();
+        fn impls[3] = {
+          []() { return 0; },
+          []() { return 1; },
+          []() { return 2; }
+        };
+        dispatcher<fn> all( impls[0], impls[1], impls[2] );
+        AssertThat( all(), Equals( static_cast<int>( cpu().best() ) ) );
+        AssertThat( all.level(), Equals( cpu().best() ) );
+        dispatcher<fn> baseline( impls[0], nullptr, nullptr );
+        AssertThat( baseline(), Equals( 0 ) );
+        AssertThat( baseline.level(), Equals( isa::sse41 ) );
+      } );
+      it( "computes fma with or without FMA3", [&]()
+      {
+        vec8f a( 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f, 8.0f );
+        vec8f b( 0.5f );
+        vec8f c( -1.0f );
+        auto v = a.fma( a, b, c );
+        nm_assert_float( v.e0, -0.5f );
+        nm_assert_float( v.e3, 1.0f );
+        nm_assert_float( v.e7, 3.0f );
+        v = a.fms( a, b, c );
+        nm_assert_float( v.e0, 1.5f );
+        nm_assert_float( v.e7, 5.0f );
+      } );
     } );
 
+    // VECMATH ----------------------------------------------------------------
+    describe( "vecmath", []()
+    {
+      it( "computes exp & log (float)", [&]()
+      {
+        vec8f x( -80.0f, -10.5f, -1.0f, -0.001f, 0.0f, 0.5f, 10.25f, 88.0f );
+        float in[8], e[8], l[8];
+        x.storeUnaligned( in );
+        exp( x ).storeUnaligned( e );
+        log( exp( x ) ).storeUnaligned( l );
+        for ( int i = 0; i < 8; ++i )
+        {
+          AssertThat( e[i], EqualsWithDelta( std::exp( in[i] ), std::exp( in[i] ) * 2e-7f ) );
+          AssertThat( l[i], EqualsWithDelta( in[i], std::fabs( in[i] ) * 2e-7f + 1e-7f ) );
+        }
+        const auto e4 = exp( vec4f( 1.0f ) );
+        nm_assert_float( e4.x, 2.7182818f );
+      } );
+      it( "computes exp & log (double)", [&]()
+      {
+        vec4d x( -700.0, -1.0, 0.75, 300.0 );
+        double in[4], e[4], l[4];
+        x.storeUnaligned( in );
+        exp( x ).storeUnaligned( e );
+        log( exp( x ) ).storeUnaligned( l );
+        for ( int i = 0; i < 4; ++i )
+        {
+          AssertThat( e[i], EqualsWithDelta( std::exp( in[i] ), std::exp( in[i] ) * 1e-15 ) );
+          AssertThat( l[i], EqualsWithDelta( in[i], std::fabs( in[i] ) * 1e-15 ) );
+        }
+      } );
+      it( "returns IEEE results for log edge cases", [&]()
+      {
+        const auto v = log( vec4f( 0.0f, -1.0f, INFINITY, 1.0f ) );
+        AssertThat( std::isinf( v.x ) && v.x < 0.0f, Is().True() );
+        AssertThat( std::isnan( v.y ), Is().True() );
+        AssertThat( std::isinf( v.z ) && v.z > 0.0f, Is().True() );
+        nm_assert_float_zero( v.w );
+        const auto d = log( vec4d( 4.9e-324, 0.0, -0.5, 1.0 ) );
+        AssertThat( d.x, EqualsWithDelta( -744.44007192138126, 1e-12 ) );
+        AssertThat( std::isinf( d.y ), Is().True() );
+        AssertThat( std::isnan( d.z ), Is().True() );
+      } );
+      it( "computes sin, cos & tan", [&]()
+      {
+        const float angles[8] = { -7.0f, -3.0f, -1.5f, -0.25f, 0.0f, 0.8f, 2.5f, 100.0f };
+        vec8f x;
+        x.loadUnaligned( angles );
+        float s[8], c[8], t[8];
+        sin( x ).storeUnaligned( s );
+        cos( x ).storeUnaligned( c );
+        tan( x ).storeUnaligned( t );
+        for ( int i = 0; i < 8; ++i )
+        {
+          AssertThat( s[i], EqualsWithDelta( std::sin( angles[i] ), 2e-7f ) );
+          AssertThat( c[i], EqualsWithDelta( std::cos( angles[i] ), 2e-7f ) );
+          AssertThat( t[i], EqualsWithDelta( std::tan( angles[i] ), std::fabs( std::tan( angles[i] ) ) * 5e-7f ) );
+        }
+        vec4d sd, cd;
+        sincos( vec4d( -5.0, 0.1, 1.0, 1e6 ), sd, cd );
+        AssertThat( sd.x, EqualsWithDelta( std::sin( -5.0 ), 1e-15 ) );
+        AssertThat( cd.y, EqualsWithDelta( std::cos( 0.1 ), 1e-15 ) );
+        AssertThat( sd.w, EqualsWithDelta( std::sin( 1e6 ), 1e-15 ) );
+        AssertThat( cd.w, EqualsWithDelta( std::cos( 1e6 ), 1e-15 ) );
+      } );
+      it( "computes atan2 in all quadrants", [&]()
+      {
+        const vec4f y( 1.0f, 1.0f, -1.0f, -2.0f );
+        const vec4f x( 2.0f, -2.0f, -0.5f, 3.0f );
+        const auto f = atan2( y, x );
+        nm_assert_float( f.x, std::atan2( 1.0f, 2.0f ) );
+        nm_assert_float( f.y, std::atan2( 1.0f, -2.0f ) );
+        nm_assert_float( f.z, std::atan2( -1.0f, -0.5f ) );
+        nm_assert_float( f.w, std::atan2( -2.0f, 3.0f ) );
+        const auto d = atan2( vec4d( 0.0, 0.0, 5.0, -5.0 ), vec4d( 0.0, -1.0, 0.0, 0.0 ) );
+        nm_assert_double_zero( d.x );
+        AssertThat( d.y, EqualsWithDelta( 3.14159265358979323846, 1e-15 ) );
+        AssertThat( d.z, EqualsWithDelta( 1.57079632679489661923, 1e-15 ) );
+        AssertThat( d.w, EqualsWithDelta( -1.57079632679489661923, 1e-15 ) );
+      } );
+      it( "computes pow", [&]()
+      {
+        const auto v = pow( vec8f( 2.0f, 10.0f, 0.5f, 0.0f, 0.0f, 0.0f, 9.0f, 1.0f ), vec8f( 10.0f, -2.0f, 3.0f, 2.0f, 0.0f, -1.0f, 0.5f, 123.0f ) );
+        AssertThat( v.e0, EqualsWithDelta( 1024.0f, 1024.0f * 2e-6f ) );
+        nm_assert_float( v.e1, 0.01f );
+        nm_assert_float( v.e2, 0.125f );
+        nm_assert_float_zero( v.e3 );
+        nm_assert_float( v.e4, 1.0f );
+        AssertThat( std::isinf( v.e5 ), Is().True() );
+        nm_assert_float( v.e6, 3.0f );
+        nm_assert_float( v.e7, 1.0f );
+        const auto d = pow( vec4d( 2.0 ), vec4d( 0.5, 52.0, -1.0, 0.0 ) );
+        AssertThat( d.x, EqualsWithDelta( 1.4142135623730951, 1e-14 ) );
+        AssertThat( d.y, EqualsWithDelta( 4503599627370496.0, 1e2 ) );
+        AssertThat( d.z, EqualsWithDelta( 0.5, 1e-15 ) );
+        AssertThat( d.w, EqualsWithDelta( 1.0, 1e-15 ) );
+      } );
+    } );
+
+    // MAT4F ------------------------------------------------------------------
+    describe( "mat4f", []()
+    {
+      // plain row-major reference product
+      auto reference = []( const mat4f& a, const mat4f& b )
+      {
+        float m[16];
+        for ( int i = 0; i < 4; ++i )
+          for ( int j = 0; j < 4; ++j )
+          {
+            m[i * 4 + j] = 0.0f;
+            for ( int k = 0; k < 4; ++k )
+              m[i * 4 + j] += a( i, k ) * b( k, j );
+          }
+        mat4f r;
+        r.loadUnaligned( m );
+        return r;
+      };
+      auto assertNear = []( const mat4f& a, const mat4f& b, float delta )
+      {
+        for ( int i = 0; i < 4; ++i )
+          for ( int j = 0; j < 4; ++j )
+            AssertThat( a( i, j ), EqualsWithDelta( b( i, j ), delta ) );
+      };
+      const mat4f m( vec4f( 2.0f, 0.5f, -1.0f, 0.25f ), vec4f( 0.0f, 3.0f, 1.5f, -2.0f ), vec4f( 1.0f, -1.0f, 4.0f, 0.5f ), vec4f( -3.0f, 2.0f, 0.0f, 1.0f ) );
+      it( "multiplies matrices & vectors", [&]()
+      {
+        const mat4f n = m.transposed() * mat4f::scaling( 1.0f, 2.0f, 3.0f );
+        assertNear( m * n, reference( m, n ), 1e-5f );
+        AssertThat( m * mat4f::identity() == m, Is().True() );
+        const auto v = mat4f::translation( 1.0f, 2.0f, 3.0f ).transform( vec4f( 5.0f, 6.0f, 7.0f, 1.0f ) );
+        AssertThat( v == vec4f( 6.0f, 8.0f, 10.0f, 1.0f ), Is().True() );
+        const auto d = m.transform( vec4f( 0.0f, 1.0f, 0.0f, 0.0f ) );
+        AssertThat( d == m.rows[1], Is().True() );
+      } );
+      it( "transposes", [&]()
+      {
+        const auto t = m.transposed();
+        for ( int i = 0; i < 4; ++i )
+          for ( int j = 0; j < 4; ++j )
+            AssertThat( t( i, j ), Equals( m( j, i ) ) );
+      } );
+      it( "inverts general & affine matrices", [&]()
+      {
+        assertNear( m * m.inverse(), mat4f::identity(), 1e-5f );
+        assertNear( m.inverse() * m, mat4f::identity(), 1e-5f );
+        const mat4f affine = mat4f::scaling( 2.0f, -0.5f, 4.0f ) * mat4f( vec4f( 0.0f, 1.0f, 0.0f, 0.0f ), vec4f( -1.0f, 0.0f, 0.0f, 0.0f ), vec4f( 0.0f, 0.0f, 1.0f, 0.0f ), vec4f( 0.0f, 0.0f, 0.0f, 1.0f ) ) * mat4f::translation( 3.0f, -7.0f, 0.5f );
+        assertNear( affine * affine.inverseAffine(), mat4f::identity(), 1e-6f );
+        assertNear( affine.inverseAffine(), affine.inverse(), 1e-6f );
+      } );
+      it( "multiplies arrays of matrices", [&]()
+      {
+        aligned_vector<mat4f> a( 5 ), b( 5 ), c( 5 );
+        for ( size_t i = 0; i < a.size(); ++i )
+        {
+          a[i] = m * mat4f::translation( static_cast<float>( i ), 1.0f, 0.0f );
+          b[i] = m.transposed() * mat4f::scaling( 1.0f, static_cast<float>( i ), 2.0f );
+        }
+        multiply( c.data(), a.data(), b.data(), a.size() );
+        for ( size_t i = 0; i < a.size(); ++i )
+          assertNear( c[i], a[i] * b[i], 1e-4f );
+        // in place
+        multiply( a.data(), a.data(), b.data(), a.size() );
+        AssertThat( a[4] == c[4], Is().True() );
+      } );
+      it( "transforms points & directions in separate x, y & z arrays", [&]()
+      {
+        // 19 covers two full vectors & a tail
+        const size_t n = 19;
+        std::vector<float> x( n ), y( n ), z( n ), ox( n ), oy( n ), oz( n );
+        for ( size_t i = 0; i < n; ++i )
+        {
+          x[i] = static_cast<float>( i ) * 0.5f - 3.0f;
+          y[i] = 1.0f - static_cast<float>( i % 5 );
+          z[i] = static_cast<float>( i % 3 ) + 2.0f;
+        }
+        auto check = [&]( void ( *fn )( const mat4f&, const float*, const float*, const float*, float*, float*, float*, size_t ), const mat4f& mat, float w, bool divide )
+        {
+          fn( mat, x.data(), y.data(), z.data(), ox.data(), oy.data(), oz.data(), n );
+          for ( size_t i = 0; i < n; ++i )
+          {
+            auto r = mat.transform( vec4f( x[i], y[i], z[i], w ) );
+            const float s = ( divide ? 1.0f / r.w : 1.0f );
+            AssertThat( ox[i], EqualsWithDelta( r.x * s, 1e-4f ) );
+            AssertThat( oy[i], EqualsWithDelta( r.y * s, 1e-4f ) );
+            AssertThat( oz[i], EqualsWithDelta( r.z * s, 1e-4f ) );
+          }
+        };
+        check( transformPoints, m, 1.0f, false );
+        check( transformDirections, m, 0.0f, false );
+        // perspective with w' = z
+        const mat4f projection( vec4f( 1.0f, 0.0f, 0.0f, 0.0f ), vec4f( 0.0f, 1.0f, 0.0f, 0.0f ), vec4f( 0.0f, 0.0f, 1.0f, 1.0f ), vec4f( 0.0f, 0.0f, -0.1f, 0.0f ) );
+        check( projectPoints, projection, 1.0f, true );
+        // in place
+        const auto expected = m.transform( vec4f( x[n - 1], y[n - 1], z[n - 1], 1.0f ) );
+        transformPoints( m, x.data(), y.data(), z.data(), x.data(), y.data(), z.data(), n );
+        AssertThat( x[n - 1], EqualsWithDelta( expected.x, 1e-4f ) );
+        AssertThat( z[n - 1], EqualsWithDelta( expected.z, 1e-4f ) );
+      } );
+    } );
+
+    // SOA --------------------------------------------------------------------
+    describe( "soa", []()
+    {
+      // 21 covers two full vectors & a tail
+      const size_t n = 21;
+      it( "transposes xyz triples to streams & back", [&]()
+      {
+        std::vector<float> xyz( 3 * n ), back( 3 * n );
+        for ( size_t i = 0; i < xyz.size(); ++i )
+          xyz[i] = static_cast<float>( i );
+        soa3f s;
+        s.assignInterleaved( xyz.data(), n );
+        AssertThat( s.size(), Equals( n ) );
+        AssertThat( s.padded(), Equals( size_t( 24 ) ) );
+        for ( size_t i = 0; i < n; ++i )
+        {
+          AssertThat( s.x[i], Equals( xyz[3 * i] ) );
+          AssertThat( s.y[i], Equals( xyz[3 * i + 1] ) );
+          AssertThat( s.z[i], Equals( xyz[3 * i + 2] ) );
+        }
+        AssertThat( s.x[n], Equals( 0.0f ) );
+        s.storeInterleaved( back.data() );
+        AssertThat( back, Equals( xyz ) );
+      } );
+      it( "transposes xyzw quadruples to streams & back", [&]()
+      {
+        std::vector<float> xyzw( 4 * n ), back( 4 * n );
+        for ( size_t i = 0; i < xyzw.size(); ++i )
+          xyzw[i] = static_cast<float>( i );
+        soa4f s;
+        s.assignInterleaved( xyzw.data(), n );
+        for ( size_t i = 0; i < n; ++i )
+        {
+          AssertThat( s.x[i], Equals( xyzw[4 * i] ) );
+          AssertThat( s.y[i], Equals( xyzw[4 * i + 1] ) );
+          AssertThat( s.z[i], Equals( xyzw[4 * i + 2] ) );
+          AssertThat( s.w[i], Equals( xyzw[4 * i + 3] ) );
+        }
+        s.storeInterleaved( back.data() );
+        AssertThat( back, Equals( xyzw ) );
+      } );
+    } );
+
+    // QUATF ------------------------------------------------------------------
+    describe( "quatf", []()
+    {
+      const float pi = 3.14159265358979f;
+      const auto a = quatf::axisAngle( 0.0f, 0.0f, 1.0f, pi / 2.0f );
+      const auto b = quatf::axisAngle( 0.6f, 0.0f, 0.8f, 1.0f );
+      auto assertNear = []( const vec4f& p, const vec4f& q, float delta )
+      {
+        AssertThat( p.x, EqualsWithDelta( q.x, delta ) );
+        AssertThat( p.y, EqualsWithDelta( q.y, delta ) );
+        AssertThat( p.z, EqualsWithDelta( q.z, delta ) );
+        AssertThat( p.w, EqualsWithDelta( q.w, delta ) );
+      };
+      it( "rotates, multiplies & converts to and from matrices", [&]()
+      {
+        assertNear( a.rotate( vec4f( 1.0f, 0.0f, 0.0f, 1.0f ) ), vec4f( 0.0f, 1.0f, 0.0f, 1.0f ), 1e-6f );
+        const vec4f p( 0.5f, -2.0f, 3.0f, 0.0f );
+        assertNear( ( a * b ).rotate( p ), a.rotate( b.rotate( p ) ), 1e-5f );
+        assertNear( b.toMatrix().transform( p ), b.rotate( p ), 1e-5f );
+        const auto ab = ( a * b ).toMatrix();
+        const auto chained = b.toMatrix() * a.toMatrix();
+        for ( int i = 0; i < 4; ++i )
+          assertNear( ab.rows[i], chained.rows[i], 1e-5f );
+        assertNear( ( b * b.conjugate() ).v, quatf::identity().v, 1e-6f );
+        assertNear( quatf( 1.0f, 2.0f, 2.0f, 4.0f ).normalized().v, vec4f( 0.2f, 0.4f, 0.4f, 0.8f ), 1e-6f );
+        // every branch of the matrix conversion, & the same rotation for q and -q
+        for ( const auto& q : { a, b, quatf::axisAngle( 1.0f, 0.0f, 0.0f, 3.0f ), quatf::axisAngle( 0.0f, 1.0f, 0.0f, 3.0f ), quatf::axisAngle( 0.0f, 0.0f, 1.0f, 3.0f ) } )
+        {
+          const auto back = quatf::fromMatrix( q.toMatrix() );
+          AssertThat( std::fabs( back.dot( q ) ), EqualsWithDelta( 1.0f, 1e-5f ) );
+        }
+      } );
+      it( "interpolates one at a time", [&]()
+      {
+        // halfway between two rotations about z is the rotation by the mean angle
+        const auto z1 = quatf::axisAngle( 0.0f, 0.0f, 1.0f, 0.4f );
+        const auto z2 = quatf::axisAngle( 0.0f, 0.0f, 1.0f, 1.6f );
+        assertNear( slerp( z1, z2, 0.25f ).v, quatf::axisAngle( 0.0f, 0.0f, 1.0f, 0.7f ).v, 1e-6f );
+        assertNear( nlerp( z1, z2, 0.5f ).v, quatf::axisAngle( 0.0f, 0.0f, 1.0f, 1.0f ).v, 1e-6f );
+        // the shorter arc: -z2 is the same rotation
+        const quatf negated( vec4f( 0.0f ) - z2.v );
+        assertNear( slerp( z1, negated, 0.25f ).v, quatf::axisAngle( 0.0f, 0.0f, 1.0f, 0.7f ).v, 1e-6f );
+        assertNear( slerp( z1, z1, 0.3f ).v, z1.v, 1e-6f );
+      } );
+      it( "interpolates streams eight at a time", [&]()
+      {
+        // 13 covers a full vector & a tail
+        const size_t n = 13;
+        soa4f sa( n ), sb( n ), out;
+        for ( size_t i = 0; i < n; ++i )
+        {
+          const float f = static_cast<float>( i );
+          const auto qa = quatf::axisAngle( 0.6f, 0.0f, 0.8f, 0.3f * f );
+          // odd ones on the far side, & one pair that is nearly equal
+          auto qb = quatf::axisAngle( 0.0f, 0.8f, 0.6f, i == 5 ? 1e-4f : 2.0f - 0.2f * f );
+          if ( i % 2 )
+            qb = quatf( vec4f( 0.0f ) - qb.v );
+          sa.x[i] = qa.v.x, sa.y[i] = qa.v.y, sa.z[i] = qa.v.z, sa.w[i] = qa.v.w;
+          sb.x[i] = qb.v.x, sb.y[i] = qb.v.y, sb.z[i] = qb.v.z, sb.w[i] = qb.v.w;
+        }
+        for ( const float t : { 0.0f, 0.3f, 1.0f } )
+        {
+          slerp( out, sa, sb, t );
+          AssertThat( out.size(), Equals( n ) );
+          for ( size_t i = 0; i < n; ++i )
+          {
+            const quatf qa( sa.x[i], sa.y[i], sa.z[i], sa.w[i] ), qb( sb.x[i], sb.y[i], sb.z[i], sb.w[i] );
+            assertNear( vec4f( out.x[i], out.y[i], out.z[i], out.w[i] ), slerp( qa, qb, t ).v, 2e-6f );
+          }
+          nlerp( out, sa, sb, t );
+          for ( size_t i = 0; i < n; ++i )
+          {
+            const quatf qa( sa.x[i], sa.y[i], sa.z[i], sa.w[i] ), qb( sb.x[i], sb.y[i], sb.z[i], sb.w[i] );
+            assertNear( vec4f( out.x[i], out.y[i], out.z[i], out.w[i] ), nlerp( qa, qb, t ).v, 2e-6f );
+          }
+          // the padding stays zero
+          AssertThat( out.w[n], Equals( 0.0f ) );
+        }
+        // streams of different sizes only go as far as the shorter one
+        soa4f few( 3 );
+        for ( size_t i = 0; i < 3; ++i )
+          few.x[i] = sb.x[i], few.y[i] = sb.y[i], few.z[i] = sb.z[i], few.w[i] = sb.w[i];
+        slerp( out, sa, few, 0.5f );
+        AssertThat( out.size(), Equals( size_t( 3 ) ) );
+        nlerp( out, few, sa, 0.5f );
+        AssertThat( out.size(), Equals( size_t( 3 ) ) );
+        assertNear( vec4f( out.x[2], out.y[2], out.z[2], out.w[2] ),
+          nlerp( quatf( few.x[2], few.y[2], few.z[2], few.w[2] ), quatf( sa.x[2], sa.y[2], sa.z[2], sa.w[2] ), 0.5f ).v, 2e-6f );
+      } );
+    } );
+
+    // RAY --------------------------------------------------------------------
+    describe( "ray", []()
+    {
+      const float lo[3] = { 0.0f, 0.0f, 0.0f }, hi[3] = { 1.0f, 1.0f, 1.0f };
+      it( "tests eight rays against a box", [&]()
+      {
+        rayf rays[8] = {
+          { { -1.0f, 0.5f, 0.5f }, { 1.0f, 0.0f, 0.0f } }, // through
+          { { -1.0f, 2.0f, 0.5f }, { 1.0f, 0.0f, 0.0f } }, // passes above
+          { { 2.0f, 0.5f, 0.5f }, { 1.0f, 0.0f, 0.0f } }, // box behind the origin
+          { { 0.5f, 0.5f, 0.5f }, { 0.0f, 0.0f, 1.0f } }, // starts inside
+          { { -1.0f, 0.0f, 0.5f }, { 1.0f, 0.0f, 0.0f } }, // along the y = 0 face
+          { { -1.0f, -1.0f, 0.5f }, { 1.0f, 1.0f, 0.0f } }, // through the z edge at the origin
+          { { -1.0f, 0.5f, 0.5f }, { 1.0f, 0.0f, 0.0f }, 0.0f, 0.5f }, // ends short
+          { { -1.0f, 1.0f, 0.5f }, { 1.0f, -0.0f, 0.0f } } // along the y = 1 face, negative zero
+        };
+        vec8f tnear;
+        const int mask = intersect( ray8f::gather( rays ), aabb8f::splat( lo, hi ), tnear );
+        AssertThat( mask, Equals( 0b10111001 ) );
+        AssertThat( tnear.e0, Equals( 1.0f ) );
+        AssertThat( tnear.e3, Equals( 0.0f ) );
+        AssertThat( tnear.e4, Equals( 1.0f ) );
+        AssertThat( tnear.e5, Equals( 1.0f ) );
+        AssertThat( tnear.e7, Equals( 1.0f ) );
+        AssertThat( std::isinf( tnear.e1 ), Is().True() );
+      } );
+      it( "tests a ray against eight boxes", [&]()
+      {
+        aabb8f boxes;
+        for ( int i = 0; i < 8; ++i )
+        {
+          // a row of boxes along x, every odd one moved out of the way
+          const float y = ( i % 2 ? 3.0f : 0.0f );
+          const float blo[3] = { 2.0f * i, y, 0.0f }, bhi[3] = { 2.0f * i + 1.0f, y + 1.0f, 1.0f };
+          boxes.set( i, blo, bhi );
+        }
+        boxes.clear( 6 );
+        const rayf ray = { { -1.0f, 0.5f, 0.5f }, { 2.0f, 0.0f, 0.0f }, 0.0f, 6.0f };
+        vec8f tnear;
+        const int mask = intersect( ray8f::splat( ray ), boxes, tnear );
+        // the odd boxes are out of the way & box 6 is cleared
+        AssertThat( mask, Equals( 0b00010101 ) );
+        AssertThat( tnear.e0, Equals( 0.5f ) );
+        AssertThat( tnear.e2, Equals( 2.5f ) );
+        AssertThat( tnear.e4, Equals( 4.5f ) );
+        // cleared boxes are missed from everywhere, in every direction
+        const rayf back = { { 20.0f, 20.0f, 20.0f }, { -1.0f, -1.0f, -1.0f } };
+        AssertThat( intersect( ray8f::splat( back ), boxes, tnear ) & 0b01000000, Equals( 0 ) );
+      } );
+      it( "tests a ray against eight triangles", [&]()
+      {
+        // triangles in the z = i plane, every odd one shifted off the ray
+        tri8f tris;
+        for ( int i = 0; i < 8; ++i )
+        {
+          const float z = static_cast<float>( i ) + 1.0f, x = ( i % 2 ? 5.0f : 0.0f );
+          const float a[3] = { x, 0.0f, z }, b[3] = { x + 2.0f, 0.0f, z }, c[3] = { x, 2.0f, z };
+          tris.set( i, a, b, c );
+        }
+        tris.clear( 4 );
+        const rayf ray = { { 0.5f, 0.25f, 0.0f }, { 0.0f, 0.0f, 1.0f }, 0.0f, 7.5f };
+        vec8f t, u, v;
+        // lane 4 is cleared, lane 6 is past tmax at 7
+        const int mask = intersect( ray8f::splat( ray ), tris, t, u, v );
+        AssertThat( mask, Equals( 0b01000101 ) );
+        AssertThat( t.e0, EqualsWithDelta( 1.0f, 1e-6f ) );
+        AssertThat( u.e0, EqualsWithDelta( 0.25f, 1e-6f ) );
+        AssertThat( v.e0, EqualsWithDelta( 0.125f, 1e-6f ) );
+        AssertThat( t.e2, EqualsWithDelta( 3.0f, 1e-6f ) );
+        // parallel to the triangles' plane
+        const rayf along = { { -1.0f, 0.5f, 1.0f }, { 1.0f, 0.0f, 0.0f } };
+        AssertThat( intersect( ray8f::splat( along ), tris, t, u, v ), Equals( 0 ) );
+      } );
+    } );
+
+    // BVH --------------------------------------------------------------------
+    describe( "bvh", []()
+    {
+      // bumpy height field of 2 * 64 * 64 triangles, enough for several build tasks
+      const uint32_t grid = 64;
+      std::vector<float> vertices;
+      std::vector<uint32_t> indices;
+      for ( uint32_t y = 0; y <= grid; ++y )
+        for ( uint32_t x = 0; x <= grid; ++x )
+        {
+          vertices.push_back( static_cast<float>( x ) );
+          vertices.push_back( static_cast<float>( y ) );
+          vertices.push_back( 2.0f * std::sin( 0.3f * x ) * std::cos( 0.2f * y ) );
+        }
+      for ( uint32_t y = 0; y < grid; ++y )
+        for ( uint32_t x = 0; x < grid; ++x )
+        {
+          const uint32_t i = y * ( grid + 1 ) + x;
+          indices.insert( indices.end(), { i, i + 1, i + grid + 1, i + 1, i + grid + 2, i + grid + 1 } );
+        }
+      const size_t triangles = indices.size() / 3;
+      // closest hit over all triangles, eight at a time
+      auto bruteForce = [&]( const rayf& ray, rayhit& hit )
+      {
+        bool found = false;
+        const auto packet = ray8f::splat( ray );
+        for ( size_t first = 0; first < triangles; first += 8 )
+        {
+          tri8f tris;
+          for ( int i = 0; i < 8; ++i )
+          {
+            const uint32_t* tri = &indices[3 * ( first + i )];
+            tris.set( i, &vertices[3 * tri[0]], &vertices[3 * tri[1]], &vertices[3 * tri[2]] );
+          }
+          vec8f t, u, v;
+          const int mask = intersect( packet, tris, t, u, v );
+          for ( int i = 0; i < 8; ++i )
+            if ( ( mask >> i & 1 ) && reinterpret_cast<float*>( &t )[i] < hit.t )
+            {
+              hit.t = reinterpret_cast<float*>( &t )[i];
+              hit.triangle = static_cast<uint32_t>( first + i );
+              found = true;
+            }
+        }
+        return found;
+      };
+      auto rays = [&]()
+      {
+        std::vector<rayf> result;
+        for ( int i = 0; i < 300; ++i )
+        {
+          const float f = static_cast<float>( i );
+          // slanted rays from above, some grazing, some leaving the field
+          result.push_back( { { std::fmod( f * 7.3f, 70.0f ) - 3.0f, std::fmod( f * 3.1f, 66.0f ), 5.0f },
+            { std::sin( f ) * 0.5f, std::cos( f * 0.7f ) * 0.5f, -1.0f + 0.9f * ( i % 3 == 0 ) } } );
+        }
+        return result;
+      };
+      it( "finds the same closest hits as a brute force search", [&]()
+      {
+        bvh8 tree;
+        tree.build( vertices.data(), indices.data(), triangles );
+        AssertThat( tree.leafCount() * 8, IsGreaterThanOrEqualTo( triangles ) );
+        int hits = 0;
+        for ( const auto& ray : rays() )
+        {
+          rayhit expected, hit;
+          const bool any = bruteForce( ray, expected );
+          AssertThat( tree.intersect( ray, hit ), Equals( any ) );
+          AssertThat( tree.occluded( ray ), Equals( any ) );
+          if ( any )
+          {
+            ++hits;
+            AssertThat( hit.t, EqualsWithDelta( expected.t, 1e-5f ) );
+            // the same triangle, unless the ray hit a shared edge
+            if ( hit.triangle != expected.triangle )
+              AssertThat( std::min( std::min( hit.u, hit.v ), 1.0f - hit.u - hit.v ), IsLessThan( 1e-4f ) );
+          }
+        }
+        AssertThat( hits, IsGreaterThan( 150 ) );
+        // nothing before tmin or past tmax
+        rayf shortRay = rays()[1];
+        rayhit full;
+        if ( tree.intersect( shortRay, full ) )
+        {
+          rayhit hit;
+          shortRay.tmax = full.t * 0.5f;
+          AssertThat( tree.intersect( shortRay, hit ), Is().False() );
+          AssertThat( tree.occluded( shortRay ), Is().False() );
+        }
+      } );
+      it( "traces packets of eight rays like single rays", [&]()
+      {
+        bvh8 tree;
+        tree.build( vertices.data(), indices.data(), triangles );
+        auto all = rays();
+        // coherent packets too: eight neighbouring rays straight down
+        for ( int i = 0; i < 64; ++i )
+          all.push_back( { { 20.0f + 0.37f * static_cast<float>( i ), 30.0f + 0.11f * static_cast<float>( i % 8 ), 5.0f }, { 0.05f, -0.02f, -1.0f } } );
+        // & some lanes cut short of their hit
+        for ( size_t i = 0; i < all.size(); i += 5 )
+          all[i].tmax = 4.0f;
+        for ( size_t first = 0; first + 8 <= all.size(); first += 8 )
+        {
+          const auto packet = ray8f::gather( &all[first] );
+          rayhit hits[8];
+          const int mask = tree.intersect( packet, hits );
+          AssertThat( tree.occluded( packet ), Equals( mask ) );
+          for ( int i = 0; i < 8; ++i )
+          {
+            rayhit expected;
+            const bool any = tree.intersect( all[first + i], expected );
+            AssertThat( ( mask >> i & 1 ) != 0, Equals( any ) );
+            if ( any )
+            {
+              AssertThat( hits[i].t, Equals( expected.t ) );
+              // the same triangle, unless the ray hit a shared edge
+              if ( hits[i].triangle != expected.triangle )
+                AssertThat( std::min( std::min( hits[i].u, hits[i].v ), 1.0f - hits[i].u - hits[i].v ), IsLessThan( 1e-4f ) );
+            }
+          }
+        }
+        bvh8 empty;
+        rayhit hits[8];
+        AssertThat( empty.intersect( ray8f::gather( all.data() ), hits ), Equals( 0 ) );
+        AssertThat( empty.occluded( ray8f::gather( all.data() ) ), Equals( 0 ) );
+      } );
+      it( "builds the same tree with a thread pool", [&]()
+      {
+        bvh8 serial, parallel;
+        threadpool pool( 3 );
+        serial.build( vertices.data(), indices.data(), triangles );
+        parallel.build( vertices.data(), indices.data(), triangles, &pool );
+        AssertThat( parallel.nodeCount(), Equals( serial.nodeCount() ) );
+        AssertThat( parallel.leafCount(), Equals( serial.leafCount() ) );
+        for ( const auto& ray : rays() )
+        {
+          rayhit a, b;
+          AssertThat( parallel.intersect( ray, a ), Equals( serial.intersect( ray, b ) ) );
+          AssertThat( a.t, Equals( b.t ) );
+          AssertThat( a.triangle, Equals( b.triangle ) );
+        }
+      } );
+      it( "handles tiny & empty meshes", [&]()
+      {
+        bvh8 tree;
+        tree.build( vertices.data(), indices.data(), 0 );
+        const rayf down = { { 0.6f, 0.3f, 5.0f }, { 0.0f, 0.0f, -1.0f } };
+        rayhit hit;
+        AssertThat( tree.intersect( down, hit ), Is().False() );
+        AssertThat( tree.occluded( down ), Is().False() );
+        tree.build( vertices.data(), indices.data(), 1 );
+        AssertThat( tree.nodeCount(), Equals( size_t( 1 ) ) );
+        AssertThat( tree.intersect( down, hit ), Is().True() );
+        AssertThat( hit.triangle, Equals( 0u ) );
+        AssertThat( hit.t, EqualsWithDelta( 5.0f - 0.6f * vertices[5] - 0.3f * vertices[3 * ( grid + 1 ) + 2], 1e-5f ) );
+        AssertThat( hit.u, EqualsWithDelta( 0.6f, 1e-5f ) );
+      } );
+    } );
+
+    // CULL -------------------------------------------------------------------
+    describe( "cull", []()
+    {
+      // the clip space of the identity matrix is the volume [-1, 1] x [-1, 1] x [0, 1],
+      // scaled by 10 & moved along z to [-10, 10] x [-10, 10] x [5, 15]
+      const auto viewProj = mat4f::translation( 0.0f, 0.0f, -5.0f ) * mat4f::scaling( 0.1f, 0.1f, 0.1f );
+      const auto frustum = frustumf::fromMatrix( viewProj );
+      const size_t count = 1003;
+      std::vector<float> x( count ), y( count ), z( count ), r( count );
+      uint32_t seed = 17;
+      auto next = [&]() { seed = seed * 1664525u + 1013904223u; return static_cast<float>( seed >> 8 ) / 16777216.0f; };
+      for ( size_t i = 0; i < count; ++i )
+      {
+        x[i] = 40.0f * next() - 20.0f;
+        y[i] = 40.0f * next() - 20.0f;
+        z[i] = 30.0f * next() - 5.0f;
+        r[i] = 4.0f * next();
+      }
+      it( "takes the planes from a matrix", [&]()
+      {
+        AssertThat( frustum.planes[0] == vec4f( 1.0f, 0.0f, 0.0f, 10.0f ), Is().True() );
+        AssertThat( frustum.planes[3] == vec4f( 0.0f, -1.0f, 0.0f, 10.0f ), Is().True() );
+        AssertThat( frustum.planes[4].w, EqualsWithDelta( -5.0f, 1e-5f ) );
+        AssertThat( frustum.planes[5].w, EqualsWithDelta( 15.0f, 1e-5f ) );
+        const auto gl = frustumf::fromMatrix( viewProj, clipDepth::minusOneToOne );
+        AssertThat( gl.planes[4].w, EqualsWithDelta( 5.0f, 1e-5f ) );
+        AssertThat( gl.planes[4].z, EqualsWithDelta( 1.0f, 1e-6f ) );
+      } );
+      it( "culls spheres like a scalar test", [&]()
+      {
+        std::vector<uint32_t> expected;
+        for ( size_t i = 0; i < count; ++i )
+        {
+          bool inside = true;
+          for ( const auto& p : frustum.planes )
+            inside = inside && p.x * x[i] + p.y * y[i] + p.z * z[i] + p.w >= -r[i];
+          if ( inside )
+            expected.push_back( static_cast<uint32_t>( i ) );
+        }
+        AssertThat( expected.size(), IsGreaterThan( size_t( 100 ) ) );
+        AssertThat( expected.size(), IsLessThan( count - 100 ) );
+        std::vector<uint32_t> visible( count );
+        visible.resize( cullSpheres( frustum, x.data(), y.data(), z.data(), r.data(), count, visible.data() ) );
+        AssertThat( visible, EqualsContainer( expected ) );
+        std::vector<uint8_t> bits( ( count + 7 ) / 8 );
+        cullSpheresMask( frustum, x.data(), y.data(), z.data(), r.data(), count, bits.data() );
+        size_t set = 0;
+        for ( size_t i = 0; i < count; ++i )
+          set += ( bits[i / 8] >> ( i % 8 ) ) & 1;
+        AssertThat( set, Equals( expected.size() ) );
+        for ( auto i : expected )
+          AssertThat( ( bits[i / 8] >> ( i % 8 ) ) & 1, Equals( 1 ) );
+        soa4f spheres( count );
+        std::copy( x.begin(), x.end(), spheres.x.data() );
+        std::copy( y.begin(), y.end(), spheres.y.data() );
+        std::copy( z.begin(), z.end(), spheres.z.data() );
+        std::copy( r.begin(), r.end(), spheres.w.data() );
+        AssertThat( cullSpheres( frustum, spheres, visible.data() ), Equals( expected.size() ) );
+      } );
+      it( "culls boxes like a scalar test", [&]()
+      {
+        std::vector<uint32_t> expected;
+        for ( size_t i = 0; i < count; ++i )
+        {
+          // the box from the random sphere's radius as x & y extent, half of it as z
+          bool inside = true;
+          for ( const auto& p : frustum.planes )
+            inside = inside && p.x * x[i] + p.y * y[i] + p.z * z[i] + p.w + std::abs( p.x ) * r[i] + std::abs( p.y ) * r[i] + std::abs( p.z ) * 0.5f * r[i] >= 0.0f;
+          if ( inside )
+            expected.push_back( static_cast<uint32_t>( i ) );
+        }
+        std::vector<float> half( count );
+        for ( size_t i = 0; i < count; ++i )
+          half[i] = 0.5f * r[i];
+        std::vector<uint32_t> visible( count );
+        visible.resize( cullBoxes( frustum, x.data(), y.data(), z.data(), r.data(), r.data(), half.data(), count, visible.data() ) );
+        AssertThat( visible, EqualsContainer( expected ) );
+        std::vector<uint8_t> bits( ( count + 7 ) / 8 );
+        cullBoxesMask( frustum, x.data(), y.data(), z.data(), r.data(), r.data(), half.data(), count, bits.data() );
+        for ( size_t i = 0, k = 0; i < count; ++i )
+        {
+          const bool hit = k < expected.size() && expected[k] == i;
+          AssertThat( ( bits[i / 8] >> ( i % 8 ) ) & 1, Equals( hit ? 1 : 0 ) );
+          k += hit;
+        }
+      } );
+      it( "keeps objects straddling a plane & drops the tail of a group", [&]()
+      {
+        // one box across the near plane, one just outside the right plane, one inside
+        const float cx[3] = { 0.0f, 10.5f, 1.0f }, cy[3] = { 0.0f, 0.0f, 1.0f }, cz[3] = { 5.0f, 10.0f, 10.0f };
+        const float e[3] = { 0.25f, 0.25f, 0.25f };
+        uint32_t visible[3];
+        AssertThat( cullBoxes( frustum, cx, cy, cz, e, e, e, 3, visible ), Equals( size_t( 2 ) ) );
+        AssertThat( visible[0], Equals( 0u ) );
+        AssertThat( visible[1], Equals( 2u ) );
+        uint8_t bits = 0xff;
+        cullSpheresMask( frustum, cx, cy, cz, e, 3, &bits );
+        AssertThat( bits, Equals( uint8_t( 0b101 ) ) );
+      } );
+    } );
+
+    // BROADPHASE -------------------------------------------------------------
+    describe( "broadphase", []()
+    {
+      const size_t count = 1500;
+      soa3f lo( count ), hi( count );
+      uint32_t seed = 5;
+      auto next = [&]() { seed = seed * 1664525u + 1013904223u; return static_cast<float>( seed >> 8 ) / 16777216.0f; };
+      for ( size_t i = 0; i < count; ++i )
+      {
+        // mostly small boxes, every 50th one large, some straddling the origin
+        const float size = ( i % 50 ? 0.5f + next() : 6.0f );
+        lo.x[i] = 40.0f * next() - 20.0f;
+        lo.y[i] = 40.0f * next() - 20.0f;
+        lo.z[i] = 10.0f * next() - 5.0f;
+        hi.x[i] = lo.x[i] + size;
+        hi.y[i] = lo.y[i] + size * next();
+        hi.z[i] = lo.z[i] + size;
+      }
+      auto bruteForce = [&]()
+      {
+        std::vector<bodyPair> pairs;
+        for ( uint32_t a = 0; a < lo.size(); ++a )
+          for ( uint32_t b = a + 1; b < lo.size(); ++b )
+            if ( lo.x[a] <= hi.x[b] && lo.x[b] <= hi.x[a] && lo.y[a] <= hi.y[b] && lo.y[b] <= hi.y[a] && lo.z[a] <= hi.z[b] && lo.z[b] <= hi.z[a] )
+              pairs.push_back( { a, b } );
+        return pairs;
+      };
+      auto found = [&]( auto& finder, size_t capacity )
+      {
+        std::vector<bodyPair> pairs( capacity );
+        pairs.resize( std::min( capacity, finder.findPairs( lo, hi, pairs.data(), capacity ) ) );
+        std::sort( pairs.begin(), pairs.end() );
+        return pairs;
+      };
+      it( "tests a box against eight boxes", [&]()
+      {
+        const float blo[3] = { 0.0f, 0.0f, 0.0f }, bhi[3] = { 1.0f, 1.0f, 1.0f };
+        aabb8f boxes;
+        for ( int i = 0; i < 8; ++i )
+        {
+          // moving along x, touching the box in lanes 0 & 4 and apart from it from lane 5 on
+          const float olo[3] = { 0.5f * i - 1.0f, 0.5f, 0.5f }, ohi[3] = { 0.5f * i, 2.0f, 0.75f };
+          boxes.set( i, olo, ohi );
+        }
+        boxes.clear( 1 );
+        AssertThat( overlap( aabb8f::splat( blo, bhi ), boxes ), Equals( 0b00011101 ) );
+      } );
+      it( "finds the same pairs as brute force by sweep and prune", [&]()
+      {
+        const auto expected = bruteForce();
+        AssertThat( expected.size(), IsGreaterThan( size_t( 100 ) ) );
+        sweepAndPrune sap;
+        AssertThat( found( sap, 2 * expected.size() ), EqualsContainer( expected ) );
+        // move everything a little, so the next call starts from a nearly sorted order
+        for ( size_t i = 0; i < count; ++i )
+        {
+          const float dx = 0.2f * next() - 0.1f;
+          lo.x[i] += dx;
+          hi.x[i] += dx;
+        }
+        const auto moved = bruteForce();
+        AssertThat( found( sap, moved.size() ), EqualsContainer( moved ) );
+        for ( size_t i = 1; i < count; ++i )
+          AssertThat( sap.order()[i - 1].key, IsLessThanOrEqualTo( sap.order()[i].key ) );
+        // fewer bodies than last time; growing back would zero the rest, so keep copies
+        const soa3f allLo = lo, allHi = hi;
+        lo.resize( 700 );
+        hi.resize( 700 );
+        AssertThat( found( sap, moved.size() ), EqualsContainer( bruteForce() ) );
+        lo = allLo;
+        hi = allHi;
+      } );
+      it( "sweeps boxes that reach to infinity", [&]()
+      {
+        // a ground plane under everything, unbounded along x & z
+        const float inf = std::numeric_limits<float>::infinity();
+        const float saved[6] = { lo.x[7], lo.y[7], lo.z[7], hi.x[7], hi.y[7], hi.z[7] };
+        lo.x[7] = -inf;
+        lo.y[7] = -30.0f;
+        lo.z[7] = -inf;
+        hi.x[7] = inf;
+        hi.y[7] = -19.0f;
+        hi.z[7] = inf;
+        const auto expected = bruteForce();
+        sweepAndPrune sap;
+        AssertThat( found( sap, expected.size() ), EqualsContainer( expected ) );
+        lo.x[7] = saved[0];
+        lo.y[7] = saved[1];
+        lo.z[7] = saved[2];
+        hi.x[7] = saved[3];
+        hi.y[7] = saved[4];
+        hi.z[7] = saved[5];
+      } );
+      it( "finds the same pairs as brute force on a uniform grid", [&]()
+      {
+        const auto expected = bruteForce();
+        for ( float cell : { 0.3f, 1.0f, 4.0f } )
+        {
+          uniformGrid grid( cell );
+          AssertThat( found( grid, expected.size() + 1 ), EqualsContainer( expected ) );
+        }
+      } );
+      it( "counts the pairs that don't fit", [&]()
+      {
+        const auto expected = bruteForce();
+        sweepAndPrune sap;
+        uniformGrid grid( 1.0f );
+        bodyPair some[10];
+        AssertThat( sap.findPairs( lo, hi, some, 10 ), Equals( expected.size() ) );
+        AssertThat( grid.findPairs( lo, hi, some, 10 ), Equals( expected.size() ) );
+        AssertThat( sap.findPairs( lo, hi, nullptr, 0 ), Equals( expected.size() ) );
+        soa3f none;
+        AssertThat( sap.findPairs( none, none, some, 10 ), Equals( size_t( 0 ) ) );
+        AssertThat( grid.findPairs( none, none, some, 10 ), Equals( size_t( 0 ) ) );
+      } );
+    } );
+
+    // BIQUAD -----------------------------------------------------------------
+    describe( "biquad", []()
+    {
+      const double rate = 48000.0;
+      const biquad designs[8] = {
+        biquad::lowpass( rate, 1000.0 ), biquad::highpass( rate, 200.0 ), biquad::bandpass( rate, 3000.0, 2.0 ), biquad::notch( rate, 50.0, 4.0 ),
+        biquad::allpass( rate, 700.0, 0.5 ), biquad::peak( rate, 2000.0, 1.0, 6.0 ), biquad::lowShelf( rate, 120.0, 0.7, -9.0 ), biquad::highShelf( rate, 8000.0, 0.7, 3.0 )
+      };
+      const size_t length = 1000;
+      std::vector<double> noise( length );
+      uint32_t seed = 9;
+      for ( auto& x : noise )
+      {
+        seed = seed * 1664525u + 1013904223u;
+        x = static_cast<double>( seed >> 8 ) / 8388608.0 - 1.0;
+      }
+      //! Reference transposed direct form II in double
+      auto reference = []( const biquad& c, std::vector<double> x )
+      {
+        double z1 = 0.0, z2 = 0.0;
+        for ( auto& v : x )
+        {
+          const double y = c.b0 * v + z1;
+          z1 = c.b1 * v - c.a1 * y + z2;
+          z2 = c.b2 * v - c.a2 * y;
+          v = y;
+        }
+        return x;
+      };
+      auto bankMatches = [&]( auto bank, const double tolerance )
+      {
+        using bank_t = decltype( bank );
+        using scalar = typename bank_t::scalar;
+        const int channels = bank_t::channels;
+        std::vector<scalar> frames( length * channels );
+        for ( size_t n = 0; n < length; ++n )
+          for ( int c = 0; c < channels; ++c )
+            frames[n * channels + c] = static_cast<scalar>( noise[( n + 37 * c ) % length] );
+        for ( int c = 0; c < channels; ++c )
+          bank.set( c, designs[c], false );
+        // in place & in uneven blocks
+        bank.process( frames.data(), frames.data(), 3 );
+        bank.process( frames.data() + 3 * channels, frames.data() + 3 * channels, length - 3 );
+        double worst = 0.0;
+        for ( int c = 0; c < channels; ++c )
+        {
+          std::vector<double> x( length );
+          for ( size_t n = 0; n < length; ++n )
+            x[n] = static_cast<double>( static_cast<scalar>( noise[( n + 37 * c ) % length] ) );
+          // the coefficients rounded like the bank's, to only see the arithmetic's rounding
+          biquad rounded = designs[c];
+          for ( double* k : { &rounded.b0, &rounded.b1, &rounded.b2, &rounded.a1, &rounded.a2 } )
+            *k = static_cast<double>( static_cast<scalar>( *k ) );
+          const auto y = reference( rounded, x );
+          for ( size_t n = 0; n < length; ++n )
+            worst = std::max( worst, std::abs( y[n] - frames[n * channels + c] ) );
+        }
+        AssertThat( worst, IsLessThan( tolerance ) );
+      };
+      it( "filters channels in lockstep like scalar biquads", [&]()
+      {
+        // float rounding is amplified by the poles of the 50 Hz notch, just as in scalar float code
+        bankMatches( biquadBank<vec4f>(), 1e-3 );
+        bankMatches( biquadBank<vec8f>(), 1e-3 );
+        bankMatches( biquadBank<vec4d>(), 1e-12 );
+      } );
+      it( "glides to new coefficients", [&]()
+      {
+        biquadBank<vec8f> gliding, jumped;
+        gliding.glideTime( 100.0 );
+        gliding.setAll( designs[0] );
+        jumped.setAll( designs[0], false );
+        // an impulse right after the change still passes mostly unfiltered
+        std::vector<float> block( 8 * 4096, 0.0f );
+        for ( int c = 0; c < 8; ++c )
+          block[c] = 1.0f;
+        gliding.process( block.data(), block.data(), 4096 );
+        AssertThat( block[0], IsGreaterThan( 0.9f ) );
+        // & after a while it filters like a filter that jumped straight there
+        gliding.reset();
+        std::vector<float> a( 8 * length ), b( 8 * length );
+        for ( size_t i = 0; i < a.size(); ++i )
+          a[i] = b[i] = static_cast<float>( noise[i % length] );
+        gliding.process( a.data(), a.data(), length );
+        jumped.process( b.data(), b.data(), length );
+        AssertThat( a, EqualsContainer( b ) );
+      } );
+      it( "applies coefficients set with the defaults", [&]()
+      {
+        // without a glide time, set jumps even when asked to glide
+        biquadBank<vec4f> bank, jumped;
+        bank.setAll( designs[0] );
+        jumped.setAll( designs[0], false );
+        biquadCascade<vec8f> cascade( 3 ), jumpedCascade( 3 );
+        for ( size_t k = 0; k < 3; ++k )
+        {
+          cascade.set( k, designs[k] );
+          jumpedCascade.set( k, designs[k], false );
+        }
+        std::vector<float> a( 4 * length ), b( 4 * length );
+        for ( size_t i = 0; i < a.size(); ++i )
+          a[i] = b[i] = static_cast<float>( noise[i % length] );
+        const auto input = a;
+        bank.process( a.data(), a.data(), length );
+        jumped.process( b.data(), b.data(), length );
+        AssertThat( a, EqualsContainer( b ) );
+        AssertThat( a, !EqualsContainer( input ) );
+        std::vector<float> c( input.begin(), input.begin() + length ), d( c );
+        cascade.process( c.data(), c.data(), length );
+        jumpedCascade.process( d.data(), d.data(), length );
+        AssertThat( c, EqualsContainer( d ) );
+        AssertThat( c[length / 2], !Equals( input[length / 2] ) );
+      } );
+      it( "pipelines a cascade of sections on one channel", [&]()
+      {
+        auto cascadeMatches = [&]( auto cascade, const double tolerance )
+        {
+          using scalar = typename decltype( cascade )::scalar;
+          cascade.resize( 11 );
+          std::vector<double> expected( noise.begin(), noise.end() );
+          for ( size_t k = 0; k < 11; ++k )
+          {
+            cascade.set( k, designs[k % 8], false );
+            expected = reference( designs[k % 8], expected );
+          }
+          std::vector<scalar> x( noise.begin(), noise.end() );
+          // blocks shorter & longer than the pipeline
+          size_t done = 0;
+          for ( size_t block : { size_t( 1 ), size_t( 3 ), size_t( 100 ), size_t( 7 ), length - 111 } )
+          {
+            cascade.process( x.data() + done, x.data() + done, block );
+            done += block;
+          }
+          double worst = 0.0;
+          for ( size_t n = 0; n < length; ++n )
+            worst = std::max( worst, std::abs( expected[n] - x[n] ) );
+          AssertThat( worst, IsLessThan( tolerance ) );
+        };
+        cascadeMatches( biquadCascade<vec4f>(), 1e-3 );
+        cascadeMatches( biquadCascade<vec8f>(), 1e-3 );
+        cascadeMatches( biquadCascade<vec4d>(), 1e-10 );
+      } );
+      it( "restores the floating point mode", [&]()
+      {
+        const auto mode = _mm_getcsr();
+        biquadCascade<vec8f> cascade( 3 );
+        float x[16] = { 1.0f };
+        cascade.process( x, x, 16 );
+        AssertThat( _mm_getcsr(), Equals( mode ) );
+        AssertThat( x[0], Equals( 1.0f ) );
+        AssertThat( x[15], Equals( 0.0f ) );
+      } );
+    } );
+
+    // FFT --------------------------------------------------------------------
+    describe( "fft", []()
+    {
+      std::vector<float> signal( 3000 ), kernel( 1000 );
+      uint32_t seed = 5;
+      for ( auto* v : { &signal, &kernel } )
+      {
+        for ( auto& x : *v )
+        {
+          seed = seed * 1664525u + 1013904223u;
+          x = static_cast<float>( seed >> 8 ) / 8388608.0f - 1.0f;
+        }
+      }
+      it( "transforms complex signals like a DFT, in & out of place", [&]()
+      {
+        // 256 & 512 end in radix 8 then 2, & radix 4 then 8
+        for ( size_t size : { 1, 2, 8, 16, 32, 64, 256, 512 } )
+        {
+          fftf fft( size );
+          std::vector<float> re( size ), im( size );
+          std::copy( signal.begin(), signal.begin() + static_cast<std::ptrdiff_t>( size ), re.begin() );
+          std::copy( kernel.begin(), kernel.begin() + static_cast<std::ptrdiff_t>( size ), im.begin() );
+          std::vector<float> outRe( size ), outIm( size );
+          fft.forward( re.data(), im.data(), outRe.data(), outIm.data() );
+          double worst = 0.0;
+          for ( size_t k = 0; k < size; ++k )
+          {
+            std::complex<double> sum;
+            for ( size_t j = 0; j < size; ++j )
+              sum += std::complex<double>( re[j], im[j] ) * std::polar( 1.0, -2.0 * 3.14159265358979323846 * static_cast<double>( j * k % size ) / static_cast<double>( size ) );
+            worst = std::max( worst, std::abs( sum - std::complex<double>( outRe[k], outIm[k] ) ) );
+          }
+          AssertThat( worst, IsLessThan( 1e-5 * static_cast<double>( size ) ) );
+          fft.inverse( outRe.data(), outIm.data(), outRe.data(), outIm.data() );
+          for ( size_t j = 0; j < size; ++j )
+          {
+            AssertThat( outRe[j] / static_cast<float>( size ), EqualsWithDelta( re[j], 1e-5f ) );
+            AssertThat( outIm[j] / static_cast<float>( size ), EqualsWithDelta( im[j], 1e-5f ) );
+          }
+        }
+      } );
+      it( "transforms real signals to half spectra & back", [&]()
+      {
+        for ( size_t size : { 2, 8, 16, 64, 1024 } )
+        {
+          realFftf fft( size );
+          AssertThat( fft.bins(), Equals( size / 2 + 1 ) );
+          std::vector<float> re( fft.bins() ), im( fft.bins() ), x( size );
+          fft.forward( signal.data(), re.data(), im.data() );
+          double worst = 0.0;
+          for ( size_t k = 0; k < fft.bins(); ++k )
+          {
+            std::complex<double> sum;
+            for ( size_t j = 0; j < size; ++j )
+              sum += static_cast<double>( signal[j] ) * std::polar( 1.0, -2.0 * 3.14159265358979323846 * static_cast<double>( j * k % size ) / static_cast<double>( size ) );
+            worst = std::max( worst, std::abs( sum - std::complex<double>( re[k], im[k] ) ) );
+          }
+          AssertThat( worst, IsLessThan( 1e-5 * static_cast<double>( size ) ) );
+          fft.inverse( re.data(), im.data(), x.data() );
+          for ( size_t j = 0; j < size; ++j )
+            AssertThat( x[j] / static_cast<float>( size ), EqualsWithDelta( signal[j], 1e-5f ) );
+        }
+      } );
+      it( "transforms in double precision", [&]()
+      {
+        // every mix of passes for vec4d: radix 4 alone, then with radix 8 & 2
+        for ( size_t size : { 4, 16, 32, 64, 128, 2048 } )
+        {
+          fftd fft( size );
+          std::vector<double> re( signal.begin(), signal.begin() + static_cast<std::ptrdiff_t>( size ) );
+          std::vector<double> im( signal.rbegin(), signal.rbegin() + static_cast<std::ptrdiff_t>( size ) );
+          std::vector<double> outRe = re, outIm = im;
+          fft.forward( outRe.data(), outIm.data(), outRe.data(), outIm.data() );
+          double worst = 0.0;
+          for ( size_t k = 0; k < size; k += size / 64 + 1 )
+          {
+            std::complex<double> sum;
+            for ( size_t j = 0; j < size; ++j )
+              sum += std::complex<double>( re[j], im[j] ) * std::polar( 1.0, -2.0 * 3.14159265358979323846 * static_cast<double>( j * k % size ) / static_cast<double>( size ) );
+            worst = std::max( worst, std::abs( sum - std::complex<double>( outRe[k], outIm[k] ) ) );
+          }
+          AssertThat( worst, IsLessThan( 1e-12 * static_cast<double>( size ) ) );
+          fft.inverse( outRe.data(), outIm.data(), outRe.data(), outIm.data() );
+          for ( size_t j = 0; j < size; ++j )
+          {
+            AssertThat( outRe[j] / static_cast<double>( size ), EqualsWithDelta( re[j], 1e-13 ) );
+            AssertThat( outIm[j] / static_cast<double>( size ), EqualsWithDelta( im[j], 1e-13 ) );
+          }
+        }
+        for ( size_t size : { 2, 16, 256, 2048 } )
+        {
+          realFftd fft( size );
+          std::vector<double> x( signal.begin(), signal.begin() + static_cast<std::ptrdiff_t>( size ) ), re( fft.bins() ), im( fft.bins() );
+          fft.forward( x.data(), re.data(), im.data() );
+          double nyquist = 0.0;
+          for ( size_t j = 0; j < size; ++j )
+            nyquist += x[j] * ( j % 2 ? -1.0 : 1.0 );
+          AssertThat( re[size / 2], EqualsWithDelta( nyquist, 1e-12 * static_cast<double>( size ) ) );
+          fft.inverse( re.data(), im.data(), x.data() );
+          for ( size_t j = 0; j < size; ++j )
+            AssertThat( x[j] / static_cast<double>( size ), EqualsWithDelta( static_cast<double>( signal[j] ), 1e-13 ) );
+        }
+      } );
+    } );
+
+    // CONVOLUTION ------------------------------------------------------------
+    describe( "convolution", []()
+    {
+      std::vector<float> signal( 3000 ), kernel( 1000 );
+      uint32_t seed = 5;
+      for ( auto* v : { &signal, &kernel } )
+      {
+        for ( auto& x : *v )
+        {
+          seed = seed * 1664525u + 1013904223u;
+          x = static_cast<float>( seed >> 8 ) / 8388608.0f - 1.0f;
+        }
+      }
+      //! Direct convolution sum in double with the first taps of kernel
+      auto reference = [&]( const size_t taps )
+      {
+        std::vector<double> y( signal.size() );
+        for ( size_t n = 0; n < y.size(); ++n )
+          for ( size_t k = 0; k < taps && k <= n; ++k )
+            y[n] += static_cast<double>( kernel[k] ) * signal[n - k];
+        return y;
+      };
+      //! Push signal through process( in, out, count ) in place, in uneven calls
+      auto chunked = [&]( auto&& process )
+      {
+        std::vector<float> y = signal;
+        const size_t sizes[] = { 1, 7, 33, 600, 2 };
+        for ( size_t n = 0, i = 0; n < y.size(); ++i )
+        {
+          const size_t count = std::min( sizes[i % 5], y.size() - n );
+          process( y.data() + n, y.data() + n, count );
+          n += count;
+        }
+        return y;
+      };
+      it( "filters directly like the convolution sum", [&]()
+      {
+        for ( size_t taps : { 1, 3, 32, 37, 1000 } )
+        {
+          const auto expected = reference( taps );
+          firFilter fir( kernel.data(), taps );
+          const auto y = chunked( [&]( const float* in, float* out, size_t count ) { fir.process( in, out, count ); } );
+          double worst = 0.0;
+          for ( size_t n = 0; n < y.size(); ++n )
+            worst = std::max( worst, std::abs( expected[n] - y[n] ) );
+          AssertThat( worst, IsLessThan( 1e-4 ) );
+          fir.reset();
+          float impulse[8] = { 1.0f };
+          fir.process( impulse, impulse, 8 );
+          AssertThat( impulse[0], Equals( kernel[0] ) );
+        }
+      } );
+      it( "convolves by partitions one block late", [&]()
+      {
+        for ( size_t taps : { 1, 16, 37, 1000 } )
+        {
+          const auto expected = reference( taps );
+          for ( size_t block : { 8, 16, 64 } )
+          {
+            convolver reverb( kernel.data(), taps, block );
+            AssertThat( reverb.latency(), Equals( block ) );
+            AssertThat( reverb.length(), IsGreaterThanOrEqualTo( taps ) );
+            const auto y = chunked( [&]( const float* in, float* out, size_t count ) { reverb.process( in, out, count ); } );
+            double worst = 0.0;
+            for ( size_t n = 0; n < y.size(); ++n )
+              worst = std::max( worst, std::abs( ( n < block ? 0.0 : expected[n - block] ) - y[n] ) );
+            AssertThat( worst, IsLessThan( 1e-4 ) );
+          }
+        }
+      } );
+    } );
+
+    // PCM --------------------------------------------------------------------
+    describe( "pcm", []()
+    {
+      // full scale, over it, tiny values, halfway cases & a NaN, 37 so there are tails
+      std::vector<float> samples( 37 );
+      for ( size_t i = 0; i < samples.size(); ++i )
+        samples[i] = std::sin( static_cast<float>( i ) * 0.7f ) * 1.1f;
+      samples[3] = -4.0f;
+      samples[4] = 1.0f;
+      samples[5] = 2.5f / 32768.0f;
+      samples[6] = std::numeric_limits<float>::quiet_NaN();
+      //! What a sample should quantize to at scale, rounding half to even
+      auto expected = []( const float x, const double scale )
+      {
+        if ( std::isnan( x ) )
+          return -scale;
+        return std::nearbyint( std::min( std::max( static_cast<double>( x ) * scale, -scale ), scale - 1.0 ) );
+      };
+      auto read24 = []( const uint8_t* p )
+      {
+        return static_cast<int32_t>( ( static_cast<uint32_t>( p[0] ) << 8 ) | ( static_cast<uint32_t>( p[1] ) << 16 ) | ( static_cast<uint32_t>( p[2] ) << 24 ) ) >> 8;
+      };
+      it( "rounds & saturates floats to int16 & int24", [&]()
+      {
+        for ( size_t count : { size_t( 5 ), size_t( 9 ), samples.size() } )
+        {
+          // one more than count, to see that nothing is written past the end
+          std::vector<int16_t> pcm16( count + 1, 77 );
+          std::vector<uint8_t> pcm24( 3 * count + 1, 77 );
+          floatToInt16( samples.data(), pcm16.data(), count );
+          floatToInt24( samples.data(), pcm24.data(), count );
+          for ( size_t i = 0; i < count; ++i )
+          {
+            AssertThat( static_cast<double>( pcm16[i] ), Equals( expected( samples[i], 32768.0 ) ) );
+            AssertThat( static_cast<double>( read24( &pcm24[3 * i] ) ), Equals( expected( samples[i], 8388608.0 ) ) );
+          }
+          AssertThat( pcm16[count], Equals( 77 ) );
+          AssertThat( pcm24[3 * count], Equals( 77 ) );
+        }
+      } );
+      it( "saturates floats to int32 below 2^31", [&]()
+      {
+        std::vector<int32_t> pcm32( samples.size() );
+        floatToInt32( samples.data(), pcm32.data(), samples.size() );
+        AssertThat( pcm32[3], Equals( std::numeric_limits<int32_t>::min() ) );
+        AssertThat( pcm32[4], Equals( 2147483520 ) );
+        AssertThat( pcm32[5], Equals( 5 << 15 ) );
+        for ( size_t i = 7; i < samples.size(); ++i )
+          AssertThat( static_cast<double>( pcm32[i] ), Equals( std::min( expected( samples[i], 2147483648.0 ), 2147483520.0 ) ) );
+      } );
+      it( "converts int16, packed int24 & int32 to float exactly", [&]()
+      {
+        std::vector<int16_t> pcm16( samples.size() );
+        std::vector<uint8_t> pcm24( 3 * samples.size() );
+        std::vector<int32_t> pcm32( samples.size() );
+        floatToInt16( samples.data(), pcm16.data(), samples.size() );
+        floatToInt24( samples.data(), pcm24.data(), samples.size() );
+        floatToInt32( samples.data(), pcm32.data(), samples.size() );
+        buffer<float> out;
+        int16ToFloat( pcm16.data(), pcm16.size(), out );
+        AssertThat( out.size(), Equals( samples.size() ) );
+        for ( size_t i = 0; i < samples.size(); ++i )
+          AssertThat( out[i], Equals( static_cast<float>( pcm16[i] ) / 32768.0f ) );
+        int24ToFloat( pcm24.data(), samples.size(), out );
+        for ( size_t i = 0; i < samples.size(); ++i )
+          AssertThat( out[i], Equals( static_cast<float>( read24( &pcm24[3 * i] ) ) / 8388608.0f ) );
+        int32ToFloat( pcm32.data(), pcm32.size(), out );
+        for ( size_t i = 7; i < samples.size(); ++i )
+          AssertThat( out[i], EqualsWithDelta( std::clamp( samples[i], -1.0f, 1.0f ), 1e-7f ) );
+      } );
+      it( "dithers with triangular noise of +-1 LSB", [&]()
+      {
+        tpdfDither dither( 42 );
+        double sum = 0.0, squares = 0.0;
+        const int draws = 20000;
+        for ( int d = 0; d < draws; ++d )
+        {
+          float noise[8];
+          dither.next().storeUnaligned( noise );
+          for ( int i = 0; i < 8; ++i )
+          {
+            AssertThat( std::abs( noise[i] ), IsLessThan( 1.0f ) );
+            sum += noise[i];
+            squares += noise[i] * noise[i];
+          }
+        }
+        // a triangular distribution on (-1, 1) has mean 0 & variance 1 / 6
+        AssertThat( sum / ( 8.0 * draws ), EqualsWithDelta( 0.0, 0.01 ) );
+        AssertThat( squares / ( 8.0 * draws ), EqualsWithDelta( 1.0 / 6.0, 0.01 ) );
+        // a quiet signal dithered to int16 keeps its level on average, where
+        // plain rounding would lose it
+        std::vector<float> quiet( 4096, 0.3f / 32768.0f );
+        std::vector<int16_t> pcm16( quiet.size() );
+        floatToInt16( quiet.data(), pcm16.data(), quiet.size() );
+        AssertThat( pcm16[0], Equals( 0 ) );
+        floatToInt16( quiet.data(), pcm16.data(), quiet.size(), dither );
+        double mean = 0.0;
+        for ( auto s : pcm16 )
+        {
+          AssertThat( std::abs( s ), IsLessThanOrEqualTo( 1 ) );
+          mean += s;
+        }
+        AssertThat( mean / static_cast<double>( pcm16.size() ), EqualsWithDelta( 0.3, 0.05 ) );
+      } );
+    } );
+
+    // CHANNELS ---------------------------------------------------------------
+    describe( "channels", []()
+    {
+      // 45 frames, so that every kernel has a tail
+      const size_t frames = 45;
+      it( "deinterleaves & interleaves any channel count", [&]()
+      {
+        for ( size_t channels = 1; channels <= 9; ++channels )
+        {
+          std::vector<float> in( channels * frames ), out( channels * frames + 1, 77.0f );
+          for ( size_t i = 0; i < in.size(); ++i )
+            in[i] = static_cast<float>( i );
+          std::vector<buffer<float>> planes( channels, buffer<float>( frames ) );
+          std::vector<float*> planar;
+          for ( auto& p : planes )
+            planar.push_back( p.data() );
+          deinterleave( in.data(), planar.data(), channels, frames );
+          for ( size_t c = 0; c < channels; ++c )
+            for ( size_t i = 0; i < frames; ++i )
+              AssertThat( planes[c][i], Equals( in[channels * i + c] ) );
+          interleave( planar.data(), out.data(), channels, frames );
+          for ( size_t i = 0; i < in.size(); ++i )
+            AssertThat( out[i], Equals( in[i] ) );
+          AssertThat( out.back(), Equals( 77.0f ) );
+        }
+      } );
+      it( "splats mono into every channel", [&]()
+      {
+        std::vector<float> mono( frames );
+        for ( size_t i = 0; i < frames; ++i )
+          mono[i] = static_cast<float>( i ) + 0.5f;
+        for ( size_t channels = 1; channels <= 9; ++channels )
+        {
+          std::vector<float> out( channels * frames + 1, 77.0f );
+          splat( mono.data(), out.data(), channels, frames );
+          for ( size_t i = 0; i < channels * frames; ++i )
+            AssertThat( out[i], Equals( mono[i / channels] ) );
+          AssertThat( out.back(), Equals( 77.0f ) );
+        }
+      } );
+      it( "remixes with a gain matrix", [&]()
+      {
+        for ( size_t inChannels : { size_t( 1 ), size_t( 2 ), size_t( 5 ), size_t( 6 ) } )
+        {
+          for ( size_t outChannels : { size_t( 1 ), size_t( 2 ), size_t( 6 ), size_t( 7 ), size_t( 8 ) } )
+          {
+            std::vector<float> in( inChannels * frames ), gains( inChannels * outChannels );
+            for ( size_t i = 0; i < in.size(); ++i )
+              in[i] = std::sin( static_cast<float>( i ) );
+            for ( size_t g = 0; g < gains.size(); ++g )
+              gains[g] = static_cast<float>( g % 5 ) * 0.25f - 0.5f;
+            std::vector<float> out( outChannels * frames + 1, 77.0f );
+            remix( in.data(), inChannels, out.data(), outChannels, gains.data(), frames );
+            for ( size_t i = 0; i < frames; ++i )
+            {
+              for ( size_t o = 0; o < outChannels; ++o )
+              {
+                float sum = 0.0f;
+                for ( size_t c = 0; c < inChannels; ++c )
+                  sum += gains[o * inChannels + c] * in[inChannels * i + c];
+                AssertThat( out[outChannels * i + o], EqualsWithDelta( sum, 1e-5f ) );
+              }
+            }
+            AssertThat( out.back(), Equals( 77.0f ) );
+          }
+        }
+      } );
+      it( "upmixes stereo to 5.1", [&]()
+      {
+        const float in[4] = { 0.25f, -0.5f, 1.0f, 0.5f };
+        const float gains[12] = { 1.0f, 0.0f, 0.0f, 1.0f, 0.5f, 0.5f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f };
+        float out[12];
+        remix( in, 2, out, 6, gains, 2 );
+        const float expected[12] = { 0.25f, -0.5f, -0.125f, 0.0f, 0.25f, -0.5f, 1.0f, 0.5f, 0.75f, 0.0f, 1.0f, 0.5f };
+        for ( int i = 0; i < 12; ++i )
+          AssertThat( out[i], Equals( expected[i] ) );
+      } );
+    } );
+
+    // RESAMPLE ---------------------------------------------------------------
+    describe( "resample", []()
+    {
+      const std::pair<size_t, size_t> rates[] = { { 44100, 48000 }, { 48000, 44100 }, { 48000, 96000 }, { 96000, 48000 } };
+      it( "streams in blocks of any size like all at once", [&]()
+      {
+        std::vector<float> in( 5000 );
+        for ( size_t i = 0; i < in.size(); ++i )
+          in[i] = static_cast<float>( ( i * 7919 ) % 1000 ) * 0.001f - 0.5f;
+        for ( const auto& [inRate, outRate] : rates )
+        {
+          resampler once( inRate, outRate ), blocks( inRate, outRate );
+          std::vector<float> a( once.maxOutput( in.size() ) ), b( a.size() + 64 );
+          const size_t n = once.process( in.data(), in.size(), a.data() );
+          // the stream starts on silence, so there are up() outputs for every down() inputs from the first
+          AssertThat( n, Equals( ( in.size() * once.up() + once.down() - 1 ) / once.down() ) );
+          size_t m = 0;
+          for ( size_t i = 0, size = 1; i < in.size(); i += size, size = size * 3 % 1100 + 1 )
+          {
+            const size_t count = std::min( size, in.size() - i );
+            const size_t written = blocks.process( in.data() + i, count, b.data() + m );
+            AssertThat( written, IsLessThanOrEqualTo( blocks.maxOutput( count ) ) );
+            m += written;
+          }
+          AssertThat( m, Equals( n ) );
+          for ( size_t i = 0; i < n; ++i )
+            AssertThat( b[i], Equals( a[i] ) );
+        }
+      } );
+      it( "keeps constant input constant", [&]()
+      {
+        for ( const auto& [inRate, outRate] : rates )
+          for ( const auto quality : { resampleQuality::fast, resampleQuality::good, resampleQuality::best } )
+          {
+            resampler converter( inRate, outRate, quality );
+            std::vector<float> in( 3000, 0.25f ), out( converter.maxOutput( in.size() ) );
+            const size_t n = converter.process( in.data(), in.size(), out.data() );
+            // past the outputs whose window still reaches into the silence before the stream
+            for ( size_t i = converter.taps() * converter.up() / converter.down() + 1; i < n; ++i )
+              AssertThat( out[i], EqualsWithDelta( 0.25f, 1e-5f ) );
+          }
+      } );
+      it( "passes a tone in the passband at its new rate", [&]()
+      {
+        for ( const auto& [inRate, outRate] : rates )
+        {
+          resampler converter( inRate, outRate, resampleQuality::best );
+          const double frequency = 1000.0, twoPi = 6.283185307179586;
+          std::vector<float> in( inRate / 10 ), out( converter.maxOutput( in.size() ) );
+          for ( size_t i = 0; i < in.size(); ++i )
+            in[i] = static_cast<float>( std::sin( twoPi * frequency * static_cast<double>( i ) / static_cast<double>( inRate ) ) );
+          const size_t n = converter.process( in.data(), in.size(), out.data() );
+          // output j is input time j * down / up, less the filter's latency
+          for ( size_t j = converter.taps() * converter.up() / converter.down() + 1; j < n; ++j )
+          {
+            const double t = ( static_cast<double>( j * converter.down() ) / static_cast<double>( converter.up() ) -
+              converter.latency() ) / static_cast<double>( inRate );
+            AssertThat( out[j], EqualsWithDelta( static_cast<float>( std::sin( twoPi * frequency * t ) ), 1e-4f ) );
+          }
+        }
+      } );
+    } );
+    // MIX --------------------------------------------------------------------
+    describe( "mix", []()
+    {
+      // 77 samples, so that every kernel has a partial vector at the end
+      const size_t count = 77;
+      it( "mixes buses with their gains", [&]()
+      {
+        for ( size_t buses : { size_t( 1 ), size_t( 3 ), size_t( 8 ) } )
+        {
+          std::vector<std::vector<float>> in( buses, std::vector<float>( count ) );
+          std::vector<const float*> inputs;
+          std::vector<float> gains( buses ), out( count + 1, 77.0f ), expected( count );
+          for ( size_t b = 0; b < buses; ++b )
+          {
+            for ( size_t i = 0; i < count; ++i )
+              in[b][i] = static_cast<float>( ( i * 31 + b * 7 ) % 19 ) - 9.0f;
+            gains[b] = 0.25f * static_cast<float>( b + 1 );
+            inputs.push_back( in[b].data() );
+          }
+          for ( size_t i = 0; i < count; ++i )
+          {
+            expected[i] = 77.0f;
+            for ( size_t b = 0; b < buses; ++b )
+              expected[i] += gains[b] * in[b][i];
+          }
+          mix( inputs.data(), gains.data(), buses, out.data(), count );
+          for ( size_t i = 0; i < count; ++i )
+            AssertThat( out[i], EqualsWithDelta( expected[i], 1e-4f ) );
+          AssertThat( out.back(), Equals( 77.0f ) );
+        }
+      } );
+      it( "ramps gains & joins ramps split over blocks", [&]()
+      {
+        std::vector<float> in( count, 1.0f );
+        for ( const auto curve : { fadeCurve::linear, fadeCurve::equalPower } )
+        {
+          std::vector<float> whole( count + 1, 77.0f ), split( count, 0.0f ), mixed( count, 1.0f );
+          ramp( in.data(), whole.data(), 2.0f, 0.5f, count, curve );
+          AssertThat( whole[0], EqualsWithDelta( 2.0f, 1e-6f ) );
+          AssertThat( whole.back(), Equals( 77.0f ) );
+          for ( size_t i = 1; i < count; ++i )
+            AssertThat( whole[i], IsLessThan( whole[i - 1] ) );
+          // equal power keeps the squared gain linear
+          const float fraction = static_cast<float>( count - 1 ) / static_cast<float>( count );
+          const float last = curve == fadeCurve::linear ? 2.0f - 1.5f * fraction : std::sqrt( 4.0f - 3.75f * fraction );
+          AssertThat( whole[count - 1], EqualsWithDelta( last, 1e-5f ) );
+          const size_t first = 20;
+          const float middle = whole[first];
+          ramp( in.data(), split.data(), 2.0f, middle, first, curve );
+          ramp( in.data() + first, split.data() + first, middle, 0.5f, count - first, curve );
+          mixRamp( in.data(), mixed.data(), 2.0f, 0.5f, count, curve );
+          for ( size_t i = 0; i < count; ++i )
+          {
+            AssertThat( split[i], EqualsWithDelta( whole[i], 1e-5f ) );
+            AssertThat( mixed[i], EqualsWithDelta( whole[i] + 1.0f, 1e-5f ) );
+          }
+        }
+      } );
+      it( "crossfades at constant amplitude or power", [&]()
+      {
+        std::vector<float> ones( count, 1.0f ), zeros( count, 0.0f ), out( count + 1, 77.0f ), fadeIn( count );
+        crossfade( ones.data(), ones.data(), out.data(), count );
+        for ( size_t i = 0; i < count; ++i )
+          AssertThat( out[i], EqualsWithDelta( 1.0f, 1e-6f ) );
+        crossfade( ones.data(), zeros.data(), out.data(), count, fadeCurve::equalPower );
+        crossfade( zeros.data(), ones.data(), fadeIn.data(), count, fadeCurve::equalPower );
+        AssertThat( out[0], Equals( 1.0f ) );
+        AssertThat( fadeIn[0], Equals( 0.0f ) );
+        for ( size_t i = 0; i < count; ++i )
+          AssertThat( out[i] * out[i] + fadeIn[i] * fadeIn[i], EqualsWithDelta( 1.0f, 1e-5f ) );
+        AssertThat( out.back(), Equals( 77.0f ) );
+      } );
+      it( "flushes denormals under a guard & restores the mode", [&]()
+      {
+        const auto mode = _mm_getcsr();
+        volatile float tiny = 1e-30f;
+        AssertThat( tiny * 1e-10f, IsGreaterThan( 0.0f ) );
+        {
+          const denormalGuard ftz;
+          AssertThat( tiny * 1e-10f, Equals( 0.0f ) );
+        }
+        AssertThat( _mm_getcsr(), Equals( mode ) );
+        AssertThat( tiny * 1e-10f, IsGreaterThan( 0.0f ) );
+      } );
+    } );
+    // KERNELS ----------------------------------------------------------------
+    describe( "kernels", []()
+    {
+      it( "handles every head & tail alignment", [&]()
+      {
+        std::vector<float> a( 80 ), b( 80 ), dst( 80 );
+        for ( size_t i = 0; i < a.size(); ++i )
+        {
+          a[i] = static_cast<float>( i );
+          b[i] = static_cast<float>( i ) * 0.5f;
+        }
+        for ( size_t offset = 0; offset < 8; ++offset )
+          for ( size_t n = 0; n < 64; ++n )
+          {
+            std::fill( dst.begin(), dst.end(), -1.0f );
+            kernels::add( dst.data() + offset, a.data(), b.data() + 3, n );
+            for ( size_t i = 0; i < dst.size(); ++i )
+            {
+              const bool inside = ( i >= offset && i < offset + n );
+              const float expected = inside ? a[i - offset] + b[i - offset + 3] : -1.0f;
+              AssertThat( dst[i], Equals( expected ) );
+            }
+          }
+      } );
+      it( "computes float kernels", [&]()
+      {
+        const size_t n = 37;
+        std::vector<float> a( n ), b( n ), c( n ), dst( n );
+        for ( size_t i = 0; i < n; ++i )
+        {
+          a[i] = static_cast<float>( i ) - 10.0f;
+          b[i] = 2.0f;
+          c[i] = 1.0f;
+        }
+        kernels::sub( dst.data(), a.data(), b.data(), n );
+        AssertThat( dst[36], Equals( 24.0f ) );
+        kernels::mul( dst.data(), a.data(), b.data(), n );
+        AssertThat( dst[35], Equals( 50.0f ) );
+        kernels::scale( dst.data(), a.data(), 0.5, n );
+        AssertThat( dst[0], Equals( -5.0f ) );
+        kernels::fma( dst.data(), a.data(), b.data(), c.data(), n );
+        AssertThat( dst[1], Equals( -17.0f ) );
+        kernels::clamp( dst.data(), a.data(), -2.0f, 3.0f, n );
+        AssertThat( dst[0], Equals( -2.0f ) );
+        AssertThat( dst[11], Equals( 1.0f ) );
+        AssertThat( dst[36], Equals( 3.0f ) );
+        // in place
+        kernels::axpy( c.data(), 3.0f, a.data(), n );
+        AssertThat( c[20], Equals( 31.0f ) );
+        kernels::add( a.data(), a.data(), a.data(), n );
+        AssertThat( a[36], Equals( 52.0f ) );
+      } );
+      it( "computes double kernels", [&]()
+      {
+        const size_t n = 11;
+        std::vector<double> a( n, 1.5 ), b( n, -4.0 ), dst( n );
+        kernels::axpy( b.data() + 1, 2.0, a.data(), n - 1 );
+        AssertThat( b[0], Equals( -4.0 ) );
+        AssertThat( b[10], Equals( -1.0 ) );
+        kernels::clamp( dst.data(), b.data(), -2.0, 0.0, n );
+        AssertThat( dst[0], Equals( -2.0 ) );
+        AssertThat( dst[5], Equals( -1.0 ) );
+      } );
+      it( "streams large outputs correctly", [&]()
+      {
+        const size_t n = kernels::nontemporalThreshold / sizeof( float ) + 13;
+        std::vector<float> a( n, 1.0f ), dst( n + 1, 0.0f );
+        kernels::scale( dst.data(), a.data(), 3.0f, n );
+        AssertThat( dst[0], Equals( 3.0f ) );
+        AssertThat( dst[n / 2], Equals( 3.0f ) );
+        AssertThat( dst[n - 1], Equals( 3.0f ) );
+        AssertThat( dst[n], Equals( 0.0f ) );
+      } );
+    } );
+
+    // REDUCTIONS -------------------------------------------------------------
+    describe( "reductions", []()
+    {
+      it( "sums every length exactly", [&]()
+      {
+        std::vector<float> f( 300 );
+        std::vector<double> d( 300 );
+        for ( size_t i = 0; i < f.size(); ++i )
+        {
+          f[i] = static_cast<float>( i + 1 );
+          d[i] = static_cast<double>( i + 1 );
+        }
+        for ( size_t n = 0; n < f.size(); ++n )
+        {
+          const float expected = static_cast<float>( n * ( n + 1 ) / 2 );
+          AssertThat( kernels::sum( f.data(), n ), Equals( expected ) );
+          AssertThat( kernels::sum<kernels::accumulate::compensated>( f.data(), n ), Equals( expected ) );
+          AssertThat( kernels::sum<kernels::accumulate::wide>( f.data(), n ), Equals( static_cast<double>( expected ) ) );
+          AssertThat( kernels::sum( d.data() + 1, n ), Equals( static_cast<double>( n * ( n + 3 ) / 2 ) ) );
+        }
+      } );
+      it( "compensates rounding error", [&]()
+      {
+        // 1 followed by many values each below half an ulp of 1
+        const size_t n = 1 << 16;
+        std::vector<float> f( n, 1e-8f );
+        f[0] = 1.0f;
+        const double exact = 1.0 + ( n - 1 ) * static_cast<double>( 1e-8f );
+        AssertThat( kernels::sum<kernels::accumulate::compensated>( f.data(), n ), EqualsWithDelta( exact, 1.2e-7 ) );
+        AssertThat( kernels::sum<kernels::accumulate::wide>( f.data(), n ), EqualsWithDelta( exact, 1e-12 ) );
+        std::vector<double> d( n, 1e-17 );
+        d[0] = 1.0;
+        AssertThat( kernels::sum<kernels::accumulate::compensated>( d.data(), n ), EqualsWithDelta( 1.0 + ( n - 1 ) * 1e-17, 2.3e-16 ) );
+      } );
+      it( "computes dot products & norms", [&]()
+      {
+        const size_t n = 37;
+        std::vector<float> a( n ), b( n, 2.0f );
+        for ( size_t i = 0; i < n; ++i )
+          a[i] = static_cast<float>( i ) - 18.0f;
+        AssertThat( kernels::dot( a.data(), b.data(), n ), Equals( 0.0f ) );
+        AssertThat( kernels::dot<kernels::accumulate::compensated>( a.data(), a.data(), n ), Equals( 4218.0f ) );
+        AssertThat( kernels::dot<kernels::accumulate::wide>( a.data(), b.data() + 1, n - 1 ), Equals( -36.0 ) );
+        const double d[5] = { 3.0, 4.0, 0.0, 12.0, 0.0 };
+        AssertThat( kernels::l2norm( d, 5 ), Equals( 13.0 ) );
+        AssertThat( kernels::l2norm<kernels::accumulate::wide>( b.data(), 4 ), Equals( 4.0 ) );
+      } );
+      it( "finds min, max & argmax skipping NaNs", [&]()
+      {
+        std::vector<float> f( 100 );
+        for ( size_t i = 0; i < f.size(); ++i )
+          f[i] = static_cast<float>( ( i * 37 ) % 101 ) - 50.0f;
+        f[3] = NAN;
+        float lo, hi;
+        for ( size_t n = 5; n < f.size(); n += 7 )
+        {
+          kernels::minmax( f.data(), n, lo, hi );
+          float elo = INFINITY, ehi = -INFINITY;
+          size_t at = 0;
+          for ( size_t i = 0; i < n; ++i )
+          {
+            if ( f[i] < elo )
+              elo = f[i];
+            if ( f[i] > ehi )
+            {
+              ehi = f[i];
+              at = i;
+            }
+          }
+          AssertThat( lo, Equals( elo ) );
+          AssertThat( hi, Equals( ehi ) );
+          AssertThat( kernels::argmax( f.data(), n ), Equals( at ) );
+        }
+        kernels::minmax( f.data() + 3, 1, lo, hi );
+        AssertThat( std::isinf( lo ) && lo > 0.0f, Is().True() );
+        AssertThat( std::isinf( hi ) && hi < 0.0f, Is().True() );
+        AssertThat( kernels::argmax( f.data() + 3, 1 ), Equals( 1u ) );
+        // a zero maximum mustn't be found in the zeroed lanes past the tail
+        const double d[3] = { -1.0, -2.0, 0.0 };
+        AssertThat( kernels::argmax( d, 2 ), Equals( 0u ) );
+        AssertThat( kernels::argmax( d, 3 ), Equals( 2u ) );
+        // first occurrence wins, across blocks too
+        std::vector<double> big( 10000, 1.0 );
+        big[5000] = 2.0;
+        big[9000] = 2.0;
+        AssertThat( kernels::argmax( big.data(), big.size() ), Equals( 5000u ) );
+      } );
+    } );
+
+    // MEMORY -----------------------------------------------------------------
+    describe( "memory", []()
+    {
+      it( "aligns vectors of vector types", [&]()
+      {
+        for ( size_t n = 1; n < 20; ++n )
+        {
+          aligned_vector<vec8f> v( n, vec8f( 1.0f ) );
+          AssertThat( reinterpret_cast<uintptr_t>( v.data() ) % 32, Equals( 0u ) );
+          std::vector<float, aligned_allocator<float, 64>> f( n );
+          AssertThat( reinterpret_cast<uintptr_t>( f.data() ) % 64, Equals( 0u ) );
+        }
+      } );
+      it( "bumps, rewinds & resets an arena", [&]()
+      {
+        arena scratch( 256 );
+        float* a = scratch.allocate<float>( 3 );
+        double* b = scratch.allocate<double>( 5 );
+        AssertThat( reinterpret_cast<uintptr_t>( a ) % 32, Equals( 0u ) );
+        AssertThat( reinterpret_cast<uintptr_t>( b ) % 32, Equals( 0u ) );
+        AssertThat( reinterpret_cast<char*>( b ) - reinterpret_cast<char*>( a ), Equals( 32 ) );
+        const auto mark = scratch.marker();
+        AssertThat( scratch.allocate<float>( 41 ) == nullptr, Is().True() );
+        AssertThat( scratch.allocate<double>( 20 ) != nullptr, Is().True() );
+        AssertThat( scratch.used(), Equals( 256u ) );
+        scratch.rewind( mark );
+        AssertThat( scratch.used(), Equals( 96u ) );
+        scratch.reset();
+        AssertThat( scratch.allocate<float>( 1 ) == a, Is().True() );
+        scratch.reset();
+        arena_allocator<int> alloc( scratch );
+        std::vector<int, arena_allocator<int>> v( alloc );
+        v.assign( { 1, 2, 3 } );
+        AssertThat( scratch.used(), IsGreaterThan( 0u ) );
+        AssertThat( v[2], Equals( 3 ) );
+        // alignments past the block's own round the address, not the offset
+        struct alignas( 64 ) line {
+          float x[16];
+        };
+        arena wide( 4096 );
+        for ( size_t n = 1; n < 20; ++n )
+        {
+          wide.allocate<float>( n );
+          line* l = wide.allocate<line>( 1 );
+          AssertThat( reinterpret_cast<uintptr_t>( l ) % 64, Equals( 0u ) );
+          void* p = wide.allocate( 1, 128 );
+          AssertThat( reinterpret_cast<uintptr_t>( p ) % 128, Equals( 0u ) );
+        }
+      } );
+      it( "pads buffers with zeroes to whole vectors", [&]()
+      {
+        buffer<float> f( 13 );
+        AssertThat( f.size(), Equals( 13u ) );
+        AssertThat( f.padded(), Equals( 16u ) );
+        AssertThat( reinterpret_cast<uintptr_t>( f.data() ) % 32, Equals( 0u ) );
+        for ( auto& x : f )
+          x = 7.0f;
+        const float* storage = f.data();
+        f.resize( 2 );
+        AssertThat( f.data() == storage, Is().True() );
+        f.resize( 11 );
+        AssertThat( f[1], Equals( 7.0f ) );
+        for ( size_t i = 2; i < f.padded(); ++i )
+          AssertThat( f[i], Equals( 0.0f ) );
+        // whole vectors over the padded size, no tail handling
+        for ( size_t i = 0; i < f.padded(); i += 8 )
+          ( vec8f( f.data() + i ) + vec8f( 1.0f ) ).storeTemporal( f.data() + i );
+        AssertThat( f[10], Equals( 1.0f ) );
+        // those stores went into the padding too, which comes back as zero
+        f.resize( 16 );
+        for ( size_t i = 11; i < 16; ++i )
+          AssertThat( f[i], Equals( 0.0f ) );
+        f.resize( 11 );
+        for ( size_t i = 0; i < f.padded(); i += 8 )
+          ( vec8f( f.data() + i ) + vec8f( 1.0f ) ).storeTemporal( f.data() + i );
+        f.resize( 3 );
+        f.resize( 16 );
+        for ( size_t i = 3; i < 16; ++i )
+          AssertThat( f[i], Equals( 0.0f ) );
+        buffer<double> d( 5 );
+        d[4] = 2.0;
+        d.resize( 100 );
+        AssertThat( d[4], Equals( 2.0 ) );
+        AssertThat( d[99], Equals( 0.0 ) );
+        AssertThat( reinterpret_cast<uintptr_t>( d.data() ) % 32, Equals( 0u ) );
+        buffer<double> copy( d );
+        AssertThat( copy[4], Equals( 2.0 ) );
+      } );
+    } );
+
+    // PARALLEL ---------------------------------------------------------------
+    describe( "parallel", []()
+    {
+      it( "runs every chunk exactly once", [&]()
+      {
+        threadpool pool( 4 );
+        std::vector<std::atomic<int>> hits( 1000 );
+        for ( int round = 0; round < 20; ++round )
+        {
+          // uneven chunks so that stealing kicks in
+          parallel_for( pool, hits.size(), 7, [&]( size_t first, size_t last )
+          {
+            for ( size_t i = first; i < last; ++i )
+            {
+              if ( i % 97 == 0 )
+                std::this_thread::sleep_for( std::chrono::microseconds( 200 ) );
+              hits[i].fetch_add( 1 );
+            }
+          } );
+        }
+        for ( const auto& h : hits )
+          AssertThat( h.load(), Equals( 20 ) );
+        std::atomic<int> calls( 0 );
+        parallel_for( pool, 0, 16, [&]( size_t, size_t ) { ++calls; } );
+        AssertThat( calls.load(), Equals( 0 ) );
+        // a grain of 0 means ranges of one element
+        parallel_for( pool, 5, 0, [&]( size_t first, size_t last ) { calls += ( last - first == 1 ); } );
+        AssertThat( calls.load(), Equals( 5 ) );
+      } );
+      it( "matches the serial kernels", [&]()
+      {
+        threadpool pool( 3 );
+        const size_t n = kernels::parallelChunk / sizeof( float ) * 5 + 13;
+        std::vector<float> a( n ), b( n ), dst( n + 1 ), ref( n + 1 );
+        for ( size_t i = 0; i < n; ++i )
+        {
+          a[i] = static_cast<float>( i % 1000 );
+          b[i] = 0.5f;
+        }
+        kernels::firstTouch( pool, dst.data(), dst.size() );
+        kernels::fma( pool, dst.data() + 1, a.data(), b.data(), b.data(), n );
+        kernels::fma( ref.data() + 1, a.data(), b.data(), b.data(), n );
+        AssertThat( dst == ref, Is().True() );
+        kernels::axpy( pool, dst.data(), 2.0f, a.data(), n, kernels::stores::nontemporal );
+        kernels::axpy( ref.data(), 2.0f, a.data(), n, kernels::stores::temporal );
+        AssertThat( dst == ref, Is().True() );
+      } );
+      it( "reduces deterministically for any thread count", [&]()
+      {
+        const size_t n = kernels::parallelChunk / sizeof( float ) * 9 + 5;
+        std::vector<float> a( n );
+        for ( size_t i = 0; i < n; ++i )
+          a[i] = 1.0f / static_cast<float>( 1 + i % 4099 );
+        threadpool one( 1 );
+        const float s1 = kernels::sum( one, a.data(), n );
+        const float c1 = kernels::sum<kernels::accumulate::compensated>( one, a.data(), n );
+        const double d1 = kernels::dot<kernels::accumulate::wide>( one, a.data(), a.data(), n );
+        for ( size_t threads : { 2, 3, 8 } )
+        {
+          threadpool pool( threads );
+          AssertThat( kernels::sum( pool, a.data(), n ), Equals( s1 ) );
+          AssertThat( kernels::sum<kernels::accumulate::compensated>( pool, a.data(), n ), Equals( c1 ) );
+          AssertThat( kernels::dot<kernels::accumulate::wide>( pool, a.data(), a.data(), n ), Equals( d1 ) );
+        }
+        AssertThat( static_cast<double>( s1 ), EqualsWithDelta( kernels::sum<kernels::accumulate::wide>( a.data(), n ), 1e-2 ) );
+      } );
+    } );
   } );
 } );
 